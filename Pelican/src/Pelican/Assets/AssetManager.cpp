@@ -3,15 +3,22 @@
 
 #include <logtools.h>
 
+#include "Pelican/Core/Profiler.h"
+
 #include "imgui.h"
 
 #include "BaseAsset.h"
+#include "Pelican/Renderer/Model.h"
+#include "Pelican/Renderer/TextureStreamer.h"
+#include "Pelican/Renderer/VulkanRenderer.h"
 #include "Pelican/Renderer/VulkanTexture.h"
 
 namespace Pelican
 {
 	VulkanTexture* AssetManager::LoadTexture(const std::string& filePath, VulkanTexture::TextureMode textureMode)
 	{
+		PELICAN_PROFILE_FUNCTION();
+
 		const bool bAssetExists = m_TextureMap.find(filePath) != m_TextureMap.end();
 
 		// If it already exists, simply up the refCount and return the pointer
@@ -48,21 +55,85 @@ namespace Pelican
 		delete pAsset; // Releases the texture from GPU memory.
 	}
 
+	Model* AssetManager::LoadModel(const std::string& filePath)
+	{
+		PELICAN_PROFILE_FUNCTION();
+
+		const auto it = m_ModelMap.find(filePath);
+		if (it != m_ModelMap.end())
+		{
+			it->second.refCount += 1;
+			return it->second.pAsset;
+		}
+
+		Model* pModel = new Model(filePath); // Imports the model and uploads its meshes.
+		m_ModelMap[filePath] = AssetReference<Model>{ pModel, 1 };
+		return pModel;
+	}
+
+	void AssetManager::UnloadModel(Model* pAsset)
+	{
+		const auto it = m_ModelMap.find(pAsset->GetAssetPath());
+		if (it == m_ModelMap.end())
+		{
+			Logger::LogWarning("Tried to unload model \"%s\", which isn't loaded", pAsset->GetAssetPath().c_str());
+			return;
+		}
+
+		if (it->second.refCount > 1)
+		{
+			it->second.refCount -= 1;
+			return;
+		}
+
+		// Removed before deleting, the model unloads its textures through the asset manager as well.
+		m_ModelMap.erase(it);
+		delete pAsset;
+	}
+
 	void AssetManager::DebugDraw() const
 	{
 		if (ImGui::Begin("Asset Manager"))
 		{
 			ImGui::Text("Total assest loaded: %d", m_TextureMap.size());
+			ImGui::Text("Models loaded: %d", static_cast<int>(m_ModelMap.size()));
+			for (const auto& it : m_ModelMap)
+			{
+				ImGui::BulletText("%s (%d users)", it.first.c_str(), it.second.refCount);
+			}
 			ImGui::Spacing();
 			ImGui::Spacing();
+
+			// Mips are counted from the full size texture, a lower mip has more detail.
+			TextureStreamer* pStreamer = VulkanRenderer::GetTextureStreamer();
+			constexpr float mib = 1024.0f * 1024.0f;
+			ImGui::Text("Streamed textures: %u (%u loading)", pStreamer->GetTextureCount(), pStreamer->GetLoadCount());
+			int budget = static_cast<int>(pStreamer->GetBudget() / (1024 * 1024));
+			if (ImGui::SliderInt("Budget (MiB)", &budget, 16, 4096))
+			{
+				pStreamer->SetBudget(static_cast<vk::DeviceSize>(budget) * 1024 * 1024);
+			}
+			ImGui::ProgressBar(static_cast<float>(pStreamer->GetResidentSize()) / static_cast<float>(pStreamer->GetBudget()), ImVec2(-1.0f, 0.0f));
+			ImGui::Text("Resident: %.1f / %.1f MiB", static_cast<float>(pStreamer->GetResidentSize()) / mib,
+				static_cast<float>(pStreamer->GetBudget()) / mib);
 			ImGui::Spacing();
 			ImGui::Spacing();
 			ImGui::Separator();
 
 			for (auto& it : m_TextureMap)
 			{
-				ImGui::Text("Hash: %d", it.second.pAsset->GetHash());
-				ImGui::Text("Path: %s", it.second.pAsset->GetAssetPath().string().c_str());
+				const VulkanTexture* pTexture = it.second.pAsset;
+				ImGui::Text("Hash: %d", pTexture->GetHash());
+				ImGui::Text("Path: %s", pTexture->GetAssetPath().string().c_str());
+				ImGui::Text("Status: %s", pTexture->IsReady() ? (pTexture->IsStreaming() ? "Streaming" : "Ready") : "Uploading");
+				if (pTexture->IsStreamed())
+				{
+					const uint32_t requestedMip = pStreamer->GetRequestedMip(pTexture);
+					const uint32_t targetMip = pStreamer->GetTargetMip(pTexture);
+					ImGui::Text("Mips: resident %u, requested %s, target %u of %u", pTexture->GetResidentMip(),
+						requestedMip != ~0u ? std::to_string(requestedMip).c_str() : "-", targetMip, pTexture->GetMipCount());
+				}
+				ImGui::Text("Memory: %.2f MiB", static_cast<float>(pTexture->GetMemorySize()) / mib);
 				ImGui::Separator();
 			}
 		}
@@ -5,6 +5,7 @@ namespace Pelican
 {
 	class VulkanTexture;
 	class BaseAsset;
+	class Model;
 
 	// Simple reference-counted wrapper around a BaseAsset.
 	// Basically a smart pointer, but I can't control what happens when the pointer goes invalid.
@@ -16,6 +17,7 @@ namespace Pelican
 	};
 
 	using TextureMap = std::unordered_map<std::string, AssetReference<VulkanTexture>>;
+	using ModelMap = std::unordered_map<std::string, AssetReference<Model>>;
 
 	class AssetManager
 	{
@@ -30,9 +32,14 @@ namespace Pelican
 		VulkanTexture* LoadTexture(const std::string& filePath, VulkanTexture::TextureMode textureMode = VulkanTexture::TextureMode::Texture2d);
 		void UnloadTexture(VulkanTexture* pAsset);
 
+		// Entities using the same asset share one Model, which is what lets the scene draw them instanced.
+		Model* LoadModel(const std::string& filePath);
+		void UnloadModel(Model* pAsset);
+
 		void DebugDraw() const;
 
 	private:
 		TextureMap m_TextureMap;
+		ModelMap m_ModelMap;
 	};
 }
@@ -0,0 +1,100 @@
+﻿#include "PelicanPCH.h"
+#include "TextureCooker.h"
+
+#include <chrono>
+#include <logtools.h>
+#include <stb_image.h>
+
+#include "Pelican/Renderer/Ktx2File.h"
+#include "Pelican/Renderer/MipGenerator.h"
+#include "Pelican/Renderer/TextureFormat.h"
+
+namespace Pelican
+{
+	TextureCooker::TextureCooker(ThreadPool* pThreadPool)
+		: m_pThreadPool(pThreadPool)
+	{
+	}
+
+	bool TextureCooker::Cook(const std::filesystem::path& source, const std::filesystem::path& destination, const Params& params) const
+	{
+		const auto startTime = std::chrono::high_resolution_clock::now();
+
+		const bool isHdr = stbi_is_hdr(source.string().c_str());
+		vk::Format format = params.format;
+		if (format == vk::Format::eUndefined)
+		{
+			format = isHdr ? vk::Format::eBc6HUfloatBlock : vk::Format::eBc7SrgbBlock;
+		}
+		if (!BcEncoder::CanEncode(format))
+		{
+			Logger::LogError("Failed to cook \"%s\", %s can't be encoded", source.string().c_str(), vk::to_string(format).c_str());
+			return false;
+		}
+
+		// BC6H is encoded from floats, everything else from RGBA8. stb converts between the two when the source is the other kind.
+		const bool encodeFloats = format == vk::Format::eBc6HUfloatBlock;
+		int width, height, channelCount;
+		void* pPixels = encodeFloats
+			? static_cast<void*>(stbi_loadf(source.string().c_str(), &width, &height, &channelCount, STBI_rgb_alpha))
+			: static_cast<void*>(stbi_load(source.string().c_str(), &width, &height, &channelCount, STBI_rgb_alpha));
+		if (!pPixels)
+		{
+			Logger::LogError("Failed to load \"%s\": %s", source.string().c_str(), stbi_failure_reason());
+			return false;
+		}
+
+		const uint32_t levelCount = params.generateMips ? MipGenerator::GetMipCount(width, height) : 1;
+		Ktx2File file(format, static_cast<uint32_t>(width), static_cast<uint32_t>(height), 1, levelCount);
+
+		// Every level is downsampled from the one before it, two buffers get swapped between the levels.
+		// sRGB targets get filtered in linear space, or the smaller mips end up too dark.
+		const bool srgb = TextureFormat::IsSrgb(format);
+		const size_t texelSize = encodeFloats ? sizeof(float) * 4 : 4;
+		std::vector<uint8_t> level(static_cast<size_t>(width) * height * texelSize);
+		std::vector<uint8_t> nextLevel{};
+		memcpy(level.data(), pPixels, level.size());
+		stbi_image_free(pPixels);
+
+		for (uint32_t i = 0; i < levelCount; i++)
+		{
+			const uint32_t levelWidth = file.GetLevelWidth(i);
+			const uint32_t levelHeight = file.GetLevelHeight(i);
+			BcEncoder::EncodeImage(format, level.data(), levelWidth, levelHeight, file.GetImageData(i, 0, 0), params.quality, m_pThreadPool);
+
+			if (i + 1 == levelCount)
+				break;
+
+			nextLevel.resize(static_cast<size_t>(file.GetLevelWidth(i + 1)) * file.GetLevelHeight(i + 1) * texelSize);
+			if (encodeFloats)
+			{
+				MipGenerator::DownsampleRgba32f(reinterpret_cast<const float*>(level.data()), levelWidth, levelHeight,
+					reinterpret_cast<float*>(nextLevel.data()));
+			}
+			else if (srgb)
+			{
+				MipGenerator::DownsampleSrgba8(level.data(), levelWidth, levelHeight, nextLevel.data());
+			}
+			else
+			{
+				MipGenerator::DownsampleRgba8(level.data(), levelWidth, levelHeight, nextLevel.data());
+			}
+			std::swap(level, nextLevel);
+		}
+
+		if (!file.Save(destination))
+			return false;
+
+		const auto endTime = std::chrono::high_resolution_clock::now();
+		Logger::LogInfo("Cooked \"%s\" into %s with %u mips in %.1fms", source.string().c_str(), vk::to_string(format).c_str(), levelCount,
+			std::chrono::duration<float, std::milli>(endTime - startTime).count());
+		return true;
+	}
+
+	std::filesystem::path TextureCooker::GetCookedPath(const std::filesystem::path& source)
+	{
+		std::filesystem::path cookedPath = source;
+		cookedPath.replace_extension(".ktx2");
+		return cookedPath;
+	}
+}
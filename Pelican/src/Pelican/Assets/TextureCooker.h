@@ -0,0 +1,34 @@
+﻿#pragma once
+#include <vulkan/vulkan.hpp>
+
+#include "Pelican/Renderer/BcEncoder.h"
+
+namespace Pelican
+{
+	class ThreadPool;
+
+	// Turns source images into block compressed KTX2 files with all their mips, which VulkanTexture uploads without any processing.
+	class TextureCooker final
+	{
+	public:
+		struct Params
+		{
+			// eUndefined picks BC6H for HDR sources and BC7 sRGB for everything else.
+			vk::Format format{ vk::Format::eUndefined };
+			BcEncoder::Quality quality{ BcEncoder::Quality::Normal };
+			bool generateMips{ true };
+		};
+
+		// Blocks get encoded on the thread pool when one is given.
+		explicit TextureCooker(ThreadPool* pThreadPool = nullptr);
+
+		// Logs why and returns false when the source can't be loaded or the destination can't be written.
+		bool Cook(const std::filesystem::path& source, const std::filesystem::path& destination, const Params& params) const;
+
+		// Where the cooked version of a source texture lives, Model picks it up from there.
+		[[nodiscard]] static std::filesystem::path GetCookedPath(const std::filesystem::path& source);
+
+	private:
+		ThreadPool* m_pThreadPool;
+	};
+}
@@ -1,19 +1,24 @@
 ﻿#include "PelicanPCH.h"
 #include "Application.h"
 
+#include "Pelican/Core/Profiler.h"
 #include "Pelican/Core/Time.h"
 #include "Pelican/Input/Input.h"
 #include "Pelican/Renderer/Camera.h"
+#include "Pelican/Renderer/FrustumCuller.h"
 #include "Pelican/Renderer/Mesh.h"
 #include "Pelican/Renderer/Model.h"
 #include "Pelican/Renderer/ImGui/ImGuiWrapper.h"
 #include "Pelican/Scene/Scene.h"
 
 #include <thread>
+#include <charconv>
+#include <cmath>
 #include <logtools.h>
 #include <filesystem>
 
 #include <imgui.h>
+#include <misc/cpp/imgui_stdlib.h>
 
 #include "Layer.h"
 #include "Pelican/Events/ApplicationEvent.h"
@@ -22,7 +27,79 @@ namespace Pelican
 {
 	Application* Application::m_Instance = nullptr;
 
+	bool ApplicationCommandLineArgs::HasFlag(const char* flag) const
+	{
+		for (int i = 1; i < count; i++)
+		{
+			if (strcmp(args[i], flag) == 0)
+				return true;
+		}
+
+		return false;
+	}
+
+	std::string ApplicationCommandLineArgs::GetOption(const char* option, const std::string& defaultValue) const
+	{
+		for (int i = 1; i < count - 1; i++)
+		{
+			if (strcmp(args[i], option) == 0)
+				return args[i + 1];
+		}
+
+		return defaultValue;
+	}
+
+	namespace
+	{
+		// Unlike the sto* functions this doesn't throw, and the whole argument has to be the number.
+		template<typename T>
+		bool ParseNumber(const ApplicationCommandLineArgs& args, const char* option, T& value)
+		{
+			const std::string text = args.GetOption(option);
+			if (text.empty())
+				return !args.HasFlag(option);
+
+			T parsed{};
+			const auto [pEnd, error] = std::from_chars(text.data(), text.data() + text.size(), parsed);
+			bool valid = error == std::errc{} && pEnd == text.data() + text.size();
+			if constexpr (std::is_floating_point_v<T>)
+			{
+				valid = valid && std::isfinite(parsed);
+			}
+
+			if (!valid)
+			{
+				std::cerr << "Invalid value \"" << text << "\" for " << option << "\n";
+				return false;
+			}
+
+			value = parsed;
+			return true;
+		}
+	}
+
+	bool ApplicationCommandLineArgs::ParseOption(const char* option, uint32_t& value) const
+	{
+		return ParseNumber(*this, option, value);
+	}
+
+	bool ApplicationCommandLineArgs::ParseOption(const char* option, int& value) const
+	{
+		return ParseNumber(*this, option, value);
+	}
+
+	bool ApplicationCommandLineArgs::ParseOption(const char* option, float& value) const
+	{
+		return ParseNumber(*this, option, value);
+	}
+
 	Application::Application()
+		: Application(Params{})
+	{
+	}
+
+	Application::Application(const Params& params)
+		: m_Params(params)
 	{
 		if (m_Instance)
 		{
@@ -78,22 +155,57 @@ namespace Pelican
 		return false;
 	}
 
+	void Application::Close()
+	{
+		m_pWindow->Close();
+	}
+
 	void Application::Run()
 	{
+		if (m_Params.benchmarkCulling)
+		{
+			Logger::Init();
+			Logger::Configure({ true, true });
+			FrustumCuller::RunBenchmark();
+			return;
+		}
+
+		Profiler::SetThreadName("Main");
+
 		Init();
 
 		LoadScene(m_pScene);
 
-		auto t = std::chrono::high_resolution_clock::now();
+		if (!m_Params.playCameraPath.empty())
+		{
+			try
+			{
+				CameraPath path;
+				path.LoadFromFile(m_Params.playCameraPath);
+				m_CameraRecorder.StartPlayback(path, m_Params.cameraTimestep, m_Params.loopCameraPlayback);
+			}
+			catch (const std::exception& e)
+			{
+				Logger::LogError("%s", e.what());
+			}
+		}
+		else if (!m_Params.recordCameraPath.empty())
+		{
+			m_CameraRecorder.StartRecording();
+		}
+
 		auto lastTime = std::chrono::high_resolution_clock::now();
 		while (!m_pWindow->ShouldClose())
 		{
+			Profiler::BeginFrame();
+
 			const auto currentTime = std::chrono::high_resolution_clock::now();
 			Time::Update(lastTime);
 			lastTime = currentTime;
 
 			m_pWindow->Update();
 			m_pCamera->Update();
+			m_CameraRecorder.Update(m_pCamera);
 
 			// Update scene
 			{
@@ -106,6 +218,11 @@ namespace Pelican
 			if (!m_pRenderer->BeginScene())
 				continue;
 
+			if (!m_Params.capturePath.empty() && m_FrameCount == m_Params.captureFrame)
+			{
+				VulkanRenderer::GetFrameCapture()->RequestCapture(m_Params.capturePath);
+			}
+
 			// Draw scene
 			{
 				m_pScene->Draw(m_pCamera);
@@ -149,13 +266,118 @@ namespace Pelican
 						ImGui::RadioButton("Points", &mode, static_cast<int>(RenderMode::Points));
 						m_RenderMode = static_cast<RenderMode>(mode);
 					}
+
+					if (ImGui::CollapsingHeader("Depth Prepass"))
+					{
+						// Compare the total with the prepass on and off, it only pays off when it saves more shading than it costs.
+						bool enabled = VulkanRenderer::IsDepthPrepassEnabled();
+						if (ImGui::Checkbox("Enabled##DepthPrepass", &enabled))
+						{
+							VulkanRenderer::SetDepthPrepassEnabled(enabled);
+						}
+						if (m_RenderMode != RenderMode::Filled)
+						{
+							ImGui::Text("Only used when rendering solid");
+						}
+
+						const GpuProfiler* pGpuProfiler = VulkanRenderer::GetGpuProfiler();
+						const float prepassTime = pGpuProfiler->GetRegionTime("Depth Prepass");
+						const float sceneTime = pGpuProfiler->GetRegionTime("Scene Render");
+						ImGui::Text("Prepass: %.3fms", prepassTime);
+						ImGui::Text("Scene: %.3fms", sceneTime);
+						ImGui::Text("Total: %.3fms", prepassTime + sceneTime);
+					}
+
+					if (ImGui::CollapsingHeader("Uniform Ring"))
+					{
+						const VulkanUniformRing* pUniformRing = VulkanRenderer::GetUniformRing();
+						ImGui::Text("Used this frame: %.1f KiB", static_cast<float>(pUniformRing->GetUsedBytes()) / 1024.0f);
+						ImGui::Text("Peak: %.1f KiB", static_cast<float>(pUniformRing->GetPeakUsedBytes()) / 1024.0f);
+						ImGui::Text("Frame size: %.1f KiB", static_cast<float>(pUniformRing->GetFrameSize()) / 1024.0f);
+					}
+
+					if (ImGui::CollapsingHeader("Descriptors"))
+					{
+						const DescriptorStats& stats = VulkanRenderer::GetDescriptorStats();
+						ImGui::Text("Writes this frame: %u", stats.writes.load());
+						ImGui::Text("Binds: %u (%u redundant skipped)", stats.binds.load(), stats.skippedBinds.load());
+						ImGui::Text("Persistent pools: %u (%u sets)", VulkanRenderer::GetDescriptorAllocator()->GetPoolCount(),
+							VulkanRenderer::GetDescriptorAllocator()->GetAllocatedSetCount());
+						ImGui::Text("Frame pools: %u (%u sets)", VulkanRenderer::GetFrameDescriptorAllocator()->GetPoolCount(),
+							VulkanRenderer::GetFrameDescriptorAllocator()->GetAllocatedSetCount());
+					}
+
+					if (ImGui::CollapsingHeader("Geometry Arena"))
+					{
+						const OffsetAllocatorStats vertexStats = VulkanRenderer::GetGeometryArena()->GetVertexStats();
+						const OffsetAllocatorStats indexStats = VulkanRenderer::GetGeometryArena()->GetIndexStats();
+						ImGui::Text("Vertices: %llu / %llu (fragmentation %.2f)", static_cast<unsigned long long>(vertexStats.usedSize), static_cast<unsigned long long>(vertexStats.totalSize), vertexStats.GetFragmentation());
+						ImGui::Text("Indices: %llu / %llu (fragmentation %.2f)", static_cast<unsigned long long>(indexStats.usedSize), static_cast<unsigned long long>(indexStats.totalSize), indexStats.GetFragmentation());
+						ImGui::Text("Meshes: %u", vertexStats.allocationCount);
+					}
+
+					if (ImGui::CollapsingHeader("GPU Culling"))
+					{
+						VulkanCullingPass* pCullingPass = VulkanRenderer::GetCullingPass();
+						bool enabled = pCullingPass->IsEnabled();
+						ImGui::Checkbox("Enabled", &enabled);
+						pCullingPass->SetEnabled(enabled);
+						ImGui::Text("Mode: %s", pCullingPass->IsCompacting() ? "compacted, draw indirect count" : "in place, culled draws have no instances");
+						ImGui::Text("Visible: %u, culled: %u", pCullingPass->GetVisibleCount(), pCullingPass->GetCulledCount());
+						ImGui::Text("Max draws: %u", pCullingPass->GetMaxDraws());
+					}
+
+					if (ImGui::CollapsingHeader("Bindless Table"))
+					{
+						const VulkanBindlessTable* pBindlessTable = VulkanRenderer::GetBindlessTable();
+						ImGui::Text("Textures: %u / %u", pBindlessTable->GetTextureCount(), pBindlessTable->GetTextureCapacity());
+						ImGui::Text("Cubemaps: %u / %u", pBindlessTable->GetCubemapCount(), VulkanBindlessTable::MAX_CUBEMAPS);
+						ImGui::Text("Materials: %u / %u", pBindlessTable->GetMaterialCount(), VulkanBindlessTable::MAX_MATERIALS);
+					}
+
+					if (ImGui::CollapsingHeader("Frame Capture"))
+					{
+						VulkanFrameCapture* pFrameCapture = VulkanRenderer::GetFrameCapture();
+						ImGui::InputText("File", &m_UiCapturePath);
+						ImGui::Checkbox("Include debug UI", &m_UiCaptureIncludesUi);
+						if (ImGui::Button("Capture") && !m_UiCapturePath.empty())
+						{
+							pFrameCapture->RequestCapture(m_UiCapturePath, m_UiCaptureIncludesUi);
+						}
+						ImGui::Text("Pending: %u, written: %u", pFrameCapture->GetPendingCount(), pFrameCapture->GetWrittenCount());
+					}
 				}
 				ImGui::End();
+
+				VulkanRenderer::GetAllocator()->DebugDraw();
+				VulkanRenderer::GetGpuProfiler()->DebugDraw();
+				Profiler::DebugDraw();
+				m_CameraRecorder.DebugDraw();
 			}
 
 			m_pRenderer->EndScene();
 
 			Input::Update();
+
+			m_FrameCount++;
+			if (m_Params.maxFrames > 0 && m_FrameCount >= m_Params.maxFrames)
+			{
+				Logger::LogInfo("Rendered %u frames, closing the application.", m_FrameCount);
+				Close();
+			}
+		}
+
+		if (!m_Params.recordCameraPath.empty() && m_CameraRecorder.GetState() == CameraRecorder::State::Recording)
+		{
+			try
+			{
+				m_CameraRecorder.GetRecording().SaveToFile(m_Params.recordCameraPath);
+				Logger::LogInfo("Saved %u camera frames to %s", m_CameraRecorder.GetFrame(), m_Params.recordCameraPath.c_str());
+			}
+			catch (const std::exception& e)
+			{
+				Logger::LogError("%s", e.what());
+			}
 		}
 
 		Cleanup();
@@ -166,7 +388,8 @@ namespace Pelican
 		Logger::Init();
 		Logger::Configure({ true, true });
 
-		m_pWindow = new Window(Window::Params{ 1600, 900, "Sandbox", true });
+		m_pThreadPool = new ThreadPool();
+		m_pWindow = new Window(Window::Params{ m_Params.width, m_Params.height, m_Params.name, true, m_Params.headless });
 		m_pRenderer = new VulkanRenderer();
 		m_pCamera = new Camera(120.0f,
 			static_cast<float>(m_pWindow->GetParams().width),
@@ -177,7 +400,7 @@ namespace Pelican
 		m_pWindow->Init();
 		m_pWindow->SetEventCallback(BIND_EVENT_FN(Application::OnEvent));
 		Input::Init(m_pWindow->GetGLFWWindow());
-		m_pRenderer->Initialize();
+		m_pRenderer->Initialize(m_Params.headless);
 
 		m_pScene = new Scene();
 	}
@@ -194,10 +417,12 @@ namespace Pelican
 		delete m_pCamera;
 		delete m_pRenderer;
 		delete m_pWindow;
+		delete m_pThreadPool;
 
 		m_pScene = nullptr;
 		m_pCamera = nullptr;
 		m_pRenderer = nullptr;
 		m_pWindow = nullptr;
+		m_pThreadPool = nullptr;
 	}
 }
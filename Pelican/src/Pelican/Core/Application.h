@@ -1,10 +1,12 @@
 ﻿#pragma once
 #include "Window.h"
 #include "LayerStack.h"
+#include "ThreadPool.h"
 
 #include "Pelican/Events/ApplicationEvent.h"
 #include "Pelican/Events/Event.h"
 
+#include "Pelican/Renderer/CameraRecorder.h"
 #include "Pelican/Renderer/VulkanRenderer.h"
 
 namespace Pelican
@@ -14,10 +16,59 @@ namespace Pelican
 	class Model;
 	class ImGuiWrapper;
 
+	struct ApplicationCommandLineArgs
+	{
+		int count = 0;
+		char** args = nullptr;
+
+		const char* operator[](int index) const
+		{
+			ASSERT(index < count);
+			return args[index];
+		}
+
+		// Returns true when the given flag (e.g. "--headless") was passed on the command line.
+		[[nodiscard]] bool HasFlag(const char* flag) const;
+		// Returns the argument following the given option, or the default value if the option was not passed.
+		[[nodiscard]] std::string GetOption(const char* option, const std::string& defaultValue = "") const;
+		// Parses the argument following the given option into value, which is left alone if the option was not passed.
+		// Returns false and prints an error when the argument isn't a valid number.
+		[[nodiscard]] bool ParseOption(const char* option, uint32_t& value) const;
+		[[nodiscard]] bool ParseOption(const char* option, int& value) const;
+		[[nodiscard]] bool ParseOption(const char* option, float& value) const;
+	};
+
 	class Application
 	{
 	public:
+		struct Params
+		{
+			std::string name = "Sandbox";
+			int width = 1600;
+			int height = 900;
+
+			// Headless mode doesn't open a window, and renders into offscreen images instead of a swap chain.
+			// This allows the renderer to run on machines without a display, and on software Vulkan implementations.
+			bool headless = false;
+			// Amount of frames to render before closing automatically. 0 means run until the window is closed.
+			uint32_t maxFrames = 0;
+			// Only runs the CPU frustum culling benchmark and returns, without creating a window or renderer.
+			bool benchmarkCulling = false;
+
+			// Records the camera every frame and writes it to this file when the application closes.
+			std::string recordCameraPath{};
+			// Replays this recording or camera path instead of following input, moving a fixed timestep every frame.
+			std::string playCameraPath{};
+			float cameraTimestep = CameraRecorder::DEFAULT_TIMESTEP;
+			bool loopCameraPlayback = false;
+
+			// Writes frame captureFrame to this PNG, without the debug UI.
+			std::string capturePath{};
+			uint32_t captureFrame = 0;
+		};
+
 		Application();
+		explicit Application(const Params& params);
 		virtual ~Application() = default;
 
 		void OnEvent(Event& e);
@@ -29,6 +80,7 @@ namespace Pelican
 		bool OnWindowResize(WindowResizeEvent& e);
 
 		virtual void Run() final;
+		void Close();
 
 		virtual void LoadScene(Scene* /*pScene*/) {}
 
@@ -38,6 +90,14 @@ namespace Pelican
 		static Application& Get() { return *m_Instance; }
 		Scene* GetScene() const { return m_pScene; }
 		Camera* GetCamera() const { return m_pCamera; }
+		ThreadPool* GetThreadPool() const { return m_pThreadPool; }
+		CameraRecorder& GetCameraRecorder() { return m_CameraRecorder; }
+		const Params& GetParams() const { return m_Params; }
+		bool IsHeadless() const { return m_Params.headless; }
+		uint32_t GetFrameCount() const { return m_FrameCount; }
+		// Returned from main once the application closes, tools set this to report failures.
+		int GetExitCode() const { return m_ExitCode; }
+		void SetExitCode(int exitCode) { m_ExitCode = exitCode; }
 
 	public:
 		RenderMode m_RenderMode = RenderMode::Filled;
@@ -47,15 +107,25 @@ namespace Pelican
 		void Cleanup();
 
 	private:
+		Params m_Params;
+		uint32_t m_FrameCount{};
+		int m_ExitCode{};
+
 		Window* m_pWindow{};
 		VulkanRenderer* m_pRenderer{};
 		Scene* m_pScene{};
 		Camera* m_pCamera{};
+		ThreadPool* m_pThreadPool{};
 
 		LayerStack m_LayerStack;
+		CameraRecorder m_CameraRecorder;
+
+		// Settings of the capture button in the debug UI.
+		std::string m_UiCapturePath{ "capture.png" };
+		bool m_UiCaptureIncludesUi{};
 
 		static Application* m_Instance;
 	};
 
-	Application* CreateApplication();
+	Application* CreateApplication(ApplicationCommandLineArgs args);
 }
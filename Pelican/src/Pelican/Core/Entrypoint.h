@@ -1,11 +1,17 @@
 #pragma once
 #include "Application.h"
 
-int main(int, char**)
+int main(int argc, char** argv)
 {
-	Pelican::Application* app = Pelican::CreateApplication();
+	// CreateApplication returns nullptr when the command line is invalid.
+	Pelican::Application* app = Pelican::CreateApplication({ argc, argv });
+	if (!app)
+		return 2;
 
 	app->Run();
 
+	const int exitCode = app->GetExitCode();
 	delete app;
+
+	return exitCode;
 }
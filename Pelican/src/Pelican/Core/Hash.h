@@ -0,0 +1,13 @@
+﻿#pragma once
+
+#include <functional>
+
+namespace Pelican
+{
+	// Same mixing as boost::hash_combine.
+	template<typename T>
+	void HashCombine(size_t& seed, const T& value)
+	{
+		seed ^= std::hash<T>()(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+	}
+}
@@ -0,0 +1,315 @@
+﻿#include "PelicanPCH.h"
+#include "Profiler.h"
+
+#include <fstream>
+
+#include <imgui.h>
+#include <misc/cpp/imgui_stdlib.h>
+#include <logtools.h>
+
+namespace Pelican
+{
+	const std::chrono::steady_clock::time_point Profiler::m_StartTime = std::chrono::steady_clock::now();
+
+	std::mutex Profiler::m_ThreadMutex{};
+	std::vector<std::unique_ptr<Profiler::ThreadBuffer>> Profiler::m_Threads{};
+
+	std::vector<Profiler::Zone> Profiler::m_FrameZones{};
+	uint64_t Profiler::m_FrameStart{};
+	uint64_t Profiler::m_FrameEnd{};
+	uint64_t Profiler::m_CurrentFrameStart{};
+	bool Profiler::m_Paused{};
+
+	std::vector<Profiler::Zone> Profiler::m_Capture{};
+	bool Profiler::m_IsCapturing{};
+
+	namespace
+	{
+		void WriteEscaped(std::ofstream& file, const std::string& text)
+		{
+			for (const char c : text)
+			{
+				if (c == '"' || c == '\\')
+				{
+					file << '\\';
+				}
+				file << c;
+			}
+		}
+	}
+
+	void Profiler::BeginFrame()
+	{
+		const uint64_t now = GetTimestamp();
+
+		std::vector<Zone> zones;
+		{
+			std::lock_guard lock(m_ThreadMutex);
+			for (const std::unique_ptr<ThreadBuffer>& pBuffer : m_Threads)
+			{
+				// Everything up to the write index has been written completely, the owner can't overwrite it until the read index moves.
+				const uint64_t writeIndex = pBuffer->writeIndex.load(std::memory_order_acquire);
+				uint64_t readIndex = pBuffer->readIndex.load(std::memory_order_relaxed);
+				for (; readIndex < writeIndex; readIndex++)
+				{
+					zones.push_back(pBuffer->zones[readIndex % RING_SIZE]);
+				}
+				pBuffer->readIndex.store(readIndex, std::memory_order_release);
+			}
+		}
+
+		if (m_IsCapturing)
+		{
+			m_Capture.insert(m_Capture.end(), zones.begin(), zones.end());
+		}
+
+		if (!m_Paused)
+		{
+			m_FrameZones = std::move(zones);
+			m_FrameStart = m_CurrentFrameStart;
+			m_FrameEnd = now;
+		}
+		m_CurrentFrameStart = now;
+	}
+
+	void Profiler::SetThreadName(const std::string& name)
+	{
+		ThreadBuffer& buffer = GetThreadBuffer();
+
+		std::lock_guard lock(m_ThreadMutex);
+		buffer.name = name;
+	}
+
+	void Profiler::StartCapture()
+	{
+		m_Capture.clear();
+		m_IsCapturing = true;
+	}
+
+	void Profiler::StopCapture()
+	{
+		m_IsCapturing = false;
+	}
+
+	bool Profiler::IsCapturing()
+	{
+		return m_IsCapturing;
+	}
+
+	bool Profiler::SaveCapture(const std::filesystem::path& path)
+	{
+		std::ofstream file(path);
+		if (!file)
+		{
+			Logger::LogError("Failed to open \"%s\" to save the profiler capture", path.string().c_str());
+			return false;
+		}
+
+		// Timestamps are in microseconds, every zone is a complete event.
+		file << "{\"traceEvents\":[\n";
+		{
+			std::lock_guard lock(m_ThreadMutex);
+			for (const std::unique_ptr<ThreadBuffer>& pBuffer : m_Threads)
+			{
+				file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << pBuffer->index << ",\"args\":{\"name\":\"";
+				WriteEscaped(file, pBuffer->name);
+				file << "\"}},\n";
+			}
+		}
+
+		char number[32];
+		for (size_t i = 0; i < m_Capture.size(); i++)
+		{
+			const Zone& zone = m_Capture[i];
+			file << "{\"name\":\"";
+			WriteEscaped(file, zone.name);
+			snprintf(number, sizeof(number), "%.3f", static_cast<double>(zone.start) / 1000.0);
+			file << "\",\"cat\":\"cpu\",\"ph\":\"X\",\"ts\":" << number;
+			snprintf(number, sizeof(number), "%.3f", static_cast<double>(zone.end - zone.start) / 1000.0);
+			file << ",\"dur\":" << number << ",\"pid\":0,\"tid\":" << zone.thread << "}";
+			file << (i + 1 < m_Capture.size() ? ",\n" : "\n");
+		}
+		file << "]}\n";
+
+		Logger::LogInfo("Saved %u profiler zones to \"%s\"", static_cast<uint32_t>(m_Capture.size()), path.string().c_str());
+		return true;
+	}
+
+	const std::vector<Profiler::Zone>& Profiler::GetFrameZones()
+	{
+		return m_FrameZones;
+	}
+
+	uint64_t Profiler::GetFrameStart()
+	{
+		return m_FrameStart;
+	}
+
+	uint64_t Profiler::GetFrameEnd()
+	{
+		return m_FrameEnd;
+	}
+
+	uint64_t Profiler::GetDroppedCount()
+	{
+		std::lock_guard lock(m_ThreadMutex);
+		uint64_t count = 0;
+		for (const std::unique_ptr<ThreadBuffer>& pBuffer : m_Threads)
+		{
+			count += pBuffer->droppedCount.load(std::memory_order_relaxed);
+		}
+		return count;
+	}
+
+	uint64_t Profiler::GetTimestamp()
+	{
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_StartTime).count());
+	}
+
+	Profiler::ThreadBuffer& Profiler::GetThreadBuffer()
+	{
+		// Registering is the only time a thread takes the lock.
+		thread_local ThreadBuffer* pBuffer = nullptr;
+		if (!pBuffer)
+		{
+			std::lock_guard lock(m_ThreadMutex);
+			m_Threads.push_back(std::make_unique<ThreadBuffer>());
+			pBuffer = m_Threads.back().get();
+			pBuffer->index = static_cast<uint32_t>(m_Threads.size() - 1);
+			pBuffer->name = "Thread " + std::to_string(pBuffer->index);
+		}
+		return *pBuffer;
+	}
+
+	void Profiler::Record(ThreadBuffer& buffer, const char* name, uint64_t start, uint32_t depth)
+	{
+		const uint64_t end = GetTimestamp();
+
+		const uint64_t writeIndex = buffer.writeIndex.load(std::memory_order_relaxed);
+		if (writeIndex - buffer.readIndex.load(std::memory_order_acquire) >= RING_SIZE)
+		{
+			buffer.droppedCount.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		buffer.zones[writeIndex % RING_SIZE] = Zone{ name, start, end, depth, buffer.index };
+		buffer.writeIndex.store(writeIndex + 1, std::memory_order_release);
+	}
+
+	void Profiler::DebugDraw()
+	{
+		if (ImGui::Begin("CPU Profiler"))
+		{
+			ImGui::Text("Frame: %.3fms, %u zones, %llu dropped", static_cast<float>(m_FrameEnd - m_FrameStart) / 1'000'000.0f,
+				static_cast<uint32_t>(m_FrameZones.size()), static_cast<unsigned long long>(GetDroppedCount()));
+			ImGui::Checkbox("Pause", &m_Paused);
+
+			ImGui::SameLine();
+			if (ImGui::Button(m_IsCapturing ? "Stop capture" : "Start capture"))
+			{
+				if (m_IsCapturing)
+					StopCapture();
+				else
+					StartCapture();
+			}
+
+			static std::string capturePath = "profile.json";
+			ImGui::InputText("Trace file", &capturePath);
+			ImGui::Text("Captured %u zones", static_cast<uint32_t>(m_Capture.size()));
+			if (!m_IsCapturing && !m_Capture.empty())
+			{
+				ImGui::SameLine();
+				if (ImGui::Button("Save"))
+				{
+					SaveCapture(capturePath);
+				}
+			}
+
+			ImGui::Separator();
+			DrawFlameGraph();
+		}
+		ImGui::End();
+	}
+
+	void Profiler::DrawFlameGraph()
+	{
+		std::vector<std::string> threadNames;
+		{
+			std::lock_guard lock(m_ThreadMutex);
+			for (const std::unique_ptr<ThreadBuffer>& pBuffer : m_Threads)
+			{
+				threadNames.push_back(pBuffer->name);
+			}
+		}
+
+		const double frameDuration = static_cast<double>(std::max<uint64_t>(m_FrameEnd - m_FrameStart, 1));
+		const float width = std::max(ImGui::GetContentRegionAvail().x, 1.0f);
+		const float rowHeight = ImGui::GetTextLineHeightWithSpacing();
+		ImDrawList* pDrawList = ImGui::GetWindowDrawList();
+
+		// One graph per thread, the time axis spans the whole frame.
+		for (uint32_t thread = 0; thread < static_cast<uint32_t>(threadNames.size()); thread++)
+		{
+			uint32_t rowCount = 0;
+			for (const Zone& zone : m_FrameZones)
+			{
+				if (zone.thread == thread)
+				{
+					rowCount = std::max(rowCount, zone.depth + 1);
+				}
+			}
+			if (rowCount == 0)
+				continue;
+
+			ImGui::TextUnformatted(threadNames[thread].c_str());
+			const ImVec2 origin = ImGui::GetCursorScreenPos();
+			ImGui::PushID(static_cast<int>(thread));
+			ImGui::InvisibleButton("FlameGraph", ImVec2(width, rowHeight * static_cast<float>(rowCount)));
+			ImGui::PopID();
+
+			for (const Zone& zone : m_FrameZones)
+			{
+				if (zone.thread != thread)
+					continue;
+
+				const auto toX = [&](uint64_t time)
+				{
+					const double offset = static_cast<double>(std::clamp(time, m_FrameStart, m_FrameEnd) - m_FrameStart);
+					return origin.x + static_cast<float>(offset / frameDuration) * width;
+				};
+
+				const ImVec2 min(toX(zone.start), origin.y + rowHeight * static_cast<float>(zone.depth));
+				const ImVec2 max(std::max(toX(zone.end), min.x + 1.0f), min.y + rowHeight - 1.0f);
+
+				// The same zone keeps its color from frame to frame.
+				const float hue = static_cast<float>(std::hash<std::string_view>{}(zone.name) % 360) / 360.0f;
+				pDrawList->AddRectFilled(min, max, ImColor::HSV(hue, 0.5f, 0.7f));
+				if (max.x - min.x > 20.0f)
+				{
+					pDrawList->PushClipRect(min, max, true);
+					pDrawList->AddText(ImVec2(min.x + 2.0f, min.y), IM_COL32_WHITE, zone.name);
+					pDrawList->PopClipRect();
+				}
+
+				if (ImGui::IsMouseHoveringRect(min, max))
+				{
+					ImGui::SetTooltip("%s: %.3fms", zone.name, static_cast<float>(zone.end - zone.start) / 1'000'000.0f);
+				}
+			}
+		}
+	}
+
+	ProfileZone::ProfileZone(const char* name)
+		: m_pBuffer(&Profiler::GetThreadBuffer())
+		, m_Name(name)
+		, m_Start(Profiler::GetTimestamp())
+		, m_Depth(m_pBuffer->depth++)
+	{
+	}
+
+	ProfileZone::~ProfileZone()
+	{
+		m_pBuffer->depth--;
+		Profiler::Record(*m_pBuffer, m_Name, m_Start, m_Depth);
+	}
+}
@@ -0,0 +1,115 @@
+﻿#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+
+// Zones time the scope they're declared in. Names have to outlive the profiler, string literals or __FUNCTION__.
+// Define PELICAN_NO_PROFILING to compile them out.
+#ifndef PELICAN_NO_PROFILING
+#define PELICAN_PROFILE_CONCAT_INNER(a, b) a##b
+#define PELICAN_PROFILE_CONCAT(a, b) PELICAN_PROFILE_CONCAT_INNER(a, b)
+#define PELICAN_PROFILE_SCOPE(name) const ::Pelican::ProfileZone PELICAN_PROFILE_CONCAT(profileZone, __LINE__){ name }
+#define PELICAN_PROFILE_FUNCTION() PELICAN_PROFILE_SCOPE(__FUNCTION__)
+#else
+#define PELICAN_PROFILE_SCOPE(name)
+#define PELICAN_PROFILE_FUNCTION()
+#endif
+
+namespace Pelican
+{
+	// Collects the zones every thread records and groups them per frame.
+	// Each thread writes into a ring of its own, which only that thread writes and only the main thread reads,
+	// so recording a zone never takes a lock. Threads that record faster than the frames are collected lose zones,
+	// these are counted in GetDroppedCount().
+	class Profiler final
+	{
+	public:
+		struct Zone
+		{
+			const char* name;
+			// Nanoseconds since the profiler started.
+			uint64_t start;
+			uint64_t end;
+			uint32_t depth;
+			uint32_t thread;
+		};
+
+		// Call this at the start of every frame on the main thread, it collects the zones that ended during the last one.
+		static void BeginFrame();
+
+		// Names the calling thread in the flame graph and the trace, threads are called "Thread <n>" otherwise.
+		static void SetThreadName(const std::string& name);
+
+		// Keeps every zone from now on until the capture is stopped.
+		static void StartCapture();
+		static void StopCapture();
+		[[nodiscard]] static bool IsCapturing();
+		// Writes the capture in the Chrome trace event format, open it in chrome://tracing or ui.perfetto.dev.
+		static bool SaveCapture(const std::filesystem::path& path);
+
+		// The zones of the last finished frame and when it began and ended.
+		[[nodiscard]] static const std::vector<Zone>& GetFrameZones();
+		[[nodiscard]] static uint64_t GetFrameStart();
+		[[nodiscard]] static uint64_t GetFrameEnd();
+		[[nodiscard]] static uint64_t GetDroppedCount();
+
+		[[nodiscard]] static uint64_t GetTimestamp();
+
+		static void DebugDraw();
+
+	private:
+		friend class ProfileZone;
+
+		static constexpr uint32_t RING_SIZE = 16384;
+
+		struct ThreadBuffer
+		{
+			std::unique_ptr<Zone[]> zones{ std::make_unique<Zone[]>(RING_SIZE) };
+			std::atomic<uint64_t> writeIndex{};
+			std::atomic<uint64_t> readIndex{};
+			std::atomic<uint64_t> droppedCount{};
+			std::string name{};
+			uint32_t index{};
+			// Only touched by the owning thread.
+			uint32_t depth{};
+		};
+
+		static ThreadBuffer& GetThreadBuffer();
+		static void Record(ThreadBuffer& buffer, const char* name, uint64_t start, uint32_t depth);
+		static void DrawFlameGraph();
+
+	private:
+		static const std::chrono::steady_clock::time_point m_StartTime;
+
+		// Buffers live as long as the profiler, even when their thread is gone.
+		static std::mutex m_ThreadMutex;
+		static std::vector<std::unique_ptr<ThreadBuffer>> m_Threads;
+
+		static std::vector<Zone> m_FrameZones;
+		static uint64_t m_FrameStart;
+		static uint64_t m_FrameEnd;
+		static uint64_t m_CurrentFrameStart;
+		static bool m_Paused;
+
+		static std::vector<Zone> m_Capture;
+		static bool m_IsCapturing;
+	};
+
+	class ProfileZone final
+	{
+	public:
+		explicit ProfileZone(const char* name);
+		~ProfileZone();
+
+		ProfileZone(const ProfileZone&) = delete;
+		ProfileZone& operator=(const ProfileZone&) = delete;
+
+	private:
+		Profiler::ThreadBuffer* m_pBuffer;
+		const char* m_Name;
+		uint64_t m_Start;
+		uint32_t m_Depth;
+	};
+}
@@ -0,0 +1,124 @@
+﻿#include "PelicanPCH.h"
+#include "ThreadPool.h"
+
+#include "Profiler.h"
+
+namespace Pelican
+{
+	ThreadPool::ThreadPool(uint32_t workerCount)
+	{
+		m_Workers.reserve(workerCount);
+		for (uint32_t i = 0; i < workerCount; i++)
+		{
+			m_Workers.emplace_back(&ThreadPool::WorkerLoop, this, i + 1);
+		}
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Stop = true;
+		}
+		m_WakeCondition.notify_all();
+
+		for (std::thread& worker : m_Workers)
+		{
+			worker.join();
+		}
+	}
+
+	void ThreadPool::ParallelFor(uint32_t jobCount, const Job& job)
+	{
+		if (jobCount == 0)
+			return;
+
+		// Not worth waking anyone up for.
+		if (jobCount == 1 || m_Workers.empty())
+		{
+			for (uint32_t i = 0; i < jobCount; i++)
+			{
+				job(i, 0);
+			}
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_pJob = &job;
+			m_JobCount = jobCount;
+			m_NextJob = 0;
+			m_ActiveWorkers = static_cast<uint32_t>(m_Workers.size());
+			m_Exception = nullptr;
+			m_Generation++;
+		}
+		m_WakeCondition.notify_all();
+
+		RunJobs(0);
+
+		std::exception_ptr exception;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_DoneCondition.wait(lock, [this]() { return m_ActiveWorkers == 0; });
+			m_pJob = nullptr;
+			exception = m_Exception;
+			m_Exception = nullptr;
+		}
+
+		if (exception)
+			std::rethrow_exception(exception);
+	}
+
+	uint32_t ThreadPool::GetDefaultWorkerCount()
+	{
+		// Leave one core for the main thread, it joins in on ParallelFor anyway.
+		const uint32_t cores = std::thread::hardware_concurrency();
+		return cores > 1 ? cores - 1 : 0;
+	}
+
+	void ThreadPool::WorkerLoop(uint32_t threadIndex)
+	{
+		Profiler::SetThreadName("Worker " + std::to_string(threadIndex));
+
+		uint64_t generation = 0;
+
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(m_Mutex);
+				m_WakeCondition.wait(lock, [&]() { return m_Stop || m_Generation != generation; });
+
+				if (m_Stop)
+					return;
+
+				generation = m_Generation;
+			}
+
+			RunJobs(threadIndex);
+
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				if (--m_ActiveWorkers == 0)
+					m_DoneCondition.notify_one();
+			}
+		}
+	}
+
+	void ThreadPool::RunJobs(uint32_t threadIndex)
+	{
+		uint32_t jobIndex;
+		while ((jobIndex = m_NextJob.fetch_add(1)) < m_JobCount)
+		{
+			try
+			{
+				(*m_pJob)(jobIndex, threadIndex);
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				if (!m_Exception)
+					m_Exception = std::current_exception();
+			}
+		}
+	}
+}
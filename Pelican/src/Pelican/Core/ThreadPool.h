@@ -0,0 +1,56 @@
+﻿#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Pelican
+{
+	// A fixed set of worker threads that split a range of jobs between them.
+	// The thread calling ParallelFor works on the jobs as well, it has thread index 0.
+	class ThreadPool final
+	{
+	public:
+		// Gets the job index and the index of the thread running it, the thread index is stable for the
+		// duration of the job and is always smaller than GetThreadCount(), so it can be used to pick per-thread resources.
+		using Job = std::function<void(uint32_t jobIndex, uint32_t threadIndex)>;
+
+		explicit ThreadPool(uint32_t workerCount = GetDefaultWorkerCount());
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		// Runs the job for every index in [0, jobCount) and returns once all of them are done.
+		// Exceptions thrown by a job get rethrown here.
+		void ParallelFor(uint32_t jobCount, const Job& job);
+
+		// The worker threads plus the calling thread.
+		[[nodiscard]] uint32_t GetThreadCount() const { return static_cast<uint32_t>(m_Workers.size()) + 1; }
+
+		[[nodiscard]] static uint32_t GetDefaultWorkerCount();
+
+	private:
+		void WorkerLoop(uint32_t threadIndex);
+		void RunJobs(uint32_t threadIndex);
+
+	private:
+		std::vector<std::thread> m_Workers;
+
+		std::mutex m_Mutex;
+		std::condition_variable m_WakeCondition;
+		std::condition_variable m_DoneCondition;
+
+		const Job* m_pJob{};
+		uint32_t m_JobCount{};
+		std::atomic<uint32_t> m_NextJob{};
+		uint64_t m_Generation{};
+		uint32_t m_ActiveWorkers{};
+		std::exception_ptr m_Exception{};
+		bool m_Stop{};
+	};
+}
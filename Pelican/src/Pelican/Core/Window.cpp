@@ -1,6 +1,7 @@
 ﻿#include "PelicanPCH.h"
 #include "Window.h"
 #include "Application.h"
+#include "Profiler.h"
 
 #include "Pelican/Events/ApplicationEvent.h"
 #include "Pelican/Events/KeyEvent.h"
@@ -23,6 +24,10 @@ namespace Pelican
 
 	void Window::Init()
 	{
+		// Nothing to create, the renderer will render into offscreen images.
+		if (m_Params.headless)
+			return;
+
 		if (!glfwInit())
 		{
 			ASSERT_MSG(false, "Failed to initialize GLFW!");
@@ -152,18 +157,34 @@ namespace Pelican
 
 	void Window::Cleanup()
 	{
+		if (m_Params.headless)
+			return;
+
 		glfwDestroyWindow(m_pGLFWwindow);
 		glfwTerminate();
 	}
 
 	void Window::Update()
 	{
+		PELICAN_PROFILE_FUNCTION();
+
+		if (m_Params.headless)
+			return;
+
 		glfwPollEvents();
 	}
 
+	void Window::Close()
+	{
+		m_ShouldClose = true;
+	}
+
 	bool Window::ShouldClose() const
 	{
-		return glfwWindowShouldClose(m_pGLFWwindow);
+		if (m_Params.headless)
+			return m_ShouldClose;
+
+		return m_ShouldClose || glfwWindowShouldClose(m_pGLFWwindow);
 	}
 
 	// Credits to ValentinDev: https://vallentin.dev/2014/02/07/glfw-center-window
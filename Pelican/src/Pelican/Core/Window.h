@@ -17,6 +17,8 @@ namespace Pelican
 			int height;
 			std::string title;
 			bool resizable;
+			// A headless window doesn't create a GLFW window, it only keeps track of the size and close state.
+			bool headless = false;
 		};
 
 		Window(Params&& params);
@@ -28,8 +30,10 @@ namespace Pelican
 		void SetEventCallback(const EventCallbackFn& callback) { m_EventCallback = callback; }
 
 		void Update();
+		void Close();
 
 		[[nodiscard]] bool ShouldClose() const;
+		[[nodiscard]] bool IsHeadless() const { return m_Params.headless; }
 
 		[[nodiscard]] GLFWwindow* GetGLFWWindow() const { return m_pGLFWwindow; }
 
@@ -42,6 +46,7 @@ namespace Pelican
 	private:
 		GLFWwindow* m_pGLFWwindow;
 		Params m_Params;
+		bool m_ShouldClose{ false };
 
 		EventCallbackFn m_EventCallback;
 	};
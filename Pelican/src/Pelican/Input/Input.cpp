@@ -9,6 +9,10 @@ namespace Pelican
 	{
 		GetInstance().m_pWindow = window;
 
+		// Headless applications don't have a window to poll, all input queries will return their defaults.
+		if (!window)
+			return;
+
 		glfwSetScrollCallback(window, [](GLFWwindow* /*pWindow*/, double /*x*/, double y)
 		{
 			GetInstance().m_Scroll = static_cast<float>(y);
@@ -22,16 +26,25 @@ namespace Pelican
 
 	bool Input::GetKey(KeyCode key)
 	{
+		if (!GetInstance().m_pWindow)
+			return false;
+
 		return glfwGetKey(GetInstance().m_pWindow, static_cast<int>(key)) == GLFW_PRESS;
 	}
 
 	bool Input::GetMouseButton(MouseCode code)
 	{
+		if (!GetInstance().m_pWindow)
+			return false;
+
 		return glfwGetMouseButton(GetInstance().m_pWindow, static_cast<int>(code)) == GLFW_PRESS;
 	}
 
 	glm::vec2 Input::GetMousePos()
 	{
+		if (!GetInstance().m_pWindow)
+			return glm::vec2(0.0f);
+
 		double x, y;
 		glfwGetCursorPos(GetInstance().m_pWindow, &x, &y);
 
@@ -40,6 +53,9 @@ namespace Pelican
 
 	glm::vec2 Input::GetMouseMovement()
 	{
+		if (!GetInstance().m_pWindow)
+			return glm::vec2(0.0f);
+
 		double x, y;
 		glfwGetCursorPos(GetInstance().m_pWindow, &x, &y);
 
@@ -57,6 +73,9 @@ namespace Pelican
 
 	void Input::SetCursorMode(bool enabled)
 	{
+		if (!GetInstance().m_pWindow)
+			return;
+
 		glfwSetInputMode(GetInstance().m_pWindow, GLFW_CURSOR, enabled ? GLFW_CURSOR_NORMAL : GLFW_CURSOR_DISABLED);
 	}
 }
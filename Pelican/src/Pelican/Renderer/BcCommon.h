@@ -0,0 +1,343 @@
+﻿#pragma once
+#include <cstring>
+
+namespace Pelican
+{
+	// Block layouts, tables and bit packing shared by BcDecoder and BcEncoder.
+	namespace BcCommon
+	{
+		inline constexpr uint32_t BLOCK_SIZE = 4;
+		inline constexpr uint32_t BLOCK_TEXELS = BLOCK_SIZE * BLOCK_SIZE;
+
+		// Reads the 128 bits of a BC6H or BC7 block from the least significant bit up.
+		class BitReader final
+		{
+		public:
+			explicit BitReader(const uint8_t* pBlock)
+			{
+				memcpy(m_Bytes, pBlock, sizeof(m_Bytes));
+			}
+
+			uint32_t Read(uint32_t count)
+			{
+				uint32_t value = 0;
+				for (uint32_t i = 0; i < count; i++)
+				{
+					value |= GetBit(m_Position++) << i;
+				}
+				return value;
+			}
+
+			// The first bit read ends up as the most significant one.
+			uint32_t ReadReversed(uint32_t count)
+			{
+				uint32_t value = 0;
+				for (uint32_t i = 0; i < count; i++)
+				{
+					value |= GetBit(m_Position++) << (count - 1 - i);
+				}
+				return value;
+			}
+
+			[[nodiscard]] uint32_t GetPosition() const { return m_Position; }
+
+		private:
+			[[nodiscard]] uint32_t GetBit(uint32_t position) const { return (m_Bytes[position >> 3] >> (position & 7)) & 1; }
+
+		private:
+			uint8_t m_Bytes[16]{};
+			uint32_t m_Position{};
+		};
+
+		// Writes the 128 bits of a BC6H or BC7 block in the same order BitReader reads them.
+		class BitWriter final
+		{
+		public:
+			explicit BitWriter(uint8_t* pBlock)
+				: m_pBlock(pBlock)
+			{
+				memset(m_pBlock, 0, 16);
+			}
+
+			void Write(uint32_t value, uint32_t count)
+			{
+				for (uint32_t i = 0; i < count; i++)
+				{
+					SetBit(m_Position++, (value >> i) & 1);
+				}
+			}
+
+			void WriteReversed(uint32_t value, uint32_t count)
+			{
+				for (uint32_t i = 0; i < count; i++)
+				{
+					SetBit(m_Position++, (value >> (count - 1 - i)) & 1);
+				}
+			}
+
+			[[nodiscard]] uint32_t GetPosition() const { return m_Position; }
+
+		private:
+			void SetBit(uint32_t position, uint32_t bit) { m_pBlock[position >> 3] |= static_cast<uint8_t>(bit << (position & 7)); }
+
+		private:
+			uint8_t* m_pBlock;
+			uint32_t m_Position{};
+		};
+
+		// Shared by BC6H and BC7, index [partition][texel] gives the subset of the texel.
+		inline constexpr uint8_t PARTITIONS_2[64][16] = {
+			{ 0,0,1,1,0,0,1,1,0,0,1,1,0,0,1,1 }, { 0,0,0,1,0,0,0,1,0,0,0,1,0,0,0,1 }, { 0,1,1,1,0,1,1,1,0,1,1,1,0,1,1,1 }, { 0,0,0,1,0,0,1,1,0,0,1,1,0,1,1,1 },
+			{ 0,0,0,0,0,0,0,1,0,0,0,1,0,0,1,1 }, { 0,0,1,1,0,1,1,1,0,1,1,1,1,1,1,1 }, { 0,0,0,1,0,0,1,1,0,1,1,1,1,1,1,1 }, { 0,0,0,0,0,0,0,1,0,0,1,1,0,1,1,1 },
+			{ 0,0,0,0,0,0,0,0,0,0,0,1,0,0,1,1 }, { 0,0,1,1,0,1,1,1,1,1,1,1,1,1,1,1 }, { 0,0,0,0,0,0,0,1,0,1,1,1,1,1,1,1 }, { 0,0,0,0,0,0,0,0,0,0,0,1,0,1,1,1 },
+			{ 0,0,0,1,0,1,1,1,1,1,1,1,1,1,1,1 }, { 0,0,0,0,0,0,0,0,1,1,1,1,1,1,1,1 }, { 0,0,0,0,1,1,1,1,1,1,1,1,1,1,1,1 }, { 0,0,0,0,0,0,0,0,0,0,0,0,1,1,1,1 },
+			{ 0,0,0,0,1,0,0,0,1,1,1,0,1,1,1,1 }, { 0,1,1,1,0,0,0,1,0,0,0,0,0,0,0,0 }, { 0,0,0,0,0,0,0,0,1,0,0,0,1,1,1,0 }, { 0,1,1,1,0,0,1,1,0,0,0,1,0,0,0,0 },
+			{ 0,0,1,1,0,0,0,1,0,0,0,0,0,0,0,0 }, { 0,0,0,0,1,0,0,0,1,1,0,0,1,1,1,0 }, { 0,0,0,0,0,0,0,0,1,0,0,0,1,1,0,0 }, { 0,1,1,1,0,0,1,1,0,0,1,1,0,0,0,1 },
+			{ 0,0,1,1,0,0,0,1,0,0,0,1,0,0,0,0 }, { 0,0,0,0,1,0,0,0,1,0,0,0,1,1,0,0 }, { 0,1,1,0,0,1,1,0,0,1,1,0,0,1,1,0 }, { 0,0,1,1,0,1,1,0,0,1,1,0,1,1,0,0 },
+			{ 0,0,0,1,0,1,1,1,1,1,1,0,1,0,0,0 }, { 0,0,0,0,1,1,1,1,1,1,1,1,0,0,0,0 }, { 0,1,1,1,0,0,0,1,1,0,0,0,1,1,1,0 }, { 0,0,1,1,1,0,0,1,1,0,0,1,1,1,0,0 },
+			{ 0,1,0,1,0,1,0,1,0,1,0,1,0,1,0,1 }, { 0,0,0,0,1,1,1,1,0,0,0,0,1,1,1,1 }, { 0,1,0,1,1,0,1,0,0,1,0,1,1,0,1,0 }, { 0,0,1,1,0,0,1,1,1,1,0,0,1,1,0,0 },
+			{ 0,0,1,1,1,1,0,0,0,0,1,1,1,1,0,0 }, { 0,1,0,1,0,1,0,1,1,0,1,0,1,0,1,0 }, { 0,1,1,0,1,0,0,1,0,1,1,0,1,0,0,1 }, { 0,1,0,1,1,0,1,0,1,0,1,0,0,1,0,1 },
+			{ 0,1,1,1,0,0,1,1,1,1,0,0,1,1,1,0 }, { 0,0,0,1,0,0,1,1,1,1,0,0,1,0,0,0 }, { 0,0,1,1,0,0,1,0,0,1,0,0,1,1,0,0 }, { 0,0,1,1,1,0,1,1,1,1,0,1,1,1,0,0 },
+			{ 0,1,1,0,1,0,0,1,1,0,0,1,0,1,1,0 }, { 0,0,1,1,1,1,0,0,1,1,0,0,0,0,1,1 }, { 0,1,1,0,0,1,1,0,1,0,0,1,1,0,0,1 }, { 0,0,0,0,0,1,1,0,0,1,1,0,0,0,0,0 },
+			{ 0,1,0,0,1,1,1,0,0,1,0,0,0,0,0,0 }, { 0,0,1,0,0,1,1,1,0,0,1,0,0,0,0,0 }, { 0,0,0,0,0,0,1,0,0,1,1,1,0,0,1,0 }, { 0,0,0,0,0,1,0,0,1,1,1,0,0,1,0,0 },
+			{ 0,1,1,0,1,1,0,0,1,0,0,1,0,0,1,1 }, { 0,0,1,1,0,1,1,0,1,1,0,0,1,0,0,1 }, { 0,1,1,0,0,0,1,1,1,0,0,1,1,1,0,0 }, { 0,0,1,1,1,0,0,1,1,1,0,0,0,1,1,0 },
+			{ 0,1,1,0,1,1,0,0,1,1,0,0,1,0,0,1 }, { 0,1,1,0,0,0,1,1,0,0,1,1,1,0,0,1 }, { 0,1,1,1,1,1,1,0,1,0,0,0,0,0,0,1 }, { 0,0,0,1,1,0,0,0,1,1,1,0,0,1,1,1 },
+			{ 0,0,0,0,1,1,1,1,0,0,1,1,0,0,1,1 }, { 0,0,1,1,0,0,1,1,1,1,1,1,0,0,0,0 }, { 0,0,1,0,0,0,1,0,1,1,1,0,1,1,1,0 }, { 0,1,0,0,0,1,0,0,0,1,1,1,0,1,1,1 },
+		};
+
+		inline constexpr uint8_t PARTITIONS_3[64][16] = {
+			{ 0,0,1,1,0,0,1,1,0,2,2,1,2,2,2,2 }, { 0,0,0,1,0,0,1,1,2,2,1,1,2,2,2,1 }, { 0,0,0,0,2,0,0,1,2,2,1,1,2,2,1,1 }, { 0,2,2,2,0,0,2,2,0,0,1,1,0,1,1,1 },
+			{ 0,0,0,0,0,0,0,0,1,1,2,2,1,1,2,2 }, { 0,0,1,1,0,0,1,1,0,0,2,2,0,0,2,2 }, { 0,0,2,2,0,0,2,2,1,1,1,1,1,1,1,1 }, { 0,0,1,1,0,0,1,1,2,2,1,1,2,2,1,1 },
+			{ 0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2 }, { 0,0,0,0,1,1,1,1,1,1,1,1,2,2,2,2 }, { 0,0,0,0,1,1,1,1,2,2,2,2,2,2,2,2 }, { 0,0,1,2,0,0,1,2,0,0,1,2,0,0,1,2 },
+			{ 0,1,1,2,0,1,1,2,0,1,1,2,0,1,1,2 }, { 0,1,2,2,0,1,2,2,0,1,2,2,0,1,2,2 }, { 0,0,1,1,0,1,1,2,1,1,2,2,1,2,2,2 }, { 0,0,1,1,2,0,0,1,2,2,0,0,2,2,2,0 },
+			{ 0,0,0,1,0,0,1,1,0,1,1,2,1,1,2,2 }, { 0,1,1,1,0,0,1,1,2,0,0,1,2,2,0,0 }, { 0,0,0,0,1,1,2,2,1,1,2,2,1,1,2,2 }, { 0,0,2,2,0,0,2,2,0,0,2,2,1,1,1,1 },
+			{ 0,1,1,1,0,1,1,1,0,2,2,2,0,2,2,2 }, { 0,0,0,1,0,0,0,1,2,2,2,1,2,2,2,1 }, { 0,0,0,0,0,0,1,1,0,1,2,2,0,1,2,2 }, { 0,0,0,0,1,1,0,0,2,2,1,0,2,2,1,0 },
+			{ 0,1,2,2,0,1,2,2,0,0,1,1,0,0,0,0 }, { 0,0,1,2,0,0,1,2,1,1,2,2,2,2,2,2 }, { 0,1,1,0,1,2,2,1,1,2,2,1,0,1,1,0 }, { 0,0,0,0,0,1,1,0,1,2,2,1,1,2,2,1 },
+			{ 0,0,2,2,1,1,0,2,1,1,0,2,0,0,2,2 }, { 0,1,1,0,0,1,1,0,2,0,0,2,2,2,2,2 }, { 0,0,1,1,0,1,2,2,0,1,2,2,0,0,1,1 }, { 0,0,0,0,2,0,0,0,2,2,1,1,2,2,2,1 },
+			{ 0,0,0,0,0,0,0,2,1,1,2,2,1,2,2,2 }, { 0,2,2,2,0,0,2,2,0,0,1,2,0,0,1,1 }, { 0,0,1,1,0,0,1,2,0,0,2,2,0,2,2,2 }, { 0,1,2,0,0,1,2,0,0,1,2,0,0,1,2,0 },
+			{ 0,0,0,0,1,1,1,1,2,2,2,2,0,0,0,0 }, { 0,1,2,0,1,2,0,1,2,0,1,2,0,1,2,0 }, { 0,1,2,0,2,0,1,2,1,2,0,1,0,1,2,0 }, { 0,0,1,1,2,2,0,0,1,1,2,2,0,0,1,1 },
+			{ 0,0,1,1,1,1,2,2,2,2,0,0,0,0,1,1 }, { 0,1,0,1,0,1,0,1,2,2,2,2,2,2,2,2 }, { 0,0,0,0,0,0,0,0,2,1,2,1,2,1,2,1 }, { 0,0,2,2,1,1,2,2,0,0,2,2,1,1,2,2 },
+			{ 0,0,2,2,0,0,1,1,0,0,2,2,0,0,1,1 }, { 0,2,2,0,1,2,2,1,0,2,2,0,1,2,2,1 }, { 0,1,0,1,2,2,2,2,2,2,2,2,0,1,0,1 }, { 0,0,0,0,2,1,2,1,2,1,2,1,2,1,2,1 },
+			{ 0,1,0,1,0,1,0,1,0,1,0,1,2,2,2,2 }, { 0,2,2,2,0,1,1,1,0,2,2,2,0,1,1,1 }, { 0,0,0,2,1,1,1,2,0,0,0,2,1,1,1,2 }, { 0,0,0,0,2,1,1,2,2,1,1,2,2,1,1,2 },
+			{ 0,2,2,2,0,1,1,1,0,1,1,1,0,2,2,2 }, { 0,0,0,2,1,1,1,2,1,1,1,2,0,0,0,2 }, { 0,1,1,0,0,1,1,0,0,1,1,0,2,2,2,2 }, { 0,0,0,0,0,0,0,0,2,1,1,2,2,1,1,2 },
+			{ 0,1,1,0,0,1,1,0,2,2,2,2,2,2,2,2 }, { 0,0,2,2,0,0,1,1,0,0,1,1,0,0,2,2 }, { 0,0,2,2,1,1,2,2,1,1,2,2,0,0,2,2 }, { 0,0,0,0,0,0,0,0,0,0,0,0,2,1,1,2 },
+			{ 0,0,0,2,0,0,0,1,0,0,0,2,0,0,0,1 }, { 0,2,2,2,1,2,2,2,0,2,2,2,1,2,2,2 }, { 0,1,0,1,2,2,2,2,2,2,2,2,2,2,2,2 }, { 0,1,1,1,2,0,1,1,2,2,0,1,2,2,2,0 },
+		};
+
+		// The anchor texel of every subset stores its index with one bit less, subset 0's anchor is always texel 0.
+		inline constexpr uint8_t ANCHORS_2[64] = {
+			15,15,15,15,15,15,15,15, 15,15,15,15,15,15,15,15, 15, 2, 8, 2, 2, 8, 8,15, 2, 8, 2, 2, 8, 8, 2, 2,
+			15,15, 6, 8, 2, 8,15,15, 2, 8, 2, 2, 2,15,15, 6, 6, 2, 6, 8,15,15, 2, 2, 15,15,15,15,15, 2, 2,15,
+		};
+		inline constexpr uint8_t ANCHORS_3_SECOND[64] = {
+			3, 3,15,15, 8, 3,15,15, 8, 8, 6, 6, 6, 5, 3, 3, 3, 3, 8,15, 3, 3, 6,10, 5, 8, 8, 6, 8, 5,15,15,
+			8,15, 3, 5, 6,10, 8,15, 15, 3,15, 5,15,15,15,15, 3,15, 5, 5, 5, 8, 5,10, 5,10, 8,13,15,12, 3, 3,
+		};
+		inline constexpr uint8_t ANCHORS_3_THIRD[64] = {
+			15, 8, 8, 3,15,15, 3, 8, 15,15,15,15,15,15,15, 8, 15, 8,15, 3,15, 8,15, 8, 3,15, 6,10,15,15,10, 8,
+			15, 3,15,10,10, 8, 9,10, 6,15, 8,15, 3, 6, 6, 8, 15, 3,15,15,15,15,15,15, 15,15,15,15, 3,15,15, 8,
+		};
+
+		inline constexpr uint8_t WEIGHTS_2[4] = { 0, 21, 43, 64 };
+		inline constexpr uint8_t WEIGHTS_3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+		inline constexpr uint8_t WEIGHTS_4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+		inline const uint8_t* GetWeights(uint32_t indexBits)
+		{
+			return indexBits == 2 ? WEIGHTS_2 : indexBits == 3 ? WEIGHTS_3 : WEIGHTS_4;
+		}
+
+		inline bool IsAnchor(uint32_t subsetCount, uint32_t partition, uint32_t texel)
+		{
+			if (texel == 0)
+				return true;
+			if (subsetCount == 2)
+				return texel == ANCHORS_2[partition];
+			if (subsetCount == 3)
+				return texel == ANCHORS_3_SECOND[partition] || texel == ANCHORS_3_THIRD[partition];
+			return false;
+		}
+
+		inline uint32_t GetSubset(uint32_t subsetCount, uint32_t partition, uint32_t texel)
+		{
+			if (subsetCount == 2)
+				return PARTITIONS_2[partition][texel];
+			if (subsetCount == 3)
+				return PARTITIONS_3[partition][texel];
+			return 0;
+		}
+
+		//
+		// BC6H
+		//
+		enum Bc6hField : uint8_t
+		{
+			RW, GW, BW,
+			RX, GX, BX,
+			RY, GY, BY,
+			RZ, GZ, BZ,
+			PARTITION,
+			FIELD_COUNT,
+		};
+
+		// A run of bits in the block that belongs to one field, starting at bit lsb of that field.
+		struct Bc6hBits
+		{
+			Bc6hField field;
+			uint8_t lsb;
+			uint8_t count;
+			// Stored from the most significant bit down.
+			bool reversed = false;
+		};
+
+		struct Bc6hMode
+		{
+			bool transformed;
+			uint8_t endpointBits;
+			uint8_t deltaBits[3];
+			bool twoSubsets;
+			std::vector<Bc6hBits> layout;
+		};
+
+		// Indexed with the mode bits, the layouts are in the order they're stored in after those.
+		inline const std::map<uint32_t, Bc6hMode>& GetBc6hModes()
+		{
+			static const std::map<uint32_t, Bc6hMode> modes = {
+				{ 0x00, { true, 10, { 5, 5, 5 }, true, {
+					{ GY, 4, 1 }, { BY, 4, 1 }, { BZ, 4, 1 }, { RW, 0, 10 }, { GW, 0, 10 }, { BW, 0, 10 }, { RX, 0, 5 }, { GZ, 4, 1 }, { GY, 0, 4 },
+					{ GX, 0, 5 }, { BZ, 0, 1 }, { GZ, 0, 4 }, { BX, 0, 5 }, { BZ, 1, 1 }, { BY, 0, 4 }, { RY, 0, 5 }, { BZ, 2, 1 }, { RZ, 0, 5 },
+					{ BZ, 3, 1 }, { PARTITION, 0, 5 } } } },
+				{ 0x01, { true, 7, { 6, 6, 6 }, true, {
+					{ GY, 5, 1 }, { GZ, 4, 1 }, { GZ, 5, 1 }, { RW, 0, 7 }, { BZ, 0, 1 }, { BZ, 1, 1 }, { BY, 4, 1 }, { GW, 0, 7 }, { BY, 5, 1 },
+					{ BZ, 2, 1 }, { GY, 4, 1 }, { BW, 0, 7 }, { BZ, 3, 1 }, { BZ, 5, 1 }, { BZ, 4, 1 }, { RX, 0, 6 }, { GY, 0, 4 }, { GX, 0, 6 },
+					{ GZ, 0, 4 }, { BX, 0, 6 }, { BY, 0, 4 }, { RY, 0, 6 }, { RZ, 0, 6 }, { PARTITION, 0, 5 } } } },
+				{ 0x02, { true, 11, { 5, 4, 4 }, true, {
+					{ RW, 0, 10 }, { GW, 0, 10 }, { BW, 0, 10 }, { RX, 0, 5 }, { RW, 10, 1 }, { GY, 0, 4 }, { GX, 0, 4 }, { GW, 10, 1 }, { BZ, 0, 1 },
+					{ GZ, 0, 4 }, { BX, 0, 4 }, { BW, 10, 1 }, { BZ, 1, 1 }, { BY, 0, 4 }, { RY, 0, 5 }, { BZ, 2, 1 }, { RZ, 0, 5 }, { BZ, 3, 1 },
+					{ PARTITION, 0, 5 } } } },
+				{ 0x06, { true, 11, { 4, 5, 4 }, true, {
+					{ RW, 0, 10 }, { GW, 0, 10 }, { BW, 0, 10 }, { RX, 0, 4 }, { RW, 10, 1 }, { GZ, 4, 1 }, { GY, 0, 4 }, { GX, 0, 5 }, { GW, 10, 1 },
+					{ GZ, 0, 4 }, { BX, 0, 4 }, { BW, 10, 1 }, { BZ, 1, 1 }, { BY, 0, 4 }, { RY, 0, 4 }, { BZ, 0, 1 }, { BZ, 2, 1 }, { RZ, 0, 4 },
+					{ GY, 4, 1 }, { BZ, 3, 1 }, { PARTITION, 0, 5 } } } },
+				{ 0x0A, { true, 11, { 4, 4, 5 }, true, {
+					{ RW, 0, 10 }, { GW, 0, 10 }, { BW, 0, 10 }, { RX, 0, 4 }, { RW, 10, 1 }, { BY, 4, 1 }, { GY, 0, 4 }, { GX, 0, 4 }, { GW, 10, 1 },
+					{ BZ, 0, 1 }, { GZ, 0, 4 }, { BX, 0, 5 }, { BW, 10, 1 }, { BY, 0, 4 }, { RY, 0, 4 }, { BZ, 1, 1 }, { BZ, 2, 1 }, { RZ, 0, 4 },
+					{ BZ, 4, 1 }, { BZ, 3, 1 }, { PARTITION, 0, 5 } } } },
+				{ 0x0E, { true, 9, { 5, 5, 5 }, true, {
+					{ RW, 0, 9 }, { BY, 4, 1 }, { GW, 0, 9 }, { GY, 4, 1 }, { BW, 0, 9 }, { BZ, 4, 1 }, { RX, 0, 5 }, { GZ, 4, 1 }, { GY, 0, 4 },
+					{ GX, 0, 5 }, { BZ, 0, 1 }, { GZ, 0, 4 }, { BX, 0, 5 }, { BZ, 1, 1 }, { BY, 0, 4 }, { RY, 0, 5 }, { BZ, 2, 1 }, { RZ, 0, 5 },
+					{ BZ, 3, 1 }, { PARTITION, 0, 5 } } } },
+				{ 0x12, { true, 8, { 6, 5, 5 }, true, {
+					{ RW, 0, 8 }, { GZ, 4, 1 }, { BY, 4, 1 }, { GW, 0, 8 }, { BZ, 2, 1 }, { GY, 4, 1 }, { BW, 0, 8 }, { BZ, 3, 1 }, { BZ, 4, 1 },
+					{ RX, 0, 6 }, { GY, 0, 4 }, { GX, 0, 5 }, { BZ, 0, 1 }, { GZ, 0, 4 }, { BX, 0, 5 }, { BZ, 1, 1 }, { BY, 0, 4 }, { RY, 0, 6 },
+					{ RZ, 0, 6 }, { PARTITION, 0, 5 } } } },
+				{ 0x16, { true, 8, { 5, 6, 5 }, true, {
+					{ RW, 0, 8 }, { BZ, 0, 1 }, { BY, 4, 1 }, { GW, 0, 8 }, { GY, 5, 1 }, { GY, 4, 1 }, { BW, 0, 8 }, { GZ, 5, 1 }, { BZ, 4, 1 },
+					{ RX, 0, 5 }, { GZ, 4, 1 }, { GY, 0, 4 }, { GX, 0, 6 }, { GZ, 0, 4 }, { BX, 0, 5 }, { BZ, 1, 1 }, { BY, 0, 4 }, { RY, 0, 5 },
+					{ BZ, 2, 1 }, { RZ, 0, 5 }, { BZ, 3, 1 }, { PARTITION, 0, 5 } } } },
+				{ 0x1A, { true, 8, { 5, 5, 6 }, true, {
+					{ RW, 0, 8 }, { BZ, 1, 1 }, { BY, 4, 1 }, { GW, 0, 8 }, { BY, 5, 1 }, { GY, 4, 1 }, { BW, 0, 8 }, { BZ, 5, 1 }, { BZ, 4, 1 },
+					{ RX, 0, 5 }, { GZ, 4, 1 }, { GY, 0, 4 }, { GX, 0, 5 }, { BZ, 0, 1 }, { GZ, 0, 4 }, { BX, 0, 6 }, { BY, 0, 4 }, { RY, 0, 5 },
+					{ BZ, 2, 1 }, { RZ, 0, 5 }, { BZ, 3, 1 }, { PARTITION, 0, 5 } } } },
+				{ 0x1E, { false, 6, { 6, 6, 6 }, true, {
+					{ RW, 0, 6 }, { GZ, 4, 1 }, { BZ, 0, 1 }, { BZ, 1, 1 }, { BY, 4, 1 }, { GW, 0, 6 }, { GY, 5, 1 }, { BY, 5, 1 }, { BZ, 2, 1 },
+					{ GY, 4, 1 }, { BW, 0, 6 }, { GZ, 5, 1 }, { BZ, 3, 1 }, { BZ, 5, 1 }, { BZ, 4, 1 }, { RX, 0, 6 }, { GY, 0, 4 }, { GX, 0, 6 },
+					{ GZ, 0, 4 }, { BX, 0, 6 }, { BY, 0, 4 }, { RY, 0, 6 }, { RZ, 0, 6 }, { PARTITION, 0, 5 } } } },
+				{ 0x03, { false, 10, { 10, 10, 10 }, false, {
+					{ RW, 0, 10 }, { GW, 0, 10 }, { BW, 0, 10 }, { RX, 0, 10 }, { GX, 0, 10 }, { BX, 0, 10 } } } },
+				{ 0x07, { true, 11, { 9, 9, 9 }, false, {
+					{ RW, 0, 10 }, { GW, 0, 10 }, { BW, 0, 10 }, { RX, 0, 9 }, { RW, 10, 1 }, { GX, 0, 9 }, { GW, 10, 1 }, { BX, 0, 9 }, { BW, 10, 1 } } } },
+				{ 0x0B, { true, 12, { 8, 8, 8 }, false, {
+					{ RW, 0, 10 }, { GW, 0, 10 }, { BW, 0, 10 }, { RX, 0, 8 }, { RW, 10, 2, true }, { GX, 0, 8 }, { GW, 10, 2, true },
+					{ BX, 0, 8 }, { BW, 10, 2, true } } } },
+				{ 0x0F, { true, 16, { 4, 4, 4 }, false, {
+					{ RW, 0, 10 }, { GW, 0, 10 }, { BW, 0, 10 }, { RX, 0, 4 }, { RW, 10, 6, true }, { GX, 0, 4 }, { GW, 10, 6, true },
+					{ BX, 0, 4 }, { BW, 10, 6, true } } } },
+			};
+			return modes;
+		}
+
+		inline int32_t SignExtend(uint32_t value, uint32_t bits)
+		{
+			const uint32_t shift = 32 - bits;
+			return static_cast<int32_t>(value << shift) >> shift;
+		}
+
+		inline int32_t Bc6hUnquantize(int32_t value, uint32_t bits, bool isSigned)
+		{
+			if (!isSigned)
+			{
+				if (bits >= 15 || value == 0)
+					return value;
+				if (value == (1 << bits) - 1)
+					return 0xFFFF;
+				return ((value << 16) + 0x8000) >> bits;
+			}
+
+			if (bits >= 16)
+				return value;
+
+			const bool negative = value < 0;
+			const int32_t magnitude = negative ? -value : value;
+			int32_t unquantized = 0;
+			if (magnitude == 0)
+				unquantized = 0;
+			else if (magnitude >= (1 << (bits - 1)) - 1)
+				unquantized = 0x7FFF;
+			else
+				unquantized = ((magnitude << 15) + 0x4000) >> (bits - 1);
+
+			return negative ? -unquantized : unquantized;
+		}
+
+		// Scales the interpolated value to the range of a half float and returns its bits.
+		inline uint16_t Bc6hFinish(int32_t value, bool isSigned)
+		{
+			if (!isSigned)
+				return static_cast<uint16_t>((value * 31) >> 6);
+
+			if (value < 0)
+				return static_cast<uint16_t>(0x8000 | ((-value * 31) >> 5));
+			return static_cast<uint16_t>((value * 31) >> 5);
+		}
+
+		//
+		// BC7
+		//
+		struct Bc7Mode
+		{
+			uint8_t subsetCount;
+			uint8_t partitionBits;
+			uint8_t rotationBits;
+			uint8_t indexSelectionBits;
+			uint8_t colorBits;
+			uint8_t alphaBits;
+			uint8_t endpointPBits;
+			uint8_t sharedPBits;
+			uint8_t indexBits;
+			uint8_t secondaryIndexBits;
+		};
+
+		inline constexpr Bc7Mode BC7_MODES[8] = {
+			{ 3, 4, 0, 0, 4, 0, 1, 0, 3, 0 },
+			{ 2, 6, 0, 0, 6, 0, 0, 1, 3, 0 },
+			{ 3, 6, 0, 0, 5, 0, 0, 0, 2, 0 },
+			{ 2, 6, 0, 0, 7, 0, 1, 0, 2, 0 },
+			{ 1, 0, 2, 1, 5, 6, 0, 0, 2, 3 },
+			{ 1, 0, 2, 0, 7, 8, 0, 0, 2, 2 },
+			{ 1, 0, 0, 0, 7, 7, 1, 0, 4, 0 },
+			{ 2, 6, 0, 0, 5, 5, 1, 0, 2, 0 },
+		};
+
+		inline uint8_t Bc7Unquantize(uint32_t value, uint32_t bits)
+		{
+			value <<= 8 - bits;
+			return static_cast<uint8_t>(value | (value >> bits));
+		}
+
+		inline uint8_t Interpolate(uint32_t e0, uint32_t e1, uint32_t weight)
+		{
+			return static_cast<uint8_t>(((64 - weight) * e0 + weight * e1 + 32) >> 6);
+		}
+	}
+}
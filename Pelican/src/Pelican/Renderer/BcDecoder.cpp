@@ -0,0 +1,431 @@
+﻿#include "PelicanPCH.h"
+#include "BcDecoder.h"
+
+#include <cstring>
+
+#include "BcCommon.h"
+
+namespace Pelican
+{
+	namespace BcDecoder
+	{
+		using namespace BcCommon;
+
+		namespace
+		{
+			//
+			// BC1 - BC5
+			//
+			void Expand565(uint16_t color, uint8_t* pRgb)
+			{
+				const uint32_t r = (color >> 11) & 0x1F;
+				const uint32_t g = (color >> 5) & 0x3F;
+				const uint32_t b = color & 0x1F;
+				pRgb[0] = static_cast<uint8_t>((r << 3) | (r >> 2));
+				pRgb[1] = static_cast<uint8_t>((g << 2) | (g >> 4));
+				pRgb[2] = static_cast<uint8_t>((b << 3) | (b >> 2));
+			}
+
+			// BC1 picks between 4 colors or 3 colors and black by the order of the endpoints, the color part of BC3 is
+			// always 4 colors. The black is only transparent in the BC1 formats with alpha.
+			void DecodeColorBlock(const uint8_t* pBlock, uint8_t* pDst, size_t pitch, bool allowThreeColors, bool hasAlpha)
+			{
+				const uint16_t color0 = static_cast<uint16_t>(pBlock[0] | (pBlock[1] << 8));
+				const uint16_t color1 = static_cast<uint16_t>(pBlock[2] | (pBlock[3] << 8));
+
+				uint8_t palette[4][4]{};
+				Expand565(color0, palette[0]);
+				Expand565(color1, palette[1]);
+				palette[0][3] = palette[1][3] = 255;
+
+				const bool fourColors = color0 > color1 || !allowThreeColors;
+				for (uint32_t c = 0; c < 3; c++)
+				{
+					if (fourColors)
+					{
+						palette[2][c] = static_cast<uint8_t>((2 * palette[0][c] + palette[1][c]) / 3);
+						palette[3][c] = static_cast<uint8_t>((palette[0][c] + 2 * palette[1][c]) / 3);
+					}
+					else
+					{
+						palette[2][c] = static_cast<uint8_t>((palette[0][c] + palette[1][c]) / 2);
+						palette[3][c] = 0;
+					}
+				}
+				palette[2][3] = 255;
+				palette[3][3] = fourColors || !hasAlpha ? 255 : 0;
+
+				const uint32_t indices = pBlock[4] | (pBlock[5] << 8) | (pBlock[6] << 16) | (static_cast<uint32_t>(pBlock[7]) << 24);
+				for (uint32_t texel = 0; texel < BLOCK_TEXELS; texel++)
+				{
+					uint8_t* pTexel = pDst + (texel / BLOCK_SIZE) * pitch + (texel % BLOCK_SIZE) * 4;
+					memcpy(pTexel, palette[(indices >> (texel * 2)) & 3], 4);
+				}
+			}
+
+			// The alpha part of BC3, also used for every channel of BC4 and BC5. Writes every stride bytes.
+			void DecodeChannelBlock(const uint8_t* pBlock, uint8_t* pDst, size_t pitch, size_t stride)
+			{
+				const uint32_t value0 = pBlock[0];
+				const uint32_t value1 = pBlock[1];
+
+				uint8_t palette[8]{ static_cast<uint8_t>(value0), static_cast<uint8_t>(value1) };
+				if (value0 > value1)
+				{
+					for (uint32_t i = 2; i < 8; i++)
+					{
+						palette[i] = static_cast<uint8_t>(((8 - i) * value0 + (i - 1) * value1) / 7);
+					}
+				}
+				else
+				{
+					for (uint32_t i = 2; i < 6; i++)
+					{
+						palette[i] = static_cast<uint8_t>(((6 - i) * value0 + (i - 1) * value1) / 5);
+					}
+					palette[6] = 0;
+					palette[7] = 255;
+				}
+
+				uint64_t indices = 0;
+				for (uint32_t i = 0; i < 6; i++)
+				{
+					indices |= static_cast<uint64_t>(pBlock[2 + i]) << (8 * i);
+				}
+
+				for (uint32_t texel = 0; texel < BLOCK_TEXELS; texel++)
+				{
+					pDst[(texel / BLOCK_SIZE) * pitch + (texel % BLOCK_SIZE) * stride] = palette[(indices >> (texel * 3)) & 7];
+				}
+			}
+		}
+
+		vk::Format GetDecodedFormat(vk::Format format)
+		{
+			switch (format)
+			{
+			case vk::Format::eBc1RgbUnormBlock:
+			case vk::Format::eBc1RgbaUnormBlock:
+			case vk::Format::eBc3UnormBlock:
+			case vk::Format::eBc7UnormBlock:
+				return vk::Format::eR8G8B8A8Unorm;
+			case vk::Format::eBc1RgbSrgbBlock:
+			case vk::Format::eBc1RgbaSrgbBlock:
+			case vk::Format::eBc3SrgbBlock:
+			case vk::Format::eBc7SrgbBlock:
+				return vk::Format::eR8G8B8A8Srgb;
+			case vk::Format::eBc4UnormBlock:
+				return vk::Format::eR8Unorm;
+			case vk::Format::eBc5UnormBlock:
+				return vk::Format::eR8G8Unorm;
+			case vk::Format::eBc6HUfloatBlock:
+			case vk::Format::eBc6HSfloatBlock:
+				return vk::Format::eR16G16B16A16Sfloat;
+			default:
+				return vk::Format::eUndefined;
+			}
+		}
+
+		void DecodeImage(vk::Format format, const uint8_t* pBlocks, uint32_t width, uint32_t height, uint8_t* pTexels)
+		{
+			const vk::Format decodedFormat = GetDecodedFormat(format);
+			ASSERT_MSG(decodedFormat != vk::Format::eUndefined, "Format can't be decoded on the CPU!");
+
+			const bool isBc1 = format == vk::Format::eBc1RgbUnormBlock || format == vk::Format::eBc1RgbaUnormBlock
+				|| format == vk::Format::eBc1RgbSrgbBlock || format == vk::Format::eBc1RgbaSrgbBlock;
+			const bool isBc4 = format == vk::Format::eBc4UnormBlock;
+			const size_t blockSize = isBc1 || isBc4 ? 8 : 16;
+			const size_t texelSize = decodedFormat == vk::Format::eR8Unorm ? 1
+				: decodedFormat == vk::Format::eR8G8Unorm ? 2
+				: decodedFormat == vk::Format::eR16G16B16A16Sfloat ? 8 : 4;
+
+			// Blocks are decoded into a full 4x4 first, the edges of the image can cut them off.
+			uint8_t block[BLOCK_TEXELS * 8]{};
+			const size_t blockPitch = BLOCK_SIZE * texelSize;
+
+			const uint32_t blocksX = (width + BLOCK_SIZE - 1) / BLOCK_SIZE;
+			const uint32_t blocksY = (height + BLOCK_SIZE - 1) / BLOCK_SIZE;
+			for (uint32_t by = 0; by < blocksY; by++)
+			{
+				for (uint32_t bx = 0; bx < blocksX; bx++)
+				{
+					const uint8_t* pBlock = pBlocks + (static_cast<size_t>(by) * blocksX + bx) * blockSize;
+					switch (format)
+					{
+					case vk::Format::eBc1RgbUnormBlock:
+					case vk::Format::eBc1RgbSrgbBlock:
+						DecodeBc1(pBlock, block, blockPitch, false);
+						break;
+					case vk::Format::eBc1RgbaUnormBlock:
+					case vk::Format::eBc1RgbaSrgbBlock:
+						DecodeBc1(pBlock, block, blockPitch, true);
+						break;
+					case vk::Format::eBc3UnormBlock:
+					case vk::Format::eBc3SrgbBlock:
+						DecodeBc3(pBlock, block, blockPitch);
+						break;
+					case vk::Format::eBc4UnormBlock:
+						DecodeBc4(pBlock, block, blockPitch);
+						break;
+					case vk::Format::eBc5UnormBlock:
+						DecodeBc5(pBlock, block, blockPitch);
+						break;
+					case vk::Format::eBc6HUfloatBlock:
+					case vk::Format::eBc6HSfloatBlock:
+						DecodeBc6h(pBlock, reinterpret_cast<uint16_t*>(block), blockPitch, format == vk::Format::eBc6HSfloatBlock);
+						break;
+					default:
+						DecodeBc7(pBlock, block, blockPitch);
+						break;
+					}
+
+					const uint32_t rows = std::min(BLOCK_SIZE, height - by * BLOCK_SIZE);
+					const uint32_t columns = std::min(BLOCK_SIZE, width - bx * BLOCK_SIZE);
+					for (uint32_t row = 0; row < rows; row++)
+					{
+						uint8_t* pDstRow = pTexels + ((static_cast<size_t>(by) * BLOCK_SIZE + row) * width + bx * BLOCK_SIZE) * texelSize;
+						memcpy(pDstRow, block + row * blockPitch, columns * texelSize);
+					}
+				}
+			}
+		}
+
+		void DecodeBc1(const uint8_t* pBlock, uint8_t* pDst, size_t pitch, bool hasAlpha)
+		{
+			DecodeColorBlock(pBlock, pDst, pitch, true, hasAlpha);
+		}
+
+		void DecodeBc3(const uint8_t* pBlock, uint8_t* pDst, size_t pitch)
+		{
+			DecodeColorBlock(pBlock + 8, pDst, pitch, false, false);
+			DecodeChannelBlock(pBlock, pDst + 3, pitch, 4);
+		}
+
+		void DecodeBc4(const uint8_t* pBlock, uint8_t* pDst, size_t pitch)
+		{
+			DecodeChannelBlock(pBlock, pDst, pitch, 1);
+		}
+
+		void DecodeBc5(const uint8_t* pBlock, uint8_t* pDst, size_t pitch)
+		{
+			DecodeChannelBlock(pBlock, pDst, pitch, 2);
+			DecodeChannelBlock(pBlock + 8, pDst + 1, pitch, 2);
+		}
+
+		void DecodeBc6h(const uint8_t* pBlock, uint16_t* pDst, size_t pitch, bool isSigned)
+		{
+			constexpr uint16_t HALF_ONE = 0x3C00;
+			const size_t pitchInHalfs = pitch / sizeof(uint16_t);
+
+			BitReader reader(pBlock);
+			uint32_t modeBits = reader.Read(2);
+			if (modeBits > 1)
+			{
+				modeBits |= reader.Read(3) << 2;
+			}
+
+			const auto& modes = GetBc6hModes();
+			const auto modeIt = modes.find(modeBits);
+			if (modeIt == modes.end())
+			{
+				// Reserved modes decode to black.
+				for (uint32_t texel = 0; texel < BLOCK_TEXELS; texel++)
+				{
+					uint16_t* pTexel = pDst + (texel / BLOCK_SIZE) * pitchInHalfs + (texel % BLOCK_SIZE) * 4;
+					pTexel[0] = pTexel[1] = pTexel[2] = 0;
+					pTexel[3] = HALF_ONE;
+				}
+				return;
+			}
+			const Bc6hMode& mode = modeIt->second;
+
+			uint32_t fields[FIELD_COUNT]{};
+			for (const Bc6hBits& bits : mode.layout)
+			{
+				const uint32_t value = bits.reversed ? reader.ReadReversed(bits.count) : reader.Read(bits.count);
+				fields[bits.field] |= value << bits.lsb;
+			}
+
+			// Endpoints per channel: subset 0 is w and x, subset 1 is y and z.
+			const uint32_t subsetCount = mode.twoSubsets ? 2 : 1;
+			const uint32_t endpointMask = (1u << mode.endpointBits) - 1;
+			int32_t endpoints[2][2][3]{};
+			for (uint32_t channel = 0; channel < 3; channel++)
+			{
+				const uint32_t base = fields[RW + channel];
+				const uint32_t others[3] = { fields[RX + channel], fields[RY + channel], fields[RZ + channel] };
+
+				int32_t values[4]{};
+				values[0] = isSigned ? SignExtend(base, mode.endpointBits) : static_cast<int32_t>(base);
+				for (uint32_t i = 0; i < 3; i++)
+				{
+					if (mode.transformed)
+					{
+						// The others are deltas from the first endpoint.
+						const uint32_t value = (base + static_cast<uint32_t>(SignExtend(others[i], mode.deltaBits[channel]))) & endpointMask;
+						values[i + 1] = isSigned ? SignExtend(value, mode.endpointBits) : static_cast<int32_t>(value);
+					}
+					else
+					{
+						values[i + 1] = isSigned ? SignExtend(others[i], mode.endpointBits) : static_cast<int32_t>(others[i]);
+					}
+				}
+
+				for (uint32_t i = 0; i < 4; i++)
+				{
+					endpoints[i / 2][i % 2][channel] = Bc6hUnquantize(values[i], mode.endpointBits, isSigned);
+				}
+			}
+
+			const uint32_t partition = fields[PARTITION];
+			const uint32_t indexBits = mode.twoSubsets ? 3 : 4;
+			const uint8_t* pWeights = GetWeights(indexBits);
+			for (uint32_t texel = 0; texel < BLOCK_TEXELS; texel++)
+			{
+				const uint32_t index = reader.Read(IsAnchor(subsetCount, partition, texel) ? indexBits - 1 : indexBits);
+				const uint32_t subset = GetSubset(subsetCount, partition, texel);
+				const uint32_t weight = pWeights[index];
+
+				uint16_t* pTexel = pDst + (texel / BLOCK_SIZE) * pitchInHalfs + (texel % BLOCK_SIZE) * 4;
+				for (uint32_t channel = 0; channel < 3; channel++)
+				{
+					const int32_t e0 = endpoints[subset][0][channel];
+					const int32_t e1 = endpoints[subset][1][channel];
+					const int32_t value = ((64 - static_cast<int32_t>(weight)) * e0 + static_cast<int32_t>(weight) * e1 + 32) >> 6;
+					pTexel[channel] = Bc6hFinish(value, isSigned);
+				}
+				pTexel[3] = HALF_ONE;
+			}
+		}
+
+		void DecodeBc7(const uint8_t* pBlock, uint8_t* pDst, size_t pitch)
+		{
+			BitReader reader(pBlock);
+
+			// The mode is the number of zero bits before the first one.
+			uint32_t modeIndex = 0;
+			while (modeIndex < 8 && reader.Read(1) == 0)
+			{
+				modeIndex++;
+			}
+
+			if (modeIndex == 8)
+			{
+				// Reserved, decodes to transparent black.
+				for (uint32_t row = 0; row < BLOCK_SIZE; row++)
+				{
+					memset(pDst + row * pitch, 0, BLOCK_SIZE * 4);
+				}
+				return;
+			}
+
+			const Bc7Mode& mode = BC7_MODES[modeIndex];
+			const uint32_t partition = reader.Read(mode.partitionBits);
+			const uint32_t rotation = reader.Read(mode.rotationBits);
+			const uint32_t indexSelection = reader.Read(mode.indexSelectionBits);
+
+			// Channel by channel, subset by subset, two endpoints each.
+			uint32_t endpoints[3][2][4]{};
+			for (uint32_t channel = 0; channel < 4; channel++)
+			{
+				const uint32_t bits = channel < 3 ? mode.colorBits : mode.alphaBits;
+				for (uint32_t subset = 0; subset < mode.subsetCount; subset++)
+				{
+					for (uint32_t endpoint = 0; endpoint < 2; endpoint++)
+					{
+						endpoints[subset][endpoint][channel] = reader.Read(bits);
+					}
+				}
+			}
+
+			// P-bits are an extra least significant bit, either one per endpoint or one shared by a subset's endpoints.
+			uint32_t pBits[3][2]{};
+			const bool hasPBits = mode.endpointPBits || mode.sharedPBits;
+			for (uint32_t subset = 0; subset < mode.subsetCount; subset++)
+			{
+				if (mode.endpointPBits)
+				{
+					pBits[subset][0] = reader.Read(1);
+					pBits[subset][1] = reader.Read(1);
+				}
+			}
+			if (mode.sharedPBits)
+			{
+				for (uint32_t subset = 0; subset < mode.subsetCount; subset++)
+				{
+					pBits[subset][0] = pBits[subset][1] = reader.Read(1);
+				}
+			}
+
+			for (uint32_t subset = 0; subset < mode.subsetCount; subset++)
+			{
+				for (uint32_t endpoint = 0; endpoint < 2; endpoint++)
+				{
+					uint32_t* pEndpoint = endpoints[subset][endpoint];
+					for (uint32_t channel = 0; channel < 4; channel++)
+					{
+						uint32_t bits = channel < 3 ? mode.colorBits : mode.alphaBits;
+						if (bits == 0)
+						{
+							pEndpoint[channel] = 255;
+							continue;
+						}
+
+						if (hasPBits)
+						{
+							pEndpoint[channel] = (pEndpoint[channel] << 1) | pBits[subset][endpoint];
+							bits++;
+						}
+						pEndpoint[channel] = Bc7Unquantize(pEndpoint[channel], bits);
+					}
+				}
+			}
+
+			// Modes 4 and 5 have a second set of indices for alpha, which never has anchors other than texel 0.
+			uint32_t indices[BLOCK_TEXELS]{};
+			for (uint32_t texel = 0; texel < BLOCK_TEXELS; texel++)
+			{
+				indices[texel] = reader.Read(IsAnchor(mode.subsetCount, partition, texel) ? mode.indexBits - 1u : mode.indexBits);
+			}
+
+			uint32_t secondaryIndices[BLOCK_TEXELS]{};
+			if (mode.secondaryIndexBits)
+			{
+				for (uint32_t texel = 0; texel < BLOCK_TEXELS; texel++)
+				{
+					secondaryIndices[texel] = reader.Read(texel == 0 ? mode.secondaryIndexBits - 1u : mode.secondaryIndexBits);
+				}
+			}
+
+			for (uint32_t texel = 0; texel < BLOCK_TEXELS; texel++)
+			{
+				const uint32_t subset = GetSubset(mode.subsetCount, partition, texel);
+				const uint32_t* pE0 = endpoints[subset][0];
+				const uint32_t* pE1 = endpoints[subset][1];
+
+				uint32_t colorWeight = GetWeights(mode.indexBits)[indices[texel]];
+				uint32_t alphaWeight = colorWeight;
+				if (mode.secondaryIndexBits)
+				{
+					const uint32_t secondaryWeight = GetWeights(mode.secondaryIndexBits)[secondaryIndices[texel]];
+					// The index selection bit swaps which set goes to color and which to alpha.
+					alphaWeight = indexSelection ? colorWeight : secondaryWeight;
+					colorWeight = indexSelection ? secondaryWeight : colorWeight;
+				}
+
+				uint8_t* pTexel = pDst + (texel / BLOCK_SIZE) * pitch + (texel % BLOCK_SIZE) * 4;
+				for (uint32_t channel = 0; channel < 3; channel++)
+				{
+					pTexel[channel] = Interpolate(pE0[channel], pE1[channel], colorWeight);
+				}
+				pTexel[3] = Interpolate(pE0[3], pE1[3], alphaWeight);
+
+				// Rotation swaps alpha with one of the color channels.
+				if (rotation > 0)
+				{
+					std::swap(pTexel[3], pTexel[rotation - 1]);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,26 @@
+﻿#pragma once
+#include <vulkan/vulkan.hpp>
+
+namespace Pelican
+{
+	// Decompresses BC1, BC3, BC4, BC5, BC6H and BC7 on the CPU, for devices that don't have textureCompressionBC.
+	namespace BcDecoder
+	{
+		// What a block compressed format gets decoded into: RGBA8 (sRGB when the source is), R8 for BC4, RG8 for BC5
+		// and RGBA16F for BC6H. Returns eUndefined for formats this can't decode.
+		[[nodiscard]] vk::Format GetDecodedFormat(vk::Format format);
+
+		// Decodes a whole width by height image, pTexels gets the texels of GetDecodedFormat(format) tightly packed.
+		void DecodeImage(vk::Format format, const uint8_t* pBlocks, uint32_t width, uint32_t height, uint8_t* pTexels);
+
+		// Single 4x4 blocks, pitch is the distance between rows of the destination in bytes.
+		// hasAlpha is false for the BC1 RGB formats, their third color mode uses opaque black.
+		void DecodeBc1(const uint8_t* pBlock, uint8_t* pDst, size_t pitch, bool hasAlpha);
+		void DecodeBc3(const uint8_t* pBlock, uint8_t* pDst, size_t pitch);
+		void DecodeBc4(const uint8_t* pBlock, uint8_t* pDst, size_t pitch);
+		void DecodeBc5(const uint8_t* pBlock, uint8_t* pDst, size_t pitch);
+		// Writes half floats, alpha is always 1.
+		void DecodeBc6h(const uint8_t* pBlock, uint16_t* pDst, size_t pitch, bool isSigned);
+		void DecodeBc7(const uint8_t* pBlock, uint8_t* pDst, size_t pitch);
+	}
+}
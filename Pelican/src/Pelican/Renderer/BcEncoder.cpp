@@ -0,0 +1,1208 @@
+﻿#include "PelicanPCH.h"
+#include "BcEncoder.h"
+
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#include "BcCommon.h"
+#include "TextureFormat.h"
+#include "Pelican/Core/ThreadPool.h"
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__)
+#define PELICAN_BC_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace Pelican
+{
+	namespace BcEncoder
+	{
+		using namespace BcCommon;
+
+		namespace
+		{
+			constexpr uint32_t MAX_CHANNELS = 4;
+
+			using Texels = float[BLOCK_TEXELS][MAX_CHANNELS];
+			using Color = uint8_t[MAX_CHANNELS];
+
+			uint32_t GetRefinementCount(Quality quality)
+			{
+				return quality == Quality::Fast ? 0 : quality == Quality::Normal ? 1 : 3;
+			}
+
+			//
+			// Fitting
+			//
+
+			// Mean of the texels and the direction they vary the most in, returns how much of the variation that direction covers.
+			float FindPrincipalAxis(const Texels& texels, const uint8_t* pTexelList, uint32_t count, uint32_t channelCount,
+				float* pMean, float* pAxis)
+			{
+				for (uint32_t c = 0; c < MAX_CHANNELS; c++)
+				{
+					pMean[c] = 0.0f;
+					pAxis[c] = 0.0f;
+				}
+				if (count == 0)
+					return 0.0f;
+
+				for (uint32_t i = 0; i < count; i++)
+				{
+					for (uint32_t c = 0; c < channelCount; c++)
+					{
+						pMean[c] += texels[pTexelList[i]][c];
+					}
+				}
+				for (uint32_t c = 0; c < channelCount; c++)
+				{
+					pMean[c] /= static_cast<float>(count);
+				}
+
+				float covariance[MAX_CHANNELS][MAX_CHANNELS]{};
+				for (uint32_t i = 0; i < count; i++)
+				{
+					float delta[MAX_CHANNELS]{};
+					for (uint32_t c = 0; c < channelCount; c++)
+					{
+						delta[c] = texels[pTexelList[i]][c] - pMean[c];
+					}
+					for (uint32_t a = 0; a < channelCount; a++)
+					{
+						for (uint32_t b = 0; b < channelCount; b++)
+						{
+							covariance[a][b] += delta[a] * delta[b];
+						}
+					}
+				}
+
+				// Power iteration, starting from the channel that varies the most.
+				uint32_t largest = 0;
+				for (uint32_t c = 1; c < channelCount; c++)
+				{
+					if (covariance[c][c] > covariance[largest][largest])
+						largest = c;
+				}
+				for (uint32_t c = 0; c < channelCount; c++)
+				{
+					pAxis[c] = covariance[largest][c];
+				}
+
+				float eigenvalue = 0.0f;
+				for (uint32_t iteration = 0; iteration < 8; iteration++)
+				{
+					float length = 0.0f;
+					for (uint32_t c = 0; c < channelCount; c++)
+					{
+						length += pAxis[c] * pAxis[c];
+					}
+					if (length < 1e-12f)
+					{
+						for (uint32_t c = 0; c < channelCount; c++)
+						{
+							pAxis[c] = 0.0f;
+						}
+						return 0.0f;
+					}
+
+					length = std::sqrt(length);
+					float next[MAX_CHANNELS]{};
+					for (uint32_t a = 0; a < channelCount; a++)
+					{
+						pAxis[a] /= length;
+					}
+					for (uint32_t a = 0; a < channelCount; a++)
+					{
+						for (uint32_t b = 0; b < channelCount; b++)
+						{
+							next[a] += covariance[a][b] * pAxis[b];
+						}
+					}
+
+					eigenvalue = 0.0f;
+					for (uint32_t c = 0; c < channelCount; c++)
+					{
+						eigenvalue += next[c] * pAxis[c];
+					}
+					if (iteration < 7)
+					{
+						memcpy(pAxis, next, sizeof(next));
+					}
+				}
+
+				return eigenvalue;
+			}
+
+			// The two ends of the principal axis that still cover all texels.
+			void FitEndpoints(const Texels& texels, const uint8_t* pTexelList, uint32_t count, uint32_t channelCount,
+				float maxValue, float* pE0, float* pE1)
+			{
+				float mean[MAX_CHANNELS]{};
+				float axis[MAX_CHANNELS]{};
+				FindPrincipalAxis(texels, pTexelList, count, channelCount, mean, axis);
+
+				float minT = 0.0f;
+				float maxT = 0.0f;
+				for (uint32_t i = 0; i < count; i++)
+				{
+					float t = 0.0f;
+					for (uint32_t c = 0; c < channelCount; c++)
+					{
+						t += (texels[pTexelList[i]][c] - mean[c]) * axis[c];
+					}
+					minT = std::min(minT, t);
+					maxT = std::max(maxT, t);
+				}
+
+				for (uint32_t c = 0; c < MAX_CHANNELS; c++)
+				{
+					pE0[c] = std::clamp(mean[c] + minT * axis[c], 0.0f, maxValue);
+					pE1[c] = std::clamp(mean[c] + maxT * axis[c], 0.0f, maxValue);
+				}
+			}
+
+			// Least squares endpoints for the weights the texels got, 0 is all e0 and 1 all e1.
+			// Returns false when the weights don't pin down two endpoints, for example when they're all the same.
+			bool RefineEndpoints(const Texels& texels, const uint8_t* pTexelList, uint32_t count, const float* pWeights,
+				uint32_t channelCount, float maxValue, float* pE0, float* pE1)
+			{
+				float aa = 0.0f;
+				float ab = 0.0f;
+				float bb = 0.0f;
+				float ax[MAX_CHANNELS]{};
+				float bx[MAX_CHANNELS]{};
+				for (uint32_t i = 0; i < count; i++)
+				{
+					const uint32_t texel = pTexelList[i];
+					const float b = pWeights[texel];
+					const float a = 1.0f - b;
+					aa += a * a;
+					ab += a * b;
+					bb += b * b;
+					for (uint32_t c = 0; c < channelCount; c++)
+					{
+						ax[c] += a * texels[texel][c];
+						bx[c] += b * texels[texel][c];
+					}
+				}
+
+				const float determinant = aa * bb - ab * ab;
+				if (std::abs(determinant) < 1e-6f)
+					return false;
+
+				for (uint32_t c = 0; c < channelCount; c++)
+				{
+					pE0[c] = std::clamp((bb * ax[c] - ab * bx[c]) / determinant, 0.0f, maxValue);
+					pE1[c] = std::clamp((aa * bx[c] - ab * ax[c]) / determinant, 0.0f, maxValue);
+				}
+				return true;
+			}
+
+			// Picks the closest palette entry for every texel and writes its squared error, the alpha channel counts as well.
+			void FindClosest(const uint8_t* pTexels, const Color* pPalette, uint32_t paletteSize, uint8_t* pIndices, uint32_t* pErrors)
+			{
+#ifdef PELICAN_BC_SSE2
+				// Four texels at a time, their channels widened to 16 bits so madd can square and sum them.
+				const __m128i zero = _mm_setzero_si128();
+				for (uint32_t group = 0; group < BLOCK_TEXELS; group += 4)
+				{
+					const __m128i texels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pTexels + group * 4));
+					const __m128i texels01 = _mm_unpacklo_epi8(texels, zero);
+					const __m128i texels23 = _mm_unpackhi_epi8(texels, zero);
+
+					__m128i bestError = _mm_set1_epi32(INT32_MAX);
+					__m128i bestIndex = zero;
+					for (uint32_t i = 0; i < paletteSize; i++)
+					{
+						int32_t entry = 0;
+						memcpy(&entry, pPalette[i], sizeof(entry));
+						const __m128i color = _mm_unpacklo_epi8(_mm_set1_epi32(entry), zero);
+
+						const __m128i delta01 = _mm_sub_epi16(texels01, color);
+						const __m128i delta23 = _mm_sub_epi16(texels23, color);
+						// [rg, ba] per texel, summed into one error per texel.
+						const __m128 squared01 = _mm_castsi128_ps(_mm_madd_epi16(delta01, delta01));
+						const __m128 squared23 = _mm_castsi128_ps(_mm_madd_epi16(delta23, delta23));
+						const __m128i error = _mm_add_epi32(
+							_mm_castps_si128(_mm_shuffle_ps(squared01, squared23, _MM_SHUFFLE(2, 0, 2, 0))),
+							_mm_castps_si128(_mm_shuffle_ps(squared01, squared23, _MM_SHUFFLE(3, 1, 3, 1))));
+
+						const __m128i better = _mm_cmplt_epi32(error, bestError);
+						bestError = _mm_or_si128(_mm_and_si128(better, error), _mm_andnot_si128(better, bestError));
+						bestIndex = _mm_or_si128(_mm_and_si128(better, _mm_set1_epi32(static_cast<int32_t>(i))), _mm_andnot_si128(better, bestIndex));
+					}
+
+					alignas(16) uint32_t errors[4];
+					alignas(16) uint32_t indices[4];
+					_mm_store_si128(reinterpret_cast<__m128i*>(errors), bestError);
+					_mm_store_si128(reinterpret_cast<__m128i*>(indices), bestIndex);
+					for (uint32_t i = 0; i < 4; i++)
+					{
+						pErrors[group + i] = errors[i];
+						pIndices[group + i] = static_cast<uint8_t>(indices[i]);
+					}
+				}
+#else
+				for (uint32_t texel = 0; texel < BLOCK_TEXELS; texel++)
+				{
+					pErrors[texel] = UINT32_MAX;
+					for (uint32_t i = 0; i < paletteSize; i++)
+					{
+						uint32_t error = 0;
+						for (uint32_t c = 0; c < MAX_CHANNELS; c++)
+						{
+							const int32_t delta = static_cast<int32_t>(pTexels[texel * 4 + c]) - pPalette[i][c];
+							error += static_cast<uint32_t>(delta * delta);
+						}
+						if (error < pErrors[texel])
+						{
+							pErrors[texel] = error;
+							pIndices[texel] = static_cast<uint8_t>(i);
+						}
+					}
+				}
+#endif
+			}
+
+			void ToFloats(const uint8_t* pTexels, Texels& texels)
+			{
+				for (uint32_t texel = 0; texel < BLOCK_TEXELS; texel++)
+				{
+					for (uint32_t c = 0; c < MAX_CHANNELS; c++)
+					{
+						texels[texel][c] = pTexels[texel * 4 + c];
+					}
+				}
+			}
+
+			//
+			// BC1 - BC5
+			//
+			uint16_t To565(const float* pColor)
+			{
+				const uint32_t r = static_cast<uint32_t>(std::lround(pColor[0] * 31.0f / 255.0f));
+				const uint32_t g = static_cast<uint32_t>(std::lround(pColor[1] * 63.0f / 255.0f));
+				const uint32_t b = static_cast<uint32_t>(std::lround(pColor[2] * 31.0f / 255.0f));
+				return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+			}
+
+			void Expand565(uint16_t color, uint8_t* pColor)
+			{
+				const uint32_t r = (color >> 11) & 0x1F;
+				const uint32_t g = (color >> 5) & 0x3F;
+				const uint32_t b = color & 0x1F;
+				pColor[0] = static_cast<uint8_t>((r << 3) | (r >> 2));
+				pColor[1] = static_cast<uint8_t>((g << 2) | (g >> 4));
+				pColor[2] = static_cast<uint8_t>((b << 3) | (b >> 2));
+				pColor[3] = 255;
+			}
+
+			// BC1 and the color half of BC3. BC3 always decodes 4 colors, BC1 only does when color0 > color1
+			// and otherwise decodes 3 colors and transparent black, which is used for texels with alpha below 128.
+			void EncodeColorBlock(const uint8_t* pTexels, uint8_t* pBlock, Quality quality, bool isBc1)
+			{
+				uint8_t texels[BLOCK_TEXELS * 4];
+				memcpy(texels, pTexels, sizeof(texels));
+
+				uint8_t opaqueTexels[BLOCK_TEXELS]{};
+				uint32_t opaqueCount = 0;
+				bool isTransparent[BLOCK_TEXELS]{};
+				for (uint32_t texel = 0; texel < BLOCK_TEXELS; texel++)
+				{
+					isTransparent[texel] = isBc1 && texels[texel * 4 + 3] < 128;
+					if (!isTransparent[texel])
+					{
+						opaqueTexels[opaqueCount++] = static_cast<uint8_t>(texel);
+					}
+					texels[texel * 4 + 3] = 255;
+				}
+
+				if (opaqueCount == 0)
+				{
+					// Equal endpoints select the 3 color mode, index 3 is transparent black everywhere.
+					memset(pBlock, 0, 4);
+					memset(pBlock + 4, 0xFF, 4);
+					return;
+				}
+
+				Texels values;
+				ToFloats(texels, values);
+				float e0[MAX_CHANNELS];
+				float e1[MAX_CHANNELS];
+				FitEndpoints(values, opaqueTexels, opaqueCount, 3, 255.0f, e0, e1);
+
+				const bool hasTransparency = opaqueCount < BLOCK_TEXELS;
+				uint32_t bestError = UINT32_MAX;
+				uint16_t bestColors[2]{};
+				uint8_t bestIndices[BLOCK_TEXELS]{};
+
+				const uint32_t refinements = GetRefinementCount(quality);
+				for (uint32_t iteration = 0; iteration <= refinements; iteration++)
+				{
+					uint16_t color0 = To565(e0);
+					uint16_t color1 = To565(e1);
+					// The order of the endpoints picks the mode in BC1.
+					if (isBc1 && (hasTransparency ? color0 > color1 : color0 < color1))
+					{
+						std::swap(color0, color1);
+					}
+					const bool threeColors = isBc1 && color0 <= color1;
+
+					Color palette[4];
+					Expand565(color0, palette[0]);
+					Expand565(color1, palette[1]);
+					for (uint32_t c = 0; c < 3; c++)
+					{
+						if (threeColors)
+						{
+							palette[2][c] = static_cast<uint8_t>((palette[0][c] + palette[1][c]) / 2);
+						}
+						else
+						{
+							palette[2][c] = static_cast<uint8_t>((2 * palette[0][c] + palette[1][c]) / 3);
+							palette[3][c] = static_cast<uint8_t>((palette[0][c] + 2 * palette[1][c]) / 3);
+						}
+					}
+					palette[2][3] = palette[3][3] = 255;
+
+					uint8_t indices[BLOCK_TEXELS];
+					uint32_t errors[BLOCK_TEXELS];
+					FindClosest(texels, palette, threeColors ? 3 : 4, indices, errors);
+
+					uint32_t error = 0;
+					for (uint32_t texel = 0; texel < BLOCK_TEXELS; texel++)
+					{
+						if (isTransparent[texel])
+						{
+							indices[texel] = 3;
+							continue;
+						}
+						error += errors[texel];
+					}
+
+					if (error < bestError)
+					{
+						bestError = error;
+						bestColors[0] = color0;
+						bestColors[1] = color1;
+						memcpy(bestIndices, indices, sizeof(indices));
+					}
+
+					if (iteration == refinements || bestError == 0)
+						break;
+
+					constexpr float FOUR_COLOR_WEIGHTS[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+					constexpr float THREE_COLOR_WEIGHTS[4] = { 0.0f, 1.0f, 0.5f, 0.0f };
+					float weights[BLOCK_TEXELS]{};
+					for (uint32_t texel = 0; texel < BLOCK_TEXELS; texel++)
+					{
+						weights[texel] = threeColors ? THREE_COLOR_WEIGHTS[indices[texel]] : FOUR_COLOR_WEIGHTS[indices[texel]];
+					}
+					if (!RefineEndpoints(values, opaqueTexels, opaqueCount, weights, 3, 255.0f, e0, e1))
+						break;
+				}
+
+				uint32_t packedIndices = 0;
+				for (uint32_t texel = 0; texel < BLOCK_TEXELS; texel++)
+				{
+					packedIndices |= static_cast<uint32_t>(bestIndices[texel]) << (texel * 2);
+				}
+				memcpy(pBlock, bestColors, sizeof(bestColors));
+				memcpy(pBlock + 4, &packedIndices, sizeof(packedIndices));
+			}
+
+			// The alpha half of BC3 and every channel of BC4 and BC5.
+			void EncodeChannelBlock(const uint8_t* pTexels, uint32_t channel, uint8_t* pBlock)
+			{
+				uint8_t values[BLOCK_TEXELS];
+				uint8_t minValue = 255;
+				uint8_t maxValue = 0;
+				// The extremes besides 0 and 255, which the 6 value mode has exact entries for.
+				uint8_t innerMin = 255;
+				uint8_t innerMax = 0;
+				for (uint32_t texel = 0; texel < BLOCK_TEXELS; texel++)
+				{
+					values[texel] = pTexels[texel * 4 + channel];
+					minValue = std::min(minValue, values[texel]);
+					maxValue = std::max(maxValue, values[texel]);
+					if (values[texel] != 0 && values[texel] != 255)
+					{
+						innerMin = std::min(innerMin, values[texel]);
+						innerMax = std::max(innerMax, values[texel]);
+					}
+				}
+				if (innerMin > innerMax)
+				{
+					innerMin = innerMax = 0;
+				}
+
+				// The 8 value mode needs value0 > value1, the 6 value mode value0 <= value1.
+				const uint8_t candidates[2][2] = { { maxValue, minValue }, { innerMin, innerMax } };
+				uint32_t bestError = UINT32_MAX;
+				uint64_t bestIndices = 0;
+				uint32_t bestCandidate = 0;
+				for (uint32_t candidate = 0; candidate < 2; candidate++)
+				{
+					const uint32_t value0 = candidates[candidate][0];
+					const uint32_t value1 = candidates[candidate][1];
+
+					uint32_t palette[8]{ value0, value1 };
+					if (value0 > value1)
+					{
+						for (uint32_t i = 2; i < 8; i++)
+						{
+							palette[i] = ((8 - i) * value0 + (i - 1) * value1) / 7;
+						}
+					}
+					else
+					{
+						for (uint32_t i = 2; i < 6; i++)
+						{
+							palette[i] = ((6 - i) * value0 + (i - 1) * value1) / 5;
+						}
+						palette[6] = 0;
+						palette[7] = 255;
+					}
+
+					uint32_t error = 0;
+					uint64_t indices = 0;
+					for (uint32_t texel = 0; texel < BLOCK_TEXELS; texel++)
+					{
+						uint32_t bestTexelError = UINT32_MAX;
+						uint32_t bestIndex = 0;
+						for (uint32_t i = 0; i < 8; i++)
+						{
+							const int32_t delta = static_cast<int32_t>(values[texel]) - static_cast<int32_t>(palette[i]);
+							const uint32_t texelError = static_cast<uint32_t>(delta * delta);
+							if (texelError < bestTexelError)
+							{
+								bestTexelError = texelError;
+								bestIndex = i;
+							}
+						}
+						error += bestTexelError;
+						indices |= static_cast<uint64_t>(bestIndex) << (texel * 3);
+					}
+
+					if (error < bestError)
+					{
+						bestError = error;
+						bestIndices = indices;
+						bestCandidate = candidate;
+					}
+				}
+
+				pBlock[0] = candidates[bestCandidate][0];
+				pBlock[1] = candidates[bestCandidate][1];
+				for (uint32_t i = 0; i < 6; i++)
+				{
+					pBlock[2 + i] = static_cast<uint8_t>(bestIndices >> (i * 8));
+				}
+			}
+
+			//
+			// BC7
+			//
+			struct Bc7Encoding
+			{
+				uint32_t endpoints[3][2][MAX_CHANNELS]{};
+				uint32_t pBits[3][2]{};
+				uint8_t indices[BLOCK_TEXELS]{};
+				uint32_t error{ UINT32_MAX };
+			};
+
+			// Stores the endpoint in the bits of the mode with the given p-bit, returns the squared error of the reconstruction.
+			uint32_t QuantizeBc7Endpoint(const Bc7Mode& mode, const float* pValue, uint32_t pBit, uint32_t* pStored, uint8_t* pReconstructed)
+			{
+				const bool hasPBit = mode.endpointPBits || mode.sharedPBits;
+
+				uint32_t error = 0;
+				for (uint32_t c = 0; c < MAX_CHANNELS; c++)
+				{
+					const uint32_t bits = c < 3 ? mode.colorBits : mode.alphaBits;
+					if (bits == 0)
+					{
+						pStored[c] = 0;
+						pReconstructed[c] = 255;
+						continue;
+					}
+
+					const uint32_t totalBits = bits + (hasPBit ? 1 : 0);
+					const float scaled = pValue[c] * static_cast<float>((1u << totalBits) - 1) / 255.0f;
+					const int32_t guess = static_cast<int32_t>(std::lround(hasPBit ? (scaled - static_cast<float>(pBit)) / 2.0f : scaled));
+
+					uint32_t bestError = UINT32_MAX;
+					for (int32_t q = guess - 1; q <= guess + 1; q++)
+					{
+						const uint32_t stored = static_cast<uint32_t>(std::clamp(q, 0, static_cast<int32_t>((1u << bits) - 1)));
+						const uint8_t reconstructed = Bc7Unquantize(hasPBit ? (stored << 1) | pBit : stored, totalBits);
+						const float delta = static_cast<float>(reconstructed) - pValue[c];
+						const uint32_t channelError = static_cast<uint32_t>(delta * delta);
+						if (channelError < bestError)
+						{
+							bestError = channelError;
+							pStored[c] = stored;
+							pReconstructed[c] = reconstructed;
+						}
+					}
+					error += bestError;
+				}
+
+				return error;
+			}
+
+			void QuantizeBc7Subset(const Bc7Mode& mode, const float (*pEndpoints)[MAX_CHANNELS], uint32_t (*pStored)[MAX_CHANNELS],
+				uint32_t* pPBits, Color* pReconstructed)
+			{
+				if (mode.sharedPBits)
+				{
+					uint32_t bestError = UINT32_MAX;
+					for (uint32_t pBit = 0; pBit < 2; pBit++)
+					{
+						uint32_t stored[2][MAX_CHANNELS];
+						Color reconstructed[2];
+						const uint32_t error = QuantizeBc7Endpoint(mode, pEndpoints[0], pBit, stored[0], reconstructed[0])
+							+ QuantizeBc7Endpoint(mode, pEndpoints[1], pBit, stored[1], reconstructed[1]);
+						if (error < bestError)
+						{
+							bestError = error;
+							memcpy(pStored, stored, sizeof(stored));
+							memcpy(pReconstructed, reconstructed, sizeof(reconstructed));
+							pPBits[0] = pPBits[1] = pBit;
+						}
+					}
+					return;
+				}
+
+				for (uint32_t endpoint = 0; endpoint < 2; endpoint++)
+				{
+					uint32_t bestError = UINT32_MAX;
+					for (uint32_t pBit = 0; pBit < (mode.endpointPBits ? 2u : 1u); pBit++)
+					{
+						uint32_t stored[MAX_CHANNELS];
+						Color reconstructed;
+						const uint32_t error = QuantizeBc7Endpoint(mode, pEndpoints[endpoint], pBit, stored, reconstructed);
+						if (error < bestError)
+						{
+							bestError = error;
+							memcpy(pStored[endpoint], stored, sizeof(stored));
+							memcpy(pReconstructed[endpoint], reconstructed, sizeof(reconstructed));
+							pPBits[endpoint] = pBit;
+						}
+					}
+				}
+			}
+
+			uint32_t GetAnchor(uint32_t subsetCount, uint32_t partition, uint32_t subset)
+			{
+				if (subset == 0)
+					return 0;
+				if (subsetCount == 2)
+					return ANCHORS_2[partition];
+				return subset == 1 ? ANCHORS_3_SECOND[partition] : ANCHORS_3_THIRD[partition];
+			}
+
+			void WriteBc7Block(uint32_t modeIndex, uint32_t partition, Bc7Encoding encoding, uint8_t* pBlock)
+			{
+				const Bc7Mode& mode = BC7_MODES[modeIndex];
+				const uint32_t indexCount = 1u << mode.indexBits;
+
+				// Anchors store their index without the top bit, so it has to be 0. Swapping the endpoints flips the indices.
+				for (uint32_t subset = 0; subset < mode.subsetCount; subset++)
+				{
+					if (encoding.indices[GetAnchor(mode.subsetCount, partition, subset)] < indexCount / 2)
+						continue;
+
+					std::swap(encoding.endpoints[subset][0], encoding.endpoints[subset][1]);
+					std::swap(encoding.pBits[subset][0], encoding.pBits[subset][1]);
+					for (uint32_t texel = 0; texel < BLOCK_TEXELS; texel++)
+					{
+						if (GetSubset(mode.subsetCount, partition, texel) == subset)
+						{
+							encoding.indices[texel] = static_cast<uint8_t>(indexCount - 1 - encoding.indices[texel]);
+						}
+					}
+				}
+
+				BitWriter writer(pBlock);
+				writer.Write(1u << modeIndex, modeIndex + 1);
+				writer.Write(partition, mode.partitionBits);
+				writer.Write(0, mode.rotationBits);
+				writer.Write(0, mode.indexSelectionBits);
+				for (uint32_t c = 0; c < MAX_CHANNELS; c++)
+				{
+					const uint32_t bits = c < 3 ? mode.colorBits : mode.alphaBits;
+					for (uint32_t subset = 0; subset < mode.subsetCount; subset++)
+					{
+						writer.Write(encoding.endpoints[subset][0][c], bits);
+						writer.Write(encoding.endpoints[subset][1][c], bits);
+					}
+				}
+				for (uint32_t subset = 0; subset < mode.subsetCount; subset++)
+				{
+					if (mode.endpointPBits)
+					{
+						writer.Write(encoding.pBits[subset][0], 1);
+						writer.Write(encoding.pBits[subset][1], 1);
+					}
+				}
+				if (mode.sharedPBits)
+				{
+					for (uint32_t subset = 0; subset < mode.subsetCount; subset++)
+					{
+						writer.Write(encoding.pBits[subset][0], 1);
+					}
+				}
+				for (uint32_t texel = 0; texel < BLOCK_TEXELS; texel++)
+				{
+					writer.Write(encoding.indices[texel], IsAnchor(mode.subsetCount, partition, texel) ? mode.indexBits - 1u : mode.indexBits);
+				}
+			}
+
+			// Only handles the modes without rotation or separate alpha indices, which are 0, 1, 2, 3, 6 and 7.
+			// Returns the squared error of the block.
+			uint32_t EncodeBc7Mode(uint32_t modeIndex, uint32_t partition, const uint8_t* pTexels, const Texels& values,
+				uint32_t refinements, uint8_t* pBlock)
+			{
+				const Bc7Mode& mode = BC7_MODES[modeIndex];
+				const uint32_t channelCount = mode.alphaBits ? 4 : 3;
+				const uint32_t indexCount = 1u << mode.indexBits;
+				const uint8_t* pWeights = GetWeights(mode.indexBits);
+
+				// Modes without alpha decode it as 255.
+				uint8_t texels[BLOCK_TEXELS * 4];
+				memcpy(texels, pTexels, sizeof(texels));
+				if (!mode.alphaBits)
+				{
+					for (uint32_t texel = 0; texel < BLOCK_TEXELS; texel++)
+					{
+						texels[texel * 4 + 3] = 255;
+					}
+				}
+
+				uint8_t subsetTexels[3][BLOCK_TEXELS]{};
+				uint32_t subsetCounts[3]{};
+				for (uint32_t texel = 0; texel < BLOCK_TEXELS; texel++)
+				{
+					const uint32_t subset = GetSubset(mode.subsetCount, partition, texel);
+					subsetTexels[subset][subsetCounts[subset]++] = static_cast<uint8_t>(texel);
+				}
+
+				float endpoints[3][2][MAX_CHANNELS]{};
+				for (uint32_t subset = 0; subset < mode.subsetCount; subset++)
+				{
+					FitEndpoints(values, subsetTexels[subset], subsetCounts[subset], channelCount, 255.0f, endpoints[subset][0], endpoints[subset][1]);
+				}
+
+				Bc7Encoding best{};
+				for (uint32_t iteration = 0; iteration <= refinements; iteration++)
+				{
+					Bc7Encoding current{};
+					current.error = 0;
+					for (uint32_t subset = 0; subset < mode.subsetCount; subset++)
+					{
+						Color reconstructed[2];
+						QuantizeBc7Subset(mode, endpoints[subset], current.endpoints[subset], current.pBits[subset], reconstructed);
+
+						Color palette[16];
+						for (uint32_t i = 0; i < indexCount; i++)
+						{
+							for (uint32_t c = 0; c < MAX_CHANNELS; c++)
+							{
+								palette[i][c] = Interpolate(reconstructed[0][c], reconstructed[1][c], pWeights[i]);
+							}
+						}
+
+						uint8_t indices[BLOCK_TEXELS];
+						uint32_t errors[BLOCK_TEXELS];
+						FindClosest(texels, palette, indexCount, indices, errors);
+						for (uint32_t i = 0; i < subsetCounts[subset]; i++)
+						{
+							const uint32_t texel = subsetTexels[subset][i];
+							current.indices[texel] = indices[texel];
+							current.error += errors[texel];
+						}
+					}
+
+					if (current.error < best.error)
+					{
+						best = current;
+					}
+
+					if (iteration == refinements || best.error == 0)
+						break;
+
+					float weights[BLOCK_TEXELS];
+					for (uint32_t texel = 0; texel < BLOCK_TEXELS; texel++)
+					{
+						weights[texel] = static_cast<float>(pWeights[current.indices[texel]]) / 64.0f;
+					}
+					for (uint32_t subset = 0; subset < mode.subsetCount; subset++)
+					{
+						RefineEndpoints(values, subsetTexels[subset], subsetCounts[subset], weights, channelCount, 255.0f,
+							endpoints[subset][0], endpoints[subset][1]);
+					}
+				}
+
+				WriteBc7Block(modeIndex, partition, best, pBlock);
+				return best.error;
+			}
+
+			// Sums of the colors and their products, enough to get the covariance of any set of texels.
+			struct ColorMoments
+			{
+				float count{};
+				float sum[3]{};
+				// xx, xy, xz, yy, yz, zz
+				float products[6]{};
+
+				void Add(const float* pColor)
+				{
+					count += 1.0f;
+					uint32_t product = 0;
+					for (uint32_t a = 0; a < 3; a++)
+					{
+						sum[a] += pColor[a];
+						for (uint32_t b = a; b < 3; b++)
+						{
+							products[product++] += pColor[a] * pColor[b];
+						}
+					}
+				}
+
+				// What's left of the variation after taking out the principal axis, which is the trace minus the largest eigenvalue.
+				[[nodiscard]] float GetLineError() const
+				{
+					if (count < 1.0f)
+						return 0.0f;
+
+					float covariance[3][3];
+					uint32_t product = 0;
+					for (uint32_t a = 0; a < 3; a++)
+					{
+						for (uint32_t b = a; b < 3; b++)
+						{
+							covariance[a][b] = covariance[b][a] = products[product++] - sum[a] * sum[b] / count;
+						}
+					}
+
+					float axis[3] = { 1.0f, 1.0f, 1.0f };
+					float eigenvalue = 0.0f;
+					for (uint32_t iteration = 0; iteration < 4; iteration++)
+					{
+						float next[3]{};
+						for (uint32_t a = 0; a < 3; a++)
+						{
+							next[a] = covariance[a][0] * axis[0] + covariance[a][1] * axis[1] + covariance[a][2] * axis[2];
+						}
+						const float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+						if (length < 1e-6f)
+							break;
+						eigenvalue = length / std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+						for (uint32_t a = 0; a < 3; a++)
+						{
+							axis[a] = next[a] / length;
+						}
+					}
+
+					return covariance[0][0] + covariance[1][1] + covariance[2][2] - eigenvalue;
+				}
+			};
+
+			// How far the texels are from the two lines through the subsets of the partition, without encoding anything.
+			float EstimatePartitionError(const Texels& values, const ColorMoments& block, uint32_t partition)
+			{
+				ColorMoments second{};
+				for (uint32_t texel = 0; texel < BLOCK_TEXELS; texel++)
+				{
+					if (PARTITIONS_2[partition][texel] == 1)
+						second.Add(values[texel]);
+				}
+
+				ColorMoments first = block;
+				first.count -= second.count;
+				for (uint32_t c = 0; c < 3; c++)
+				{
+					first.sum[c] -= second.sum[c];
+				}
+				for (uint32_t i = 0; i < 6; i++)
+				{
+					first.products[i] -= second.products[i];
+				}
+
+				return first.GetLineError() + second.GetLineError();
+			}
+
+			//
+			// BC6H
+			//
+			uint16_t FloatToHalf(float value)
+			{
+				// Also catches NaN.
+				if (!(value > 0.0f))
+					return 0;
+				if (value >= 65504.0f)
+					return 0x7BFF;
+
+				uint32_t bits = 0;
+				memcpy(&bits, &value, sizeof(bits));
+				const int32_t exponent = static_cast<int32_t>((bits >> 23) & 0xFF) - 127 + 15;
+				if (exponent <= 0)
+				{
+					// Denormal half.
+					if (exponent < -10)
+						return 0;
+					const uint32_t mantissa = (bits & 0x7FFFFF) | 0x800000;
+					const uint32_t shift = static_cast<uint32_t>(14 - exponent);
+					const uint32_t half = (mantissa >> shift) + ((mantissa >> (shift - 1)) & 1);
+					return static_cast<uint16_t>(half);
+				}
+
+				// Rounding can carry into the exponent, which is still the right result.
+				const uint32_t half = (static_cast<uint32_t>(exponent) << 10 | ((bits >> 13) & 0x3FF)) + ((bits >> 12) & 1);
+				return static_cast<uint16_t>(std::min(half, 0x7BFFu));
+			}
+
+			// The stored value whose unquantized and finished half is closest to the wanted one.
+			// Unquantized values are in the 0 - 0xFFFF range the endpoints get interpolated in.
+			uint32_t QuantizeBc6h(float unquantized, uint32_t bits)
+			{
+				const float target = unquantized * 31.0f / 64.0f;
+				const int32_t guess = static_cast<int32_t>(unquantized * static_cast<float>(1u << bits) / 65536.0f);
+
+				uint32_t best = 0;
+				float bestError = FLT_MAX;
+				for (int32_t q = guess - 1; q <= guess + 1; q++)
+				{
+					const int32_t clamped = std::clamp(q, 0, static_cast<int32_t>((1u << bits) - 1));
+					const float half = static_cast<float>((Bc6hUnquantize(clamped, bits, false) * 31) >> 6);
+					const float error = std::abs(half - target);
+					if (error < bestError)
+					{
+						bestError = error;
+						best = static_cast<uint32_t>(clamped);
+					}
+				}
+				return best;
+			}
+
+			// Only the single subset modes, which have 4 bit indices. Returns the squared error in half float bits.
+			uint64_t EncodeBc6hMode(uint32_t modeBits, const Bc6hMode& mode, const Texels& unquantized, const uint16_t (*pHalfs)[3],
+				uint32_t refinements, uint8_t* pBlock)
+			{
+				constexpr uint8_t ALL_TEXELS[BLOCK_TEXELS] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 };
+
+				float endpoints[2][MAX_CHANNELS]{};
+				FitEndpoints(unquantized, ALL_TEXELS, BLOCK_TEXELS, 3, 65535.0f, endpoints[0], endpoints[1]);
+
+				// Keep deltas symmetric so swapping the endpoints for the anchor never pushes them out of range.
+				const int32_t maxDelta = (1 << (mode.deltaBits[0] - 1)) - 1;
+
+				uint64_t bestError = UINT64_MAX;
+				uint32_t bestEndpoints[2][3]{};
+				uint8_t bestIndices[BLOCK_TEXELS]{};
+				for (uint32_t iteration = 0; iteration <= refinements; iteration++)
+				{
+					uint32_t quantized[2][3];
+					for (uint32_t c = 0; c < 3; c++)
+					{
+						quantized[0][c] = QuantizeBc6h(endpoints[0][c], mode.endpointBits);
+						quantized[1][c] = QuantizeBc6h(endpoints[1][c], mode.endpointBits);
+						if (mode.transformed)
+						{
+							const int32_t delta = std::clamp(static_cast<int32_t>(quantized[1][c]) - static_cast<int32_t>(quantized[0][c]), -maxDelta, maxDelta);
+							quantized[1][c] = static_cast<uint32_t>(static_cast<int32_t>(quantized[0][c]) + delta);
+						}
+					}
+
+					uint32_t palette[16][3];
+					for (uint32_t i = 0; i < 16; i++)
+					{
+						for (uint32_t c = 0; c < 3; c++)
+						{
+							const int32_t e0 = Bc6hUnquantize(static_cast<int32_t>(quantized[0][c]), mode.endpointBits, false);
+							const int32_t e1 = Bc6hUnquantize(static_cast<int32_t>(quantized[1][c]), mode.endpointBits, false);
+							const int32_t weight = WEIGHTS_4[i];
+							palette[i][c] = Bc6hFinish(((64 - weight) * e0 + weight * e1 + 32) >> 6, false);
+						}
+					}
+
+					uint64_t error = 0;
+					uint8_t indices[BLOCK_TEXELS];
+					for (uint32_t texel = 0; texel < BLOCK_TEXELS; texel++)
+					{
+						uint64_t bestTexelError = UINT64_MAX;
+						for (uint32_t i = 0; i < 16; i++)
+						{
+							uint64_t texelError = 0;
+							for (uint32_t c = 0; c < 3; c++)
+							{
+								const int64_t delta = static_cast<int64_t>(pHalfs[texel][c]) - palette[i][c];
+								texelError += static_cast<uint64_t>(delta * delta);
+							}
+							if (texelError < bestTexelError)
+							{
+								bestTexelError = texelError;
+								indices[texel] = static_cast<uint8_t>(i);
+							}
+						}
+						error += bestTexelError;
+					}
+
+					if (error < bestError)
+					{
+						bestError = error;
+						memcpy(bestEndpoints, quantized, sizeof(quantized));
+						memcpy(bestIndices, indices, sizeof(indices));
+					}
+
+					if (iteration == refinements || bestError == 0)
+						break;
+
+					float weights[BLOCK_TEXELS];
+					for (uint32_t texel = 0; texel < BLOCK_TEXELS; texel++)
+					{
+						weights[texel] = static_cast<float>(WEIGHTS_4[indices[texel]]) / 64.0f;
+					}
+					if (!RefineEndpoints(unquantized, ALL_TEXELS, BLOCK_TEXELS, weights, 3, 65535.0f, endpoints[0], endpoints[1]))
+						break;
+				}
+
+				// Texel 0 is the anchor, its index can't have the top bit set.
+				if (bestIndices[0] >= 8)
+				{
+					std::swap(bestEndpoints[0], bestEndpoints[1]);
+					for (uint8_t& index : bestIndices)
+					{
+						index = static_cast<uint8_t>(15 - index);
+					}
+				}
+
+				uint32_t fields[FIELD_COUNT]{};
+				for (uint32_t c = 0; c < 3; c++)
+				{
+					fields[RW + c] = bestEndpoints[0][c];
+					fields[RX + c] = mode.transformed
+						? (bestEndpoints[1][c] - bestEndpoints[0][c]) & ((1u << mode.deltaBits[c]) - 1)
+						: bestEndpoints[1][c];
+				}
+
+				BitWriter writer(pBlock);
+				writer.Write(modeBits, 5);
+				for (const Bc6hBits& bits : mode.layout)
+				{
+					const uint32_t value = (fields[bits.field] >> bits.lsb) & ((1u << bits.count) - 1);
+					if (bits.reversed)
+						writer.WriteReversed(value, bits.count);
+					else
+						writer.Write(value, bits.count);
+				}
+				for (uint32_t texel = 0; texel < BLOCK_TEXELS; texel++)
+				{
+					writer.Write(bestIndices[texel], texel == 0 ? 3 : 4);
+				}
+
+				return bestError;
+			}
+		}
+
+		bool CanEncode(vk::Format format)
+		{
+			switch (format)
+			{
+			case vk::Format::eBc1RgbUnormBlock:
+			case vk::Format::eBc1RgbSrgbBlock:
+			case vk::Format::eBc1RgbaUnormBlock:
+			case vk::Format::eBc1RgbaSrgbBlock:
+			case vk::Format::eBc3UnormBlock:
+			case vk::Format::eBc3SrgbBlock:
+			case vk::Format::eBc4UnormBlock:
+			case vk::Format::eBc5UnormBlock:
+			case vk::Format::eBc6HUfloatBlock:
+			case vk::Format::eBc7UnormBlock:
+			case vk::Format::eBc7SrgbBlock:
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		void EncodeImage(vk::Format format, const void* pTexels, uint32_t width, uint32_t height, uint8_t* pBlocks,
+			Quality quality, ThreadPool* pThreadPool)
+		{
+			ASSERT_MSG(CanEncode(format), "Format can't be encoded!");
+
+			const bool isHdr = format == vk::Format::eBc6HUfloatBlock;
+			const size_t texelSize = isHdr ? sizeof(float) * 4 : 4;
+			const size_t blockSize = TextureFormat::GetBlockInfo(format).size;
+			const uint32_t blocksX = (width + BLOCK_SIZE - 1) / BLOCK_SIZE;
+			const uint32_t blocksY = (height + BLOCK_SIZE - 1) / BLOCK_SIZE;
+			const uint8_t* pSource = static_cast<const uint8_t*>(pTexels);
+
+			const auto encodeRow = [&](uint32_t by, uint32_t /*threadIndex*/)
+			{
+				alignas(16) uint8_t texels[BLOCK_TEXELS * sizeof(float) * 4];
+				for (uint32_t bx = 0; bx < blocksX; bx++)
+				{
+					for (uint32_t y = 0; y < BLOCK_SIZE; y++)
+					{
+						const size_t sourceY = std::min(by * BLOCK_SIZE + y, height - 1);
+						for (uint32_t x = 0; x < BLOCK_SIZE; x++)
+						{
+							const size_t sourceX = std::min(bx * BLOCK_SIZE + x, width - 1);
+							memcpy(texels + (y * BLOCK_SIZE + x) * texelSize, pSource + (sourceY * width + sourceX) * texelSize, texelSize);
+						}
+					}
+
+					uint8_t* pBlock = pBlocks + (static_cast<size_t>(by) * blocksX + bx) * blockSize;
+					switch (format)
+					{
+					case vk::Format::eBc1RgbUnormBlock:
+					case vk::Format::eBc1RgbSrgbBlock:
+					case vk::Format::eBc1RgbaUnormBlock:
+					case vk::Format::eBc1RgbaSrgbBlock:
+						EncodeBc1(texels, pBlock, quality);
+						break;
+					case vk::Format::eBc3UnormBlock:
+					case vk::Format::eBc3SrgbBlock:
+						EncodeBc3(texels, pBlock, quality);
+						break;
+					case vk::Format::eBc4UnormBlock:
+						EncodeBc4(texels, pBlock);
+						break;
+					case vk::Format::eBc5UnormBlock:
+						EncodeBc5(texels, pBlock);
+						break;
+					case vk::Format::eBc6HUfloatBlock:
+						EncodeBc6h(reinterpret_cast<const float*>(texels), pBlock, quality);
+						break;
+					default:
+						EncodeBc7(texels, pBlock, quality);
+						break;
+					}
+				}
+			};
+
+			if (pThreadPool)
+			{
+				pThreadPool->ParallelFor(blocksY, encodeRow);
+			}
+			else
+			{
+				for (uint32_t by = 0; by < blocksY; by++)
+				{
+					encodeRow(by, 0);
+				}
+			}
+		}
+
+		void EncodeBc1(const uint8_t* pTexels, uint8_t* pBlock, Quality quality)
+		{
+			EncodeColorBlock(pTexels, pBlock, quality, true);
+		}
+
+		void EncodeBc3(const uint8_t* pTexels, uint8_t* pBlock, Quality quality)
+		{
+			EncodeChannelBlock(pTexels, 3, pBlock);
+			EncodeColorBlock(pTexels, pBlock + 8, quality, false);
+		}
+
+		void EncodeBc4(const uint8_t* pTexels, uint8_t* pBlock)
+		{
+			EncodeChannelBlock(pTexels, 0, pBlock);
+		}
+
+		void EncodeBc5(const uint8_t* pTexels, uint8_t* pBlock)
+		{
+			EncodeChannelBlock(pTexels, 0, pBlock);
+			EncodeChannelBlock(pTexels, 1, pBlock + 8);
+		}
+
+		void EncodeBc7(const uint8_t* pTexels, uint8_t* pBlock, Quality quality)
+		{
+			Texels values;
+			ToFloats(pTexels, values);
+
+			// Mode 6 is a single subset with alpha, which fits most blocks well.
+			const uint32_t refinements = GetRefinementCount(quality);
+			uint32_t bestError = EncodeBc7Mode(6, 0, pTexels, values, refinements, pBlock);
+
+			bool isOpaque = true;
+			for (uint32_t texel = 0; texel < BLOCK_TEXELS; texel++)
+			{
+				isOpaque &= pTexels[texel * 4 + 3] == 255;
+			}
+			// Blocks mode 6 already gets within a couple of steps per channel don't gain anything from the partition search,
+			// skipping them is what keeps Normal fast on smooth textures.
+			const uint32_t goodEnoughError = quality == Quality::High ? 0 : BLOCK_TEXELS * 3 * 4;
+			if (quality == Quality::Fast || !isOpaque || bestError <= goodEnoughError)
+				return;
+
+			// Opaque blocks with more than one gradient try two subsets with mode 1, only for the partitions two lines fit best.
+			ColorMoments block{};
+			for (uint32_t texel = 0; texel < BLOCK_TEXELS; texel++)
+			{
+				block.Add(values[texel]);
+			}
+
+			std::array<uint32_t, 64> partitions;
+			std::array<float, 64> estimates;
+			for (uint32_t partition = 0; partition < 64; partition++)
+			{
+				partitions[partition] = partition;
+				estimates[partition] = EstimatePartitionError(values, block, partition);
+			}
+			const uint32_t candidateCount = quality == Quality::High ? 8 : 2;
+			std::partial_sort(partitions.begin(), partitions.begin() + candidateCount, partitions.end(),
+				[&estimates](uint32_t a, uint32_t b) { return estimates[a] < estimates[b]; });
+
+			for (uint32_t i = 0; i < candidateCount; i++)
+			{
+				uint8_t block[16];
+				const uint32_t error = EncodeBc7Mode(1, partitions[i], pTexels, values, refinements, block);
+				if (error < bestError)
+				{
+					bestError = error;
+					memcpy(pBlock, block, sizeof(block));
+				}
+			}
+		}
+
+		void EncodeBc6h(const float* pTexels, uint8_t* pBlock, Quality quality)
+		{
+			// Endpoints are fitted in the range they get interpolated in, the error is measured in half float bits,
+			// which is roughly logarithmic.
+			uint16_t halfs[BLOCK_TEXELS][3];
+			Texels unquantized{};
+			for (uint32_t texel = 0; texel < BLOCK_TEXELS; texel++)
+			{
+				for (uint32_t c = 0; c < 3; c++)
+				{
+					halfs[texel][c] = FloatToHalf(pTexels[texel * 4 + c]);
+					unquantized[texel][c] = std::min(static_cast<float>(halfs[texel][c]) * 64.0f / 31.0f, 65535.0f);
+				}
+			}
+
+			// Mode 11 stores both endpoints in 10 bits, 12 to 14 trade delta precision for more endpoint bits.
+			constexpr uint32_t FAST_MODES[] = { 0x03 };
+			constexpr uint32_t ALL_MODES[] = { 0x03, 0x07, 0x0B, 0x0F };
+			const uint32_t* pModes = quality == Quality::Fast ? FAST_MODES : ALL_MODES;
+			const uint32_t modeCount = quality == Quality::Fast ? 1 : 4;
+
+			const uint32_t refinements = GetRefinementCount(quality);
+			const auto& modes = GetBc6hModes();
+			uint64_t bestError = UINT64_MAX;
+			for (uint32_t i = 0; i < modeCount; i++)
+			{
+				uint8_t block[16];
+				const uint64_t error = EncodeBc6hMode(pModes[i], modes.at(pModes[i]), unquantized, halfs, refinements, block);
+				if (error < bestError)
+				{
+					bestError = error;
+					memcpy(pBlock, block, sizeof(block));
+				}
+			}
+		}
+	}
+}
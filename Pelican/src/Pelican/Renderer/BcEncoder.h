@@ -0,0 +1,39 @@
+﻿#pragma once
+#include <vulkan/vulkan.hpp>
+
+namespace Pelican
+{
+	class ThreadPool;
+
+	// Compresses textures into BC1, BC3, BC4, BC5, BC6H and BC7 on the CPU, used to cook KTX2 files offline.
+	namespace BcEncoder
+	{
+		// Fast only fits a line through every block, Normal refines the endpoints once and tries a few BC7 partitions
+		// and BC6H modes, High refines a few more times and tries more BC7 partitions.
+		enum class Quality
+		{
+			Fast,
+			Normal,
+			High,
+		};
+
+		[[nodiscard]] bool CanEncode(vk::Format format);
+
+		// Encodes a width by height image into the blocks of format. BC6H takes RGBA32F texels, the other formats RGBA8.
+		// The edges of images that aren't a multiple of 4 repeat their last texel. Rows of blocks get split
+		// across the thread pool when one is given.
+		void EncodeImage(vk::Format format, const void* pTexels, uint32_t width, uint32_t height, uint8_t* pBlocks,
+			Quality quality, ThreadPool* pThreadPool = nullptr);
+
+		// Single blocks, pTexels holds the 4x4 texels row by row.
+		void EncodeBc1(const uint8_t* pTexels, uint8_t* pBlock, Quality quality);
+		void EncodeBc3(const uint8_t* pTexels, uint8_t* pBlock, Quality quality);
+		// Keeps the red channel.
+		void EncodeBc4(const uint8_t* pTexels, uint8_t* pBlock);
+		// Keeps the red and green channels.
+		void EncodeBc5(const uint8_t* pTexels, uint8_t* pBlock);
+		void EncodeBc7(const uint8_t* pTexels, uint8_t* pBlock, Quality quality);
+		// Unsigned BC6H, negative values become 0.
+		void EncodeBc6h(const float* pTexels, uint8_t* pBlock, Quality quality);
+	}
+}
@@ -0,0 +1,30 @@
+﻿#pragma once
+#include <cfloat>
+
+#include <glm/glm.hpp>
+
+namespace Pelican
+{
+	// Axis aligned bounding box, starts out empty (min > max) so it can be grown point by point.
+	struct BoundingBox
+	{
+		glm::vec3 min{ FLT_MAX };
+		glm::vec3 max{ -FLT_MAX };
+
+		void Expand(const glm::vec3& point)
+		{
+			min = glm::min(min, point);
+			max = glm::max(max, point);
+		}
+
+		void Expand(const BoundingBox& other)
+		{
+			min = glm::min(min, other.min);
+			max = glm::max(max, other.max);
+		}
+
+		[[nodiscard]] bool IsValid() const { return min.x <= max.x && min.y <= max.y && min.z <= max.z; }
+		[[nodiscard]] glm::vec3 GetCenter() const { return (min + max) * 0.5f; }
+		[[nodiscard]] glm::vec3 GetExtents() const { return (max - min) * 0.5f; }
+	};
+}
@@ -3,6 +3,7 @@
 
 #include <logtools.h>
 
+#include "Pelican/Core/Profiler.h"
 #include "Pelican/Core/Time.h"
 
 #include "Pelican/Events/Event.h"
@@ -34,10 +35,12 @@ namespace Pelican
 
 	void Camera::Update()
 	{
+		PELICAN_PROFILE_FUNCTION();
+
 		glm::vec3 movement{};
 
 		glm::vec2 mouseMov = Input::GetMouseMovement();
-		if (Input::GetMouseButton(MouseCode::ButtonRight))
+		if (m_IsInputEnabled && Input::GetMouseButton(MouseCode::ButtonRight))
 		{
 			// Movement
 			if (Input::GetKey(KeyCode::A))
@@ -66,18 +69,7 @@ namespace Pelican
 			Input::SetCursorMode(true);
 		}
 
-		// constrain pitch
-		if (m_Pitch > 89.9f)
-			m_Pitch = 89.9f;
-		if (m_Pitch < -89.9f)
-			m_Pitch = -89.9f;
-
-		glm::vec3 front;
-		front.x = cos(glm::radians(m_Yaw)) * cos(glm::radians(m_Pitch));
-		front.y = sin(glm::radians(m_Pitch));
-		front.z = sin(glm::radians(m_Yaw)) * cos(glm::radians(-m_Pitch));
-		front = glm::normalize(front);
-		m_Forward = front;
+		UpdateForward();
 
 		if (glm::length(movement) > 0)
 		{
@@ -96,6 +88,15 @@ namespace Pelican
 		}
 	}
 
+	void Camera::SetTransform(const glm::vec3& position, float yaw, float pitch)
+	{
+		m_Position = position;
+		m_Yaw = yaw;
+		m_Pitch = pitch;
+
+		UpdateForward();
+	}
+
 	glm::mat4 Camera::GetView()
 	{
 		UpdateViewMatrix();
@@ -113,6 +114,11 @@ namespace Pelican
 		return m_Position;
 	}
 
+	Frustum Camera::GetFrustum()
+	{
+		return Frustum::FromMatrix(m_Projection * GetView());
+	}
+
 	bool Camera::OnResize(WindowResizeEvent& e)
 	{
 		if (e.GetWidth() <= 0 || e.GetHeight() <= 0)
@@ -135,6 +141,22 @@ namespace Pelican
 		m_View = glm::lookAt(m_Position, m_Position + m_Forward, glm::vec3(0.0f, 1.0f, 0.0f));
 	}
 
+	void Camera::UpdateForward()
+	{
+		// constrain pitch
+		if (m_Pitch > 89.9f)
+			m_Pitch = 89.9f;
+		if (m_Pitch < -89.9f)
+			m_Pitch = -89.9f;
+
+		glm::vec3 front;
+		front.x = cos(glm::radians(m_Yaw)) * cos(glm::radians(m_Pitch));
+		front.y = sin(glm::radians(m_Pitch));
+		front.z = sin(glm::radians(m_Yaw)) * cos(glm::radians(-m_Pitch));
+		front = glm::normalize(front);
+		m_Forward = front;
+	}
+
 	void Camera::UpdateProjection(float fov, float width, float height, float zNear, float zFar)
 	{
 		m_Fov = fov;
@@ -1,6 +1,8 @@
 ﻿#pragma once
 #include <glm/glm.hpp>
 
+#include "Frustum.h"
+
 #include "Pelican/Events/Event.h"
 #include "Pelican/Events/KeyEvent.h"
 #include "Pelican/Events/ApplicationEvent.h"
@@ -10,11 +12,6 @@ namespace Pelican
 	enum class KeyCode;
 	class Event;
 
-	struct CameraPushConst
-	{
-		glm::vec3 eyePos;
-	};
-
 	class Camera
 	{
 	public:
@@ -23,9 +20,20 @@ namespace Pelican
 		void OnEvent(Event& e);
 		void Update();
 
+		// Places the camera directly, the angles are in degrees.
+		void SetTransform(const glm::vec3& position, float yaw, float pitch);
+		// Without input the camera stays wherever SetTransform() puts it.
+		void SetInputEnabled(bool enabled) { m_IsInputEnabled = enabled; }
+
 		[[nodiscard]] glm::mat4 GetView();
 		[[nodiscard]] glm::mat4 GetProjection() const;
 		[[nodiscard]] glm::vec3 GetPosition() const;
+		[[nodiscard]] float GetYaw() const { return m_Yaw; }
+		[[nodiscard]] float GetPitch() const { return m_Pitch; }
+		// Height of the viewport in pixels.
+		[[nodiscard]] float GetHeight() const { return m_Height; }
+		// World space frustum of the current view and projection.
+		[[nodiscard]] Frustum GetFrustum();
 
 	private:
 		bool OnResize(WindowResizeEvent& e);
@@ -34,6 +42,8 @@ namespace Pelican
 		// Pass 0 if you want to keep the original values
 		void UpdateProjection(float fov, float width, float height, float zNear, float zFar);
 		void UpdateViewMatrix();
+		// Clamps the pitch and points the forward vector along the yaw and pitch.
+		void UpdateForward();
 
 	private:
 		glm::vec3 m_Position{};
@@ -45,6 +55,7 @@ namespace Pelican
 		float m_MoveSpeedSlow{ 10.0f };
 		float m_MouseSpeed{ 5.0f };
 		bool m_IsSlowMovement{ false };
+		bool m_IsInputEnabled{ true };
 
 		glm::mat4 m_View{};
 		glm::mat4 m_Projection{};
@@ -0,0 +1,217 @@
+﻿#include "PelicanPCH.h"
+#include "CameraPath.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <json.hpp>
+
+#include "Camera.h"
+
+#include "Pelican/Core/System/FileUtils.h"
+
+namespace Pelican
+{
+	namespace
+	{
+		constexpr char BINARY_MAGIC[4] = { 'P', 'C', 'A', 'M' };
+		constexpr uint32_t BINARY_VERSION = 1;
+
+		struct BinaryHeader
+		{
+			char magic[4];
+			uint32_t version;
+			uint32_t keyframeCount;
+		};
+	}
+
+	// The binary format stores the keyframes as they are in memory.
+	static_assert(sizeof(CameraPath::Keyframe) == 24, "Camera path keyframes have to match the file layout");
+
+	void CameraPath::LoadFromFile(const std::filesystem::path& path)
+	{
+		std::string contents;
+		if (!FileUtils::ReadFileSync(path.string(), contents))
+		{
+			throw std::runtime_error("Failed to read camera path " + path.string());
+		}
+
+		try
+		{
+			m_Keyframes.clear();
+			if (contents.size() >= sizeof(BINARY_MAGIC) && memcmp(contents.data(), BINARY_MAGIC, sizeof(BINARY_MAGIC)) == 0)
+				LoadBinary(contents);
+			else
+				LoadJson(contents);
+		}
+		catch (const std::exception& e)
+		{
+			m_Keyframes.clear();
+			throw std::runtime_error("Failed to load camera path " + path.string() + ": " + e.what());
+		}
+	}
+
+	void CameraPath::SaveToFile(const std::filesystem::path& path) const
+	{
+		if (path.extension() == ".json")
+			SaveJson(path);
+		else
+			SaveBinary(path);
+	}
+
+	void CameraPath::AddKeyframe(const Keyframe& keyframe)
+	{
+		if (!m_Keyframes.empty() && keyframe.time < m_Keyframes.back().time)
+		{
+			throw std::runtime_error("Camera path keyframes have to be in time order");
+		}
+
+		m_Keyframes.push_back(keyframe);
+	}
+
+	CameraPath::Keyframe CameraPath::Sample(float time) const
+	{
+		ASSERT_MSG(!m_Keyframes.empty(), "Can't sample an empty camera path!");
+
+		if (time <= m_Keyframes.front().time)
+			return m_Keyframes.front();
+		if (time >= m_Keyframes.back().time)
+			return m_Keyframes.back();
+
+		// The first keyframe after the time, the one before it can't be the last.
+		const auto next = std::upper_bound(m_Keyframes.begin(), m_Keyframes.end(), time,
+			[](float t, const Keyframe& keyframe) { return t < keyframe.time; });
+		const Keyframe& from = *(next - 1);
+		const Keyframe& to = *next;
+
+		const float length = to.time - from.time;
+		const float t = length > 0.0f ? (time - from.time) / length : 1.0f;
+		return Keyframe{
+			time,
+			glm::mix(from.position, to.position, t),
+			glm::mix(from.yaw, to.yaw, t),
+			glm::mix(from.pitch, to.pitch, t)
+		};
+	}
+
+	void CameraPath::Apply(Camera* pCamera, float time) const
+	{
+		const Keyframe keyframe = Sample(time);
+		pCamera->SetTransform(keyframe.position, keyframe.yaw, keyframe.pitch);
+	}
+
+	float CameraPath::GetDuration() const
+	{
+		if (m_Keyframes.empty())
+			return 0.0f;
+
+		return m_Keyframes.back().time - m_Keyframes.front().time;
+	}
+
+	void CameraPath::LoadJson(const std::string& contents)
+	{
+		using namespace nlohmann;
+
+		const json jPath = json::parse(contents);
+		const json& jKeyframes = jPath.at("keyframes");
+		if (!jKeyframes.is_array())
+		{
+			throw std::runtime_error("keyframes isn't an array");
+		}
+
+		for (const json& jKeyframe : jKeyframes)
+		{
+			const json& jPosition = jKeyframe.at("position");
+			AddKeyframe(Keyframe{
+				jKeyframe.at("time").get<float>(),
+				glm::vec3{ jPosition.at(0).get<float>(), jPosition.at(1).get<float>(), jPosition.at(2).get<float>() },
+				jKeyframe.at("yaw").get<float>(),
+				jKeyframe.at("pitch").get<float>()
+			});
+		}
+	}
+
+	void CameraPath::LoadBinary(const std::string& contents)
+	{
+		BinaryHeader header{};
+		if (contents.size() < sizeof(header))
+		{
+			throw std::runtime_error("the header is cut off");
+		}
+		memcpy(&header, contents.data(), sizeof(header));
+
+		if (header.version != BINARY_VERSION)
+		{
+			throw std::runtime_error("unsupported version " + std::to_string(header.version));
+		}
+		if (contents.size() < sizeof(header) + static_cast<size_t>(header.keyframeCount) * sizeof(Keyframe))
+		{
+			throw std::runtime_error("the keyframes are cut off");
+		}
+
+		m_Keyframes.reserve(header.keyframeCount);
+		for (uint32_t i = 0; i < header.keyframeCount; i++)
+		{
+			Keyframe keyframe{};
+			memcpy(&keyframe, contents.data() + sizeof(header) + i * sizeof(Keyframe), sizeof(Keyframe));
+			AddKeyframe(keyframe);
+		}
+	}
+
+	void CameraPath::SaveJson(const std::filesystem::path& path) const
+	{
+		using namespace nlohmann;
+
+		json jKeyframes = json::array();
+		for (const Keyframe& keyframe : m_Keyframes)
+		{
+			jKeyframes.push_back(json{
+				{ "time", keyframe.time },
+				{ "position", { keyframe.position.x, keyframe.position.y, keyframe.position.z } },
+				{ "yaw", keyframe.yaw },
+				{ "pitch", keyframe.pitch },
+			});
+		}
+
+		if (!FileUtils::WriteFileSync(path.string(), json{ { "keyframes", jKeyframes } }.dump(2)))
+		{
+			throw std::runtime_error("Failed to write camera path " + path.string());
+		}
+	}
+
+	void CameraPath::SaveBinary(const std::filesystem::path& path) const
+	{
+		BinaryHeader header{};
+		memcpy(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+		header.version = BINARY_VERSION;
+		header.keyframeCount = static_cast<uint32_t>(m_Keyframes.size());
+
+		std::string contents(sizeof(header) + m_Keyframes.size() * sizeof(Keyframe), '\0');
+		memcpy(contents.data(), &header, sizeof(header));
+		memcpy(contents.data() + sizeof(header), m_Keyframes.data(), m_Keyframes.size() * sizeof(Keyframe));
+
+		if (!FileUtils::WriteFileSync(path.string(), contents))
+		{
+			throw std::runtime_error("Failed to write camera path " + path.string());
+		}
+	}
+
+	CameraPath CameraPath::CreateOrbit(const glm::vec3& center, float radius, float height, float duration)
+	{
+		constexpr uint32_t keyframeCount = 64;
+
+		// Looking at the center from the orbit means facing the opposite way of the orbit angle.
+		const float pitch = -glm::degrees(std::atan2(height, radius));
+
+		CameraPath path;
+		for (uint32_t i = 0; i <= keyframeCount; i++)
+		{
+			const float fraction = static_cast<float>(i) / static_cast<float>(keyframeCount);
+			const float angle = fraction * 360.0f;
+			const glm::vec3 offset{ std::cos(glm::radians(angle)) * radius, height, std::sin(glm::radians(angle)) * radius };
+			path.AddKeyframe(Keyframe{ fraction * duration, center + offset, angle + 180.0f, pitch });
+		}
+
+		return path;
+	}
+}
@@ -0,0 +1,55 @@
+﻿#pragma once
+#include <glm/glm.hpp>
+
+namespace Pelican
+{
+	class Camera;
+
+	// Keyframes a camera moves along, sampled by time instead of by input so every run sees the same views.
+	// The JSON format is { "keyframes": [ { "time": 0.0, "position": [ x, y, z ], "yaw": 0.0, "pitch": 0.0 } ] },
+	// with the times in seconds and the angles in degrees. Recordings use a compact binary format instead, a small header
+	// followed by the raw keyframes, which is what every file that doesn't end in .json gets saved as.
+	class CameraPath final
+	{
+	public:
+		struct Keyframe
+		{
+			float time;
+			glm::vec3 position;
+			float yaw;
+			float pitch;
+		};
+
+		CameraPath() = default;
+
+		// Reads either format. Throws when the file can't be read or isn't a camera path.
+		void LoadFromFile(const std::filesystem::path& path);
+		// Throws when the file can't be written.
+		void SaveToFile(const std::filesystem::path& path) const;
+
+		// Keyframes have to be added in time order.
+		void AddKeyframe(const Keyframe& keyframe);
+
+		// Interpolates linearly between the keyframes around the time, clamped to the first and last one.
+		[[nodiscard]] Keyframe Sample(float time) const;
+		// Moves the camera to where the path is at the given time.
+		void Apply(Camera* pCamera, float time) const;
+
+		[[nodiscard]] float GetDuration() const;
+		[[nodiscard]] bool IsEmpty() const { return m_Keyframes.empty(); }
+		void Clear() { m_Keyframes.clear(); }
+		[[nodiscard]] const std::vector<Keyframe>& GetKeyframes() const { return m_Keyframes; }
+
+		// A full circle around the center that keeps looking at it, for scenes without a path of their own.
+		[[nodiscard]] static CameraPath CreateOrbit(const glm::vec3& center, float radius, float height, float duration);
+
+	private:
+		void LoadJson(const std::string& contents);
+		void LoadBinary(const std::string& contents);
+		void SaveJson(const std::filesystem::path& path) const;
+		void SaveBinary(const std::filesystem::path& path) const;
+
+	private:
+		std::vector<Keyframe> m_Keyframes{};
+	};
+}
@@ -0,0 +1,191 @@
+﻿#include "PelicanPCH.h"
+#include "CameraRecorder.h"
+
+#include <cmath>
+
+#include <imgui.h>
+#include <misc/cpp/imgui_stdlib.h>
+#include <logtools.h>
+
+#include "Camera.h"
+
+#include "Pelican/Core/Time.h"
+
+namespace Pelican
+{
+	void CameraRecorder::StartRecording()
+	{
+		Stop();
+
+		m_Path.Clear();
+		m_Frame = 0;
+		m_Time = 0.0f;
+		m_State = State::Recording;
+	}
+
+	void CameraRecorder::StartPlayback(const CameraPath& path, float timestep, bool loop)
+	{
+		Stop();
+
+		if (path.IsEmpty())
+		{
+			Logger::LogWarning("Can't play back a camera path without keyframes");
+			return;
+		}
+
+		m_Path = path;
+		m_Timestep = timestep;
+		m_Loop = loop;
+		m_Frame = 0;
+		m_Time = 0.0f;
+		m_State = State::Playing;
+	}
+
+	void CameraRecorder::Stop()
+	{
+		if (m_pPlaybackCamera)
+		{
+			m_pPlaybackCamera->SetInputEnabled(true);
+			m_pPlaybackCamera = nullptr;
+		}
+
+		m_State = State::Idle;
+	}
+
+	void CameraRecorder::Update(Camera* pCamera)
+	{
+		switch (m_State)
+		{
+		case State::Recording:
+		{
+			// The recording starts at 0, however long the frame before it took.
+			if (!m_Path.IsEmpty())
+			{
+				m_Time += Time::GetDeltaTime();
+			}
+
+			m_Path.AddKeyframe(CameraPath::Keyframe{ m_Time, pCamera->GetPosition(), pCamera->GetYaw(), pCamera->GetPitch() });
+			m_Frame++;
+			break;
+		}
+		case State::Playing:
+		{
+			if (!m_pPlaybackCamera)
+			{
+				pCamera->SetInputEnabled(false);
+				m_pPlaybackCamera = pCamera;
+			}
+
+			// Derived from the frame instead of summed up, so long playbacks don't drift.
+			const float duration = m_Path.GetDuration();
+			float time = static_cast<float>(m_Frame) * m_Timestep;
+			if (time > duration)
+			{
+				if (m_Loop)
+				{
+					time = duration > 0.0f ? std::fmod(time, duration) : 0.0f;
+				}
+				else if (static_cast<float>(m_Frame - 1) * m_Timestep >= duration)
+				{
+					Logger::LogInfo("Camera playback finished after %u frames", m_Frame);
+					Stop();
+					break;
+				}
+				else
+				{
+					// The last frame lands exactly on the end of the path.
+					time = duration;
+				}
+			}
+
+			m_Time = time;
+			m_Path.Apply(pCamera, m_Path.GetKeyframes().front().time + time);
+			m_Frame++;
+			break;
+		}
+		case State::Idle:
+			break;
+		}
+	}
+
+	void CameraRecorder::DebugDraw()
+	{
+		if (ImGui::Begin("Camera Recorder"))
+		{
+			switch (m_State)
+			{
+			case State::Idle:
+				ImGui::Text("Idle, %u keyframes", static_cast<uint32_t>(m_Path.GetKeyframes().size()));
+				break;
+			case State::Recording:
+				ImGui::Text("Recording: %u frames, %.1fs", m_Frame, m_Time);
+				break;
+			case State::Playing:
+				ImGui::Text("Playing: frame %u, %.1fs / %.1fs", m_Frame, m_Time, m_Path.GetDuration());
+				break;
+			}
+
+			if (m_State == State::Idle)
+			{
+				if (ImGui::Button("Record"))
+				{
+					StartRecording();
+				}
+
+				if (!m_Path.IsEmpty())
+				{
+					ImGui::SameLine();
+					if (ImGui::Button("Play"))
+					{
+						const CameraPath path = m_Path;
+						StartPlayback(path, m_Timestep, m_Loop);
+					}
+				}
+
+				ImGui::SameLine();
+				ImGui::Checkbox("Loop", &m_Loop);
+			}
+			else if (ImGui::Button("Stop"))
+			{
+				Stop();
+			}
+
+			static std::string filePath = "camera.campath";
+			ImGui::InputText("File", &filePath);
+			if (m_State != State::Recording)
+			{
+				if (ImGui::Button("Load"))
+				{
+					try
+					{
+						CameraPath path;
+						path.LoadFromFile(filePath);
+						Stop();
+						m_Path = path;
+					}
+					catch (const std::exception& e)
+					{
+						Logger::LogError("%s", e.what());
+					}
+				}
+
+				if (!m_Path.IsEmpty())
+				{
+					ImGui::SameLine();
+					if (ImGui::Button("Save"))
+					{
+						try
+						{
+							m_Path.SaveToFile(filePath);
+						}
+						catch (const std::exception& e)
+						{
+							Logger::LogError("%s", e.what());
+						}
+					}
+				}
+			}
+		}
+		ImGui::End();
+	}
+}
@@ -0,0 +1,49 @@
+﻿#pragma once
+#include "CameraPath.h"
+
+namespace Pelican
+{
+	class Camera;
+
+	// Records where the camera is every frame, and plays recordings or other camera paths back.
+	// Playback moves a fixed timestep along the path every frame, whatever the frame took, so two runs of the same
+	// recording render the exact same views. Input doesn't move the camera while playing.
+	class CameraRecorder final
+	{
+	public:
+		enum class State
+		{
+			Idle,
+			Recording,
+			Playing,
+		};
+
+		static constexpr float DEFAULT_TIMESTEP = 1.0f / 60.0f;
+
+		// Drops whatever was recorded or played before.
+		void StartRecording();
+		void StartPlayback(const CameraPath& path, float timestep = DEFAULT_TIMESTEP, bool loop = false);
+		void Stop();
+
+		// Call once per frame after the camera updated, records it or moves it along the path.
+		void Update(Camera* pCamera);
+
+		// Also the path that's being played back.
+		[[nodiscard]] const CameraPath& GetRecording() const { return m_Path; }
+		[[nodiscard]] State GetState() const { return m_State; }
+		[[nodiscard]] uint32_t GetFrame() const { return m_Frame; }
+
+		void DebugDraw();
+
+	private:
+		CameraPath m_Path{};
+		State m_State{ State::Idle };
+
+		uint32_t m_Frame{};
+		float m_Time{};
+		float m_Timestep{ DEFAULT_TIMESTEP };
+		bool m_Loop{};
+		// Input has to be turned on again when playback stops.
+		Camera* m_pPlaybackCamera{};
+	};
+}
@@ -0,0 +1,43 @@
+﻿#include "PelicanPCH.h"
+#include "Frustum.h"
+
+namespace Pelican
+{
+	Frustum Frustum::FromMatrix(const glm::mat4& viewProjection)
+	{
+		// glm matrices are column major, so these are the rows.
+		const glm::vec4 row0{ viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0] };
+		const glm::vec4 row1{ viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1] };
+		const glm::vec4 row2{ viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2] };
+		const glm::vec4 row3{ viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3] };
+
+		Frustum frustum;
+		frustum.planes[LEFT_PLANE] = row3 + row0;
+		frustum.planes[RIGHT_PLANE] = row3 - row0;
+		frustum.planes[BOTTOM_PLANE] = row3 + row1;
+		frustum.planes[TOP_PLANE] = row3 - row1;
+		// The camera builds its projection for a -1 to 1 depth range. For a 0 to 1 range this near plane
+		// ends up behind the real one, which only makes the test more conservative.
+		frustum.planes[NEAR_PLANE] = row3 + row2;
+		frustum.planes[FAR_PLANE] = row3 - row2;
+
+		// Normalized, so the distance to a plane can be compared against a radius.
+		for (glm::vec4& plane : frustum.planes)
+		{
+			plane /= glm::length(glm::vec3(plane));
+		}
+
+		return frustum;
+	}
+
+	bool Frustum::IntersectsSphere(const glm::vec3& center, float radius) const
+	{
+		for (const glm::vec4& plane : planes)
+		{
+			if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+				return false;
+		}
+
+		return true;
+	}
+}
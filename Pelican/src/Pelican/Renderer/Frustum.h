@@ -0,0 +1,29 @@
+﻿#pragma once
+#include <glm/glm.hpp>
+
+namespace Pelican
+{
+	// The six planes of a view frustum, with their normals pointing inwards.
+	// A point p is inside a plane when dot(plane.xyz, p) + plane.w >= 0.
+	struct Frustum
+	{
+		enum Plane : uint32_t
+		{
+			LEFT_PLANE = 0,
+			RIGHT_PLANE,
+			BOTTOM_PLANE,
+			TOP_PLANE,
+			NEAR_PLANE,
+			FAR_PLANE,
+
+			PLANE_COUNT
+		};
+
+		glm::vec4 planes[PLANE_COUNT]{};
+
+		// Extracts the planes from a (projection * view) matrix, the planes end up in the space the matrix transforms from.
+		[[nodiscard]] static Frustum FromMatrix(const glm::mat4& viewProjection);
+
+		[[nodiscard]] bool IntersectsSphere(const glm::vec3& center, float radius) const;
+	};
+}
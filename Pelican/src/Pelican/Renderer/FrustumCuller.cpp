@@ -0,0 +1,353 @@
+﻿#include "PelicanPCH.h"
+#include "FrustumCuller.h"
+
+#include <bit>
+#include <chrono>
+#include <random>
+
+#include <logtools.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#define PELICAN_CULL_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+// MSVC lets any function use any instruction set, gcc and clang have to be told per function.
+#if defined(PELICAN_CULL_X86) && !defined(_MSC_VER)
+#define PELICAN_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define PELICAN_TARGET_AVX2
+#endif
+
+namespace Pelican
+{
+	namespace
+	{
+		bool CpuSupportsAvx2()
+		{
+#if defined(PELICAN_CULL_X86) && defined(_MSC_VER)
+			int info[4]{};
+			__cpuid(info, 0);
+			if (info[0] < 7)
+				return false;
+
+			// The OS has to save the ymm registers on a context switch as well, which is what XCR0 bits 1 and 2 say.
+			__cpuid(info, 1);
+			const bool osxsave = (info[2] & (1 << 27)) != 0;
+			const bool avx = (info[2] & (1 << 28)) != 0;
+			if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+				return false;
+
+			__cpuidex(info, 7, 0);
+			return (info[1] & (1 << 5)) != 0;
+#elif defined(PELICAN_CULL_X86)
+			return __builtin_cpu_supports("avx2");
+#else
+			return false;
+#endif
+		}
+	}
+
+	void BoundsSoA::Resize(uint32_t newCount)
+	{
+		count = newCount;
+
+		const size_t paddedCount = (static_cast<size_t>(newCount) + BLOCK_SIZE - 1) / BLOCK_SIZE * BLOCK_SIZE;
+		centerX.resize(paddedCount);
+		centerY.resize(paddedCount);
+		centerZ.resize(paddedCount);
+		extentX.resize(paddedCount);
+		extentY.resize(paddedCount);
+		extentZ.resize(paddedCount);
+	}
+
+	void BoundsSoA::Set(uint32_t index, const BoundingBox& bounds, const glm::mat4& transform)
+	{
+		// A model without meshes, it doesn't draw anything either way.
+		const glm::vec3 center = bounds.IsValid() ? bounds.GetCenter() : glm::vec3{};
+		const glm::vec3 extents = bounds.IsValid() ? bounds.GetExtents() : glm::vec3{};
+
+		// Every world axis gets the extents projected through the absolute rotation and scale (Arvo's method),
+		// cheaper than transforming all eight corners.
+		const glm::mat3 absolute{ glm::abs(glm::vec3(transform[0])), glm::abs(glm::vec3(transform[1])), glm::abs(glm::vec3(transform[2])) };
+		const glm::vec3 worldCenter = glm::vec3(transform * glm::vec4(center, 1.0f));
+		const glm::vec3 worldExtents = absolute * extents;
+
+		centerX[index] = worldCenter.x;
+		centerY[index] = worldCenter.y;
+		centerZ[index] = worldCenter.z;
+		extentX[index] = worldExtents.x;
+		extentY[index] = worldExtents.y;
+		extentZ[index] = worldExtents.z;
+	}
+
+	FrustumCuller::FrustumCuller()
+	{
+		if (IsSupported(Path::Avx2))
+			m_Path = Path::Avx2;
+		else if (IsSupported(Path::Sse))
+			m_Path = Path::Sse;
+	}
+
+	uint32_t FrustumCuller::Cull(const Frustum& frustum, const BoundsSoA& bounds, uint32_t* pVisible) const
+	{
+		switch (m_Path)
+		{
+		case Path::Avx2:
+			return CullAvx2(frustum, bounds, pVisible);
+		case Path::Sse:
+			return CullSse(frustum, bounds, pVisible);
+		case Path::Scalar:
+		default:
+			return CullScalar(frustum, bounds, pVisible);
+		}
+	}
+
+	bool FrustumCuller::IsSupported(Path path)
+	{
+		static const bool s_Avx2 = CpuSupportsAvx2();
+
+		switch (path)
+		{
+		case Path::Avx2:
+			return s_Avx2;
+		case Path::Sse:
+#ifdef PELICAN_CULL_X86
+			return true;
+#else
+			return false;
+#endif
+		case Path::Scalar:
+		default:
+			return true;
+		}
+	}
+
+	const char* FrustumCuller::GetPathName(Path path)
+	{
+		switch (path)
+		{
+		case Path::Avx2:
+			return "AVX2";
+		case Path::Sse:
+			return "SSE";
+		case Path::Scalar:
+		default:
+			return "Scalar";
+		}
+	}
+
+	void FrustumCuller::RunBenchmark(uint32_t objectCount, uint32_t iterations)
+	{
+		// Fixed seed, so runs can be compared. The boxes surround the camera, so most of them end up outside the frustum.
+		std::mt19937 random{ 1337 };
+		std::uniform_real_distribution<float> position{ -500.0f, 500.0f };
+		std::uniform_real_distribution<float> size{ 0.5f, 10.0f };
+
+		BoundsSoA bounds;
+		bounds.Resize(objectCount);
+		for (uint32_t i = 0; i < objectCount; i++)
+		{
+			const glm::vec3 halfSize{ size(random), size(random), size(random) };
+			BoundingBox box;
+			box.Expand(-halfSize);
+			box.Expand(halfSize);
+
+			const glm::vec3 offset{ position(random), position(random), position(random) };
+			bounds.Set(i, box, glm::translate(glm::mat4(1.0f), offset));
+		}
+
+		const glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		const glm::mat4 projection = glm::perspective(glm::radians(90.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+		const Frustum frustum = Frustum::FromMatrix(projection * view);
+
+		std::vector<uint32_t> visible(objectCount);
+
+		Logger::LogInfo("Culling benchmark: %u objects, %u iterations", objectCount, iterations);
+
+		uint32_t scalarCount = 0;
+		for (const Path path : { Path::Scalar, Path::Sse, Path::Avx2 })
+		{
+			if (!IsSupported(path))
+			{
+				Logger::LogInfo("  %s: not supported on this CPU", GetPathName(path));
+				continue;
+			}
+
+			FrustumCuller culler;
+			culler.SetPath(path);
+
+			// Warm up the caches.
+			uint32_t visibleCount = culler.Cull(frustum, bounds, visible.data());
+
+			const auto startTime = std::chrono::high_resolution_clock::now();
+			for (uint32_t i = 0; i < iterations; i++)
+			{
+				visibleCount = culler.Cull(frustum, bounds, visible.data());
+			}
+			const float ms = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+			Logger::LogInfo("  %s: %.0f objects/ms, %.3fms per cull, %u visible", GetPathName(path),
+				static_cast<float>(objectCount) * static_cast<float>(iterations) / ms, ms / static_cast<float>(iterations), visibleCount);
+
+			if (path == Path::Scalar)
+				scalarCount = visibleCount;
+			else if (visibleCount != scalarCount)
+				Logger::LogWarning("  %s found %u visible objects, the scalar path found %u!", GetPathName(path), visibleCount, scalarCount);
+		}
+	}
+
+	uint32_t FrustumCuller::CullScalar(const Frustum& frustum, const BoundsSoA& bounds, uint32_t* pVisible)
+	{
+		uint32_t visibleCount = 0;
+		for (uint32_t i = 0; i < bounds.count; i++)
+		{
+			bool visible = true;
+			for (const glm::vec4& plane : frustum.planes)
+			{
+				// The box is outside when even its corner furthest along the plane normal is behind the plane.
+				const float distance = plane.x * bounds.centerX[i] + plane.y * bounds.centerY[i] + plane.z * bounds.centerZ[i] + plane.w;
+				const float radius = std::abs(plane.x) * bounds.extentX[i] + std::abs(plane.y) * bounds.extentY[i] + std::abs(plane.z) * bounds.extentZ[i];
+				if (distance + radius < 0.0f)
+				{
+					visible = false;
+					break;
+				}
+			}
+
+			if (visible)
+				pVisible[visibleCount++] = i;
+		}
+
+		return visibleCount;
+	}
+
+	uint32_t FrustumCuller::CullSse(const Frustum& frustum, const BoundsSoA& bounds, uint32_t* pVisible)
+	{
+#ifdef PELICAN_CULL_X86
+		__m128 planeX[Frustum::PLANE_COUNT];
+		__m128 planeY[Frustum::PLANE_COUNT];
+		__m128 planeZ[Frustum::PLANE_COUNT];
+		__m128 planeW[Frustum::PLANE_COUNT];
+		__m128 absX[Frustum::PLANE_COUNT];
+		__m128 absY[Frustum::PLANE_COUNT];
+		__m128 absZ[Frustum::PLANE_COUNT];
+		for (uint32_t p = 0; p < Frustum::PLANE_COUNT; p++)
+		{
+			const glm::vec4& plane = frustum.planes[p];
+			planeX[p] = _mm_set1_ps(plane.x);
+			planeY[p] = _mm_set1_ps(plane.y);
+			planeZ[p] = _mm_set1_ps(plane.z);
+			planeW[p] = _mm_set1_ps(plane.w);
+			absX[p] = _mm_set1_ps(std::abs(plane.x));
+			absY[p] = _mm_set1_ps(std::abs(plane.y));
+			absZ[p] = _mm_set1_ps(std::abs(plane.z));
+		}
+
+		const __m128 zero = _mm_setzero_ps();
+
+		uint32_t visibleCount = 0;
+		for (uint32_t i = 0; i < bounds.count; i += 4)
+		{
+			const __m128 centerX = _mm_loadu_ps(bounds.centerX.data() + i);
+			const __m128 centerY = _mm_loadu_ps(bounds.centerY.data() + i);
+			const __m128 centerZ = _mm_loadu_ps(bounds.centerZ.data() + i);
+			const __m128 extentX = _mm_loadu_ps(bounds.extentX.data() + i);
+			const __m128 extentY = _mm_loadu_ps(bounds.extentY.data() + i);
+			const __m128 extentZ = _mm_loadu_ps(bounds.extentZ.data() + i);
+
+			__m128 outside = _mm_setzero_ps();
+			for (uint32_t p = 0; p < Frustum::PLANE_COUNT; p++)
+			{
+				const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], centerX), _mm_mul_ps(planeY[p], centerY)),
+					_mm_add_ps(_mm_mul_ps(planeZ[p], centerZ), planeW[p]));
+				const __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absX[p], extentX), _mm_mul_ps(absY[p], extentY)), _mm_mul_ps(absZ[p], extentZ));
+				outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), zero));
+			}
+
+			uint32_t visibleMask = ~static_cast<uint32_t>(_mm_movemask_ps(outside)) & 0xF;
+			// The lanes past the end are padding.
+			if (bounds.count - i < 4)
+				visibleMask &= (1u << (bounds.count - i)) - 1;
+
+			while (visibleMask)
+			{
+				pVisible[visibleCount++] = i + static_cast<uint32_t>(std::countr_zero(visibleMask));
+				visibleMask &= visibleMask - 1;
+			}
+		}
+
+		return visibleCount;
+#else
+		return CullScalar(frustum, bounds, pVisible);
+#endif
+	}
+
+	PELICAN_TARGET_AVX2 uint32_t FrustumCuller::CullAvx2(const Frustum& frustum, const BoundsSoA& bounds, uint32_t* pVisible)
+	{
+#ifdef PELICAN_CULL_X86
+		__m256 planeX[Frustum::PLANE_COUNT];
+		__m256 planeY[Frustum::PLANE_COUNT];
+		__m256 planeZ[Frustum::PLANE_COUNT];
+		__m256 planeW[Frustum::PLANE_COUNT];
+		__m256 absX[Frustum::PLANE_COUNT];
+		__m256 absY[Frustum::PLANE_COUNT];
+		__m256 absZ[Frustum::PLANE_COUNT];
+		for (uint32_t p = 0; p < Frustum::PLANE_COUNT; p++)
+		{
+			const glm::vec4& plane = frustum.planes[p];
+			planeX[p] = _mm256_set1_ps(plane.x);
+			planeY[p] = _mm256_set1_ps(plane.y);
+			planeZ[p] = _mm256_set1_ps(plane.z);
+			planeW[p] = _mm256_set1_ps(plane.w);
+			absX[p] = _mm256_set1_ps(std::abs(plane.x));
+			absY[p] = _mm256_set1_ps(std::abs(plane.y));
+			absZ[p] = _mm256_set1_ps(std::abs(plane.z));
+		}
+
+		const __m256 zero = _mm256_setzero_ps();
+
+		uint32_t visibleCount = 0;
+		for (uint32_t i = 0; i < bounds.count; i += 8)
+		{
+			const __m256 centerX = _mm256_loadu_ps(bounds.centerX.data() + i);
+			const __m256 centerY = _mm256_loadu_ps(bounds.centerY.data() + i);
+			const __m256 centerZ = _mm256_loadu_ps(bounds.centerZ.data() + i);
+			const __m256 extentX = _mm256_loadu_ps(bounds.extentX.data() + i);
+			const __m256 extentY = _mm256_loadu_ps(bounds.extentY.data() + i);
+			const __m256 extentZ = _mm256_loadu_ps(bounds.extentZ.data() + i);
+
+			__m256 outside = _mm256_setzero_ps();
+			for (uint32_t p = 0; p < Frustum::PLANE_COUNT; p++)
+			{
+				const __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planeX[p], centerX), _mm256_mul_ps(planeY[p], centerY)),
+					_mm256_add_ps(_mm256_mul_ps(planeZ[p], centerZ), planeW[p]));
+				const __m256 radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(absX[p], extentX), _mm256_mul_ps(absY[p], extentY)), _mm256_mul_ps(absZ[p], extentZ));
+				outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), zero, _CMP_LT_OQ));
+			}
+
+			uint32_t visibleMask = ~static_cast<uint32_t>(_mm256_movemask_ps(outside)) & 0xFF;
+			// The lanes past the end are padding.
+			if (bounds.count - i < 8)
+				visibleMask &= (1u << (bounds.count - i)) - 1;
+
+			while (visibleMask)
+			{
+				pVisible[visibleCount++] = i + static_cast<uint32_t>(std::countr_zero(visibleMask));
+				visibleMask &= visibleMask - 1;
+			}
+		}
+
+		return visibleCount;
+#else
+		return CullScalar(frustum, bounds, pVisible);
+#endif
+	}
+}
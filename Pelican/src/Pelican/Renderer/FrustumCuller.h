@@ -0,0 +1,67 @@
+﻿#pragma once
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Bounds.h"
+#include "Frustum.h"
+
+namespace Pelican
+{
+	// World space boxes as center and extents, in structure of arrays layout so the culler can load
+	// 4 or 8 of the same component at once. The arrays are padded to a multiple of BLOCK_SIZE.
+	struct BoundsSoA
+	{
+		static constexpr uint32_t BLOCK_SIZE = 8;
+
+		std::vector<float> centerX{};
+		std::vector<float> centerY{};
+		std::vector<float> centerZ{};
+		std::vector<float> extentX{};
+		std::vector<float> extentY{};
+		std::vector<float> extentZ{};
+		uint32_t count{};
+
+		void Resize(uint32_t newCount);
+		// Transforms an object space box and stores the box that encloses the result.
+		void Set(uint32_t index, const BoundingBox& bounds, const glm::mat4& transform);
+	};
+
+	// Tests boxes against the six planes of a frustum, with SSE or AVX2 when the CPU has it.
+	class FrustumCuller final
+	{
+	public:
+		enum class Path
+		{
+			Scalar,
+			Sse,
+			Avx2,
+		};
+
+		// Picks the widest path the CPU supports.
+		FrustumCuller();
+
+		// Writes the indices of the visible boxes to pVisible, which needs room for bounds.count indices.
+		// Returns how many are visible.
+		uint32_t Cull(const Frustum& frustum, const BoundsSoA& bounds, uint32_t* pVisible) const;
+
+		// Falls back to the scalar path when the CPU doesn't support the given one.
+		void SetPath(Path path) { m_Path = IsSupported(path) ? path : Path::Scalar; }
+		[[nodiscard]] Path GetPath() const { return m_Path; }
+
+		[[nodiscard]] static bool IsSupported(Path path);
+		[[nodiscard]] static const char* GetPathName(Path path);
+
+		// Culls objectCount random boxes iterations times with every supported path, and logs how many objects
+		// per millisecond each of them gets through.
+		static void RunBenchmark(uint32_t objectCount = 100'000, uint32_t iterations = 200);
+
+	private:
+		static uint32_t CullScalar(const Frustum& frustum, const BoundsSoA& bounds, uint32_t* pVisible);
+		static uint32_t CullSse(const Frustum& frustum, const BoundsSoA& bounds, uint32_t* pVisible);
+		static uint32_t CullAvx2(const Frustum& frustum, const BoundsSoA& bounds, uint32_t* pVisible);
+
+	private:
+		Path m_Path{ Path::Scalar };
+	};
+}
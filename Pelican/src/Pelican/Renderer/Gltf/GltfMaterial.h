@@ -22,5 +22,10 @@ namespace Pelican
 		VulkanTexture* m_pAOTexture;
 		VulkanTexture* m_pEmissiveTexture;
 		glm::vec3 m_EmissiveFactor;
+
+		// Blended instead of written to depth, these are drawn back to front after everything else.
+		bool m_IsTranslucent;
+		// Cut out with the albedo alpha, these are left out of the depth prepass since it doesn't read any textures.
+		bool m_IsAlphaTested;
 	};
 }
@@ -0,0 +1,187 @@
+﻿#include "PelicanPCH.h"
+#include "GpuProfiler.h"
+
+#include <imgui.h>
+
+#include "VulkanDebug.h"
+#include "VulkanDevice.h"
+
+namespace Pelican
+{
+	GpuProfiler::GpuProfiler(VulkanDevice* pDevice, uint32_t frameCount)
+		: m_pDevice(pDevice)
+	{
+		const vk::PhysicalDevice physicalDevice = m_pDevice->GetPhysicalDevice();
+		const uint32_t validBits = physicalDevice.getQueueFamilyProperties()[m_pDevice->GetGraphicsQueueFamily()].timestampValidBits;
+		m_TimestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+		m_TimestampPeriod = physicalDevice.getProperties().limits.timestampPeriod;
+
+		m_Frames.resize(frameCount);
+		if (!IsSupported())
+			return;
+
+		const vk::QueryPoolCreateInfo poolInfo = vk::QueryPoolCreateInfo()
+			.setQueryType(vk::QueryType::eTimestamp)
+			.setQueryCount(MAX_REGIONS * 2);
+
+		for (Frame& frame : m_Frames)
+		{
+			try
+			{
+				frame.queryPool = m_pDevice->GetDevice().createQueryPool(poolInfo);
+			}
+			catch (vk::SystemError& e)
+			{
+				throw std::runtime_error("Failed to create timestamp query pool: "s + e.what());
+			}
+		}
+	}
+
+	GpuProfiler::~GpuProfiler()
+	{
+		for (const Frame& frame : m_Frames)
+		{
+			m_pDevice->GetDevice().destroyQueryPool(frame.queryPool);
+		}
+	}
+
+	void GpuProfiler::BeginFrame(uint32_t frameIndex)
+	{
+		m_FrameIndex = frameIndex;
+		m_OpenRegions.clear();
+
+		Frame& frame = m_Frames[m_FrameIndex];
+		if (frame.regions.empty())
+			return;
+
+		// The fence has been waited on, so the results are there already and this doesn't have to wait for them.
+		const uint32_t queryCount = static_cast<uint32_t>(frame.regions.size()) * 2;
+		std::vector<uint64_t> timestamps(queryCount);
+		const vk::Result result = m_pDevice->GetDevice().getQueryPoolResults(frame.queryPool, 0, queryCount,
+			timestamps.size() * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+
+		if (result == vk::Result::eSuccess)
+		{
+			m_Regions.clear();
+			for (size_t i = 0; i < frame.regions.size(); i++)
+			{
+				RecordedRegion& recorded = frame.regions[i];
+				const uint64_t ticks = (timestamps[i * 2 + 1] - timestamps[i * 2]) & m_TimestampMask;
+				const float time = static_cast<float>(static_cast<double>(ticks) * m_TimestampPeriod / 1'000'000.0);
+				m_Regions.push_back(Region{ std::move(recorded.name), recorded.parent, recorded.depth, time });
+			}
+		}
+		frame.regions.clear();
+	}
+
+	void GpuProfiler::ResetQueries(vk::CommandBuffer cmd)
+	{
+		if (IsSupported())
+		{
+			cmd.resetQueryPool(m_Frames[m_FrameIndex].queryPool, 0, MAX_REGIONS * 2);
+		}
+	}
+
+	void GpuProfiler::BeginRegion(vk::CommandBuffer cmd, const char* name, const glm::vec4& color)
+	{
+		VkDebugMarker::BeginRegion(cmd, name, color);
+
+		Frame& frame = m_Frames[m_FrameIndex];
+		if (!IsSupported() || frame.regions.size() >= MAX_REGIONS)
+		{
+			m_OpenRegions.push_back(INVALID_REGION);
+			return;
+		}
+
+		// Regions that didn't get queries are left out of the tree, their children hang off the closest one that did.
+		uint32_t parent = INVALID_REGION;
+		for (auto it = m_OpenRegions.rbegin(); it != m_OpenRegions.rend(); ++it)
+		{
+			if (*it != INVALID_REGION)
+			{
+				parent = *it;
+				break;
+			}
+		}
+
+		const uint32_t index = static_cast<uint32_t>(frame.regions.size());
+		const uint32_t depth = parent != INVALID_REGION ? frame.regions[parent].depth + 1 : 0;
+		frame.regions.push_back(RecordedRegion{ name, parent, depth });
+		m_OpenRegions.push_back(index);
+
+		cmd.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, frame.queryPool, index * 2);
+	}
+
+	void GpuProfiler::EndRegion(vk::CommandBuffer cmd)
+	{
+		ASSERT_MSG(!m_OpenRegions.empty(), "Ended a GPU region that was never begun!");
+
+		const uint32_t index = m_OpenRegions.back();
+		m_OpenRegions.pop_back();
+		if (index != INVALID_REGION)
+		{
+			cmd.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, m_Frames[m_FrameIndex].queryPool, index * 2 + 1);
+		}
+
+		VkDebugMarker::EndRegion(cmd);
+	}
+
+	float GpuProfiler::GetRegionTime(const std::string& name) const
+	{
+		float time = 0.0f;
+		for (const Region& region : m_Regions)
+		{
+			if (region.name == name)
+			{
+				time += region.time;
+			}
+		}
+		return time;
+	}
+
+	void GpuProfiler::DebugDraw() const
+	{
+		if (ImGui::Begin("GPU Timings"))
+		{
+			if (!IsSupported())
+			{
+				ImGui::Text("The graphics queue doesn't support timestamps.");
+			}
+
+			for (uint32_t i = 0; i < static_cast<uint32_t>(m_Regions.size()); i++)
+			{
+				if (m_Regions[i].parent == INVALID_REGION)
+				{
+					DrawRegion(i);
+				}
+			}
+		}
+		ImGui::End();
+	}
+
+	void GpuProfiler::DrawRegion(uint32_t index) const
+	{
+		// Children always come after their parent.
+		std::vector<uint32_t> children;
+		for (uint32_t i = index + 1; i < static_cast<uint32_t>(m_Regions.size()); i++)
+		{
+			if (m_Regions[i].parent == index)
+			{
+				children.push_back(i);
+			}
+		}
+
+		const Region& region = m_Regions[index];
+		const ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_DefaultOpen | (children.empty() ? ImGuiTreeNodeFlags_Leaf : 0);
+		ImGui::PushID(static_cast<int>(index));
+		if (ImGui::TreeNodeEx("Region", flags, "%s: %.3fms", region.name.c_str(), region.time))
+		{
+			for (const uint32_t child : children)
+			{
+				DrawRegion(child);
+			}
+			ImGui::TreePop();
+		}
+		ImGui::PopID();
+	}
+}
@@ -0,0 +1,91 @@
+﻿#pragma once
+
+#include <string>
+
+#include <vulkan/vulkan.hpp>
+
+#pragma warning(push, 0)
+#include <glm/vec4.hpp>
+#pragma warning(pop)
+
+namespace Pelican
+{
+	class VulkanDevice;
+
+	// Times the debug marker regions of a frame on the GPU. Every region gets a timestamp at its start and end,
+	// written into a query pool that belongs to the frame in flight. The pool is only read once the frame's fence
+	// has been waited on, so the results are MAX_FRAMES_IN_FLIGHT frames old but getting them never stalls.
+	//
+	// Regions can be nested and may be recorded into the frame's primary command buffer or into any secondary one
+	// executed by it, as long as it's done on the thread recording the frame.
+	class GpuProfiler final
+	{
+	public:
+		static constexpr uint32_t MAX_REGIONS = 128;
+		static constexpr uint32_t INVALID_REGION = ~0u;
+
+		struct Region
+		{
+			std::string name;
+			// Index of the enclosing region in the same list, regions always come after their parent.
+			uint32_t parent;
+			uint32_t depth;
+			float time;
+		};
+
+		GpuProfiler(VulkanDevice* pDevice, uint32_t frameCount);
+		~GpuProfiler();
+
+		GpuProfiler(const GpuProfiler&) = delete;
+		GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+		// Only call this once the fence of the given frame has been waited on, reads back the regions it recorded.
+		void BeginFrame(uint32_t frameIndex);
+		// Has to be recorded at the start of the frame's primary command buffer, outside of a render pass.
+		void ResetQueries(vk::CommandBuffer cmd);
+
+		// Begins a debug marker region as well, so the regions show up the same in external tools.
+		void BeginRegion(vk::CommandBuffer cmd, const char* name, const glm::vec4& color);
+		void EndRegion(vk::CommandBuffer cmd);
+
+		// The regions of the last frame the GPU finished, in the order they began. Times are in milliseconds.
+		[[nodiscard]] const std::vector<Region>& GetRegions() const { return m_Regions; }
+		// Sums the time of every region with this name, 0 if there is none.
+		[[nodiscard]] float GetRegionTime(const std::string& name) const;
+		// False when the graphics queue can't write timestamps, regions still get their debug markers then.
+		[[nodiscard]] bool IsSupported() const { return m_TimestampMask != 0; }
+
+		void DebugDraw() const;
+
+	private:
+		struct RecordedRegion
+		{
+			std::string name;
+			uint32_t parent;
+			uint32_t depth;
+		};
+
+		struct Frame
+		{
+			vk::QueryPool queryPool{};
+			// Region i uses queries 2 * i and 2 * i + 1.
+			std::vector<RecordedRegion> regions{};
+		};
+
+		void DrawRegion(uint32_t index) const;
+
+	private:
+		VulkanDevice* m_pDevice{};
+
+		std::vector<Frame> m_Frames{};
+		uint32_t m_FrameIndex{};
+		// Regions that have begun but not ended yet, INVALID_REGION for the ones that didn't get queries.
+		std::vector<uint32_t> m_OpenRegions{};
+
+		// Nanoseconds per timestamp tick.
+		float m_TimestampPeriod{};
+		uint64_t m_TimestampMask{};
+
+		std::vector<Region> m_Regions{};
+	};
+}
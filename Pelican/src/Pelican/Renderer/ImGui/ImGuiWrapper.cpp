@@ -2,9 +2,10 @@
 #include "ImGuiWrapper.h"
 
 #include "Pelican/Core/Application.h"
+#include "Pelican/Core/Time.h"
 
-#include "Pelican/Renderer/VulkanDebug.h"
 #include "Pelican/Renderer/VulkanHelpers.h"
+#include "Pelican/Renderer/VulkanRenderer.h"
 
 #include <imgui.h>
 // ReSharper disable file CppUnusedIncludeDirective
@@ -21,6 +22,7 @@ namespace Pelican
 	{
 		// Keep track of the device.
 		m_Device = initInfo.device;
+		m_Headless = Application::Get().GetWindow()->IsHeadless();
 
 		// Create ImGui descriptor pool
 		std::vector<vk::DescriptorPoolSize> poolSizes =
@@ -121,7 +123,16 @@ namespace Pelican
 		colors[ImGuiCol_ModalWindowDimBg] = ImVec4(0.80f, 0.80f, 0.80f, 0.35f);
 
 
-		ImGui_ImplGlfw_InitForVulkan(Application::Get().GetWindow()->GetGLFWWindow(), true);
+		if (m_Headless)
+		{
+			const Window::Params& params = Application::Get().GetWindow()->GetParams();
+			io.DisplaySize = ImVec2(static_cast<float>(params.width), static_cast<float>(params.height));
+			io.IniFilename = nullptr;
+		}
+		else
+		{
+			ImGui_ImplGlfw_InitForVulkan(Application::Get().GetWindow()->GetGLFWWindow(), true);
+		}
 
 		ImGui_ImplVulkan_InitInfo imguiInit = {};
 		imguiInit.Instance = initInfo.instance;
@@ -145,25 +156,39 @@ namespace Pelican
 	{
 		vkDestroyDescriptorPool(m_Device, m_Pool, nullptr);
 		ImGui_ImplVulkan_Shutdown();
-		ImGui_ImplGlfw_Shutdown();
+		if (!m_Headless)
+		{
+			ImGui_ImplGlfw_Shutdown();
+		}
 		ImGui::DestroyContext();
 	}
 
 	void ImGuiWrapper::NewFrame()
 	{
 		ImGui_ImplVulkan_NewFrame();
-		ImGui_ImplGlfw_NewFrame();
+		if (m_Headless)
+		{
+			// ImGui asserts on a zero delta time.
+			ImGui::GetIO().DeltaTime = std::max(Time::GetDeltaTime(), 1.0f / 1000.0f);
+		}
+		else
+		{
+			ImGui_ImplGlfw_NewFrame();
+		}
 		ImGui::NewFrame();
 	}
 
-	void ImGuiWrapper::Render(vk::CommandBuffer cmdBuffer)
+	void ImGuiWrapper::Render(vk::CommandBuffer cmdBuffer, bool draw)
 	{
-		VkDebugMarker::BeginRegion(cmdBuffer, "Debug UI Render", glm::vec4(0.2f, 0.2f, 0.8f, 1.0f));
+		VulkanRenderer::GetGpuProfiler()->BeginRegion(cmdBuffer, "Debug UI Render", glm::vec4(0.2f, 0.2f, 0.8f, 1.0f));
 
 		ImGui::EndFrame();
 		ImGui::Render();
-		ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), cmdBuffer);
+		if (draw)
+		{
+			ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), cmdBuffer);
+		}
 
-		VkDebugMarker::EndRegion(cmdBuffer);
+		VulkanRenderer::GetGpuProfiler()->EndRegion(cmdBuffer);
 	}
 }
@@ -25,10 +25,13 @@ namespace Pelican
 		void Cleanup();
 
 		void NewFrame();
-		void Render(vk::CommandBuffer cmdBuffer);
+		// Always ends the UI frame, drawing it can be skipped so it doesn't end up in frame captures.
+		void Render(vk::CommandBuffer cmdBuffer, bool draw = true);
 
 	private:
 		vk::Device m_Device{};
 		vk::DescriptorPool m_Pool{};
+		// No GLFW window to get input or the display size from, we feed ImGui ourselves.
+		bool m_Headless{};
 	};
 }
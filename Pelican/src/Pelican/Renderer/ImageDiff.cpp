@@ -0,0 +1,95 @@
+﻿#include "PelicanPCH.h"
+#include "ImageDiff.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Pelican
+{
+	namespace ImageDiff
+	{
+		namespace
+		{
+			constexpr uint32_t PIXEL_SIZE = 4;
+			// The YIQ delta between black and white, the largest one there is.
+			constexpr float MAX_DELTA = 35215.0f;
+
+			float Blend(uint8_t channel, float alpha)
+			{
+				return 255.0f + (static_cast<float>(channel) - 255.0f) * alpha;
+			}
+
+			float GetY(float r, float g, float b) { return r * 0.29889531f + g * 0.58662247f + b * 0.11448223f; }
+			float GetI(float r, float g, float b) { return r * 0.59597799f - g * 0.27417610f - b * 0.32180189f; }
+			float GetQ(float r, float g, float b) { return r * 0.21147017f - g * 0.52261711f + b * 0.31114694f; }
+		}
+
+		float GetColorDifference(const uint8_t* pA, const uint8_t* pB)
+		{
+			if (pA[0] == pB[0] && pA[1] == pB[1] && pA[2] == pB[2] && pA[3] == pB[3])
+				return 0.0f;
+
+			const float alphaA = static_cast<float>(pA[3]) / 255.0f;
+			const float alphaB = static_cast<float>(pB[3]) / 255.0f;
+			const float rA = Blend(pA[0], alphaA), gA = Blend(pA[1], alphaA), bA = Blend(pA[2], alphaA);
+			const float rB = Blend(pB[0], alphaB), gB = Blend(pB[1], alphaB), bB = Blend(pB[2], alphaB);
+
+			const float y = GetY(rA, gA, bA) - GetY(rB, gB, bB);
+			const float i = GetI(rA, gA, bA) - GetI(rB, gB, bB);
+			const float q = GetQ(rA, gA, bA) - GetQ(rB, gB, bB);
+			const float delta = 0.5053f * y * y + 0.299f * i * i + 0.1957f * q * q;
+
+			return std::min(std::sqrt(delta / MAX_DELTA), 1.0f);
+		}
+
+		Result Compare(const uint8_t* pA, const uint8_t* pB, uint32_t width, uint32_t height, float threshold, uint8_t* pDiff)
+		{
+			Result result{};
+			result.pixelCount = width * height;
+
+			double differenceSum = 0.0;
+			for (uint32_t pixel = 0; pixel < result.pixelCount; pixel++)
+			{
+				const size_t offset = static_cast<size_t>(pixel) * PIXEL_SIZE;
+				const float difference = GetColorDifference(pA + offset, pB + offset);
+				const bool isDifferent = difference > threshold;
+
+				differenceSum += difference;
+				result.maxDifference = std::max(result.maxDifference, difference);
+				if (isDifferent)
+				{
+					result.differentPixels++;
+				}
+
+				if (pDiff)
+				{
+					uint8_t* pOut = pDiff + offset;
+					if (isDifferent)
+					{
+						pOut[0] = 255;
+						pOut[1] = 0;
+						pOut[2] = 0;
+					}
+					else
+					{
+						// The brightness of the first image, faded towards white so the red stands out.
+						const float alpha = static_cast<float>(pA[offset + 3]) / 255.0f;
+						const float y = GetY(Blend(pA[offset], alpha), Blend(pA[offset + 1], alpha), Blend(pA[offset + 2], alpha));
+						const uint8_t faded = static_cast<uint8_t>(std::clamp(255.0f + (y - 255.0f) * 0.1f, 0.0f, 255.0f));
+						pOut[0] = faded;
+						pOut[1] = faded;
+						pOut[2] = faded;
+					}
+					pOut[3] = 255;
+				}
+			}
+
+			if (result.pixelCount > 0)
+			{
+				result.meanDifference = static_cast<float>(differenceSum / result.pixelCount);
+			}
+
+			return result;
+		}
+	}
+}
@@ -0,0 +1,33 @@
+﻿#pragma once
+#include <cstdint>
+
+namespace Pelican
+{
+	// Perceptual comparison of two RGBA8 images, used to check frame captures against golden images.
+	// Colors are compared in YIQ space the way pixelmatch does, which weighs brightness changes more than hue changes,
+	// so small shading differences between drivers count less than a missing object does.
+	namespace ImageDiff
+	{
+		struct Result
+		{
+			uint32_t differentPixels{};
+			uint32_t pixelCount{};
+			// Largest and average difference of all pixels, from 0 for the same color to 1 for black against white.
+			float maxDifference{};
+			float meanDifference{};
+
+			[[nodiscard]] float GetDifferentFraction() const
+			{
+				return pixelCount > 0 ? static_cast<float>(differentPixels) / static_cast<float>(pixelCount) : 0.0f;
+			}
+		};
+
+		// Difference between two RGBA8 colors, alpha is blended over white first.
+		[[nodiscard]] float GetColorDifference(const uint8_t* pA, const uint8_t* pB);
+
+		// Pixels that differ more than threshold (0 to 1) count as different. When pDiff is set it receives a
+		// width by height RGBA8 image with the different pixels in red over a faded copy of the first image.
+		[[nodiscard]] Result Compare(const uint8_t* pA, const uint8_t* pB, uint32_t width, uint32_t height,
+			float threshold, uint8_t* pDiff = nullptr);
+	}
+}
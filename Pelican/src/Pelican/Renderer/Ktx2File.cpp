@@ -0,0 +1,332 @@
+﻿#include "PelicanPCH.h"
+#include "Ktx2File.h"
+
+#include <cstring>
+#include <fstream>
+#include <logtools.h>
+
+#include "Pelican/Core/Profiler.h"
+
+#include "MipGenerator.h"
+#include "TextureFormat.h"
+
+namespace Pelican
+{
+	namespace
+	{
+		constexpr uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+		struct Ktx2Header
+		{
+			uint8_t identifier[12];
+			uint32_t vkFormat;
+			uint32_t typeSize;
+			uint32_t pixelWidth;
+			uint32_t pixelHeight;
+			uint32_t pixelDepth;
+			uint32_t layerCount;
+			uint32_t faceCount;
+			uint32_t levelCount;
+			uint32_t supercompressionScheme;
+
+			uint32_t dfdByteOffset;
+			uint32_t dfdByteLength;
+			uint32_t kvdByteOffset;
+			uint32_t kvdByteLength;
+			uint64_t sgdByteOffset;
+			uint64_t sgdByteLength;
+		};
+		static_assert(sizeof(Ktx2Header) == 80, "KTX2 header has to match the file layout");
+
+		struct Ktx2LevelIndex
+		{
+			uint64_t byteOffset;
+			uint64_t byteLength;
+			uint64_t uncompressedByteLength;
+		};
+
+		// The basic data format descriptor block (https://registry.khronos.org/DataFormat/specs/1.3/dataformat.1.3.html),
+		// written as its 32 bit words.
+		constexpr uint32_t DFD_VERSION = 2;
+		constexpr uint32_t DFD_PRIMARIES_BT709 = 1;
+		constexpr uint32_t DFD_TRANSFER_LINEAR = 1;
+		constexpr uint32_t DFD_TRANSFER_SRGB = 2;
+		constexpr uint32_t DFD_SAMPLE_FLOAT = 0x80;
+		constexpr uint32_t DFD_FLOAT_ONE = 0x3F800000;
+
+		struct DfdSample
+		{
+			uint32_t channel;
+			uint32_t bitOffset;
+			uint32_t bitLength;
+		};
+
+		// Color model and samples of the block compressed formats, returns false for anything else.
+		bool GetDfdLayout(vk::Format format, uint32_t& colorModel, std::vector<DfdSample>& samples)
+		{
+			switch (format)
+			{
+			case vk::Format::eBc1RgbUnormBlock:
+			case vk::Format::eBc1RgbSrgbBlock:
+				colorModel = 128;
+				samples = { { 0, 0, 64 } };
+				return true;
+			case vk::Format::eBc1RgbaUnormBlock:
+			case vk::Format::eBc1RgbaSrgbBlock:
+				// Channel 1 is color with punch through alpha.
+				colorModel = 128;
+				samples = { { 1, 0, 64 } };
+				return true;
+			case vk::Format::eBc3UnormBlock:
+			case vk::Format::eBc3SrgbBlock:
+				colorModel = 130;
+				samples = { { 15, 0, 64 }, { 0, 64, 64 } };
+				return true;
+			case vk::Format::eBc4UnormBlock:
+				colorModel = 131;
+				samples = { { 0, 0, 64 } };
+				return true;
+			case vk::Format::eBc5UnormBlock:
+				colorModel = 132;
+				samples = { { 0, 0, 64 }, { 1, 64, 64 } };
+				return true;
+			case vk::Format::eBc6HUfloatBlock:
+				colorModel = 133;
+				samples = { { DFD_SAMPLE_FLOAT, 0, 128 } };
+				return true;
+			case vk::Format::eBc7UnormBlock:
+			case vk::Format::eBc7SrgbBlock:
+				colorModel = 134;
+				samples = { { 0, 0, 128 } };
+				return true;
+			default:
+				return false;
+			}
+		}
+	}
+
+	Ktx2File::Ktx2File(vk::Format format, uint32_t width, uint32_t height, uint32_t faceCount, uint32_t levelCount)
+		: m_Format(format)
+		, m_Width(width)
+		, m_Height(height)
+		, m_FaceCount(faceCount)
+	{
+		// Levels are kept 16 byte aligned, which is enough for every texel block.
+		uint64_t size = 0;
+		m_Levels.resize(levelCount);
+		for (uint32_t level = 0; level < levelCount; level++)
+		{
+			m_Levels[level].offset = size;
+			m_Levels[level].size = GetImageSize(level) * m_LayerCount * m_FaceCount;
+			size += (m_Levels[level].size + 15) & ~15ull;
+		}
+		m_Data.resize(size);
+	}
+
+	bool Ktx2File::Load(const std::filesystem::path& path, uint32_t maxSize)
+	{
+		PELICAN_PROFILE_FUNCTION();
+
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		if (!file.is_open())
+		{
+			Logger::LogError("Failed to open \"%s\"", path.string().c_str());
+			return false;
+		}
+
+		const uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+		file.seekg(0);
+
+		Ktx2Header header{};
+		if (fileSize < sizeof(header))
+		{
+			Logger::LogError("\"%s\" is too small to be a KTX2 file", path.string().c_str());
+			return false;
+		}
+		file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+		if (memcmp(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0)
+		{
+			Logger::LogError("\"%s\" is not a KTX2 file", path.string().c_str());
+			return false;
+		}
+		if (header.supercompressionScheme != 0)
+		{
+			Logger::LogError("\"%s\" is supercompressed, only uncompressed KTX2 data is supported", path.string().c_str());
+			return false;
+		}
+		if (header.pixelDepth > 1 || header.pixelHeight == 0 || (header.faceCount != 1 && header.faceCount != 6))
+		{
+			Logger::LogError("\"%s\" is not a 2D texture or cubemap", path.string().c_str());
+			return false;
+		}
+
+		m_Format = static_cast<vk::Format>(header.vkFormat);
+		if (TextureFormat::GetBlockInfo(m_Format).size == 0)
+		{
+			Logger::LogError("\"%s\" has unsupported format %s", path.string().c_str(), vk::to_string(m_Format).c_str());
+			return false;
+		}
+
+		m_Width = header.pixelWidth;
+		m_Height = header.pixelHeight;
+		// 0 means the texture is not an array or that the mips should be generated, both are the same as 1 here.
+		m_LayerCount = std::max(header.layerCount, 1u);
+		m_FaceCount = header.faceCount;
+		const uint32_t levelCount = std::max(header.levelCount, 1u);
+
+		if (levelCount > MipGenerator::GetMipCount(m_Width, m_Height)
+			|| sizeof(header) + levelCount * sizeof(Ktx2LevelIndex) > fileSize)
+		{
+			Logger::LogError("\"%s\" has an invalid level index", path.string().c_str());
+			return false;
+		}
+
+		std::vector<Ktx2LevelIndex> levelIndex(levelCount);
+		file.read(reinterpret_cast<char*>(levelIndex.data()), static_cast<std::streamsize>(levelCount * sizeof(Ktx2LevelIndex)));
+
+		m_Levels.resize(levelCount);
+		for (uint32_t level = 0; level < levelCount; level++)
+		{
+			const Ktx2LevelIndex& index = levelIndex[level];
+
+			// Without supercompression a level is every layer and face after each other.
+			const uint64_t expectedSize = GetImageSize(level) * m_LayerCount * m_FaceCount;
+			// Checked this way around so a huge offset can't wrap around.
+			if (index.byteLength != expectedSize || index.byteOffset > fileSize || index.byteLength > fileSize - index.byteOffset)
+			{
+				Logger::LogError("\"%s\" level %u doesn't match its size", path.string().c_str(), level);
+				return false;
+			}
+
+			m_Levels[level] = { index.byteOffset, index.byteLength };
+		}
+
+		// Only the levels that fit in maxSize get read, the smallest level always does.
+		m_FirstLevel = levelCount - 1;
+		while (m_FirstLevel > 0 && std::max(GetLevelWidth(m_FirstLevel - 1), GetLevelHeight(m_FirstLevel - 1)) <= maxSize)
+		{
+			m_FirstLevel--;
+		}
+
+		// Levels are usually stored smallest first, but nothing requires that, so read whatever range covers all of them.
+		uint64_t begin = UINT64_MAX;
+		uint64_t end = 0;
+		for (uint32_t level = m_FirstLevel; level < levelCount; level++)
+		{
+			begin = std::min(begin, m_Levels[level].offset);
+			end = std::max(end, m_Levels[level].offset + m_Levels[level].size);
+		}
+
+		m_DataOffset = begin;
+		m_Data.resize(static_cast<size_t>(end - begin));
+		file.seekg(static_cast<std::streamoff>(begin));
+		file.read(reinterpret_cast<char*>(m_Data.data()), static_cast<std::streamsize>(m_Data.size()));
+		if (!file)
+		{
+			Logger::LogError("Failed to read the levels of \"%s\"", path.string().c_str());
+			return false;
+		}
+
+		return true;
+	}
+
+	bool Ktx2File::Save(const std::filesystem::path& path) const
+	{
+		uint32_t colorModel = 0;
+		std::vector<DfdSample> samples{};
+		if (!GetDfdLayout(m_Format, colorModel, samples))
+		{
+			Logger::LogError("Failed to save \"%s\", format %s can't be written", path.string().c_str(), vk::to_string(m_Format).c_str());
+			return false;
+		}
+
+		const TextureFormat::BlockInfo blockInfo = TextureFormat::GetBlockInfo(m_Format);
+		const bool isFloat = m_Format == vk::Format::eBc6HUfloatBlock;
+		const uint32_t transfer = TextureFormat::IsSrgb(m_Format) ? DFD_TRANSFER_SRGB : DFD_TRANSFER_LINEAR;
+
+		std::vector<uint32_t> dfd{};
+		const uint32_t blockSize = 24 + 16 * static_cast<uint32_t>(samples.size());
+		dfd.push_back(4 + blockSize);
+		dfd.push_back(0);
+		dfd.push_back(DFD_VERSION | (blockSize << 16));
+		dfd.push_back(colorModel | (DFD_PRIMARIES_BT709 << 8) | (transfer << 16));
+		dfd.push_back((blockInfo.width - 1) | ((blockInfo.height - 1) << 8));
+		dfd.push_back(blockInfo.size);
+		dfd.push_back(0);
+		for (const DfdSample& sample : samples)
+		{
+			dfd.push_back(sample.bitOffset | ((sample.bitLength - 1) << 16) | (sample.channel << 24));
+			dfd.push_back(0);
+			dfd.push_back(0);
+			dfd.push_back(isFloat ? DFD_FLOAT_ONE : UINT32_MAX);
+		}
+
+		Ktx2Header header{};
+		memcpy(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+		header.vkFormat = static_cast<uint32_t>(m_Format);
+		header.typeSize = 1;
+		header.pixelWidth = m_Width;
+		header.pixelHeight = m_Height;
+		header.faceCount = m_FaceCount;
+		header.levelCount = GetLevelCount();
+		header.dfdByteOffset = static_cast<uint32_t>(sizeof(header) + m_Levels.size() * sizeof(Ktx2LevelIndex));
+		header.dfdByteLength = static_cast<uint32_t>(dfd.size() * sizeof(uint32_t));
+
+		// The smallest level comes first, every level starts on a multiple of the block size.
+		std::vector<Ktx2LevelIndex> levelIndex(m_Levels.size());
+		uint64_t offset = header.dfdByteOffset + header.dfdByteLength;
+		for (size_t level = m_Levels.size(); level-- > 0;)
+		{
+			offset = (offset + blockInfo.size - 1) / blockInfo.size * blockInfo.size;
+			levelIndex[level] = { offset, m_Levels[level].size, m_Levels[level].size };
+			offset += m_Levels[level].size;
+		}
+
+		std::vector<uint8_t> data(offset);
+		memcpy(data.data(), &header, sizeof(header));
+		memcpy(data.data() + sizeof(header), levelIndex.data(), levelIndex.size() * sizeof(Ktx2LevelIndex));
+		memcpy(data.data() + header.dfdByteOffset, dfd.data(), header.dfdByteLength);
+		for (size_t level = 0; level < m_Levels.size(); level++)
+		{
+			memcpy(data.data() + levelIndex[level].byteOffset, GetImageData(static_cast<uint32_t>(level), 0, 0), m_Levels[level].size);
+		}
+
+		std::ofstream file(path, std::ios::binary);
+		if (!file.is_open())
+		{
+			Logger::LogError("Failed to open \"%s\" for writing", path.string().c_str());
+			return false;
+		}
+		file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+		return file.good();
+	}
+
+	uint32_t Ktx2File::GetLevelWidth(uint32_t level) const
+	{
+		return MipGenerator::GetMipSize(m_Width, level);
+	}
+
+	uint32_t Ktx2File::GetLevelHeight(uint32_t level) const
+	{
+		return MipGenerator::GetMipSize(m_Height, level);
+	}
+
+	vk::DeviceSize Ktx2File::GetImageSize(uint32_t level) const
+	{
+		return TextureFormat::GetImageSize(m_Format, GetLevelWidth(level), GetLevelHeight(level));
+	}
+
+	const uint8_t* Ktx2File::GetImageData(uint32_t level, uint32_t layer, uint32_t face) const
+	{
+		ASSERT_MSG(level >= m_FirstLevel, "Level was not loaded!");
+
+		const uint64_t image = static_cast<uint64_t>(layer) * m_FaceCount + face;
+		return m_Data.data() + (m_Levels[level].offset - m_DataOffset) + image * GetImageSize(level);
+	}
+
+	uint8_t* Ktx2File::GetImageData(uint32_t level, uint32_t layer, uint32_t face)
+	{
+		return const_cast<uint8_t*>(static_cast<const Ktx2File&>(*this).GetImageData(level, layer, face));
+	}
+}
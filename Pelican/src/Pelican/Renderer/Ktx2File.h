@@ -0,0 +1,57 @@
+﻿#pragma once
+#include <vulkan/vulkan.hpp>
+
+namespace Pelican
+{
+	// Reader and writer for KTX2 containers (https://registry.khronos.org/KTX/specs/2.0/ktxspec.v2.html).
+	// Only 2D textures and cubemaps without supercompression are supported, the images are kept as they're stored.
+	class Ktx2File final
+	{
+	public:
+		Ktx2File() = default;
+		// An empty texture to fill in through GetImageData and Save, used by the texture cooker.
+		Ktx2File(vk::Format format, uint32_t width, uint32_t height, uint32_t faceCount, uint32_t levelCount);
+
+		// Reads the file, logs why and returns false when it can't be used. Only the levels that are at most maxSize
+		// wide and high get read, the smallest level always does. The others can't be accessed, see GetFirstLevel().
+		bool Load(const std::filesystem::path& path, uint32_t maxSize = UINT32_MAX);
+		// Only block compressed formats can be saved, they're the only ones a data format descriptor gets written for.
+		bool Save(const std::filesystem::path& path) const;
+
+		[[nodiscard]] vk::Format GetFormat() const { return m_Format; }
+		[[nodiscard]] uint32_t GetWidth() const { return m_Width; }
+		[[nodiscard]] uint32_t GetHeight() const { return m_Height; }
+		[[nodiscard]] uint32_t GetLayerCount() const { return m_LayerCount; }
+		// 6 for cubemaps, 1 otherwise.
+		[[nodiscard]] uint32_t GetFaceCount() const { return m_FaceCount; }
+		[[nodiscard]] uint32_t GetLevelCount() const { return static_cast<uint32_t>(m_Levels.size()); }
+		// The largest level that has its data loaded.
+		[[nodiscard]] uint32_t GetFirstLevel() const { return m_FirstLevel; }
+
+		[[nodiscard]] uint32_t GetLevelWidth(uint32_t level) const;
+		[[nodiscard]] uint32_t GetLevelHeight(uint32_t level) const;
+		// Size of a single layer and face of the level.
+		[[nodiscard]] vk::DeviceSize GetImageSize(uint32_t level) const;
+		[[nodiscard]] const uint8_t* GetImageData(uint32_t level, uint32_t layer, uint32_t face) const;
+		[[nodiscard]] uint8_t* GetImageData(uint32_t level, uint32_t layer, uint32_t face);
+
+	private:
+		struct Level
+		{
+			uint64_t offset{};
+			uint64_t size{};
+		};
+
+		// The loaded part of the file, which starts at m_DataOffset.
+		std::vector<uint8_t> m_Data{};
+		uint64_t m_DataOffset{};
+		std::vector<Level> m_Levels{};
+		uint32_t m_FirstLevel{};
+
+		vk::Format m_Format{};
+		uint32_t m_Width{};
+		uint32_t m_Height{};
+		uint32_t m_LayerCount{ 1 };
+		uint32_t m_FaceCount{ 1 };
+	};
+}
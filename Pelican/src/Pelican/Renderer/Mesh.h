@@ -3,7 +3,9 @@
 
 #include <vulkan/vulkan.hpp>
 
+#include "Bounds.h"
 #include "Camera.h"
+#include "VulkanGeometryArena.h"
 
 namespace Pelican
 {
@@ -17,6 +19,7 @@ namespace Pelican
 		NORMAL,
 		METALLIC_ROUGHNESS,
 		AMBIENT_OCCLUSION,
+		EMISSIVE,
 
 		SLOT_COUNT
 	};
@@ -25,32 +28,34 @@ namespace Pelican
 	{
 	public:
 		Mesh() = default;
-		Mesh(std::vector<Vertex> vertices, std::vector<uint32_t> indices, uint32_t materialIdx);
+		// The bounds are in object space, they're computed on import while the vertices get read anyway.
+		Mesh(std::vector<Vertex> vertices, std::vector<uint32_t> indices, uint32_t materialIdx, const BoundingBox& bounds);
 		void Cleanup();
 
 		void SetupVerticesIndices(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
 
+		// Copies the vertices and indices into the geometry arena.
 		void CreateBuffers();
-		void CreateDescriptorSet(const Model* pParent, const vk::DescriptorPool& pool);
 
-		void Update(const glm::mat4& model, const glm::mat4& view, const glm::mat4& proj);
-		void Draw() const;
+		// Meshes aren't drawn one by one, their draw commands get gathered into one indirect buffer.
+		// The first instance is the index of the DrawData of the first instance.
+		[[nodiscard]] vk::DrawIndexedIndirectCommand GetDrawCommand(uint32_t firstInstance, uint32_t instanceCount) const { return m_Geometry.GetDrawCommand(firstInstance, instanceCount); }
+		[[nodiscard]] uint32_t GetMaterialIdx() const { return m_MaterialIdx; }
+		[[nodiscard]] const BoundingBox& GetBoundingBox() const { return m_BoundingBox; }
+		// Object space center in xyz, radius in w.
+		[[nodiscard]] const glm::vec4& GetBoundingSphere() const { return m_BoundingSphere; }
 
+	private:
+		void ComputeBoundingBox();
+		void ComputeBoundingSphere();
 
 	private:
 		std::vector<Vertex> m_Vertices{};
 		std::vector<uint32_t> m_Indices{};
 		uint32_t m_MaterialIdx;
+		BoundingBox m_BoundingBox{};
+		glm::vec4 m_BoundingSphere{};
 
-		vk::Buffer m_UniformBuffer{};
-		vk::DeviceMemory m_UniformBufferMemory{};
-		vk::Buffer m_LightBuffer{};
-		vk::DeviceMemory m_LightBufferMemory{};
-
-		vk::Buffer m_VertexBuffer{};
-		vk::DeviceMemory m_VertexBufferMemory{};
-		vk::Buffer m_IndexBuffer{};
-		vk::DeviceMemory m_IndexBufferMemory{};
-		vk::DescriptorSet m_DescriptorSet{};
+		GeometryAllocation m_Geometry{};
 	};
 }
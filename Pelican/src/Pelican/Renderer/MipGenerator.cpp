@@ -0,0 +1,212 @@
+﻿#include "PelicanPCH.h"
+#include "MipGenerator.h"
+
+#include <array>
+#include <bit>
+#include <cmath>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__)
+#define PELICAN_MIP_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace Pelican
+{
+	namespace MipGenerator
+	{
+		namespace
+		{
+			constexpr uint32_t PIXEL_SIZE = 4;
+
+			// Rounded average of the 2x2 block, the same as the SIMD path.
+			void DownsamplePixel(const uint8_t* pRow0, const uint8_t* pRow1, uint32_t x0, uint32_t x1, uint8_t* pDst)
+			{
+				for (uint32_t c = 0; c < PIXEL_SIZE; c++)
+				{
+					const uint32_t sum = pRow0[x0 * PIXEL_SIZE + c] + pRow0[x1 * PIXEL_SIZE + c]
+						+ pRow1[x0 * PIXEL_SIZE + c] + pRow1[x1 * PIXEL_SIZE + c];
+					pDst[c] = static_cast<uint8_t>((sum + 2) / 4);
+				}
+			}
+
+			// Every 8 bit sRGB value in linear space.
+			const std::array<float, 256>& GetSrgbToLinearTable()
+			{
+				static const std::array<float, 256> table = []()
+				{
+					std::array<float, 256> values{};
+					for (uint32_t i = 0; i < 256; i++)
+					{
+						const float value = static_cast<float>(i) / 255.0f;
+						values[i] = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+					}
+					return values;
+				}();
+				return table;
+			}
+
+			uint8_t LinearToSrgb(float value)
+			{
+				const float encoded = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+				return static_cast<uint8_t>(std::clamp(encoded, 0.0f, 1.0f) * 255.0f + 0.5f);
+			}
+		}
+
+		uint32_t GetMipCount(uint32_t width, uint32_t height)
+		{
+			return static_cast<uint32_t>(std::bit_width(std::max(std::max(width, height), 1u)));
+		}
+
+		uint32_t GetMipSize(uint32_t size, uint32_t level)
+		{
+			return std::max(size >> level, 1u);
+		}
+
+		void DownsampleRgba8(const uint8_t* pSrc, uint32_t width, uint32_t height, uint8_t* pDst)
+		{
+			const uint32_t dstWidth = GetMipSize(width, 1);
+			const uint32_t dstHeight = GetMipSize(height, 1);
+			const size_t srcPitch = static_cast<size_t>(width) * PIXEL_SIZE;
+
+			for (uint32_t y = 0; y < dstHeight; y++)
+			{
+				// A 1 pixel high source gets averaged with itself.
+				const uint8_t* pRow0 = pSrc + std::min(y * 2, height - 1) * srcPitch;
+				const uint8_t* pRow1 = pSrc + std::min(y * 2 + 1, height - 1) * srcPitch;
+				uint8_t* pDstRow = pDst + static_cast<size_t>(y) * dstWidth * PIXEL_SIZE;
+
+				uint32_t x = 0;
+#ifdef PELICAN_MIP_SSE2
+				// 8 source pixels of both rows become 4 destination pixels.
+				if (width > 1)
+				{
+					const __m128i zero = _mm_setzero_si128();
+					const __m128i rounding = _mm_set1_epi16(2);
+
+					// Sums the vertical pairs in 16 bits, then the horizontal ones, [p0 + p1 | p2 + p3].
+					const auto average = [&](__m128i top, __m128i bottom)
+					{
+						const __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bottom, zero));
+						const __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bottom, zero));
+						const __m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi));
+						return _mm_srli_epi16(_mm_add_epi16(sum, rounding), 2);
+					};
+
+					for (; x + 4 <= dstWidth; x += 4)
+					{
+						const uint8_t* pTop = pRow0 + x * 2 * PIXEL_SIZE;
+						const uint8_t* pBottom = pRow1 + x * 2 * PIXEL_SIZE;
+						const __m128i first = average(
+							_mm_loadu_si128(reinterpret_cast<const __m128i*>(pTop)),
+							_mm_loadu_si128(reinterpret_cast<const __m128i*>(pBottom)));
+						const __m128i second = average(
+							_mm_loadu_si128(reinterpret_cast<const __m128i*>(pTop + 16)),
+							_mm_loadu_si128(reinterpret_cast<const __m128i*>(pBottom + 16)));
+						_mm_storeu_si128(reinterpret_cast<__m128i*>(pDstRow + x * PIXEL_SIZE), _mm_packus_epi16(first, second));
+					}
+				}
+#endif
+				for (; x < dstWidth; x++)
+				{
+					DownsamplePixel(pRow0, pRow1, std::min(x * 2, width - 1), std::min(x * 2 + 1, width - 1), pDstRow + x * PIXEL_SIZE);
+				}
+			}
+		}
+
+		void DownsampleSrgba8(const uint8_t* pSrc, uint32_t width, uint32_t height, uint8_t* pDst)
+		{
+			const std::array<float, 256>& toLinear = GetSrgbToLinearTable();
+			const uint32_t dstWidth = GetMipSize(width, 1);
+			const uint32_t dstHeight = GetMipSize(height, 1);
+			const size_t srcPitch = static_cast<size_t>(width) * PIXEL_SIZE;
+
+			for (uint32_t y = 0; y < dstHeight; y++)
+			{
+				const uint8_t* pRow0 = pSrc + std::min(y * 2, height - 1) * srcPitch;
+				const uint8_t* pRow1 = pSrc + std::min(y * 2 + 1, height - 1) * srcPitch;
+				uint8_t* pDstRow = pDst + static_cast<size_t>(y) * dstWidth * PIXEL_SIZE;
+
+				for (uint32_t x = 0; x < dstWidth; x++)
+				{
+					const size_t x0 = std::min(x * 2, width - 1) * PIXEL_SIZE;
+					const size_t x1 = std::min(x * 2 + 1, width - 1) * PIXEL_SIZE;
+					uint8_t* pPixel = pDstRow + x * PIXEL_SIZE;
+
+					for (uint32_t c = 0; c < 3; c++)
+					{
+						const float sum = toLinear[pRow0[x0 + c]] + toLinear[pRow0[x1 + c]] + toLinear[pRow1[x0 + c]] + toLinear[pRow1[x1 + c]];
+						pPixel[c] = LinearToSrgb(sum * 0.25f);
+					}
+
+					const uint32_t alphaSum = pRow0[x0 + 3] + pRow0[x1 + 3] + pRow1[x0 + 3] + pRow1[x1 + 3];
+					pPixel[3] = static_cast<uint8_t>((alphaSum + 2) / 4);
+				}
+			}
+		}
+
+		void DownsampleRgba32f(const float* pSrc, uint32_t width, uint32_t height, float* pDst)
+		{
+			const uint32_t dstWidth = GetMipSize(width, 1);
+			const uint32_t dstHeight = GetMipSize(height, 1);
+			const size_t srcPitch = static_cast<size_t>(width) * PIXEL_SIZE;
+
+			for (uint32_t y = 0; y < dstHeight; y++)
+			{
+				const float* pRow0 = pSrc + std::min(y * 2, height - 1) * srcPitch;
+				const float* pRow1 = pSrc + std::min(y * 2 + 1, height - 1) * srcPitch;
+				float* pDstRow = pDst + static_cast<size_t>(y) * dstWidth * PIXEL_SIZE;
+
+				for (uint32_t x = 0; x < dstWidth; x++)
+				{
+					const size_t x0 = std::min(x * 2, width - 1) * PIXEL_SIZE;
+					const size_t x1 = std::min(x * 2 + 1, width - 1) * PIXEL_SIZE;
+#ifdef PELICAN_MIP_SSE2
+					// A whole pixel fits in one register.
+					const __m128 sum = _mm_add_ps(
+						_mm_add_ps(_mm_loadu_ps(pRow0 + x0), _mm_loadu_ps(pRow0 + x1)),
+						_mm_add_ps(_mm_loadu_ps(pRow1 + x0), _mm_loadu_ps(pRow1 + x1)));
+					_mm_storeu_ps(pDstRow + x * PIXEL_SIZE, _mm_mul_ps(sum, _mm_set1_ps(0.25f)));
+#else
+					for (uint32_t c = 0; c < PIXEL_SIZE; c++)
+					{
+						pDstRow[x * PIXEL_SIZE + c] = (pRow0[x0 + c] + pRow0[x1 + c] + pRow1[x0 + c] + pRow1[x1 + c]) * 0.25f;
+					}
+#endif
+				}
+			}
+		}
+
+		std::vector<uint8_t> BuildChainRgba8(const uint8_t* pPixels, uint32_t width, uint32_t height,
+			uint32_t layerCount, uint32_t levelCount, bool srgb)
+		{
+			size_t layerSize = 0;
+			for (uint32_t level = 0; level < levelCount; level++)
+			{
+				layerSize += static_cast<size_t>(GetMipSize(width, level)) * GetMipSize(height, level) * PIXEL_SIZE;
+			}
+
+			std::vector<uint8_t> chain(layerSize * layerCount);
+			const size_t firstMipSize = static_cast<size_t>(width) * height * PIXEL_SIZE;
+			for (uint32_t layer = 0; layer < layerCount; layer++)
+			{
+				uint8_t* pLevel = chain.data() + layerSize * layer;
+				memcpy(pLevel, pPixels + firstMipSize * layer, firstMipSize);
+
+				for (uint32_t level = 1; level < levelCount; level++)
+				{
+					const uint32_t levelWidth = GetMipSize(width, level - 1);
+					const uint32_t levelHeight = GetMipSize(height, level - 1);
+					uint8_t* pNextLevel = pLevel + static_cast<size_t>(levelWidth) * levelHeight * PIXEL_SIZE;
+
+					if (srgb)
+						DownsampleSrgba8(pLevel, levelWidth, levelHeight, pNextLevel);
+					else
+						DownsampleRgba8(pLevel, levelWidth, levelHeight, pNextLevel);
+					pLevel = pNextLevel;
+				}
+			}
+
+			return chain;
+		}
+	}
+}
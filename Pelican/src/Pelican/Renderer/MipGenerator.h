@@ -0,0 +1,27 @@
+﻿#pragma once
+#include <vector>
+
+namespace Pelican
+{
+	// CPU fallback for textures whose format can't be blitted with a linear filter on the GPU.
+	namespace MipGenerator
+	{
+		// Number of mips all the way down to 1x1.
+		[[nodiscard]] uint32_t GetMipCount(uint32_t width, uint32_t height);
+		[[nodiscard]] uint32_t GetMipSize(uint32_t size, uint32_t level);
+
+		// 2x2 box filter from one RGBA8 level into the next, which is GetMipSize(width, 1) by GetMipSize(height, 1).
+		// Odd sizes drop their last row or column, just like a blit does. Uses SSE2 when available.
+		void DownsampleRgba8(const uint8_t* pSrc, uint32_t width, uint32_t height, uint8_t* pDst);
+		// The same for RGBA8 with sRGB encoded colors, those get averaged in linear space. Alpha is linear already.
+		void DownsampleSrgba8(const uint8_t* pSrc, uint32_t width, uint32_t height, uint8_t* pDst);
+		// The same for RGBA32F, used for HDR sources.
+		void DownsampleRgba32f(const float* pSrc, uint32_t width, uint32_t height, float* pDst);
+
+		// pPixels holds the first mip of every layer after each other. Returns every mip of every layer,
+		// layer by layer with each layer's mips from large to small, which is the layout VulkanTexture copies from.
+		// Set srgb for sRGB formats, so the colors get filtered in linear space.
+		[[nodiscard]] std::vector<uint8_t> BuildChainRgba8(const uint8_t* pPixels, uint32_t width, uint32_t height,
+			uint32_t layerCount, uint32_t levelCount, bool srgb);
+	}
+}
@@ -2,9 +2,13 @@
 #include "Model.h"
 
 #include "Pelican/Assets/AssetManager.h"
+#include "Pelican/Assets/TextureCooker.h"
+
+#include "Pelican/Core/Profiler.h"
 
 #include "Pelican/Renderer/Camera.h"
 #include "Pelican/Renderer/Mesh.h"
+#include "Pelican/Renderer/TextureFormat.h"
 #include "Pelican/Renderer/VulkanHelpers.h"
 #include "Pelican/Renderer/VulkanTexture.h"
 #include "Pelican/Renderer/VulkanRenderer.h"
@@ -30,6 +34,14 @@
 
 namespace Pelican
 {
+	namespace
+	{
+		std::array<const VulkanTexture*, 5> GetTextures(const GltfMaterial& mat)
+		{
+			return { mat.m_pAlbedoTexture, mat.m_pNormalTexture, mat.m_pMetallicRoughnessTexture, mat.m_pAOTexture, mat.m_pEmissiveTexture };
+		}
+	}
+
 	Model::Model(const std::string& file)
 		: m_AssetPath(file)
 	{
@@ -48,7 +60,7 @@ namespace Pelican
 			AssetManager::GetInstance().UnloadTexture(mat.m_pEmissiveTexture);
 		}
 
-		vkDestroyDescriptorPool(VulkanRenderer::GetDevice(), m_DescriptorPool, nullptr);
+		VulkanRenderer::GetBindlessTable()->UnregisterMaterials(m_MaterialBase);
 
 		for (size_t i = 0; i < m_Meshes.size(); i++)
 		{
@@ -64,24 +76,67 @@ namespace Pelican
 		delete m_pWhiteTexture;
 	}
 
-	void Model::UpdateDrawData(const glm::mat4& model, const glm::mat4& view, const glm::mat4& proj)
+	vk::DrawIndexedIndirectCommand Model::GetDrawCommand(uint32_t mesh, uint32_t firstDraw, uint32_t instanceCount) const
 	{
-		for (size_t i = 0; i < m_Meshes.size(); i++)
+		return m_Meshes[mesh].GetDrawCommand(firstDraw + mesh * instanceCount, instanceCount);
+	}
+
+	uint32_t Model::GetMaterialIndex(uint32_t mesh) const
+	{
+		return m_MaterialBase + m_Meshes[mesh].GetMaterialIdx();
+	}
+
+	bool Model::IsTranslucent(uint32_t mesh) const
+	{
+		return m_Materials[m_Meshes[mesh].GetMaterialIdx()].m_IsTranslucent;
+	}
+
+	bool Model::IsAlphaTested(uint32_t mesh) const
+	{
+		return m_Materials[m_Meshes[mesh].GetMaterialIdx()].m_IsAlphaTested;
+	}
+
+	void Model::WriteInstance(DrawData* pDraws, uint32_t instanceCount, uint32_t instance, uint32_t objectIndex) const
+	{
+		for (uint32_t i = 0; i < static_cast<uint32_t>(m_Meshes.size()); i++)
 		{
-			m_Meshes[i].Update(model, view, proj);
+			pDraws[i * instanceCount + instance] = DrawData{ objectIndex, GetMaterialIndex(i), {}, m_Meshes[i].GetBoundingSphere() };
 		}
 	}
 
-	void Model::Draw()
+	void Model::UpdateMaterials()
 	{
-		for (size_t i = 0; i < m_Meshes.size(); i++)
+		size_t i = 0;
+		for (const GltfMaterial& mat : m_Materials)
 		{
-			m_Meshes[i].Draw();
+			for (const VulkanTexture* pTexture : GetTextures(mat))
+			{
+				if (pTexture->GetBindlessIndex() != m_TextureIndices[i++])
+				{
+					// Frames in flight still read the old materials, so they get new slots instead of being overwritten.
+					VulkanRenderer::GetBindlessTable()->UnregisterMaterials(m_MaterialBase);
+					RegisterMaterials();
+					return;
+				}
+			}
+		}
+	}
+
+	void Model::RequestTextureMips(float screenSize) const
+	{
+		for (const GltfMaterial& mat : m_Materials)
+		{
+			for (const VulkanTexture* pTexture : GetTextures(mat))
+			{
+				VulkanRenderer::GetTextureStreamer()->Request(pTexture, screenSize);
+			}
 		}
 	}
 
 	void Model::Initialize()
 	{
+		PELICAN_PROFILE_FUNCTION();
+
 		Assimp::Importer importer;
 		const aiScene* pScene = importer.ReadFile(m_AssetPath, aiProcessPreset_TargetRealtime_Quality | aiProcess_FlipUVs);
 
@@ -103,8 +158,15 @@ namespace Pelican
 
 			if (AI_SUCCESS == aiGetMaterialColor(pMaterial, AI_MATKEY_COLOR_DIFFUSE, &textureColor))
 				mat.m_AlbedoColor = glm::vec4(textureColor.r, textureColor.g, textureColor.b, textureColor.a);
+			mat.m_IsTranslucent = mat.m_AlbedoColor.a < 1.0f;
+			if (AI_SUCCESS == aiGetMaterialFloat(pMaterial, AI_MATKEY_OPACITY, &textureFloat) && textureFloat < 1.0f)
+				mat.m_IsTranslucent = true;
+			// glTF's alphaMode, this is what AI_MATKEY_GLTF_ALPHAMODE expands to. Other formats cut out with an opacity map.
+			aiString alphaMode;
+			mat.m_IsAlphaTested = (AI_SUCCESS == pMaterial->Get("$mat.gltf.alphaMode", 0, 0, alphaMode) && strcmp(alphaMode.C_Str(), "MASK") == 0)
+				|| pMaterial->GetTextureCount(aiTextureType_OPACITY) > 0;
 			if (AI_SUCCESS == pMaterial->GetTexture(aiTextureType_DIFFUSE, 0, &texturePath))
-				mat.m_pAlbedoTexture = AssetManager::GetInstance().LoadTexture(GetAbsolutePath(texturePath.C_Str()));
+				mat.m_pAlbedoTexture = LoadMaterialTexture(texturePath.C_Str(), TextureSlot::ALBEDO);
 			else
 				mat.m_pAlbedoTexture = AssetManager::GetInstance().LoadTexture("res/textures/default-white.png");
 
@@ -113,24 +175,24 @@ namespace Pelican
 			if (AI_SUCCESS == aiGetMaterialFloat(pMaterial, AI_MATKEY_ROUGHNESS_FACTOR, &textureFloat))
 				mat.m_RoughnessFactor = textureFloat;
 			if (AI_SUCCESS == pMaterial->GetTexture(aiTextureType_METALNESS, 0, &texturePath))
-				mat.m_pMetallicRoughnessTexture = AssetManager::GetInstance().LoadTexture(GetAbsolutePath(texturePath.C_Str()));
+				mat.m_pMetallicRoughnessTexture = LoadMaterialTexture(texturePath.C_Str(), TextureSlot::METALLIC_ROUGHNESS);
 			else
 				mat.m_pMetallicRoughnessTexture = AssetManager::GetInstance().LoadTexture("res/textures/default-white.png");
 
 			if (AI_SUCCESS == pMaterial->GetTexture(aiTextureType_NORMALS, 0, &texturePath))
-				mat.m_pNormalTexture = AssetManager::GetInstance().LoadTexture(GetAbsolutePath(texturePath.C_Str()));
+				mat.m_pNormalTexture = LoadMaterialTexture(texturePath.C_Str(), TextureSlot::NORMAL);
 			else
 				mat.m_pNormalTexture = AssetManager::GetInstance().LoadTexture("res/textures/default-normal.png");
 
 			if (AI_SUCCESS == pMaterial->GetTexture(aiTextureType_AMBIENT_OCCLUSION, 0, &texturePath))
-				mat.m_pAOTexture = AssetManager::GetInstance().LoadTexture(GetAbsolutePath(texturePath.C_Str()));
+				mat.m_pAOTexture = LoadMaterialTexture(texturePath.C_Str(), TextureSlot::AMBIENT_OCCLUSION);
 			else
 				mat.m_pAOTexture = AssetManager::GetInstance().LoadTexture("res/textures/default-white.png");
 
 			if (AI_SUCCESS == aiGetMaterialColor(pMaterial, AI_MATKEY_EMISSIVE_INTENSITY, &textureColor))
 				mat.m_EmissiveFactor = glm::vec3(textureColor.r, textureColor.g, textureColor.b);
 			if (AI_SUCCESS == pMaterial->GetTexture(aiTextureType_EMISSIVE, 0, &texturePath))
-				mat.m_pEmissiveTexture = AssetManager::GetInstance().LoadTexture(GetAbsolutePath(texturePath.C_Str()));
+				mat.m_pEmissiveTexture = LoadMaterialTexture(texturePath.C_Str(), TextureSlot::EMISSIVE);
 			else
 				mat.m_pEmissiveTexture = AssetManager::GetInstance().LoadTexture("res/textures/default-white.png");
 
@@ -139,7 +201,7 @@ namespace Pelican
 
 		ProcessNode(pScene->mRootNode, pScene);
 
-		CreateDescriptorPool();
+		RegisterMaterials();
 	}
 
 	void Model::ProcessNode(aiNode* pNode, const aiScene* pScene)
@@ -149,6 +211,7 @@ namespace Pelican
 		{
 			aiMesh* pMesh = pScene->mMeshes[pNode->mMeshes[i]];
 			m_Meshes.push_back(ProcessMesh(pMesh));
+			m_Bounds.Expand(m_Meshes.back().GetBoundingBox());
 		}
 
 		// Then do the same for each of its children
@@ -162,6 +225,7 @@ namespace Pelican
 	{
 		std::vector<Vertex> vertices;
 		std::vector<uint32_t> indices;
+		BoundingBox bounds{};
 
 		// Vertices
 		for (uint32_t i = 0; i < pMesh->mNumVertices; i++)
@@ -176,6 +240,7 @@ namespace Pelican
 			{
 				vertex.pos = glm::vec3(pMesh->mVertices[i].x, pMesh->mVertices[i].y, pMesh->mVertices[i].z);
 			}
+			bounds.Expand(vertex.pos);
 
 			if (pMesh->mNormals)
 			{
@@ -210,32 +275,61 @@ namespace Pelican
 			}
 		}
 
-		Mesh mesh{ vertices, indices, pMesh->mMaterialIndex };
+		Mesh mesh{ vertices, indices, pMesh->mMaterialIndex, bounds };
 		mesh.CreateBuffers();
 		return mesh;
 	}
 
-	void Model::CreateDescriptorPool()
+	void Model::RegisterMaterials()
 	{
-		vk::DescriptorPoolSize poolSize(vk::DescriptorType::eUniformBuffer, static_cast<uint32_t>(m_Meshes.size()));
+		std::vector<MaterialData> materials;
+		materials.reserve(m_Materials.size());
+		m_TextureIndices.clear();
 
-		vk::DescriptorPoolCreateInfo createInfo = vk::DescriptorPoolCreateInfo()
-			.setPoolSizes(poolSize)
-			.setMaxSets(static_cast<uint32_t>(m_Meshes.size()));
-
-		try
+		for (const GltfMaterial& mat : m_Materials)
 		{
-			m_DescriptorPool = VulkanRenderer::GetDevice().createDescriptorPool(createInfo);
+			for (const VulkanTexture* pTexture : GetTextures(mat))
+			{
+				m_TextureIndices.push_back(pTexture->GetBindlessIndex());
+			}
+
+			MaterialData data{};
+			data.albedoColor = mat.m_AlbedoColor;
+			data.emissiveFactor = glm::vec4(mat.m_EmissiveFactor, 1.0f);
+			data.metallicFactor = mat.m_MetallicFactor;
+			data.roughnessFactor = mat.m_RoughnessFactor;
+			data.albedoTexture = mat.m_pAlbedoTexture->GetBindlessIndex();
+			data.normalTexture = mat.m_pNormalTexture->GetBindlessIndex();
+			data.metallicRoughnessTexture = mat.m_pMetallicRoughnessTexture->GetBindlessIndex();
+			data.aoTexture = mat.m_pAOTexture->GetBindlessIndex();
+			data.emissiveTexture = mat.m_pEmissiveTexture->GetBindlessIndex();
+			// Has to match what Scene keeps out of the depth prepass.
+			data.alphaTest = mat.m_IsAlphaTested || mat.m_IsTranslucent ? 1 : 0;
+			materials.push_back(data);
 		}
-		catch (vk::SystemError& e)
+
+		m_MaterialBase = VulkanRenderer::GetBindlessTable()->RegisterMaterials(materials);
+	}
+
+	VulkanTexture* Model::LoadMaterialTexture(const std::string& uri, TextureSlot slot) const
+	{
+		// A cooked KTX2 next to the source texture is preferred, it's block compressed and has all its mips already.
+		std::filesystem::path path = GetAbsolutePath(uri);
+		const std::filesystem::path cookedPath = TextureCooker::GetCookedPath(path);
+		if (std::filesystem::exists(cookedPath))
 		{
-			throw std::runtime_error("Failed to create descriptor pool: "s + e.what());
+			path = cookedPath;
 		}
 
-		for (size_t i = 0; i < m_Meshes.size(); i++)
+		VulkanTexture* pTexture = AssetManager::GetInstance().LoadTexture(path.string());
+		const vk::Format slotFormat = TextureFormat::GetSlotFormat(slot);
+		if (pTexture && path.extension() == ".ktx2" && pTexture->GetSourceFormat() != slotFormat)
 		{
-			m_Meshes[i].CreateDescriptorSet(this, m_DescriptorPool);
+			Logger::LogWarning("\"%s\" is %s, its material slot expects %s", path.string().c_str(),
+				vk::to_string(pTexture->GetSourceFormat()).c_str(), vk::to_string(slotFormat).c_str());
 		}
+
+		return pTexture;
 	}
 
 	std::string Model::GetAbsolutePath(const std::string& uri) const
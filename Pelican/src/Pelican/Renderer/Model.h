@@ -1,6 +1,7 @@
 ﻿#pragma once
 
 #include "Pelican/Renderer/Mesh.h"
+#include "Pelican/Renderer/VulkanBindlessTable.h"
 #include "Pelican/Renderer/VulkanTexture.h"
 
 #include "Gltf/GltfMaterial.h"
@@ -26,29 +27,54 @@ namespace Pelican
 
 		void Initialize();
 
-		void UpdateDrawData(const glm::mat4& model, const glm::mat4& view, const glm::mat4& proj);
-		void Draw();
+		// Every entity using this model is drawn in the same instanced draws, one indirect command per mesh.
+		// The DrawData of mesh m's instances starts at firstDraw + m * instanceCount, which is where its command's firstInstance points.
+		[[nodiscard]] vk::DrawIndexedIndirectCommand GetDrawCommand(uint32_t mesh, uint32_t firstDraw, uint32_t instanceCount) const;
+		// Writes the DrawData of a single instance for every mesh, pDraws points at the DrawData of the first mesh's first instance.
+		// All meshes of an instance share the same object data.
+		void WriteInstance(DrawData* pDraws, uint32_t instanceCount, uint32_t instance, uint32_t objectIndex) const;
+
+		[[nodiscard]] uint32_t GetMeshCount() const { return static_cast<uint32_t>(m_Meshes.size()); }
+		// Index of the mesh's material in the bindless material buffer.
+		[[nodiscard]] uint32_t GetMaterialIndex(uint32_t mesh) const;
+		[[nodiscard]] bool IsTranslucent(uint32_t mesh) const;
+		[[nodiscard]] bool IsAlphaTested(uint32_t mesh) const;
+		// Encloses all meshes, in object space.
+		[[nodiscard]] const BoundingBox& GetBounds() const { return m_Bounds; }
 
 		[[nodiscard]] std::string GetAssetPath() const { return m_AssetPath; }
 
 		[[nodiscard]] const GltfMaterial& GetMaterial(int32_t idx) const { return m_Materials[idx]; }
 
+		// Registers the materials again when one of their textures got a new bindless index since the last time,
+		// which happens whenever the texture streamer swaps in other mips. Call this before using GetMaterialIndex().
+		void UpdateMaterials();
+		// Asks the texture streamer for the mips the material textures need when the model covers screenSize pixels.
+		void RequestTextureMips(float screenSize) const;
+
 	private:
 		void ProcessNode(aiNode* pNode, const aiScene* pScene);
 		Mesh ProcessMesh(aiMesh* pMesh);
 
-		void CreateDescriptorPool();
+		// Copies the materials into the bindless material buffer.
+		void RegisterMaterials();
 
+		// Loads the texture of a material slot, see TextureFormat::GetSlotFormat for what cooked textures are expected to be.
+		[[nodiscard]] VulkanTexture* LoadMaterialTexture(const std::string& uri, TextureSlot slot) const;
 		[[nodiscard]] std::string GetAbsolutePath(const std::string& uri) const;
 
 	private:
 		std::vector<Mesh> m_Meshes;
+		BoundingBox m_Bounds{};
 		std::vector<GltfMaterial> m_Materials;
 		std::vector<VulkanTexture*> m_pTextures;
 
 		std::string m_AssetPath{};
 
-		vk::DescriptorPool m_DescriptorPool{};
+		// Index of the first material in the bindless material buffer.
+		uint32_t m_MaterialBase{ VulkanBindlessTable::INVALID_INDEX };
+		// The bindless indices of the material textures when the materials were registered.
+		std::vector<uint32_t> m_TextureIndices;
 		VulkanTexture* m_pWhiteTexture{};
 	};
 }
@@ -0,0 +1,340 @@
+﻿#include "PelicanPCH.h"
+#include "OffsetAllocator.h"
+
+#include <bit>
+
+namespace Pelican
+{
+	namespace
+	{
+		uint64_t AlignUp(uint64_t value, uint64_t alignment)
+		{
+			return (value + alignment - 1) / alignment * alignment;
+		}
+	}
+
+	TlsfAllocator::TlsfAllocator(uint64_t size)
+		: m_Size(size)
+	{
+		for (auto& heads : m_FreeHeads)
+		{
+			for (uint32_t& head : heads)
+			{
+				head = NONE;
+			}
+		}
+
+		InsertFree(CreateNode(0, size));
+	}
+
+	OffsetAllocation TlsfAllocator::Allocate(uint64_t size, uint64_t alignment)
+	{
+		if (size == 0 || size > m_Size)
+			return {};
+
+		alignment = std::max<uint64_t>(alignment, 1);
+
+		// First try a region of exactly the requested size, if alignment makes it not fit after all,
+		// search again with enough padding to be guaranteed to fit.
+		uint32_t index = FindFreeNode(size);
+		if (index != NONE && AlignUp(m_Nodes[index].offset, alignment) + size > m_Nodes[index].offset + m_Nodes[index].size)
+		{
+			index = alignment > 1 ? FindFreeNode(size + alignment - 1) : NONE;
+		}
+
+		if (index == NONE)
+			return {};
+
+		RemoveFree(index);
+
+		// Give the padding in front back to the free lists.
+		const uint64_t alignedOffset = AlignUp(m_Nodes[index].offset, alignment);
+		const uint64_t padding = alignedOffset - m_Nodes[index].offset;
+		if (padding > 0)
+		{
+			const uint32_t paddingIndex = CreateNode(m_Nodes[index].offset, padding);
+			Node& node = m_Nodes[index];
+			Node& paddingNode = m_Nodes[paddingIndex];
+
+			paddingNode.prevPhysical = node.prevPhysical;
+			paddingNode.nextPhysical = index;
+			if (node.prevPhysical != NONE)
+				m_Nodes[node.prevPhysical].nextPhysical = paddingIndex;
+			node.prevPhysical = paddingIndex;
+
+			node.offset += padding;
+			node.size -= padding;
+
+			InsertFree(paddingIndex);
+		}
+
+		// Same for whatever is left at the end.
+		if (m_Nodes[index].size > size)
+		{
+			const uint32_t remainderIndex = CreateNode(m_Nodes[index].offset + size, m_Nodes[index].size - size);
+			Node& node = m_Nodes[index];
+			Node& remainderNode = m_Nodes[remainderIndex];
+
+			remainderNode.prevPhysical = index;
+			remainderNode.nextPhysical = node.nextPhysical;
+			if (node.nextPhysical != NONE)
+				m_Nodes[node.nextPhysical].prevPhysical = remainderIndex;
+			node.nextPhysical = remainderIndex;
+
+			node.size = size;
+
+			InsertFree(remainderIndex);
+		}
+
+		m_UsedSize += size;
+		m_AllocationCount++;
+
+		OffsetAllocation allocation;
+		allocation.offset = m_Nodes[index].offset;
+		allocation.size = size;
+		allocation.handle = index;
+		return allocation;
+	}
+
+	void TlsfAllocator::Free(const OffsetAllocation& allocation)
+	{
+		if (!allocation.IsValid())
+			return;
+
+		uint32_t index = allocation.handle;
+		ASSERT_MSG(index < m_Nodes.size() && m_Nodes[index].isUsed && !m_Nodes[index].isFree, "Invalid or double freed allocation!");
+
+		m_UsedSize -= m_Nodes[index].size;
+		m_AllocationCount--;
+
+		// Merge with the previous region if it's free.
+		const uint32_t prevIndex = m_Nodes[index].prevPhysical;
+		if (prevIndex != NONE && m_Nodes[prevIndex].isFree)
+		{
+			RemoveFree(prevIndex);
+
+			Node& prev = m_Nodes[prevIndex];
+			const Node& node = m_Nodes[index];
+			prev.size += node.size;
+			prev.nextPhysical = node.nextPhysical;
+			if (node.nextPhysical != NONE)
+				m_Nodes[node.nextPhysical].prevPhysical = prevIndex;
+
+			ReleaseNode(index);
+			index = prevIndex;
+		}
+
+		// And with the next one.
+		const uint32_t nextIndex = m_Nodes[index].nextPhysical;
+		if (nextIndex != NONE && m_Nodes[nextIndex].isFree)
+		{
+			RemoveFree(nextIndex);
+
+			Node& node = m_Nodes[index];
+			const Node& next = m_Nodes[nextIndex];
+			node.size += next.size;
+			node.nextPhysical = next.nextPhysical;
+			if (next.nextPhysical != NONE)
+				m_Nodes[next.nextPhysical].prevPhysical = index;
+
+			ReleaseNode(nextIndex);
+		}
+
+		InsertFree(index);
+	}
+
+	OffsetAllocatorStats TlsfAllocator::GetStats() const
+	{
+		OffsetAllocatorStats stats;
+		stats.totalSize = m_Size;
+		stats.usedSize = m_UsedSize;
+		stats.allocationCount = m_AllocationCount;
+
+		for (const Node& node : m_Nodes)
+		{
+			if (node.isUsed && node.isFree)
+			{
+				stats.freeRegionCount++;
+				stats.largestFreeRegion = std::max(stats.largestFreeRegion, node.size);
+			}
+		}
+
+		return stats;
+	}
+
+	void TlsfAllocator::MapSize(uint64_t size, uint32_t& fl, uint32_t& sl)
+	{
+		if (size < SL_COUNT)
+		{
+			fl = 0;
+			sl = static_cast<uint32_t>(size);
+			return;
+		}
+
+		const uint32_t msb = static_cast<uint32_t>(std::bit_width(size)) - 1;
+		fl = msb - SL_BITS + 1;
+		sl = static_cast<uint32_t>(size >> (msb - SL_BITS)) - SL_COUNT;
+	}
+
+	uint32_t TlsfAllocator::FindFreeNode(uint64_t size) const
+	{
+		// Round up to the next second level list, so every region in the list we find is big enough.
+		if (size >= SL_COUNT)
+		{
+			const uint32_t msb = static_cast<uint32_t>(std::bit_width(size)) - 1;
+			const uint64_t round = (1ull << (msb - SL_BITS)) - 1;
+			if (size > ~0ull - round)
+				return NONE;
+			size += round;
+		}
+
+		uint32_t fl, sl;
+		MapSize(size, fl, sl);
+		if (fl >= FL_COUNT)
+			return NONE;
+
+		uint32_t slMap = m_SlBitmaps[fl] & (~0u << sl);
+		if (slMap == 0)
+		{
+			// Nothing in this first level, take the smallest list of a bigger one.
+			const uint64_t flMap = fl + 1 < 64 ? m_FlBitmap & (~0ull << (fl + 1)) : 0;
+			if (flMap == 0)
+				return NONE;
+
+			fl = static_cast<uint32_t>(std::countr_zero(flMap));
+			slMap = m_SlBitmaps[fl];
+		}
+
+		sl = static_cast<uint32_t>(std::countr_zero(slMap));
+		return m_FreeHeads[fl][sl];
+	}
+
+	uint32_t TlsfAllocator::CreateNode(uint64_t offset, uint64_t size)
+	{
+		uint32_t index;
+		if (!m_UnusedNodes.empty())
+		{
+			index = m_UnusedNodes.back();
+			m_UnusedNodes.pop_back();
+			m_Nodes[index] = Node{};
+		}
+		else
+		{
+			index = static_cast<uint32_t>(m_Nodes.size());
+			m_Nodes.emplace_back();
+		}
+
+		m_Nodes[index].offset = offset;
+		m_Nodes[index].size = size;
+		m_Nodes[index].isUsed = true;
+		return index;
+	}
+
+	void TlsfAllocator::ReleaseNode(uint32_t index)
+	{
+		m_Nodes[index].isUsed = false;
+		m_Nodes[index].isFree = false;
+		m_UnusedNodes.push_back(index);
+	}
+
+	void TlsfAllocator::InsertFree(uint32_t index)
+	{
+		uint32_t fl, sl;
+		MapSize(m_Nodes[index].size, fl, sl);
+
+		Node& node = m_Nodes[index];
+		node.isFree = true;
+		node.prevFree = NONE;
+		node.nextFree = m_FreeHeads[fl][sl];
+		if (node.nextFree != NONE)
+			m_Nodes[node.nextFree].prevFree = index;
+
+		m_FreeHeads[fl][sl] = index;
+		m_FlBitmap |= 1ull << fl;
+		m_SlBitmaps[fl] |= 1u << sl;
+	}
+
+	void TlsfAllocator::RemoveFree(uint32_t index)
+	{
+		uint32_t fl, sl;
+		MapSize(m_Nodes[index].size, fl, sl);
+
+		Node& node = m_Nodes[index];
+		if (node.prevFree != NONE)
+			m_Nodes[node.prevFree].nextFree = node.nextFree;
+		else
+			m_FreeHeads[fl][sl] = node.nextFree;
+
+		if (node.nextFree != NONE)
+			m_Nodes[node.nextFree].prevFree = node.prevFree;
+
+		node.isFree = false;
+		node.prevFree = NONE;
+		node.nextFree = NONE;
+
+		if (m_FreeHeads[fl][sl] == NONE)
+		{
+			m_SlBitmaps[fl] &= ~(1u << sl);
+			if (m_SlBitmaps[fl] == 0)
+				m_FlBitmap &= ~(1ull << fl);
+		}
+	}
+
+	LinearAllocator::LinearAllocator(uint64_t size)
+		: m_Size(size)
+	{
+	}
+
+	OffsetAllocation LinearAllocator::Allocate(uint64_t size, uint64_t alignment)
+	{
+		const uint64_t offset = AlignUp(m_Head, std::max<uint64_t>(alignment, 1));
+		if (size == 0 || offset + size > m_Size)
+			return {};
+
+		m_Head = offset + size;
+		m_UsedSize += size;
+		m_AllocationCount++;
+
+		OffsetAllocation allocation;
+		allocation.offset = offset;
+		allocation.size = size;
+		allocation.handle = 0;
+		return allocation;
+	}
+
+	void LinearAllocator::Free(const OffsetAllocation& allocation)
+	{
+		if (!allocation.IsValid())
+			return;
+
+		ASSERT_MSG(m_AllocationCount > 0, "Freeing more allocations than were made!");
+
+		m_UsedSize -= allocation.size;
+		m_AllocationCount--;
+
+		// Everything has been released, we can start from the beginning again.
+		if (m_AllocationCount == 0)
+		{
+			Reset();
+		}
+	}
+
+	void LinearAllocator::Reset()
+	{
+		m_Head = 0;
+		m_UsedSize = 0;
+		m_AllocationCount = 0;
+	}
+
+	OffsetAllocatorStats LinearAllocator::GetStats() const
+	{
+		OffsetAllocatorStats stats;
+		stats.totalSize = m_Size;
+		stats.usedSize = m_UsedSize;
+		stats.allocationCount = m_AllocationCount;
+		// Only the tail can be allocated from, holes left by freed allocations aren't reusable until a reset.
+		stats.largestFreeRegion = m_Size - m_Head;
+		stats.freeRegionCount = m_Head < m_Size ? 1 : 0;
+		return stats;
+	}
+}
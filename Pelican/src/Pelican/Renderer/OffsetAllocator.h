@@ -0,0 +1,116 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace Pelican
+{
+	// Offset allocators only manage ranges inside a block of memory, they never touch the memory itself.
+	// This way the same logic can be used to sub-allocate device memory blocks as well as large shared buffers.
+
+	struct OffsetAllocation
+	{
+		static constexpr uint32_t INVALID_HANDLE = ~0u;
+
+		uint64_t offset{};
+		uint64_t size{};
+		// Strategy specific, needed to free the allocation again.
+		uint32_t handle{ INVALID_HANDLE };
+
+		[[nodiscard]] bool IsValid() const { return handle != INVALID_HANDLE; }
+	};
+
+	struct OffsetAllocatorStats
+	{
+		uint64_t totalSize{};
+		uint64_t usedSize{};
+		uint64_t largestFreeRegion{};
+		uint32_t allocationCount{};
+		uint32_t freeRegionCount{};
+
+		[[nodiscard]] uint64_t GetFreeSize() const { return totalSize - usedSize; }
+		// 0 means all free memory is in one contiguous region, approaching 1 means it's scattered in tiny pieces.
+		[[nodiscard]] float GetFragmentation() const
+		{
+			const uint64_t freeSize = GetFreeSize();
+			return freeSize == 0 ? 0.0f : 1.0f - static_cast<float>(largestFreeRegion) / static_cast<float>(freeSize);
+		}
+	};
+
+	// Two-Level Segregated Fit allocator, O(1) allocations and frees with immediate coalescing.
+	// Used for general purpose, long lived allocations.
+	class TlsfAllocator final
+	{
+	public:
+		explicit TlsfAllocator(uint64_t size);
+
+		// Returns an invalid allocation when there is no free region big enough.
+		[[nodiscard]] OffsetAllocation Allocate(uint64_t size, uint64_t alignment = 1);
+		void Free(const OffsetAllocation& allocation);
+
+		[[nodiscard]] bool IsEmpty() const { return m_AllocationCount == 0; }
+		[[nodiscard]] uint64_t GetSize() const { return m_Size; }
+		[[nodiscard]] OffsetAllocatorStats GetStats() const;
+
+	private:
+		static constexpr uint32_t SL_BITS = 4;
+		static constexpr uint32_t SL_COUNT = 1 << SL_BITS;
+		static constexpr uint32_t FL_COUNT = 64 - SL_BITS + 1;
+		static constexpr uint32_t NONE = ~0u;
+
+		struct Node
+		{
+			uint64_t offset{};
+			uint64_t size{};
+			uint32_t prevPhysical{ NONE };
+			uint32_t nextPhysical{ NONE };
+			uint32_t prevFree{ NONE };
+			uint32_t nextFree{ NONE };
+			bool isFree{};
+			bool isUsed{}; // false when the node sits in the unused node list.
+		};
+
+		static void MapSize(uint64_t size, uint32_t& fl, uint32_t& sl);
+		uint32_t FindFreeNode(uint64_t size) const;
+
+		uint32_t CreateNode(uint64_t offset, uint64_t size);
+		void ReleaseNode(uint32_t index);
+
+		void InsertFree(uint32_t index);
+		void RemoveFree(uint32_t index);
+
+	private:
+		uint64_t m_Size{};
+		uint64_t m_UsedSize{};
+		uint32_t m_AllocationCount{};
+
+		std::vector<Node> m_Nodes{};
+		std::vector<uint32_t> m_UnusedNodes{};
+
+		uint64_t m_FlBitmap{};
+		uint32_t m_SlBitmaps[FL_COUNT]{};
+		uint32_t m_FreeHeads[FL_COUNT][SL_COUNT]{};
+	};
+
+	// Bump allocator: allocating is just moving an offset forward, memory is only reused once every allocation
+	// in it has been freed. Perfect for short lived allocations like staging buffers.
+	class LinearAllocator final
+	{
+	public:
+		explicit LinearAllocator(uint64_t size);
+
+		[[nodiscard]] OffsetAllocation Allocate(uint64_t size, uint64_t alignment = 1);
+		void Free(const OffsetAllocation& allocation);
+		void Reset();
+
+		[[nodiscard]] bool IsEmpty() const { return m_AllocationCount == 0; }
+		[[nodiscard]] uint64_t GetSize() const { return m_Size; }
+		[[nodiscard]] OffsetAllocatorStats GetStats() const;
+
+	private:
+		uint64_t m_Size{};
+		uint64_t m_Head{};
+		uint64_t m_UsedSize{};
+		uint32_t m_AllocationCount{};
+	};
+}
@@ -0,0 +1,151 @@
+﻿#include "PelicanPCH.h"
+#include "RenderQueue.h"
+
+#include <bit>
+#include <chrono>
+
+namespace Pelican
+{
+	namespace RenderKey
+	{
+		namespace
+		{
+			constexpr uint32_t PASS_SHIFT = 62;
+			constexpr uint32_t UNUSED_BITS = 14;
+
+			constexpr uint64_t PIPELINE_MASK = (1ull << PIPELINE_BITS) - 1;
+			constexpr uint64_t MATERIAL_MASK = (1ull << MATERIAL_BITS) - 1;
+			constexpr uint64_t DEPTH_MASK = (1ull << DEPTH_BITS) - 1;
+
+			// Opaque: pipeline, material, depth.
+			constexpr uint32_t OPAQUE_DEPTH_SHIFT = UNUSED_BITS;
+			constexpr uint32_t OPAQUE_MATERIAL_SHIFT = OPAQUE_DEPTH_SHIFT + DEPTH_BITS;
+			constexpr uint32_t OPAQUE_PIPELINE_SHIFT = OPAQUE_MATERIAL_SHIFT + MATERIAL_BITS;
+
+			// Translucent: depth, pipeline, material.
+			constexpr uint32_t TRANSLUCENT_MATERIAL_SHIFT = UNUSED_BITS;
+			constexpr uint32_t TRANSLUCENT_PIPELINE_SHIFT = TRANSLUCENT_MATERIAL_SHIFT + MATERIAL_BITS;
+			constexpr uint32_t TRANSLUCENT_DEPTH_SHIFT = TRANSLUCENT_PIPELINE_SHIFT + PIPELINE_BITS;
+
+			static_assert(OPAQUE_PIPELINE_SHIFT + PIPELINE_BITS == PASS_SHIFT, "Opaque key fields have to add up to 62 bits!");
+			static_assert(TRANSLUCENT_DEPTH_SHIFT + DEPTH_BITS == PASS_SHIFT, "Translucent key fields have to add up to 62 bits!");
+
+			uint64_t MakeOpaqueLayout(Pass pass, uint32_t pipeline, uint32_t material, uint32_t depthBucket)
+			{
+				return static_cast<uint64_t>(pass) << PASS_SHIFT
+					| (pipeline & PIPELINE_MASK) << OPAQUE_PIPELINE_SHIFT
+					| (material & MATERIAL_MASK) << OPAQUE_MATERIAL_SHIFT
+					| (depthBucket & DEPTH_MASK) << OPAQUE_DEPTH_SHIFT;
+			}
+		}
+
+		uint32_t GetDepthBucket(float viewDepth)
+		{
+			if (!(viewDepth > 0.0f))
+				return 0;
+
+			return std::bit_cast<uint32_t>(viewDepth) >> (32 - DEPTH_BITS);
+		}
+
+		uint64_t MakeOpaque(uint32_t pipeline, uint32_t material, uint32_t depthBucket)
+		{
+			return MakeOpaqueLayout(OPAQUE_PASS, pipeline, material, depthBucket);
+		}
+
+		uint64_t MakeAlphaTested(uint32_t pipeline, uint32_t material, uint32_t depthBucket)
+		{
+			return MakeOpaqueLayout(ALPHA_TESTED_PASS, pipeline, material, depthBucket);
+		}
+
+		uint64_t MakeTranslucent(uint32_t pipeline, uint32_t material, uint32_t depthBucket)
+		{
+			// Inverted, so the furthest draw comes first.
+			return static_cast<uint64_t>(TRANSLUCENT_PASS) << PASS_SHIFT
+				| (~depthBucket & DEPTH_MASK) << TRANSLUCENT_DEPTH_SHIFT
+				| (pipeline & PIPELINE_MASK) << TRANSLUCENT_PIPELINE_SHIFT
+				| (material & MATERIAL_MASK) << TRANSLUCENT_MATERIAL_SHIFT;
+		}
+
+		Pass GetPass(uint64_t key)
+		{
+			return static_cast<Pass>(key >> PASS_SHIFT);
+		}
+
+		uint32_t GetPipeline(uint64_t key)
+		{
+			const uint32_t shift = GetPass(key) == TRANSLUCENT_PASS ? TRANSLUCENT_PIPELINE_SHIFT : OPAQUE_PIPELINE_SHIFT;
+			return static_cast<uint32_t>((key >> shift) & PIPELINE_MASK);
+		}
+
+		uint32_t GetMaterial(uint64_t key)
+		{
+			const uint32_t shift = GetPass(key) == TRANSLUCENT_PASS ? TRANSLUCENT_MATERIAL_SHIFT : OPAQUE_MATERIAL_SHIFT;
+			return static_cast<uint32_t>((key >> shift) & MATERIAL_MASK);
+		}
+	}
+
+	void RenderQueue::Sort()
+	{
+		const auto startTime = std::chrono::high_resolution_clock::now();
+
+		m_Stats.itemCount = GetCount();
+		CountStateChanges(m_Stats.pipelineChangesUnsorted, m_Stats.materialChangesUnsorted);
+
+		constexpr uint32_t RADIX_BITS = 8;
+		constexpr uint32_t BUCKET_COUNT = 1 << RADIX_BITS;
+		constexpr uint32_t PASS_COUNT = 64 / RADIX_BITS;
+
+		// All histograms are built in a single read over the keys.
+		uint32_t histograms[PASS_COUNT][BUCKET_COUNT]{};
+		for (const Item& item : m_Items)
+		{
+			for (uint32_t pass = 0; pass < PASS_COUNT; pass++)
+			{
+				histograms[pass][(item.key >> (pass * RADIX_BITS)) & (BUCKET_COUNT - 1)]++;
+			}
+		}
+
+		m_Scratch.resize(m_Items.size());
+		for (uint32_t pass = 0; pass < PASS_COUNT; pass++)
+		{
+			uint32_t* pHistogram = histograms[pass];
+
+			// When every key has the same byte here this pass wouldn't move anything.
+			const uint32_t firstKeyBucket = m_Items.empty() ? 0 : static_cast<uint32_t>((m_Items[0].key >> (pass * RADIX_BITS)) & (BUCKET_COUNT - 1));
+			if (pHistogram[firstKeyBucket] == m_Items.size())
+				continue;
+
+			// Bucket counts to the index where each bucket starts.
+			uint32_t offset = 0;
+			for (uint32_t bucket = 0; bucket < BUCKET_COUNT; bucket++)
+			{
+				const uint32_t count = pHistogram[bucket];
+				pHistogram[bucket] = offset;
+				offset += count;
+			}
+
+			for (const Item& item : m_Items)
+			{
+				m_Scratch[pHistogram[(item.key >> (pass * RADIX_BITS)) & (BUCKET_COUNT - 1)]++] = item;
+			}
+			m_Items.swap(m_Scratch);
+		}
+
+		CountStateChanges(m_Stats.pipelineChangesSorted, m_Stats.materialChangesSorted);
+		m_Stats.sortTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+	}
+
+	void RenderQueue::CountStateChanges(uint32_t& pipelineChanges, uint32_t& materialChanges) const
+	{
+		// The first draw always has to set everything.
+		pipelineChanges = m_Items.empty() ? 0 : 1;
+		materialChanges = m_Items.empty() ? 0 : 1;
+		for (size_t i = 1; i < m_Items.size(); i++)
+		{
+			if (RenderKey::GetPipeline(m_Items[i].key) != RenderKey::GetPipeline(m_Items[i - 1].key))
+				pipelineChanges++;
+			if (RenderKey::GetMaterial(m_Items[i].key) != RenderKey::GetMaterial(m_Items[i - 1].key))
+				materialChanges++;
+		}
+	}
+}
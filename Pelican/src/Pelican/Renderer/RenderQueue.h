@@ -0,0 +1,80 @@
+﻿#pragma once
+#include <vector>
+
+namespace Pelican
+{
+	// 64-bit keys that put draws in the order they should be recorded in, most significant field first.
+	//   opaque:      pass (2) | pipeline (8) | material (24) | depth (16) | unused (14)
+	//   translucent: pass (2) | inverted depth (16) | pipeline (8) | material (24) | unused (14)
+	// Opaque draws are grouped by state and go front to back within a material for early-Z,
+	// translucent draws have to be blended back to front, so depth comes before any state for them.
+	// Alpha tested draws use the opaque layout, they come after the others so the depth prepass can draw those in one go.
+	namespace RenderKey
+	{
+		enum Pass : uint32_t
+		{
+			OPAQUE_PASS = 0,
+			ALPHA_TESTED_PASS = 1,
+			TRANSLUCENT_PASS = 2,
+		};
+
+		constexpr uint32_t PIPELINE_BITS = 8;
+		constexpr uint32_t MATERIAL_BITS = 24;
+		constexpr uint32_t DEPTH_BITS = 16;
+
+		// Positive floats sort the same as their bit patterns, so the top bits of the view depth make a bucket
+		// that is finer close to the camera. Depths behind the camera end up in bucket 0.
+		[[nodiscard]] uint32_t GetDepthBucket(float viewDepth);
+
+		[[nodiscard]] uint64_t MakeOpaque(uint32_t pipeline, uint32_t material, uint32_t depthBucket);
+		[[nodiscard]] uint64_t MakeAlphaTested(uint32_t pipeline, uint32_t material, uint32_t depthBucket);
+		[[nodiscard]] uint64_t MakeTranslucent(uint32_t pipeline, uint32_t material, uint32_t depthBucket);
+
+		[[nodiscard]] Pass GetPass(uint64_t key);
+		[[nodiscard]] uint32_t GetPipeline(uint64_t key);
+		[[nodiscard]] uint32_t GetMaterial(uint64_t key);
+	}
+
+	struct RenderQueueStats
+	{
+		uint32_t itemCount{};
+		// Draws whose pipeline or material differ from the draw before them, in submission and in sorted order.
+		uint32_t pipelineChangesUnsorted{};
+		uint32_t materialChangesUnsorted{};
+		uint32_t pipelineChangesSorted{};
+		uint32_t materialChangesSorted{};
+		float sortTime{};
+	};
+
+	// Draws get submitted with a sort key and a payload that tells the caller which draw it is,
+	// once everything is in the queue it's radix sorted in one go.
+	class RenderQueue final
+	{
+	public:
+		struct Item
+		{
+			uint64_t key;
+			uint32_t payload;
+		};
+
+		void Clear() { m_Items.clear(); }
+		void Submit(uint64_t key, uint32_t payload) { m_Items.push_back(Item{ key, payload }); }
+
+		// Stable LSD radix sort, one pass per byte of the key. Bytes that are the same for every key get skipped.
+		void Sort();
+
+		[[nodiscard]] const std::vector<Item>& GetItems() const { return m_Items; }
+		[[nodiscard]] uint32_t GetCount() const { return static_cast<uint32_t>(m_Items.size()); }
+		// Filled in by Sort.
+		[[nodiscard]] const RenderQueueStats& GetStats() const { return m_Stats; }
+
+	private:
+		void CountStateChanges(uint32_t& pipelineChanges, uint32_t& materialChanges) const;
+
+	private:
+		std::vector<Item> m_Items{};
+		// Second buffer the radix passes ping-pong with, kept around so sorting doesn't allocate every frame.
+		std::vector<Item> m_Scratch{};
+		RenderQueueStats m_Stats{};
+	};
+}
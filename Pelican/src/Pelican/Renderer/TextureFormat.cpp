@@ -0,0 +1,94 @@
+﻿#include "PelicanPCH.h"
+#include "TextureFormat.h"
+
+#include "Mesh.h"
+
+namespace Pelican
+{
+	namespace TextureFormat
+	{
+		BlockInfo GetBlockInfo(vk::Format format)
+		{
+			switch (format)
+			{
+			case vk::Format::eBc1RgbUnormBlock:
+			case vk::Format::eBc1RgbSrgbBlock:
+			case vk::Format::eBc1RgbaUnormBlock:
+			case vk::Format::eBc1RgbaSrgbBlock:
+			case vk::Format::eBc4UnormBlock:
+				return { 4, 4, 8 };
+			case vk::Format::eBc3UnormBlock:
+			case vk::Format::eBc3SrgbBlock:
+			case vk::Format::eBc5UnormBlock:
+			case vk::Format::eBc6HUfloatBlock:
+			case vk::Format::eBc6HSfloatBlock:
+			case vk::Format::eBc7UnormBlock:
+			case vk::Format::eBc7SrgbBlock:
+				return { 4, 4, 16 };
+			case vk::Format::eR8Unorm:
+			case vk::Format::eR8Srgb:
+				return { 1, 1, 1 };
+			case vk::Format::eR8G8Unorm:
+			case vk::Format::eR8G8Srgb:
+				return { 1, 1, 2 };
+			case vk::Format::eR8G8B8A8Unorm:
+			case vk::Format::eR8G8B8A8Srgb:
+				return { 1, 1, 4 };
+			case vk::Format::eR16G16B16A16Sfloat:
+				return { 1, 1, 8 };
+			case vk::Format::eR32G32B32A32Sfloat:
+				return { 1, 1, 16 };
+			default:
+				return { 1, 1, 0 };
+			}
+		}
+
+		bool IsBlockCompressed(vk::Format format)
+		{
+			return GetBlockInfo(format).width > 1;
+		}
+
+		bool IsSrgb(vk::Format format)
+		{
+			switch (format)
+			{
+			case vk::Format::eBc1RgbSrgbBlock:
+			case vk::Format::eBc1RgbaSrgbBlock:
+			case vk::Format::eBc3SrgbBlock:
+			case vk::Format::eBc7SrgbBlock:
+			case vk::Format::eR8Srgb:
+			case vk::Format::eR8G8Srgb:
+			case vk::Format::eR8G8B8A8Srgb:
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		vk::DeviceSize GetImageSize(vk::Format format, uint32_t width, uint32_t height)
+		{
+			const BlockInfo block = GetBlockInfo(format);
+			const vk::DeviceSize blocksX = (width + block.width - 1) / block.width;
+			const vk::DeviceSize blocksY = (height + block.height - 1) / block.height;
+			return blocksX * blocksY * block.size;
+		}
+
+		vk::Format GetSlotFormat(TextureSlot slot)
+		{
+			switch (slot)
+			{
+			case TextureSlot::ALBEDO:
+			case TextureSlot::EMISSIVE:
+				return vk::Format::eBc7SrgbBlock;
+			case TextureSlot::NORMAL:
+				return vk::Format::eBc5UnormBlock;
+			case TextureSlot::METALLIC_ROUGHNESS:
+				return vk::Format::eBc7UnormBlock;
+			case TextureSlot::AMBIENT_OCCLUSION:
+				return vk::Format::eBc4UnormBlock;
+			default:
+				return vk::Format::eUndefined;
+			}
+		}
+	}
+}
@@ -0,0 +1,29 @@
+﻿#pragma once
+#include <vulkan/vulkan.hpp>
+
+namespace Pelican
+{
+	enum class TextureSlot : uint32_t;
+
+	namespace TextureFormat
+	{
+		// Block compressed formats store blocks of 4x4 texels, everything else is a block of one texel.
+		struct BlockInfo
+		{
+			uint32_t width{ 1 };
+			uint32_t height{ 1 };
+			uint32_t size{};
+		};
+
+		// Size is 0 for formats textures can't be stored in.
+		[[nodiscard]] BlockInfo GetBlockInfo(vk::Format format);
+		[[nodiscard]] bool IsBlockCompressed(vk::Format format);
+		[[nodiscard]] bool IsSrgb(vk::Format format);
+		// Bytes of one tightly packed width by height image, partial blocks at the edges take a whole block.
+		[[nodiscard]] vk::DeviceSize GetImageSize(vk::Format format, uint32_t width, uint32_t height);
+
+		// The compressed format each material slot gets cooked into.
+		// Normals only keep x and y in BC5, the shader reconstructs z.
+		[[nodiscard]] vk::Format GetSlotFormat(TextureSlot slot);
+	}
+}
@@ -0,0 +1,290 @@
+﻿#include "PelicanPCH.h"
+#include "TextureStreamer.h"
+
+#include <cmath>
+
+#include <logtools.h>
+
+#include "Pelican/Core/Profiler.h"
+
+#include "MipGenerator.h"
+#include "VulkanRenderer.h"
+#include "VulkanTexture.h"
+
+namespace Pelican
+{
+	namespace
+	{
+		void DestroyRetiredImage(const RetiredImage& retired)
+		{
+			VulkanRenderer::GetDevice().destroySampler(retired.sampler);
+			VulkanRenderer::GetDevice().destroyImageView(retired.view);
+			VulkanRenderer::GetDevice().destroyImage(retired.image);
+			VulkanRenderer::GetAllocator()->Free(retired.memory);
+		}
+	}
+
+	TextureStreamer::TextureStreamer(uint32_t frameCount, vk::DeviceSize budget)
+		: m_Budget(budget)
+	{
+		m_RetiredImages.resize(frameCount);
+		m_LoaderThread = std::thread(&TextureStreamer::LoaderLoop, this);
+	}
+
+	TextureStreamer::~TextureStreamer()
+	{
+		{
+			std::lock_guard lock(m_LoaderMutex);
+			m_StopLoader = true;
+		}
+		m_LoaderCondition.notify_all();
+		m_LoaderThread.join();
+
+		// Only gets destroyed once the device is idle.
+		for (const std::vector<RetiredImage>& retiredImages : m_RetiredImages)
+		{
+			for (const RetiredImage& retired : retiredImages)
+			{
+				DestroyRetiredImage(retired);
+			}
+		}
+	}
+
+	void TextureStreamer::Register(VulkanTexture* pTexture)
+	{
+		StreamedTexture entry{};
+		entry.pTexture = pTexture;
+		entry.tailMip = pTexture->GetResidentMip();
+		entry.targetMip = entry.tailMip;
+		m_Textures[pTexture] = entry;
+	}
+
+	void TextureStreamer::Unregister(const VulkanTexture* pTexture)
+	{
+		// A load that is still running gets dropped when it finishes, its id won't match anything anymore.
+		m_Textures.erase(pTexture);
+	}
+
+	void TextureStreamer::Request(const VulkanTexture* pTexture, float screenSize)
+	{
+		const auto it = m_Textures.find(pTexture);
+		if (it == m_Textures.end())
+			return;
+
+		// One texel per pixel, every time the screen size halves the texture can go one mip further down the chain.
+		StreamedTexture& entry = it->second;
+		uint32_t mip = entry.tailMip;
+		if (screenSize >= 1.0f)
+		{
+			const float fullSize = static_cast<float>(std::max(pTexture->GetFullWidth(), pTexture->GetFullHeight()));
+			const float level = std::floor(std::log2(fullSize / screenSize));
+			mip = static_cast<uint32_t>(std::clamp(level, 0.0f, static_cast<float>(entry.tailMip)));
+		}
+		entry.frameRequest = std::min(entry.frameRequest, mip);
+	}
+
+	void TextureStreamer::BeginFrame(uint32_t frameIndex)
+	{
+		PELICAN_PROFILE_FUNCTION();
+
+		m_FrameIndex = frameIndex;
+		m_FrameNumber++;
+
+		for (const RetiredImage& retired : m_RetiredImages[m_FrameIndex])
+		{
+			DestroyRetiredImage(retired);
+		}
+		m_RetiredImages[m_FrameIndex].clear();
+
+		ApplyLoads();
+		UpdateTargets();
+		QueueLoads();
+	}
+
+	void TextureStreamer::RetireImage(const RetiredImage& image)
+	{
+		m_RetiredImages[m_FrameIndex].push_back(image);
+	}
+
+	uint32_t TextureStreamer::GetRequestedMip(const VulkanTexture* pTexture) const
+	{
+		const auto it = m_Textures.find(pTexture);
+		return it != m_Textures.end() ? it->second.requestedMip : NO_REQUEST;
+	}
+
+	uint32_t TextureStreamer::GetTargetMip(const VulkanTexture* pTexture) const
+	{
+		const auto it = m_Textures.find(pTexture);
+		return it != m_Textures.end() ? it->second.targetMip : NO_REQUEST;
+	}
+
+	void TextureStreamer::ApplyLoads()
+	{
+		std::vector<LoadResult> results;
+		{
+			std::lock_guard lock(m_LoaderMutex);
+			results.swap(m_LoadResults);
+		}
+
+		for (LoadResult& result : results)
+		{
+			// The texture got unloaded while it was being read, or a new texture ended up at the same address.
+			const auto it = m_Textures.find(result.pTexture);
+			if (it == m_Textures.end() || it->second.loadId != result.id)
+				continue;
+
+			StreamedTexture& entry = it->second;
+			entry.loadId = 0;
+			if (!result.success)
+			{
+				// Keeps the texture at what it has now instead of trying again every frame.
+				Logger::LogWarning("Failed to stream the mips of \"%s\"", entry.pTexture->GetAssetPath().string().c_str());
+				entry.tailMip = entry.pTexture->GetResidentMip();
+				continue;
+			}
+
+			// The upload swaps the image once it's done, the texture is busy until then.
+			entry.pTexture->StreamMips(result.file);
+		}
+	}
+
+	void TextureStreamer::UpdateTargets()
+	{
+		m_ResidentSize = 0;
+		vk::DeviceSize targetSize = 0;
+		for (auto& [pKey, entry] : m_Textures)
+		{
+			if (entry.frameRequest != NO_REQUEST)
+			{
+				entry.requestedMip = entry.frameRequest;
+				entry.lastRequestFrame = m_FrameNumber;
+				entry.frameRequest = NO_REQUEST;
+			}
+			else if (m_FrameNumber - entry.lastRequestFrame > REQUEST_LIFETIME)
+			{
+				entry.requestedMip = NO_REQUEST;
+			}
+
+			// Mips that are resident stay resident while the texture is still in use and there is room for them.
+			const uint32_t residentMip = entry.pTexture->GetResidentMip();
+			entry.targetMip = entry.requestedMip != NO_REQUEST ? std::min(entry.requestedMip, residentMip) : entry.tailMip;
+			entry.targetMip = std::min(entry.targetMip, entry.tailMip);
+
+			m_ResidentSize += entry.pTexture->GetMemorySize();
+			targetSize += entry.pTexture->GetMemorySize(entry.targetMip);
+		}
+
+		if (targetSize <= m_Budget)
+			return;
+
+		// Mips nobody asked for go first, then the ones of textures that weren't requested in the longest time,
+		// then the largest ones.
+		std::vector<StreamedTexture*> order;
+		for (auto& [pKey, entry] : m_Textures)
+		{
+			if (entry.targetMip < entry.tailMip)
+			{
+				order.push_back(&entry);
+			}
+		}
+		std::sort(order.begin(), order.end(), [](const StreamedTexture* pA, const StreamedTexture* pB)
+		{
+			const bool aUnused = pA->targetMip < pA->requestedMip;
+			const bool bUnused = pB->targetMip < pB->requestedMip;
+			if (aUnused != bUnused)
+				return aUnused;
+			if (pA->lastRequestFrame != pB->lastRequestFrame)
+				return pA->lastRequestFrame < pB->lastRequestFrame;
+			return pA->targetMip < pB->targetMip;
+		});
+
+		// Drops one mip per texture per pass, so a single texture doesn't lose all of its detail while others keep theirs.
+		bool dropped = true;
+		while (targetSize > m_Budget && dropped)
+		{
+			dropped = false;
+			for (StreamedTexture* pEntry : order)
+			{
+				if (pEntry->targetMip >= pEntry->tailMip)
+					continue;
+
+				targetSize -= pEntry->pTexture->GetMemorySize(pEntry->targetMip) - pEntry->pTexture->GetMemorySize(pEntry->targetMip + 1);
+				pEntry->targetMip++;
+				dropped = true;
+				if (targetSize <= m_Budget)
+					break;
+			}
+		}
+	}
+
+	void TextureStreamer::QueueLoads()
+	{
+		m_LoadCount = 0;
+		std::vector<StreamedTexture*> candidates;
+		for (auto& [pKey, entry] : m_Textures)
+		{
+			if (entry.loadId != 0 || entry.pTexture->IsStreaming())
+			{
+				m_LoadCount++;
+			}
+			else if (entry.targetMip != entry.pTexture->GetResidentMip())
+			{
+				candidates.push_back(&entry);
+			}
+		}
+
+		// Evictions free memory, so they go first. The textures missing the most detail come after them.
+		std::sort(candidates.begin(), candidates.end(), [](const StreamedTexture* pA, const StreamedTexture* pB)
+		{
+			const int32_t aMissing = static_cast<int32_t>(pA->pTexture->GetResidentMip()) - static_cast<int32_t>(pA->targetMip);
+			const int32_t bMissing = static_cast<int32_t>(pB->pTexture->GetResidentMip()) - static_cast<int32_t>(pB->targetMip);
+			if ((aMissing < 0) != (bMissing < 0))
+				return aMissing < 0;
+			return aMissing > bMissing;
+		});
+
+		for (StreamedTexture* pEntry : candidates)
+		{
+			if (m_LoadCount >= MAX_LOADS_IN_FLIGHT)
+				break;
+
+			// Evicted mips get read from the file as well, the smaller levels are cheap to load again.
+			const VulkanTexture* pTexture = pEntry->pTexture;
+			const uint32_t maxSize = std::max(MipGenerator::GetMipSize(pTexture->GetFullWidth(), pEntry->targetMip),
+				MipGenerator::GetMipSize(pTexture->GetFullHeight(), pEntry->targetMip));
+
+			pEntry->loadId = m_NextLoadId++;
+			{
+				std::lock_guard lock(m_LoaderMutex);
+				m_LoadQueue.push_back(LoadRequest{ pEntry->loadId, pTexture, pTexture->GetAssetPath(), maxSize });
+			}
+			m_LoaderCondition.notify_one();
+			m_LoadCount++;
+		}
+	}
+
+	void TextureStreamer::LoaderLoop()
+	{
+		Profiler::SetThreadName("Texture Streamer");
+
+		while (true)
+		{
+			LoadRequest request{};
+			{
+				std::unique_lock lock(m_LoaderMutex);
+				m_LoaderCondition.wait(lock, [this]() { return m_StopLoader || !m_LoadQueue.empty(); });
+				if (m_StopLoader)
+					return;
+
+				request = std::move(m_LoadQueue.front());
+				m_LoadQueue.pop_front();
+			}
+
+			LoadResult result{ request.id, request.pTexture, {}, false };
+			result.success = result.file.Load(request.path, request.maxSize);
+
+			std::lock_guard lock(m_LoaderMutex);
+			m_LoadResults.push_back(std::move(result));
+		}
+	}
+}
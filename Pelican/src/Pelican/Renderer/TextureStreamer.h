@@ -0,0 +1,127 @@
+﻿#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include <vulkan/vulkan.hpp>
+
+#include "Ktx2File.h"
+#include "VulkanAllocator.h"
+
+namespace Pelican
+{
+	class VulkanTexture;
+
+	// The image a texture used before it got other mips streamed in, it's destroyed once no frame in flight samples it anymore.
+	struct RetiredImage
+	{
+		vk::Image image{};
+		VulkanAllocation memory{};
+		vk::ImageView view{};
+		vk::Sampler sampler{};
+	};
+
+	// Keeps only the mips of KTX2 textures resident that the scene actually needs.
+	// Textures start out with their small mips, the scene requests mips based on how large a model is on screen and the
+	// streamer loads the larger ones on a background thread. When the resident mips don't fit the budget anymore,
+	// the textures that haven't been requested the longest drop their largest mips first.
+	class TextureStreamer final
+	{
+	public:
+		// Streamed textures get created with the mips up to this size, these always stay resident.
+		static constexpr uint32_t INITIAL_SIZE = 128;
+		static constexpr vk::DeviceSize DEFAULT_BUDGET = 512ull * 1024 * 1024;
+
+		explicit TextureStreamer(uint32_t frameCount, vk::DeviceSize budget = DEFAULT_BUDGET);
+		~TextureStreamer();
+
+		TextureStreamer(const TextureStreamer&) = delete;
+		TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+		void Register(VulkanTexture* pTexture);
+		void Unregister(const VulkanTexture* pTexture);
+
+		// Asks for the mips the texture needs when it covers screenSize pixels, the finest request of a frame wins.
+		// Textures that aren't streamed are ignored.
+		void Request(const VulkanTexture* pTexture, float screenSize);
+
+		// Only call this once the fence of the given frame has been waited on. Destroys the images retired during that
+		// frame, hands finished loads to their textures and decides which mips get loaded or evicted next.
+		void BeginFrame(uint32_t frameIndex);
+
+		void RetireImage(const RetiredImage& image);
+
+		void SetBudget(vk::DeviceSize budget) { m_Budget = budget; }
+		[[nodiscard]] vk::DeviceSize GetBudget() const { return m_Budget; }
+		// Memory taken by the resident mips of all streamed textures.
+		[[nodiscard]] vk::DeviceSize GetResidentSize() const { return m_ResidentSize; }
+		[[nodiscard]] uint32_t GetTextureCount() const { return static_cast<uint32_t>(m_Textures.size()); }
+		[[nodiscard]] uint32_t GetLoadCount() const { return m_LoadCount; }
+
+		// The finest mip that was requested recently and the one the streamer is working towards, ~0u if not streamed.
+		[[nodiscard]] uint32_t GetRequestedMip(const VulkanTexture* pTexture) const;
+		[[nodiscard]] uint32_t GetTargetMip(const VulkanTexture* pTexture) const;
+
+	private:
+		static constexpr uint32_t NO_REQUEST = ~0u;
+		// Requests stay valid for this many frames, so textures don't get evicted the moment they leave the view.
+		static constexpr uint64_t REQUEST_LIFETIME = 120;
+		static constexpr uint32_t MAX_LOADS_IN_FLIGHT = 4;
+
+		struct StreamedTexture
+		{
+			VulkanTexture* pTexture{};
+			// The mip loaded on creation, streaming never goes below it.
+			uint32_t tailMip{};
+			uint32_t frameRequest{ NO_REQUEST };
+			uint32_t requestedMip{ NO_REQUEST };
+			uint64_t lastRequestFrame{};
+			uint32_t targetMip{};
+			// Id of the load that's on its way, 0 when there is none.
+			uint64_t loadId{};
+		};
+
+		struct LoadRequest
+		{
+			uint64_t id;
+			const VulkanTexture* pTexture;
+			std::filesystem::path path;
+			uint32_t maxSize;
+		};
+
+		struct LoadResult
+		{
+			uint64_t id;
+			const VulkanTexture* pTexture;
+			Ktx2File file;
+			bool success;
+		};
+
+		void ApplyLoads();
+		void UpdateTargets();
+		void QueueLoads();
+		void LoaderLoop();
+
+	private:
+		std::unordered_map<const VulkanTexture*, StreamedTexture> m_Textures{};
+		vk::DeviceSize m_Budget{};
+		vk::DeviceSize m_ResidentSize{};
+		uint64_t m_FrameNumber{};
+		uint64_t m_NextLoadId{ 1 };
+		uint32_t m_LoadCount{};
+
+		// Retired images per frame in flight, released the next time that frame begins.
+		std::vector<std::vector<RetiredImage>> m_RetiredImages{};
+		uint32_t m_FrameIndex{};
+
+		std::thread m_LoaderThread{};
+		std::mutex m_LoaderMutex{};
+		std::condition_variable m_LoaderCondition{};
+		std::deque<LoadRequest> m_LoadQueue{};
+		std::vector<LoadResult> m_LoadResults{};
+		bool m_StopLoader{};
+	};
+}
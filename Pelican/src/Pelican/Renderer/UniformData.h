@@ -1,4 +1,4 @@
-#pragma once
+﻿#pragma once
 #include <glm/glm.hpp>
 
 namespace Pelican
@@ -25,10 +25,75 @@ namespace Pelican
 		PointLight pointLight;
 	};
 
-	struct UniformBufferObject
+	// Written once per frame, matches the std140 FrameData block in the shaders.
+	struct FrameData
 	{
-		alignas(16) glm::mat4 model;
 		alignas(16) glm::mat4 view;
 		alignas(16) glm::mat4 proj;
+		LightsData lights;
+		alignas(16) glm::vec3 eyePos;
+		// Indices into the bindless cubemap array.
+		uint32_t skyboxIndex;
+		uint32_t radianceIndex;
+		uint32_t irradianceIndex;
 	};
+
+	// One per drawn object, stored in a std430 array that gets indexed with DrawData::objectIndex.
+	struct ObjectData
+	{
+		glm::mat4 model;
+	};
+
+	// GPU copy of a GltfMaterial, stored in the bindless material buffer. Matches the std430 layout in the shaders.
+	struct MaterialData
+	{
+		glm::vec4 albedoColor;
+		glm::vec4 emissiveFactor;
+		float metallicFactor;
+		float roughnessFactor;
+		// Indices into the bindless texture array.
+		uint32_t albedoTexture;
+		uint32_t normalTexture;
+		uint32_t metallicRoughnessTexture;
+		uint32_t aoTexture;
+		uint32_t emissiveTexture;
+		// Only these materials discard fragments with a low alpha. The others go through the depth prepass,
+		// which doesn't discard, so they have to keep every fragment the prepass wrote.
+		uint32_t alphaTest;
+	};
+	static_assert(sizeof(MaterialData) == 64, "MaterialData has to match the std430 layout in the shaders!");
+
+	// Descriptor sets of the lit pipelines, from least to most frequently changing. These have to match the shaders.
+	enum DescriptorSetIndex : uint32_t
+	{
+		FRAME_SET = 0,
+		MATERIAL_SET = 1,
+	};
+
+	// One per indirect draw (so one per mesh), stored in a std430 array that the shaders index with gl_InstanceIndex,
+	// which is the firstInstance of the draw command.
+	struct DrawData
+	{
+		uint32_t objectIndex;
+		uint32_t materialIndex;
+		uint32_t padding[2];
+		// Object space center in xyz and radius in w, used by the culling pass.
+		glm::vec4 boundingSphere;
+	};
+	static_assert(sizeof(DrawData) == 32, "DrawData has to match the std430 layout in the shaders!");
+
+	// Push constants of the culling compute shader.
+	struct CullPushConst
+	{
+		// Left, right, bottom, top, near and far, see Frustum.
+		glm::vec4 frustumPlanes[6];
+		// Index of the first input command in the uniform ring.
+		uint32_t firstCommand;
+		uint32_t drawCount;
+		// When 0, culled draws are written in place with an instance count of 0 instead of being left out.
+		uint32_t compact;
+		// The commands from splitCommands[i] on are in part i + 1, see VulkanCullingPass::MAX_PARTS.
+		uint32_t splitCommands[2];
+	};
+	static_assert(sizeof(CullPushConst) <= 128, "Push constants are only guaranteed to have 128 bytes!");
 }
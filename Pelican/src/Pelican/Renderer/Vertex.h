@@ -48,5 +48,28 @@ namespace Pelican
 
 			return attributeDescriptions;
 		}
+
+		// The position only stream the depth prepass reads, see VulkanGeometryArena::BindPositions.
+		static vk::VertexInputBindingDescription GetPositionBindingDescription()
+		{
+			vk::VertexInputBindingDescription bindingDescription{};
+			bindingDescription.binding = 0;
+			bindingDescription.stride = sizeof(glm::vec3);
+			bindingDescription.inputRate = vk::VertexInputRate::eVertex;
+
+			return bindingDescription;
+		}
+
+		static std::array<vk::VertexInputAttributeDescription, 1> GetPositionAttributeDescriptions()
+		{
+			std::array<vk::VertexInputAttributeDescription, 1> attributeDescriptions{};
+
+			attributeDescriptions[0].binding = 0;
+			attributeDescriptions[0].location = 0;
+			attributeDescriptions[0].format = vk::Format::eR32G32B32Sfloat;
+			attributeDescriptions[0].offset = 0;
+
+			return attributeDescriptions;
+		}
 	};
 }
@@ -0,0 +1,410 @@
+﻿#include "PelicanPCH.h"
+#include "VulkanAllocator.h"
+
+#include <logtools.h>
+#include <imgui.h>
+
+#include "VulkanDevice.h"
+
+namespace Pelican
+{
+	struct MemoryBlock
+	{
+		vk::DeviceMemory memory{};
+		vk::DeviceSize size{};
+		void* pMapped{};
+		size_t poolIndex{};
+
+		// Only one of these is used, depending on the strategy of the pool.
+		std::unique_ptr<TlsfAllocator> pTlsf{};
+		std::unique_ptr<LinearAllocator> pLinear{};
+
+		[[nodiscard]] OffsetAllocation Allocate(vk::DeviceSize allocSize, vk::DeviceSize alignment)
+		{
+			return pTlsf ? pTlsf->Allocate(allocSize, alignment) : pLinear->Allocate(allocSize, alignment);
+		}
+
+		void Free(const OffsetAllocation& range)
+		{
+			if (pTlsf)
+				pTlsf->Free(range);
+			else
+				pLinear->Free(range);
+		}
+
+		[[nodiscard]] bool IsEmpty() const { return pTlsf ? pTlsf->IsEmpty() : pLinear->IsEmpty(); }
+		[[nodiscard]] OffsetAllocatorStats GetStats() const { return pTlsf ? pTlsf->GetStats() : pLinear->GetStats(); }
+	};
+
+	namespace
+	{
+		constexpr vk::DeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+		constexpr vk::DeviceSize SMALL_HEAP_SIZE = 1024ull * 1024 * 1024;
+
+		float ToMiB(vk::DeviceSize size)
+		{
+			return static_cast<float>(size) / (1024.0f * 1024.0f);
+		}
+	}
+
+	VulkanAllocator::VulkanAllocator(VulkanDevice* pDevice)
+		: m_pDevice(pDevice)
+	{
+		m_MemoryProperties = m_pDevice->GetPhysicalDevice().getMemoryProperties();
+		m_MaxAllocationCount = m_pDevice->GetPhysicalDevice().getProperties().limits.maxMemoryAllocationCount;
+	}
+
+	VulkanAllocator::~VulkanAllocator()
+	{
+		for (Pool& pool : m_Pools)
+		{
+			for (std::unique_ptr<MemoryBlock>& pBlock : pool.blocks)
+			{
+				if (!pBlock->IsEmpty())
+				{
+					Logger::LogWarning("GPU memory pool (type %u) still has %u live allocations on shutdown!",
+						pool.memoryTypeIndex, pBlock->GetStats().allocationCount);
+				}
+
+				DestroyBlock(*pBlock);
+			}
+		}
+
+		if (m_DedicatedAllocationCount > 0)
+		{
+			Logger::LogWarning("%u dedicated GPU allocations were never freed!", m_DedicatedAllocationCount);
+		}
+	}
+
+	VulkanAllocation VulkanAllocator::AllocateForBuffer(vk::Buffer buffer, vk::MemoryPropertyFlags properties, MemoryStrategy strategy)
+	{
+		const vk::MemoryRequirements requirements = m_pDevice->GetDevice().getBufferMemoryRequirements(buffer);
+		VulkanAllocation allocation = Allocate(requirements, properties, false, strategy);
+
+		try
+		{
+			m_pDevice->GetDevice().bindBufferMemory(buffer, allocation.memory, allocation.offset);
+		}
+		catch (vk::SystemError& e)
+		{
+			Free(allocation);
+			throw std::runtime_error("Failed to bind buffer memory: "s + e.what());
+		}
+
+		return allocation;
+	}
+
+	VulkanAllocation VulkanAllocator::AllocateForImage(vk::Image image, vk::MemoryPropertyFlags properties, MemoryStrategy strategy)
+	{
+		const vk::MemoryRequirements requirements = m_pDevice->GetDevice().getImageMemoryRequirements(image);
+		VulkanAllocation allocation = Allocate(requirements, properties, true, strategy);
+
+		try
+		{
+			m_pDevice->GetDevice().bindImageMemory(image, allocation.memory, allocation.offset);
+		}
+		catch (vk::SystemError& e)
+		{
+			Free(allocation);
+			throw std::runtime_error("Failed to bind image memory: "s + e.what());
+		}
+
+		return allocation;
+	}
+
+	void VulkanAllocator::Free(VulkanAllocation& allocation)
+	{
+		if (!allocation.IsValid())
+			return;
+
+		std::lock_guard lock(m_Mutex);
+
+		if (!allocation.pBlock)
+		{
+			m_pDevice->GetDevice().freeMemory(allocation.memory);
+			m_DeviceAllocationCount--;
+			m_DedicatedAllocationCount--;
+			m_DedicatedAllocationSize -= allocation.size;
+		}
+		else
+		{
+			MemoryBlock* pBlock = allocation.pBlock;
+			pBlock->Free(allocation.range);
+
+			// Keep one empty block around per pool, so we don't keep allocating and freeing device memory
+			// when a single resource gets created and destroyed over and over.
+			if (pBlock->IsEmpty())
+			{
+				Pool& pool = m_Pools[pBlock->poolIndex];
+				const size_t emptyCount = std::count_if(pool.blocks.begin(), pool.blocks.end(),
+					[](const std::unique_ptr<MemoryBlock>& pOther) { return pOther->IsEmpty(); });
+
+				if (emptyCount > 1)
+				{
+					const auto it = std::find_if(pool.blocks.begin(), pool.blocks.end(),
+						[pBlock](const std::unique_ptr<MemoryBlock>& pOther) { return pOther.get() == pBlock; });
+
+					DestroyBlock(*pBlock);
+					pool.blocks.erase(it);
+				}
+			}
+		}
+
+		allocation = VulkanAllocation{};
+	}
+
+	std::vector<VulkanAllocator::PoolStats> VulkanAllocator::GetPoolStats() const
+	{
+		std::lock_guard lock(m_Mutex);
+
+		std::vector<PoolStats> result;
+		result.reserve(m_Pools.size());
+
+		for (const Pool& pool : m_Pools)
+		{
+			PoolStats poolStats;
+			poolStats.memoryTypeIndex = pool.memoryTypeIndex;
+			poolStats.properties = m_MemoryProperties.memoryTypes[pool.memoryTypeIndex].propertyFlags;
+			poolStats.isImagePool = pool.isImagePool;
+			poolStats.strategy = pool.strategy;
+			poolStats.blockCount = static_cast<uint32_t>(pool.blocks.size());
+
+			for (const std::unique_ptr<MemoryBlock>& pBlock : pool.blocks)
+			{
+				const OffsetAllocatorStats blockStats = pBlock->GetStats();
+				poolStats.stats.totalSize += blockStats.totalSize;
+				poolStats.stats.usedSize += blockStats.usedSize;
+				poolStats.stats.allocationCount += blockStats.allocationCount;
+				poolStats.stats.freeRegionCount += blockStats.freeRegionCount;
+				poolStats.stats.largestFreeRegion = std::max(poolStats.stats.largestFreeRegion, blockStats.largestFreeRegion);
+			}
+
+			result.push_back(poolStats);
+		}
+
+		return result;
+	}
+
+	void VulkanAllocator::DebugDraw() const
+	{
+		const std::vector<PoolStats> pools = GetPoolStats();
+
+		// Upload threads allocate while this draws, so the counters get copied under the lock.
+		uint32_t deviceAllocationCount;
+		uint32_t dedicatedAllocationCount;
+		vk::DeviceSize dedicatedAllocationSize;
+		{
+			std::lock_guard lock(m_Mutex);
+			deviceAllocationCount = m_DeviceAllocationCount;
+			dedicatedAllocationCount = m_DedicatedAllocationCount;
+			dedicatedAllocationSize = m_DedicatedAllocationSize;
+		}
+
+		if (ImGui::Begin("GPU Memory"))
+		{
+			vk::DeviceSize totalReserved = 0;
+			vk::DeviceSize totalUsed = 0;
+			uint32_t totalAllocations = 0;
+			for (const PoolStats& pool : pools)
+			{
+				totalReserved += pool.stats.totalSize;
+				totalUsed += pool.stats.usedSize;
+				totalAllocations += pool.stats.allocationCount;
+			}
+
+			ImGui::Text("Device allocations: %u / %u", deviceAllocationCount, m_MaxAllocationCount);
+			ImGui::Text("Sub-allocations: %u", totalAllocations);
+			ImGui::Text("Pooled: %.2f MiB used of %.2f MiB reserved", ToMiB(totalUsed), ToMiB(totalReserved));
+			ImGui::Text("Dedicated: %u allocations, %.2f MiB", dedicatedAllocationCount, ToMiB(dedicatedAllocationSize));
+			ImGui::Separator();
+
+			for (size_t i = 0; i < pools.size(); i++)
+			{
+				const PoolStats& pool = pools[i];
+
+				ImGui::PushID(static_cast<int>(i));
+				if (ImGui::TreeNode("Pool", "Type %u - %s %s", pool.memoryTypeIndex,
+					pool.isImagePool ? "Images" : "Buffers",
+					pool.strategy == MemoryStrategy::Linear ? "(Linear)" : "(TLSF)"))
+				{
+					ImGui::Text("Properties: %s", vk::to_string(pool.properties).c_str());
+					ImGui::Text("Blocks: %u", pool.blockCount);
+					ImGui::Text("Allocations: %u", pool.stats.allocationCount);
+					ImGui::Text("Used: %.2f / %.2f MiB", ToMiB(pool.stats.usedSize), ToMiB(pool.stats.totalSize));
+
+					const float usage = pool.stats.totalSize > 0
+						? static_cast<float>(pool.stats.usedSize) / static_cast<float>(pool.stats.totalSize)
+						: 0.0f;
+					ImGui::ProgressBar(usage);
+
+					ImGui::Text("Free regions: %u, largest %.2f MiB", pool.stats.freeRegionCount, ToMiB(pool.stats.largestFreeRegion));
+					ImGui::Text("Fragmentation: %.1f%%", pool.stats.GetFragmentation() * 100.0f);
+					ImGui::TreePop();
+				}
+				ImGui::PopID();
+			}
+		}
+		ImGui::End();
+	}
+
+	VulkanAllocation VulkanAllocator::Allocate(const vk::MemoryRequirements& requirements, vk::MemoryPropertyFlags properties, bool isImage, MemoryStrategy strategy)
+	{
+		uint32_t memoryTypeIndex = ~0u;
+		for (uint32_t i = 0; i < m_MemoryProperties.memoryTypeCount; i++)
+		{
+			if ((requirements.memoryTypeBits & (1 << i)) && (m_MemoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+			{
+				memoryTypeIndex = i;
+				break;
+			}
+		}
+
+		if (memoryTypeIndex == ~0u)
+		{
+			throw std::runtime_error("Failed to find suitable memory type!");
+		}
+
+		std::lock_guard lock(m_Mutex);
+
+		Pool& pool = GetPool(memoryTypeIndex, isImage, strategy);
+
+		// Big resources would waste most of a block, give them their own memory.
+		if (requirements.size > pool.blockSize / 2)
+		{
+			return AllocateDedicated(requirements, memoryTypeIndex);
+		}
+
+		VulkanAllocation allocation;
+		allocation.memoryTypeIndex = memoryTypeIndex;
+		allocation.size = requirements.size;
+
+		for (std::unique_ptr<MemoryBlock>& pBlock : pool.blocks)
+		{
+			allocation.range = pBlock->Allocate(requirements.size, requirements.alignment);
+			if (allocation.range.IsValid())
+			{
+				allocation.pBlock = pBlock.get();
+				break;
+			}
+		}
+
+		if (!allocation.pBlock)
+		{
+			pool.blocks.push_back(CreateBlock(pool));
+			allocation.pBlock = pool.blocks.back().get();
+			allocation.range = allocation.pBlock->Allocate(requirements.size, requirements.alignment);
+			ASSERT_MSG(allocation.range.IsValid(), "Allocation doesn't fit in a fresh memory block!");
+		}
+
+		allocation.memory = allocation.pBlock->memory;
+		allocation.offset = allocation.range.offset;
+		if (allocation.pBlock->pMapped)
+		{
+			allocation.pMapped = static_cast<uint8_t*>(allocation.pBlock->pMapped) + allocation.offset;
+		}
+
+		return allocation;
+	}
+
+	VulkanAllocation VulkanAllocator::AllocateDedicated(const vk::MemoryRequirements& requirements, uint32_t memoryTypeIndex)
+	{
+		const vk::MemoryAllocateInfo allocInfo(requirements.size, memoryTypeIndex);
+
+		VulkanAllocation allocation;
+		allocation.memoryTypeIndex = memoryTypeIndex;
+		allocation.size = requirements.size;
+
+		try
+		{
+			allocation.memory = m_pDevice->GetDevice().allocateMemory(allocInfo);
+		}
+		catch (vk::SystemError& e)
+		{
+			throw std::runtime_error("Failed to allocate dedicated memory: "s + e.what());
+		}
+
+		if (IsHostVisible(memoryTypeIndex))
+		{
+			allocation.pMapped = m_pDevice->GetDevice().mapMemory(allocation.memory, 0, VK_WHOLE_SIZE);
+		}
+
+		m_DeviceAllocationCount++;
+		m_DedicatedAllocationCount++;
+		m_DedicatedAllocationSize += requirements.size;
+
+		return allocation;
+	}
+
+	std::unique_ptr<MemoryBlock> VulkanAllocator::CreateBlock(const Pool& pool)
+	{
+		std::unique_ptr<MemoryBlock> pBlock = std::make_unique<MemoryBlock>();
+		pBlock->size = pool.blockSize;
+		pBlock->poolIndex = static_cast<size_t>(&pool - m_Pools.data());
+
+		const vk::MemoryAllocateInfo allocInfo(pool.blockSize, pool.memoryTypeIndex);
+
+		try
+		{
+			pBlock->memory = m_pDevice->GetDevice().allocateMemory(allocInfo);
+		}
+		catch (vk::SystemError& e)
+		{
+			throw std::runtime_error("Failed to allocate memory block: "s + e.what());
+		}
+
+		// Host visible blocks stay mapped for their whole lifetime, mapping is not free on every driver.
+		if (IsHostVisible(pool.memoryTypeIndex))
+		{
+			pBlock->pMapped = m_pDevice->GetDevice().mapMemory(pBlock->memory, 0, VK_WHOLE_SIZE);
+		}
+
+		if (pool.strategy == MemoryStrategy::Linear)
+			pBlock->pLinear = std::make_unique<LinearAllocator>(pool.blockSize);
+		else
+			pBlock->pTlsf = std::make_unique<TlsfAllocator>(pool.blockSize);
+
+		m_DeviceAllocationCount++;
+
+		Logger::LogDebug("Allocated %.2f MiB GPU memory block for memory type %u", ToMiB(pool.blockSize), pool.memoryTypeIndex);
+
+		return pBlock;
+	}
+
+	void VulkanAllocator::DestroyBlock(MemoryBlock& block)
+	{
+		if (block.pMapped)
+		{
+			m_pDevice->GetDevice().unmapMemory(block.memory);
+		}
+
+		m_pDevice->GetDevice().freeMemory(block.memory);
+		block.memory = nullptr;
+		m_DeviceAllocationCount--;
+	}
+
+	VulkanAllocator::Pool& VulkanAllocator::GetPool(uint32_t memoryTypeIndex, bool isImage, MemoryStrategy strategy)
+	{
+		for (Pool& pool : m_Pools)
+		{
+			if (pool.memoryTypeIndex == memoryTypeIndex && pool.isImagePool == isImage && pool.strategy == strategy)
+				return pool;
+		}
+
+		// Don't hog small heaps (e.g. the 256MiB device local + host visible heap) with huge blocks.
+		const vk::DeviceSize heapSize = m_MemoryProperties.memoryHeaps[m_MemoryProperties.memoryTypes[memoryTypeIndex].heapIndex].size;
+
+		Pool pool;
+		pool.memoryTypeIndex = memoryTypeIndex;
+		pool.isImagePool = isImage;
+		pool.strategy = strategy;
+		pool.blockSize = heapSize <= SMALL_HEAP_SIZE ? std::min(DEFAULT_BLOCK_SIZE, heapSize / 8) : DEFAULT_BLOCK_SIZE;
+
+		m_Pools.push_back(std::move(pool));
+		return m_Pools.back();
+	}
+
+	bool VulkanAllocator::IsHostVisible(uint32_t memoryTypeIndex) const
+	{
+		return static_cast<bool>(m_MemoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible);
+	}
+}
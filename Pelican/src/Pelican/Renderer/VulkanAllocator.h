@@ -0,0 +1,101 @@
+﻿#pragma once
+
+#include <memory>
+#include <mutex>
+
+#include <vulkan/vulkan.hpp>
+
+#include "OffsetAllocator.h"
+
+namespace Pelican
+{
+	class VulkanDevice;
+	struct MemoryBlock;
+
+	enum class MemoryStrategy
+	{
+		// TLSF, for resources that live for a while (meshes, textures, ...)
+		General,
+		// Bump allocation, for short lived resources such as staging buffers.
+		Linear,
+	};
+
+	struct VulkanAllocation
+	{
+		vk::DeviceMemory memory{};
+		vk::DeviceSize offset{};
+		vk::DeviceSize size{};
+		// Points to the start of this allocation when the memory is host visible, nullptr otherwise.
+		void* pMapped{};
+
+		uint32_t memoryTypeIndex{};
+		MemoryBlock* pBlock{}; // nullptr for dedicated allocations.
+		OffsetAllocation range{};
+
+		[[nodiscard]] bool IsValid() const { return static_cast<bool>(memory); }
+	};
+
+	// Sub-allocates resources out of big device memory blocks, instead of calling vkAllocateMemory for each of them.
+	// Blocks are pooled per memory type, resource kind and strategy. Buffers and images are kept in separate pools,
+	// so we never have to worry about bufferImageGranularity.
+	class VulkanAllocator final
+	{
+	public:
+		struct PoolStats
+		{
+			uint32_t memoryTypeIndex{};
+			vk::MemoryPropertyFlags properties{};
+			bool isImagePool{};
+			MemoryStrategy strategy{};
+			uint32_t blockCount{};
+			OffsetAllocatorStats stats{};
+		};
+
+		explicit VulkanAllocator(VulkanDevice* pDevice);
+		~VulkanAllocator();
+
+		VulkanAllocator(const VulkanAllocator&) = delete;
+		VulkanAllocator& operator=(const VulkanAllocator&) = delete;
+
+		// Allocates and binds memory for the given resource.
+		[[nodiscard]] VulkanAllocation AllocateForBuffer(vk::Buffer buffer, vk::MemoryPropertyFlags properties, MemoryStrategy strategy = MemoryStrategy::General);
+		[[nodiscard]] VulkanAllocation AllocateForImage(vk::Image image, vk::MemoryPropertyFlags properties, MemoryStrategy strategy = MemoryStrategy::General);
+		void Free(VulkanAllocation& allocation);
+
+		[[nodiscard]] std::vector<PoolStats> GetPoolStats() const;
+
+		// Shows the memory usage of all the pools.
+		void DebugDraw() const;
+
+	private:
+		struct Pool
+		{
+			uint32_t memoryTypeIndex{};
+			bool isImagePool{};
+			MemoryStrategy strategy{};
+			vk::DeviceSize blockSize{};
+			std::vector<std::unique_ptr<MemoryBlock>> blocks{};
+		};
+
+		VulkanAllocation Allocate(const vk::MemoryRequirements& requirements, vk::MemoryPropertyFlags properties, bool isImage, MemoryStrategy strategy);
+		VulkanAllocation AllocateDedicated(const vk::MemoryRequirements& requirements, uint32_t memoryTypeIndex);
+		std::unique_ptr<MemoryBlock> CreateBlock(const Pool& pool);
+		void DestroyBlock(MemoryBlock& block);
+
+		Pool& GetPool(uint32_t memoryTypeIndex, bool isImage, MemoryStrategy strategy);
+		bool IsHostVisible(uint32_t memoryTypeIndex) const;
+
+	private:
+		VulkanDevice* m_pDevice{};
+		vk::PhysicalDeviceMemoryProperties m_MemoryProperties{};
+		uint32_t m_MaxAllocationCount{};
+
+		mutable std::mutex m_Mutex{};
+		std::vector<Pool> m_Pools{};
+
+		// Total amount of vkAllocateMemory calls currently alive, this has to stay below maxMemoryAllocationCount.
+		uint32_t m_DeviceAllocationCount{};
+		uint32_t m_DedicatedAllocationCount{};
+		vk::DeviceSize m_DedicatedAllocationSize{};
+	};
+}
@@ -0,0 +1,59 @@
+﻿#include "PelicanPCH.h"
+#include "VulkanBindTracker.h"
+
+namespace Pelican
+{
+	VulkanBindTracker::VulkanBindTracker(vk::CommandBuffer cmd, DescriptorStats& stats)
+		: m_CommandBuffer(cmd), m_Stats(stats)
+	{
+	}
+
+	VulkanBindTracker::~VulkanBindTracker()
+	{
+		m_Stats.binds += m_Binds;
+		m_Stats.skippedBinds += m_SkippedBinds;
+	}
+
+	void VulkanBindTracker::BindPipeline(vk::Pipeline pipeline, vk::PipelineLayout layout)
+	{
+		if (pipeline == m_Pipeline)
+		{
+			m_SkippedBinds++;
+			return;
+		}
+
+		m_CommandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+		m_Pipeline = pipeline;
+		m_Binds++;
+
+		if (layout != m_Layout)
+		{
+			m_Layout = layout;
+			for (BoundSet& boundSet : m_Sets)
+			{
+				boundSet = {};
+			}
+		}
+	}
+
+	void VulkanBindTracker::BindDescriptorSet(uint32_t setIndex, vk::DescriptorSet set, const vk::ArrayProxy<const uint32_t>& dynamicOffsets)
+	{
+		ASSERT_MSG(setIndex < MAX_SETS, "Set index is out of range!");
+		ASSERT_MSG(dynamicOffsets.size() <= 1, "Only one dynamic offset per set is supported!");
+		ASSERT_MSG(m_Layout, "A pipeline has to be bound before binding descriptor sets!");
+
+		const bool hasDynamicOffset = dynamicOffsets.size() == 1;
+		const uint32_t dynamicOffset = hasDynamicOffset ? *dynamicOffsets.begin() : 0;
+
+		BoundSet& boundSet = m_Sets[setIndex];
+		if (boundSet.set == set && boundSet.hasDynamicOffset == hasDynamicOffset && boundSet.dynamicOffset == dynamicOffset)
+		{
+			m_SkippedBinds++;
+			return;
+		}
+
+		m_CommandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_Layout, setIndex, set, dynamicOffsets);
+		boundSet = { set, dynamicOffset, hasDynamicOffset };
+		m_Binds++;
+	}
+}
@@ -0,0 +1,56 @@
+﻿#pragma once
+
+#include <atomic>
+
+#include <vulkan/vulkan.hpp>
+
+namespace Pelican
+{
+	// Descriptor traffic of a frame, the bind trackers of all recording threads add to this.
+	struct DescriptorStats
+	{
+		std::atomic<uint32_t> writes{};
+		std::atomic<uint32_t> binds{};
+		std::atomic<uint32_t> skippedBinds{};
+	};
+
+	// Remembers what is bound on a single command buffer and drops binds that wouldn't change anything.
+	// One tracker per command buffer, so it doesn't need any locking. The counts get added to the frame's
+	// DescriptorStats when the tracker goes out of scope.
+	class VulkanBindTracker final
+	{
+	public:
+		static constexpr uint32_t MAX_SETS = 4;
+
+		VulkanBindTracker(vk::CommandBuffer cmd, DescriptorStats& stats);
+		~VulkanBindTracker();
+
+		VulkanBindTracker(const VulkanBindTracker&) = delete;
+		VulkanBindTracker& operator=(const VulkanBindTracker&) = delete;
+
+		// Binding a pipeline with a different layout forgets all bound sets, they might not be compatible.
+		void BindPipeline(vk::Pipeline pipeline, vk::PipelineLayout layout);
+		// Only one dynamic offset is tracked per set, which is all our sets need.
+		void BindDescriptorSet(uint32_t setIndex, vk::DescriptorSet set, const vk::ArrayProxy<const uint32_t>& dynamicOffsets = {});
+
+		[[nodiscard]] vk::CommandBuffer GetCommandBuffer() const { return m_CommandBuffer; }
+
+	private:
+		struct BoundSet
+		{
+			vk::DescriptorSet set{};
+			uint32_t dynamicOffset{};
+			bool hasDynamicOffset{};
+		};
+
+		vk::CommandBuffer m_CommandBuffer;
+		DescriptorStats& m_Stats;
+
+		vk::Pipeline m_Pipeline{};
+		vk::PipelineLayout m_Layout{};
+		BoundSet m_Sets[MAX_SETS]{};
+
+		uint32_t m_Binds{};
+		uint32_t m_SkippedBinds{};
+	};
+}
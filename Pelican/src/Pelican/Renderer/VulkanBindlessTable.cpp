@@ -0,0 +1,291 @@
+﻿#include "PelicanPCH.h"
+#include "VulkanBindlessTable.h"
+
+#include <logtools.h>
+
+#include "VulkanDebug.h"
+#include "VulkanDevice.h"
+#include "VulkanHelpers.h"
+#include "VulkanRenderer.h"
+#include "VulkanTexture.h"
+
+namespace Pelican
+{
+	uint32_t VulkanBindlessTable::SlotList::Acquire()
+	{
+		uint32_t index;
+		if (!freeIndices.empty())
+		{
+			index = freeIndices.back();
+			freeIndices.pop_back();
+		}
+		else if (nextIndex < capacity)
+		{
+			index = nextIndex++;
+		}
+		else
+		{
+			return INVALID_INDEX;
+		}
+
+		usedCount++;
+		return index;
+	}
+
+	void VulkanBindlessTable::SlotList::Release(uint32_t index)
+	{
+		freeIndices.push_back(index);
+		usedCount--;
+	}
+
+	VulkanBindlessTable::VulkanBindlessTable(VulkanDevice* pDevice, uint32_t frameCount)
+		: m_pDevice(pDevice)
+	{
+		// Some devices can't hold as many update-after-bind samplers in a single stage as we'd like.
+		const auto properties = m_pDevice->GetPhysicalDevice().getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceDescriptorIndexingProperties>();
+		const vk::PhysicalDeviceDescriptorIndexingProperties& indexingProperties = properties.get<vk::PhysicalDeviceDescriptorIndexingProperties>();
+		const uint32_t samplerLimit = std::min(indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers, indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages);
+
+		// The cubemaps get their slots first, whatever is left goes to the textures.
+		if (samplerLimit <= MAX_CUBEMAPS)
+		{
+			throw std::runtime_error("The device only supports "s + std::to_string(samplerLimit) +
+				" bindless samplers per stage, the bindless table needs more than " + std::to_string(MAX_CUBEMAPS));
+		}
+
+		m_CubemapSlots.capacity = MAX_CUBEMAPS;
+		m_TextureSlots.capacity = std::min(MAX_TEXTURES, samplerLimit - MAX_CUBEMAPS);
+		if (m_TextureSlots.capacity < MAX_TEXTURES)
+		{
+			Logger::LogWarning("Bindless texture array is limited to %u textures on this device", m_TextureSlots.capacity);
+		}
+
+		m_PendingFrees.resize(frameCount);
+
+		CreateLayout();
+		CreatePool();
+		CreateMaterialBuffer();
+
+		const vk::DescriptorSetAllocateInfo allocInfo = vk::DescriptorSetAllocateInfo()
+			.setDescriptorPool(m_Pool)
+			.setSetLayouts(m_Layout);
+
+		try
+		{
+			m_DescriptorSet = m_pDevice->GetDevice().allocateDescriptorSets(allocInfo)[0];
+		}
+		catch (vk::SystemError& e)
+		{
+			throw std::runtime_error("Failed to allocate the bindless descriptor set: "s + e.what());
+		}
+
+		VkDebugMarker::SetDescriptorSetName(m_pDevice->GetDevice(), m_DescriptorSet, "Bindless Set");
+
+		// The material buffer never moves, so it only has to be written once.
+		const vk::DescriptorBufferInfo materialInfo(m_MaterialBuffer, 0, VK_WHOLE_SIZE);
+		const vk::WriteDescriptorSet materialWrite = vk::WriteDescriptorSet()
+			.setDstSet(m_DescriptorSet)
+			.setDstBinding(MATERIAL_BINDING)
+			.setDstArrayElement(0)
+			.setDescriptorType(vk::DescriptorType::eStorageBuffer)
+			.setBufferInfo(materialInfo);
+
+		m_pDevice->GetDevice().updateDescriptorSets(materialWrite, {});
+		VulkanRenderer::GetDescriptorStats().writes++;
+	}
+
+	VulkanBindlessTable::~VulkanBindlessTable()
+	{
+		// Destroying the pool frees the set as well.
+		m_pDevice->GetDevice().destroyDescriptorPool(m_Pool);
+		m_pDevice->GetDevice().destroyDescriptorSetLayout(m_Layout);
+
+		VulkanHelpers::DestroyBuffer(m_MaterialBuffer, m_MaterialMemory);
+	}
+
+	void VulkanBindlessTable::BeginFrame(uint32_t frameIndex)
+	{
+		std::lock_guard lock(m_Mutex);
+
+		m_FrameIndex = frameIndex;
+
+		PendingFrees& pending = m_PendingFrees[m_FrameIndex];
+		for (uint32_t index : pending.textures)
+		{
+			m_TextureSlots.Release(index);
+		}
+		for (uint32_t index : pending.cubemaps)
+		{
+			m_CubemapSlots.Release(index);
+		}
+		for (const OffsetAllocation& allocation : pending.materials)
+		{
+			m_MaterialCount -= static_cast<uint32_t>(allocation.size);
+			m_MaterialAllocator.Free(allocation);
+		}
+
+		pending.textures.clear();
+		pending.cubemaps.clear();
+		pending.materials.clear();
+	}
+
+	uint32_t VulkanBindlessTable::RegisterTexture(const VulkanTexture& texture)
+	{
+		const bool isCubemap = texture.GetTextureMode() == VulkanTexture::TextureMode::Cubemap;
+
+		// Writes to the same set have to be externally synchronized as well, so this holds the lock until the end.
+		std::lock_guard lock(m_Mutex);
+
+		const uint32_t index = isCubemap ? m_CubemapSlots.Acquire() : m_TextureSlots.Acquire();
+		if (index == INVALID_INDEX)
+		{
+			throw std::runtime_error(isCubemap ? "Bindless cubemap array is full!" : "Bindless texture array is full!");
+		}
+
+		const vk::DescriptorImageInfo imageInfo = texture.GetDescriptorImageInfo();
+		const vk::WriteDescriptorSet write = vk::WriteDescriptorSet()
+			.setDstSet(m_DescriptorSet)
+			.setDstBinding(isCubemap ? CUBEMAP_BINDING : TEXTURE_BINDING)
+			.setDstArrayElement(index)
+			.setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
+			.setImageInfo(imageInfo);
+
+		// Update-after-bind, so this is fine even while command buffers using the set are being recorded or executed,
+		// as long as they don't access this index.
+		m_pDevice->GetDevice().updateDescriptorSets(write, {});
+		VulkanRenderer::GetDescriptorStats().writes++;
+
+		return index;
+	}
+
+	void VulkanBindlessTable::UnregisterTexture(const VulkanTexture& texture, uint32_t index)
+	{
+		if (index == INVALID_INDEX)
+			return;
+
+		std::lock_guard lock(m_Mutex);
+
+		PendingFrees& pending = m_PendingFrees[m_FrameIndex];
+		if (texture.GetTextureMode() == VulkanTexture::TextureMode::Cubemap)
+			pending.cubemaps.push_back(index);
+		else
+			pending.textures.push_back(index);
+	}
+
+	uint32_t VulkanBindlessTable::RegisterMaterials(const std::vector<MaterialData>& materials)
+	{
+		if (materials.empty())
+			return INVALID_INDEX;
+
+		OffsetAllocation allocation;
+		{
+			std::lock_guard lock(m_Mutex);
+
+			allocation = m_MaterialAllocator.Allocate(materials.size());
+			if (!allocation.IsValid())
+			{
+				throw std::runtime_error("Bindless material buffer is full!");
+			}
+
+			m_MaterialAllocations[static_cast<uint32_t>(allocation.offset)] = allocation;
+			m_MaterialCount += static_cast<uint32_t>(materials.size());
+		}
+
+		VulkanRenderer::GetUploader()->UploadBuffer(m_MaterialBuffer, materials.data(),
+			materials.size() * sizeof(MaterialData), allocation.offset * sizeof(MaterialData));
+
+		return static_cast<uint32_t>(allocation.offset);
+	}
+
+	void VulkanBindlessTable::UnregisterMaterials(uint32_t firstIndex)
+	{
+		if (firstIndex == INVALID_INDEX)
+			return;
+
+		std::lock_guard lock(m_Mutex);
+
+		const auto it = m_MaterialAllocations.find(firstIndex);
+		ASSERT_MSG(it != m_MaterialAllocations.end(), "Materials were never registered!");
+
+		m_PendingFrees[m_FrameIndex].materials.push_back(it->second);
+		m_MaterialAllocations.erase(it);
+	}
+
+	void VulkanBindlessTable::CreateLayout()
+	{
+		const std::array<vk::DescriptorSetLayoutBinding, 3> bindings = {
+			vk::DescriptorSetLayoutBinding()
+				.setBinding(TEXTURE_BINDING)
+				.setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
+				.setDescriptorCount(m_TextureSlots.capacity)
+				.setStageFlags(vk::ShaderStageFlagBits::eFragment),
+			vk::DescriptorSetLayoutBinding()
+				.setBinding(CUBEMAP_BINDING)
+				.setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
+				.setDescriptorCount(m_CubemapSlots.capacity)
+				.setStageFlags(vk::ShaderStageFlagBits::eFragment),
+			vk::DescriptorSetLayoutBinding()
+				.setBinding(MATERIAL_BINDING)
+				.setDescriptorType(vk::DescriptorType::eStorageBuffer)
+				.setDescriptorCount(1)
+				.setStageFlags(vk::ShaderStageFlagBits::eFragment),
+		};
+
+		// The arrays are never completely filled, and get written to while the set is bound.
+		constexpr vk::DescriptorBindingFlags arrayFlags = vk::DescriptorBindingFlagBits::ePartiallyBound
+			| vk::DescriptorBindingFlagBits::eUpdateAfterBind
+			| vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending;
+		const std::array<vk::DescriptorBindingFlags, 3> bindingFlags = { arrayFlags, arrayFlags, {} };
+
+		const vk::DescriptorSetLayoutBindingFlagsCreateInfo flagsInfo = vk::DescriptorSetLayoutBindingFlagsCreateInfo()
+			.setBindingFlags(bindingFlags);
+
+		const vk::DescriptorSetLayoutCreateInfo layoutInfo = vk::DescriptorSetLayoutCreateInfo()
+			.setFlags(vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool)
+			.setBindings(bindings)
+			.setPNext(&flagsInfo);
+
+		try
+		{
+			m_Layout = m_pDevice->GetDevice().createDescriptorSetLayout(layoutInfo);
+		}
+		catch (vk::SystemError& e)
+		{
+			throw std::runtime_error("Failed to create the bindless descriptor set layout: "s + e.what());
+		}
+
+		VkDebugMarker::SetDescriptorSetLayoutName(m_pDevice->GetDevice(), m_Layout, "Bindless Layout");
+	}
+
+	void VulkanBindlessTable::CreatePool()
+	{
+		const std::array<vk::DescriptorPoolSize, 2> poolSizes = {
+			vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, m_TextureSlots.capacity + m_CubemapSlots.capacity),
+			vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, 1),
+		};
+
+		const vk::DescriptorPoolCreateInfo poolInfo = vk::DescriptorPoolCreateInfo()
+			.setFlags(vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind)
+			.setMaxSets(1)
+			.setPoolSizes(poolSizes);
+
+		try
+		{
+			m_Pool = m_pDevice->GetDevice().createDescriptorPool(poolInfo);
+		}
+		catch (vk::SystemError& e)
+		{
+			throw std::runtime_error("Failed to create the bindless descriptor pool: "s + e.what());
+		}
+	}
+
+	void VulkanBindlessTable::CreateMaterialBuffer()
+	{
+		VulkanHelpers::CreateBuffer(MAX_MATERIALS * sizeof(MaterialData),
+			vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eStorageBuffer,
+			vk::MemoryPropertyFlagBits::eDeviceLocal,
+			m_MaterialBuffer, m_MaterialMemory);
+
+		VkDebugMarker::SetBufferName(m_pDevice->GetDevice(), m_MaterialBuffer, "Bindless Materials");
+	}
+}
@@ -0,0 +1,108 @@
+﻿#pragma once
+
+#include <mutex>
+#include <unordered_map>
+
+#include <vulkan/vulkan.hpp>
+
+#include "OffsetAllocator.h"
+#include "UniformData.h"
+#include "VulkanAllocator.h"
+
+namespace Pelican
+{
+	class VulkanDevice;
+	class VulkanTexture;
+
+	// One global, update-after-bind descriptor set holding every texture and material that is alive.
+	// Textures register themselves and get an index into the texture or cubemap array, materials get copied into
+	// a storage buffer. Shaders index these with the indices from MaterialData and FrameData, so the set only has to be
+	// bound once per command buffer, no matter how many meshes get drawn.
+	class VulkanBindlessTable final
+	{
+	public:
+		static constexpr uint32_t MAX_TEXTURES = 4096;
+		static constexpr uint32_t MAX_CUBEMAPS = 64;
+		static constexpr uint32_t MAX_MATERIALS = 4096;
+		static constexpr uint32_t INVALID_INDEX = ~0u;
+
+		// Binding slots, these have to match the bindless set in the shaders.
+		static constexpr uint32_t TEXTURE_BINDING = 0;
+		static constexpr uint32_t CUBEMAP_BINDING = 1;
+		static constexpr uint32_t MATERIAL_BINDING = 2;
+
+		VulkanBindlessTable(VulkanDevice* pDevice, uint32_t frameCount);
+		~VulkanBindlessTable();
+
+		VulkanBindlessTable(const VulkanBindlessTable&) = delete;
+		VulkanBindlessTable& operator=(const VulkanBindlessTable&) = delete;
+
+		// Only call this once the fence of the given frame has been waited on,
+		// indices that were released during that frame can be handed out again after this.
+		void BeginFrame(uint32_t frameIndex);
+
+		// Returns the index into the texture array or the cubemap array, depending on the texture's mode.
+		[[nodiscard]] uint32_t RegisterTexture(const VulkanTexture& texture);
+		void UnregisterTexture(const VulkanTexture& texture, uint32_t index);
+
+		// Uploads the materials into consecutive slots of the material buffer, returns the index of the first one.
+		[[nodiscard]] uint32_t RegisterMaterials(const std::vector<MaterialData>& materials);
+		void UnregisterMaterials(uint32_t firstIndex);
+
+		[[nodiscard]] vk::DescriptorSetLayout GetLayout() const { return m_Layout; }
+		[[nodiscard]] vk::DescriptorSet GetDescriptorSet() const { return m_DescriptorSet; }
+
+		[[nodiscard]] uint32_t GetTextureCount() const { return m_TextureSlots.usedCount; }
+		// Can be lower than MAX_TEXTURES, depending on the device limits.
+		[[nodiscard]] uint32_t GetTextureCapacity() const { return m_TextureSlots.capacity; }
+		[[nodiscard]] uint32_t GetCubemapCount() const { return m_CubemapSlots.usedCount; }
+		[[nodiscard]] uint32_t GetMaterialCount() const { return m_MaterialCount; }
+
+	private:
+		struct SlotList
+		{
+			std::vector<uint32_t> freeIndices{};
+			uint32_t nextIndex{};
+			uint32_t capacity{};
+			uint32_t usedCount{};
+
+			[[nodiscard]] uint32_t Acquire();
+			void Release(uint32_t index);
+		};
+
+		struct PendingFrees
+		{
+			std::vector<uint32_t> textures{};
+			std::vector<uint32_t> cubemaps{};
+			std::vector<OffsetAllocation> materials{};
+		};
+
+		void CreateLayout();
+		void CreatePool();
+		void CreateMaterialBuffer();
+
+	private:
+		VulkanDevice* m_pDevice{};
+
+		vk::DescriptorSetLayout m_Layout{};
+		vk::DescriptorPool m_Pool{};
+		vk::DescriptorSet m_DescriptorSet{};
+
+		vk::Buffer m_MaterialBuffer{};
+		VulkanAllocation m_MaterialMemory{};
+		TlsfAllocator m_MaterialAllocator{ MAX_MATERIALS };
+		// Material allocations by their first index, needed to free them again.
+		std::unordered_map<uint32_t, OffsetAllocation> m_MaterialAllocations{};
+		uint32_t m_MaterialCount{};
+
+		SlotList m_TextureSlots{};
+		SlotList m_CubemapSlots{};
+
+		// Released indices can still be in use by frames in flight, they only get reused once that frame has finished.
+		std::vector<PendingFrees> m_PendingFrees{};
+		uint32_t m_FrameIndex{};
+
+		// Textures can get created and destroyed from any thread.
+		std::mutex m_Mutex{};
+	};
+}
@@ -0,0 +1,228 @@
+﻿#include "PelicanPCH.h"
+#include "VulkanCullingPass.h"
+
+#include <logtools.h>
+
+#include "Frustum.h"
+#include "UniformData.h"
+#include "VulkanDebug.h"
+#include "VulkanDescriptorAllocator.h"
+#include "VulkanDevice.h"
+#include "VulkanGeometryArena.h"
+#include "VulkanHelpers.h"
+#include "VulkanRenderer.h"
+#include "VulkanShader.h"
+#include "VulkanUniformRing.h"
+
+namespace Pelican
+{
+	// Has to match GROUP_SIZE in cull.comp.
+	static constexpr uint32_t CULL_GROUP_SIZE = 256;
+	// One count per part, also has to match cull.comp.
+	static constexpr vk::DeviceSize COUNT_BUFFER_SIZE = VulkanCullingPass::MAX_PARTS * sizeof(uint32_t);
+
+	VulkanCullingPass::VulkanCullingPass(VulkanDevice* pDevice, VulkanUniformRing* pUniformRing, uint32_t frameCount, uint32_t maxDraws)
+		: m_pDevice(pDevice)
+		, m_pUniformRing(pUniformRing)
+		, m_MaxDraws(maxDraws)
+	{
+		m_Compact = m_pDevice->GetEnabledFeatures12().drawIndirectCount && m_pDevice->GetEnabledFeatures().multiDrawIndirect;
+		if (m_Compact)
+		{
+			// The count read from the buffer can't go over this.
+			m_MaxDraws = std::min(m_MaxDraws, m_pDevice->GetPhysicalDevice().getProperties().limits.maxDrawIndirectCount);
+		}
+
+		Logger::LogDebug("GPU culling %s, up to %u draws", m_Compact ? "compacts its draws" : "keeps culled draws in place", m_MaxDraws);
+
+		CreateSetLayout();
+		CreateFrames(frameCount);
+	}
+
+	VulkanCullingPass::~VulkanCullingPass()
+	{
+		for (Frame& frame : m_Frames)
+		{
+			VulkanHelpers::DestroyBuffer(frame.countBuffer, frame.countMemory);
+			VulkanHelpers::DestroyBuffer(frame.commandBuffer, frame.commandMemory);
+		}
+
+		m_pDevice->GetDevice().destroyDescriptorSetLayout(m_SetLayout);
+	}
+
+	void VulkanCullingPass::CreatePipeline(VulkanPipelineCache* pCache)
+	{
+		VulkanShader shader;
+		shader.AddShader(ShaderType::Compute, "res/shaders/cull.spv");
+
+		const vk::PushConstantRange pushConstants = vk::PushConstantRange()
+			.setStageFlags(vk::ShaderStageFlagBits::eCompute)
+			.setOffset(0)
+			.setSize(sizeof(CullPushConst));
+
+		PipelineBuilder builder{ m_pDevice->GetDevice(), pCache };
+		builder.SetShader(&shader);
+		builder.SetDescriptorSetLayout(1, &m_SetLayout, 1, &pushConstants);
+		m_Pipeline = builder.BuildCompute();
+	}
+
+	void VulkanCullingPass::BeginFrame(uint32_t frameIndex)
+	{
+		m_FrameIndex = frameIndex;
+
+		Frame& frame = m_Frames[m_FrameIndex];
+		if (frame.drawCount > 0)
+		{
+			const uint32_t* pCounts = static_cast<const uint32_t*>(frame.countMemory.pMapped);
+			m_VisibleCount = 0;
+			for (uint32_t part = 0; part < MAX_PARTS; part++)
+			{
+				m_VisibleCount += pCounts[part];
+			}
+			m_CulledCount = frame.drawCount - m_VisibleCount;
+		}
+		frame.drawCount = 0;
+	}
+
+	void VulkanCullingPass::Record(vk::CommandBuffer cmd, const Frustum& frustum, uint32_t firstCommand, uint32_t drawCount, const PartSplits& splits)
+	{
+		ASSERT_MSG(drawCount <= m_MaxDraws, "Too many draws for the culling pass!");
+
+		Frame& frame = m_Frames[m_FrameIndex];
+		frame.drawCount = drawCount;
+		// Parts can be empty, but they can't start before the one in front of them.
+		uint32_t previousSplit = 0;
+		for (uint32_t i = 0; i < static_cast<uint32_t>(splits.size()); i++)
+		{
+			frame.splits[i] = std::clamp(splits[i], previousSplit, drawCount);
+			previousSplit = frame.splits[i];
+		}
+
+		VulkanRenderer::GetGpuProfiler()->BeginRegion(cmd, "GPU Culling", glm::vec4(0.2f, 0.8f, 0.2f, 1.0f));
+
+		cmd.fillBuffer(frame.countBuffer, 0, COUNT_BUFFER_SIZE, 0);
+
+		const vk::MemoryBarrier clearBarrier = vk::MemoryBarrier()
+			.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+			.setDstAccessMask(vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+		cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader, {}, clearBarrier, {}, {});
+
+		CullPushConst pushConst{};
+		for (uint32_t i = 0; i < Frustum::PLANE_COUNT; i++)
+		{
+			pushConst.frustumPlanes[i] = frustum.planes[i];
+		}
+		pushConst.firstCommand = firstCommand;
+		pushConst.drawCount = drawCount;
+		pushConst.compact = m_Compact ? 1 : 0;
+		pushConst.splitCommands[0] = frame.splits[0];
+		pushConst.splitCommands[1] = frame.splits[1];
+
+		cmd.bindPipeline(vk::PipelineBindPoint::eCompute, m_Pipeline.GetPipeline());
+		cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_Pipeline.GetLayout(), 0, AllocateDescriptorSet(m_FrameIndex), {});
+		cmd.pushConstants(m_Pipeline.GetLayout(), vk::ShaderStageFlagBits::eCompute, 0, sizeof(CullPushConst), &pushConst);
+		// Compaction keeps the order with a prefix sum over all commands, so it runs in a single workgroup.
+		cmd.dispatch(m_Compact ? 1 : (drawCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+		// The draws read the commands and the count, the host reads the count back once the frame is done.
+		const vk::MemoryBarrier cullBarrier = vk::MemoryBarrier()
+			.setSrcAccessMask(vk::AccessFlagBits::eShaderWrite)
+			.setDstAccessMask(vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eHostRead);
+		cmd.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eHost,
+			{}, cullBarrier, {}, {});
+
+		VulkanRenderer::GetGpuProfiler()->EndRegion(cmd);
+	}
+
+	uint32_t VulkanCullingPass::Draw(vk::CommandBuffer cmd, const VulkanGeometryArena* pGeometryArena, uint32_t part) const
+	{
+		ASSERT_MSG(part < MAX_PARTS, "Invalid culling part!");
+
+		const Frame& frame = m_Frames[m_FrameIndex];
+		const uint32_t firstDraw = part == 0 ? 0 : frame.splits[part - 1];
+		const uint32_t endDraw = part + 1 < MAX_PARTS ? frame.splits[part] : frame.drawCount;
+		const uint32_t drawCount = endDraw - firstDraw;
+		if (drawCount == 0)
+			return 0;
+
+		const vk::DeviceSize offset = static_cast<vk::DeviceSize>(firstDraw) * sizeof(vk::DrawIndexedIndirectCommand);
+		if (m_Compact)
+		{
+			const vk::DeviceSize countOffset = static_cast<vk::DeviceSize>(part) * sizeof(uint32_t);
+			return pGeometryArena->DrawIndirectCount(cmd, frame.commandBuffer, offset, frame.countBuffer, countOffset, drawCount);
+		}
+
+		return pGeometryArena->DrawIndirect(cmd, frame.commandBuffer, offset, drawCount);
+	}
+
+	void VulkanCullingPass::CreateSetLayout()
+	{
+		const std::array<vk::DescriptorSetLayoutBinding, 5> bindings = {
+			// Objects, draws and input commands, all in the uniform ring.
+			vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute),
+			vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute),
+			vk::DescriptorSetLayoutBinding(2, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute),
+			// Output commands and their count.
+			vk::DescriptorSetLayoutBinding(3, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute),
+			vk::DescriptorSetLayoutBinding(4, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute),
+		};
+
+		const auto layoutInfo = vk::DescriptorSetLayoutCreateInfo()
+			.setBindings(bindings);
+
+		try
+		{
+			m_SetLayout = m_pDevice->GetDevice().createDescriptorSetLayout(layoutInfo);
+		}
+		catch (vk::SystemError& e)
+		{
+			throw std::runtime_error("Failed to create culling descriptor set layout: "s + e.what());
+		}
+	}
+
+	void VulkanCullingPass::CreateFrames(uint32_t frameCount)
+	{
+		m_Frames.resize(frameCount);
+
+		for (Frame& frame : m_Frames)
+		{
+			VulkanHelpers::CreateBuffer(static_cast<vk::DeviceSize>(m_MaxDraws) * sizeof(vk::DrawIndexedIndirectCommand),
+				vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer,
+				vk::MemoryPropertyFlagBits::eDeviceLocal,
+				frame.commandBuffer, frame.commandMemory);
+
+			VulkanHelpers::CreateBuffer(COUNT_BUFFER_SIZE,
+				vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eTransferDst,
+				vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+				frame.countBuffer, frame.countMemory);
+
+			VkDebugMarker::SetBufferName(m_pDevice->GetDevice(), frame.commandBuffer, "Culled Draw Commands");
+			VkDebugMarker::SetBufferName(m_pDevice->GetDevice(), frame.countBuffer, "Culled Draw Count");
+		}
+	}
+
+	vk::DescriptorSet VulkanCullingPass::AllocateDescriptorSet(uint32_t frameIndex) const
+	{
+		// Frame allocators get reset once the frame's fence has been waited on, so the set doesn't have to be freed.
+		const Frame& frame = m_Frames[frameIndex];
+		const vk::DescriptorSet set = VulkanRenderer::GetFrameDescriptorAllocator()->Allocate(m_SetLayout);
+
+		const vk::DescriptorBufferInfo ringInfo(m_pUniformRing->GetBuffer(), 0, VK_WHOLE_SIZE);
+		const vk::DescriptorBufferInfo commandInfo(frame.commandBuffer, 0, VK_WHOLE_SIZE);
+		const vk::DescriptorBufferInfo countInfo(frame.countBuffer, 0, VK_WHOLE_SIZE);
+
+		std::array<vk::WriteDescriptorSet, 5> writes{};
+		for (uint32_t i = 0; i < static_cast<uint32_t>(writes.size()); i++)
+		{
+			writes[i]
+				.setDstSet(set)
+				.setDstBinding(i)
+				.setDescriptorType(vk::DescriptorType::eStorageBuffer)
+				.setBufferInfo(i < 3 ? ringInfo : i == 3 ? commandInfo : countInfo);
+		}
+
+		m_pDevice->GetDevice().updateDescriptorSets(writes, {});
+		VulkanRenderer::GetDescriptorStats().writes++;
+		return set;
+	}
+}
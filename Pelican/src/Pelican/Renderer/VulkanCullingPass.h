@@ -0,0 +1,96 @@
+﻿#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include "VulkanAllocator.h"
+#include "VulkanPipeline.h"
+
+namespace Pelican
+{
+	class VulkanDevice;
+	class VulkanGeometryArena;
+	class VulkanPipelineCache;
+	class VulkanUniformRing;
+	struct Frustum;
+
+	// Frustum culling on the GPU. A compute shader tests the bounding sphere of every indirect draw in the uniform ring
+	// against the camera frustum and writes the visible draws into a buffer of its own, along with their count.
+	// The CPU never sees which draws are visible, the count only gets read back once the frame has finished for stats.
+	//
+	// With drawIndirectCount (and multiDrawIndirect) the visible draws are compacted and drawn with a single
+	// drawIndexedIndirectCount. Without it, every draw is kept in place and culled ones get an instance count of 0.
+	// Either way the draws keep the order they have in the ring, so a sorted list stays sorted.
+	class VulkanCullingPass final
+	{
+	public:
+		// The culled commands can be split into parts, which get drawn separately, e.g. with different pipelines.
+		static constexpr uint32_t MAX_PARTS = 3;
+		// Index of the first command of every part but the first one.
+		using PartSplits = std::array<uint32_t, MAX_PARTS - 1>;
+
+		VulkanCullingPass(VulkanDevice* pDevice, VulkanUniformRing* pUniformRing, uint32_t frameCount, uint32_t maxDraws = 64 * 1024);
+		~VulkanCullingPass();
+
+		VulkanCullingPass(const VulkanCullingPass&) = delete;
+		VulkanCullingPass& operator=(const VulkanCullingPass&) = delete;
+
+		// Has to be called again after the pipeline cache destroyed its pipelines.
+		void CreatePipeline(VulkanPipelineCache* pCache);
+
+		// Only call this once the fence of the given frame has been waited on, reads back how many draws that frame kept.
+		void BeginFrame(uint32_t frameIndex);
+
+		// Culls drawCount commands, starting at element firstCommand of the uniform ring. Part i + 1 starts at splits[i],
+		// by default everything is in the first part.
+		// Has to be recorded outside of a render pass, before the draws that use the result. The descriptor set comes from
+		// the frame's descriptor allocator, so it's only valid for the current frame.
+		void Record(vk::CommandBuffer cmd, const Frustum& frustum, uint32_t firstCommand, uint32_t drawCount, const PartSplits& splits = { ~0u, ~0u });
+		// Draws whatever the last Record of this frame kept of the part, the geometry arena has to be bound already.
+		// Returns the number of draw calls that were recorded.
+		uint32_t Draw(vk::CommandBuffer cmd, const VulkanGeometryArena* pGeometryArena, uint32_t part = 0) const;
+
+		void SetEnabled(bool enabled) { m_Enabled = enabled; }
+		[[nodiscard]] bool IsEnabled() const { return m_Enabled; }
+		[[nodiscard]] bool IsCompacting() const { return m_Compact; }
+		[[nodiscard]] uint32_t GetMaxDraws() const { return m_MaxDraws; }
+		// Of the last frame that finished on the GPU.
+		[[nodiscard]] uint32_t GetVisibleCount() const { return m_VisibleCount; }
+		[[nodiscard]] uint32_t GetCulledCount() const { return m_CulledCount; }
+
+	private:
+		void CreateSetLayout();
+		void CreateFrames(uint32_t frameCount);
+		// Allocates a set from the frame's descriptor allocator and points it at the buffers of the given frame.
+		[[nodiscard]] vk::DescriptorSet AllocateDescriptorSet(uint32_t frameIndex) const;
+
+	private:
+		struct Frame
+		{
+			vk::Buffer commandBuffer{};
+			VulkanAllocation commandMemory{};
+			// One count per part, host visible so they can be read back for stats.
+			vk::Buffer countBuffer{};
+			VulkanAllocation countMemory{};
+			// Draws culled by the last Record, 0 when nothing was recorded.
+			uint32_t drawCount{};
+			PartSplits splits{};
+		};
+
+		VulkanDevice* m_pDevice{};
+		VulkanUniformRing* m_pUniformRing{};
+
+		vk::DescriptorSetLayout m_SetLayout{};
+		// Owned by the pipeline cache.
+		VulkanPipeline m_Pipeline{};
+
+		std::vector<Frame> m_Frames{};
+		uint32_t m_FrameIndex{};
+
+		uint32_t m_MaxDraws{};
+		bool m_Compact{};
+		bool m_Enabled{ true };
+
+		uint32_t m_VisibleCount{};
+		uint32_t m_CulledCount{};
+	};
+}
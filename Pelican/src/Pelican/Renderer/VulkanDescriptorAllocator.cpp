@@ -0,0 +1,135 @@
+﻿#include "PelicanPCH.h"
+#include "VulkanDescriptorAllocator.h"
+
+#include <logtools.h>
+
+namespace Pelican
+{
+	VulkanDescriptorAllocator::VulkanDescriptorAllocator(vk::Device device, std::vector<PoolSizeRatio> ratios, uint32_t initialSetsPerPool)
+		: m_Device(device), m_Ratios(std::move(ratios)), m_SetsPerPool(initialSetsPerPool)
+	{
+	}
+
+	VulkanDescriptorAllocator::~VulkanDescriptorAllocator()
+	{
+		for (vk::DescriptorPool pool : m_UsedPools)
+		{
+			m_Device.destroyDescriptorPool(pool);
+		}
+		for (vk::DescriptorPool pool : m_FreePools)
+		{
+			m_Device.destroyDescriptorPool(pool);
+		}
+	}
+
+	vk::DescriptorSet VulkanDescriptorAllocator::Allocate(vk::DescriptorSetLayout layout)
+	{
+		std::lock_guard lock(m_Mutex);
+
+		if (!m_CurrentPool)
+		{
+			m_CurrentPool = GrabPool();
+		}
+
+		vk::DescriptorSetAllocateInfo allocInfo = vk::DescriptorSetAllocateInfo()
+			.setDescriptorPool(m_CurrentPool)
+			.setSetLayouts(layout);
+
+		// At most one retry, a fresh pool is always big enough for a single set of a layout that fits the ratios.
+		for (int attempt = 0; attempt < 2; attempt++)
+		{
+			try
+			{
+				const vk::DescriptorSet set = m_Device.allocateDescriptorSets(allocInfo)[0];
+				m_AllocatedSets++;
+				return set;
+			}
+			catch (vk::OutOfPoolMemoryError&)
+			{
+			}
+			catch (vk::FragmentedPoolError&)
+			{
+			}
+			catch (vk::SystemError& e)
+			{
+				throw std::runtime_error("Failed to allocate descriptor set: "s + e.what());
+			}
+
+			m_CurrentPool = GrabPool();
+			allocInfo.setDescriptorPool(m_CurrentPool);
+		}
+
+		throw std::runtime_error("Failed to allocate descriptor set: the layout doesn't fit in an empty pool, check the pool ratios!");
+	}
+
+	void VulkanDescriptorAllocator::Reset()
+	{
+		std::lock_guard lock(m_Mutex);
+
+		for (vk::DescriptorPool pool : m_UsedPools)
+		{
+			m_Device.resetDescriptorPool(pool);
+			m_FreePools.push_back(pool);
+		}
+
+		m_UsedPools.clear();
+		m_CurrentPool = nullptr;
+		m_AllocatedSets = 0;
+	}
+
+	uint32_t VulkanDescriptorAllocator::GetPoolCount() const
+	{
+		std::lock_guard lock(m_Mutex);
+		return static_cast<uint32_t>(m_UsedPools.size() + m_FreePools.size());
+	}
+
+	uint32_t VulkanDescriptorAllocator::GetAllocatedSetCount() const
+	{
+		std::lock_guard lock(m_Mutex);
+		return m_AllocatedSets;
+	}
+
+	vk::DescriptorPool VulkanDescriptorAllocator::GrabPool()
+	{
+		vk::DescriptorPool pool;
+		if (!m_FreePools.empty())
+		{
+			pool = m_FreePools.back();
+			m_FreePools.pop_back();
+		}
+		else
+		{
+			pool = CreatePool(m_SetsPerPool);
+
+			// Every new pool is bigger than the last one, so a growing workload doesn't keep hitting full pools.
+			m_SetsPerPool = std::min(m_SetsPerPool + m_SetsPerPool / 2, MAX_SETS_PER_POOL);
+		}
+
+		m_UsedPools.push_back(pool);
+		return pool;
+	}
+
+	vk::DescriptorPool VulkanDescriptorAllocator::CreatePool(uint32_t setCount) const
+	{
+		std::vector<vk::DescriptorPoolSize> poolSizes;
+		poolSizes.reserve(m_Ratios.size());
+		for (const PoolSizeRatio& ratio : m_Ratios)
+		{
+			poolSizes.emplace_back(ratio.type, std::max(1u, static_cast<uint32_t>(ratio.ratio * static_cast<float>(setCount))));
+		}
+
+		const vk::DescriptorPoolCreateInfo poolInfo = vk::DescriptorPoolCreateInfo()
+			.setMaxSets(setCount)
+			.setPoolSizes(poolSizes);
+
+		try
+		{
+			Logger::LogTrace("Creating descriptor pool for %u sets", setCount);
+			return m_Device.createDescriptorPool(poolInfo);
+		}
+		catch (vk::SystemError& e)
+		{
+			throw std::runtime_error("Failed to create descriptor pool: "s + e.what());
+		}
+	}
+}
@@ -0,0 +1,56 @@
+﻿#pragma once
+
+#include <mutex>
+
+#include <vulkan/vulkan.hpp>
+
+namespace Pelican
+{
+	// Allocates descriptor sets from a list of pools that grows on demand, instead of every user creating a pool of its own.
+	// Pools are sized from per-type ratios, so a pool with room for N sets can hold ratio * N descriptors of each type.
+	// When a pool runs out (eErrorOutOfPoolMemory / eErrorFragmentedPool) a new, bigger one is taken and the allocation retried.
+	// Reset() gives all sets back at once and keeps the pools around, so they get reused by the next allocations.
+	class VulkanDescriptorAllocator final
+	{
+	public:
+		struct PoolSizeRatio
+		{
+			vk::DescriptorType type;
+			float ratio;
+		};
+
+		VulkanDescriptorAllocator(vk::Device device, std::vector<PoolSizeRatio> ratios, uint32_t initialSetsPerPool = 64);
+		~VulkanDescriptorAllocator();
+
+		VulkanDescriptorAllocator(const VulkanDescriptorAllocator&) = delete;
+		VulkanDescriptorAllocator& operator=(const VulkanDescriptorAllocator&) = delete;
+
+		// Safe to call from multiple threads at once.
+		[[nodiscard]] vk::DescriptorSet Allocate(vk::DescriptorSetLayout layout);
+
+		// Frees every set allocated from this allocator in bulk, the sets can't be in use by the GPU anymore.
+		void Reset();
+
+		[[nodiscard]] uint32_t GetPoolCount() const;
+		[[nodiscard]] uint32_t GetAllocatedSetCount() const;
+
+	private:
+		// Takes a pool from the free list, or creates a new one if there is none.
+		vk::DescriptorPool GrabPool();
+		vk::DescriptorPool CreatePool(uint32_t setCount) const;
+
+	private:
+		static constexpr uint32_t MAX_SETS_PER_POOL = 4096;
+
+		vk::Device m_Device;
+		std::vector<PoolSizeRatio> m_Ratios;
+		uint32_t m_SetsPerPool;
+
+		vk::DescriptorPool m_CurrentPool{};
+		std::vector<vk::DescriptorPool> m_UsedPools{};
+		std::vector<vk::DescriptorPool> m_FreePools{};
+		uint32_t m_AllocatedSets{};
+
+		mutable std::mutex m_Mutex{};
+	};
+}
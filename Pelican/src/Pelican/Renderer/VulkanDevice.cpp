@@ -2,6 +2,7 @@
 #include "VulkanDevice.h"
 
 #include <GLFW/glfw3.h>
+#include <logtools.h>
 
 #include "Pelican/Core/Application.h"
 #include "VkInit.h"
@@ -9,17 +10,30 @@
 
 namespace Pelican
 {
-	VulkanDevice::VulkanDevice(vk::Instance instance)
-		: m_Instance(instance)
+	VulkanDevice::VulkanDevice(vk::Instance instance, bool headless)
+		: m_Instance(instance), m_Headless(headless), m_Extensions(g_DeviceExtensions)
 	{
-		CreateSurface();
+		if (m_Headless)
+		{
+			// Nothing gets presented, so we don't need the swap chain extension either.
+			m_Extensions.erase(std::remove(m_Extensions.begin(), m_Extensions.end(),
+				std::string_view(VK_KHR_SWAPCHAIN_EXTENSION_NAME)), m_Extensions.end());
+		}
+		else
+		{
+			CreateSurface();
+		}
+
 		PickPhysicalDevice();
 		CreateLogicalDevice();
 	}
 
 	VulkanDevice::~VulkanDevice()
 	{
-		vkDestroySurfaceKHR(m_Instance, m_Surface, nullptr);
+		if (m_Surface)
+		{
+			vkDestroySurfaceKHR(m_Instance, m_Surface, nullptr);
+		}
 	}
 
 	void VulkanDevice::WaitIdle()
@@ -50,26 +64,32 @@ namespace Pelican
 		int i = 0;
 		for (const auto& queueFamily : queueFamilies)
 		{
-			if (queueFamily.queueFlags & vk::QueueFlagBits::eGraphics)
+			if ((queueFamily.queueFlags & vk::QueueFlagBits::eGraphics) && !indices.graphicsFamily.has_value())
 			{
 				indices.graphicsFamily = i;
 			}
 
-			vk::Bool32 presentSupport = false;
-			const vk::Result result = physicalDevice.getSurfaceSupportKHR(i, m_Surface, &presentSupport);
-			if (result != vk::Result::eSuccess)
-			{
-				throw std::runtime_error("Failed to get physical device surface support!");
-			}
-
-			if (presentSupport)
+			// Prefer a pure transfer family over an async compute one.
+			if ((queueFamily.queueFlags & vk::QueueFlagBits::eTransfer) && !(queueFamily.queueFlags & vk::QueueFlagBits::eGraphics) &&
+				(!indices.transferFamily.has_value() || !(queueFamily.queueFlags & vk::QueueFlagBits::eCompute)))
 			{
-				indices.presentFamily = i;
+				indices.transferFamily = i;
 			}
 
-			if (indices.IsComplete())
+			if (m_Surface)
 			{
-				break;
+				vk::Bool32 presentSupport = false;
+				const vk::Result result = physicalDevice.getSurfaceSupportKHR(i, m_Surface, &presentSupport);
+				if (result != vk::Result::eSuccess)
+				{
+					throw std::runtime_error("Failed to get physical device surface support!");
+				}
+
+				// Presenting from the graphics family saves us from having to synchronize between two queues.
+				if (presentSupport && (!indices.presentFamily.has_value() || indices.graphicsFamily == static_cast<uint32_t>(i)))
+				{
+					indices.presentFamily = i;
+				}
 			}
 
 			i++;
@@ -94,12 +114,19 @@ namespace Pelican
 			throw std::runtime_error("Failed to find GPUs with Vulkan support!");
 		}
 
+		// Pick the highest rated suitable device, so we still run on integrated or software
+		// implementations (CI machines, laptops) when there's no discrete GPU available.
+		uint32_t bestScore = 0;
 		for (const vk::PhysicalDevice& device : devices)
 		{
-			if (IsDeviceSuitable(device))
+			if (!IsDeviceSuitable(device))
+				continue;
+
+			const uint32_t score = RateDevice(device);
+			if (score > bestScore)
 			{
+				bestScore = score;
 				m_PhysicalDevice = device;
-				break;
 			}
 		}
 
@@ -107,36 +134,77 @@ namespace Pelican
 		{
 			throw std::runtime_error("Failed to find a suitable GPU!");
 		}
+
+		const vk::PhysicalDeviceProperties properties = m_PhysicalDevice.getProperties();
+		Logger::LogInfo("Using GPU: %s (%s)", &properties.deviceName[0], vk::to_string(properties.deviceType).c_str());
 	}
 
 	void VulkanDevice::CreateLogicalDevice()
 	{
 		QueueFamilyIndices indices = FindQueueFamilies(m_PhysicalDevice);
+
+		m_GraphicsQueueFamily = indices.graphicsFamily.value();
+		m_TransferQueueFamily = indices.transferFamily.value_or(m_GraphicsQueueFamily);
+
+		std::set<uint32_t> uniqueQueueFamilies = { m_GraphicsQueueFamily, m_TransferQueueFamily };
+		if (indices.presentFamily.has_value())
+		{
+			uniqueQueueFamilies.insert(indices.presentFamily.value());
+		}
+
 		float queuePriority = 1.0f;
-		vk::DeviceQueueCreateInfo queueCreateInfo = vk::DeviceQueueCreateInfo(
-			{},
-			indices.graphicsFamily.value(),
-			1,
-			&queuePriority
-		);
+		std::vector<vk::DeviceQueueCreateInfo> queueCreateInfos;
+		for (uint32_t queueFamily : uniqueQueueFamilies)
+		{
+			queueCreateInfos.emplace_back(vk::DeviceQueueCreateInfo({}, queueFamily, 1, &queuePriority));
+		}
 
-		vk::PhysicalDeviceFeatures deviceFeatures = vk::PhysicalDeviceFeatures();
-		deviceFeatures.samplerAnisotropy = true;
-		deviceFeatures.fillModeNonSolid = true;
+		// Only enable the optional features the device actually supports.
+		const vk::PhysicalDeviceFeatures supportedFeatures = m_PhysicalDevice.getFeatures();
+		m_EnabledFeatures = vk::PhysicalDeviceFeatures();
+		m_EnabledFeatures.samplerAnisotropy = supportedFeatures.samplerAnisotropy;
+		m_EnabledFeatures.fillModeNonSolid = supportedFeatures.fillModeNonSolid;
+		// KTX2 textures get decoded on the CPU without it, see VulkanTexture.
+		m_EnabledFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+		// Without it every indirect draw gets its own call, see VulkanGeometryArena.
+		m_EnabledFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+		// Required, checked in IsDeviceSuitable. The shaders find their per-draw data through the instance index.
+		m_EnabledFeatures.drawIndirectFirstInstance = true;
+
+		// Vulkan 1.2 features can only be chained when the device actually supports 1.2.
+		const bool supportsVulkan12 = m_PhysicalDevice.getProperties().apiVersion >= VK_API_VERSION_1_2;
+		if (supportsVulkan12)
+		{
+			const auto supportedChain = m_PhysicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features>();
+			const vk::PhysicalDeviceVulkan12Features& supported12 = supportedChain.get<vk::PhysicalDeviceVulkan12Features>();
+
+			m_EnabledFeatures12 = vk::PhysicalDeviceVulkan12Features();
+			m_EnabledFeatures12.timelineSemaphore = supported12.timelineSemaphore;
+			// Lets the culling pass compact its draws, see VulkanCullingPass.
+			m_EnabledFeatures12.drawIndirectCount = supported12.drawIndirectCount;
+
+			// Required, checked in IsDeviceSuitable.
+			m_EnabledFeatures12.descriptorIndexing = true;
+			m_EnabledFeatures12.runtimeDescriptorArray = true;
+			m_EnabledFeatures12.shaderSampledImageArrayNonUniformIndexing = true;
+			m_EnabledFeatures12.descriptorBindingPartiallyBound = true;
+			m_EnabledFeatures12.descriptorBindingSampledImageUpdateAfterBind = true;
+			m_EnabledFeatures12.descriptorBindingUpdateUnusedWhilePending = true;
+		}
 
 		if (PELICAN_VALIDATE)
 		{
-			g_DeviceExtensions.push_back(VK_EXT_DEBUG_MARKER_EXTENSION_NAME);
+			m_Extensions.push_back(VK_EXT_DEBUG_MARKER_EXTENSION_NAME);
 		}
 
 		const vk::DeviceCreateInfo createInfo = vk::DeviceCreateInfo(
 			{},
-			1, &queueCreateInfo,
+			static_cast<uint32_t>(queueCreateInfos.size()), queueCreateInfos.data(),
 			0, nullptr,
-			static_cast<uint32_t>(g_DeviceExtensions.size()),
-			g_DeviceExtensions.data(),
-			&deviceFeatures
-		);
+			static_cast<uint32_t>(m_Extensions.size()),
+			m_Extensions.data(),
+			&m_EnabledFeatures
+		).setPNext(supportsVulkan12 ? &m_EnabledFeatures12 : nullptr);
 
 		try
 		{
@@ -147,33 +215,77 @@ namespace Pelican
 			throw std::runtime_error("Failed to create logical device: "s + e.what());
 		}
 
-		m_GraphicsQueue = m_Device->getQueue(indices.graphicsFamily.value(), 0);
-		m_PresentQueue = m_Device->getQueue(indices.presentFamily.value(), 0);
+		m_GraphicsQueue = m_Device->getQueue(m_GraphicsQueueFamily, 0);
+		m_TransferQueue = m_Device->getQueue(m_TransferQueueFamily, 0);
+
+		m_ResourceQueueFamilies = { m_GraphicsQueueFamily };
+		if (HasDedicatedTransferQueue())
+		{
+			m_ResourceQueueFamilies.push_back(m_TransferQueueFamily);
+			Logger::LogInfo("Using dedicated transfer queue family %u", m_TransferQueueFamily);
+		}
+		if (indices.presentFamily.has_value())
+		{
+			m_PresentQueue = m_Device->getQueue(indices.presentFamily.value(), 0);
+		}
 	}
 
 	bool VulkanDevice::IsDeviceSuitable(vk::PhysicalDevice device) const
 	{
-		vk::PhysicalDeviceProperties deviceProperties;
-		vk::PhysicalDeviceFeatures deviceFeatures;
-		device.getProperties(&deviceProperties);
-		device.getFeatures(&deviceFeatures);
-		
 		QueueFamilyIndices indices = FindQueueFamilies(device);
 
-		bool extensionsSupported = VulkanHelpers::CheckDeviceExtensionSupport(device);
+		bool extensionsSupported = VulkanHelpers::CheckDeviceExtensionSupport(device, m_Extensions);
 
-		bool swapChainAdequate = false;
-		if (extensionsSupported)
+		// Without a surface there is no swap chain to check.
+		bool swapChainAdequate = m_Headless;
+		if (extensionsSupported && !m_Headless)
 		{
 			SwapChainSupportDetails swapChainSupport = VulkanHelpers::QuerySwapChainSupport(device, m_Surface);
 			swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
 		}
 
-		vk::PhysicalDeviceFeatures supportedFeatures;
-		device.getFeatures(&supportedFeatures);
+		return indices.IsComplete(m_Headless) && extensionsSupported && swapChainAdequate && SupportsDescriptorIndexing(device) &&
+			device.getFeatures().drawIndirectFirstInstance;
+	}
+
+	bool VulkanDevice::SupportsDescriptorIndexing(vk::PhysicalDevice device)
+	{
+		if (device.getProperties().apiVersion < VK_API_VERSION_1_2)
+			return false;
+
+		const auto features = device.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features>();
+		const vk::PhysicalDeviceVulkan12Features& features12 = features.get<vk::PhysicalDeviceVulkan12Features>();
+
+		return features12.descriptorIndexing &&
+			features12.runtimeDescriptorArray &&
+			features12.shaderSampledImageArrayNonUniformIndexing &&
+			features12.descriptorBindingPartiallyBound &&
+			features12.descriptorBindingSampledImageUpdateAfterBind &&
+			features12.descriptorBindingUpdateUnusedWhilePending;
+	}
+
+	uint32_t VulkanDevice::RateDevice(vk::PhysicalDevice device) const
+	{
+		vk::PhysicalDeviceProperties deviceProperties;
+		vk::PhysicalDeviceFeatures deviceFeatures;
+		device.getProperties(&deviceProperties);
+		device.getFeatures(&deviceFeatures);
+
+		uint32_t score = 1;
+		switch (deviceProperties.deviceType)
+		{
+		case vk::PhysicalDeviceType::eDiscreteGpu:   score += 1000; break;
+		case vk::PhysicalDeviceType::eIntegratedGpu: score += 500; break;
+		case vk::PhysicalDeviceType::eVirtualGpu:    score += 250; break;
+		case vk::PhysicalDeviceType::eCpu:           score += 100; break;
+		default: break;
+		}
+
+		if (deviceFeatures.samplerAnisotropy)
+			score += 10;
+		if (deviceFeatures.fillModeNonSolid)
+			score += 10;
 
-		return deviceProperties.deviceType == vk::PhysicalDeviceType::eDiscreteGpu &&
-			indices.IsComplete() && extensionsSupported && swapChainAdequate &&
-			supportedFeatures.samplerAnisotropy;
+		return score;
 	}
 }
@@ -9,17 +9,25 @@ namespace Pelican
 	{
 		std::optional<uint32_t> graphicsFamily;
 		std::optional<uint32_t> presentFamily;
+		// Only set when the device has a transfer-only family (usually backed by a DMA engine).
+		std::optional<uint32_t> transferFamily;
 
 		[[nodiscard]] bool IsComplete() const
 		{
 			return graphicsFamily.has_value() && presentFamily.has_value();
 		}
+
+		// Headless rendering doesn't need to present anything, so only the graphics family is required.
+		[[nodiscard]] bool IsComplete(bool headless) const
+		{
+			return headless ? graphicsFamily.has_value() : IsComplete();
+		}
 	};
 
 	class VulkanDevice final
 	{
 	public:
-		VulkanDevice(vk::Instance instance);
+		VulkanDevice(vk::Instance instance, bool headless = false);
 		~VulkanDevice();
 
 		void WaitIdle();
@@ -28,7 +36,17 @@ namespace Pelican
 		[[nodiscard]] vk::PhysicalDevice GetPhysicalDevice() const { return m_PhysicalDevice; }
 		[[nodiscard]] vk::Queue GetGraphicsQueue() const { return m_GraphicsQueue; }
 		[[nodiscard]] vk::Queue GetPresentQueue() const { return m_PresentQueue; }
+		// Falls back to the graphics queue when there is no dedicated transfer queue.
+		[[nodiscard]] vk::Queue GetTransferQueue() const { return m_TransferQueue; }
+		[[nodiscard]] uint32_t GetGraphicsQueueFamily() const { return m_GraphicsQueueFamily; }
+		[[nodiscard]] uint32_t GetTransferQueueFamily() const { return m_TransferQueueFamily; }
+		[[nodiscard]] bool HasDedicatedTransferQueue() const { return m_TransferQueueFamily != m_GraphicsQueueFamily; }
+		// Queue families that access resources uploaded on the transfer queue, use concurrent sharing when this has more than one entry.
+		[[nodiscard]] const std::vector<uint32_t>& GetResourceQueueFamilies() const { return m_ResourceQueueFamilies; }
 		[[nodiscard]] vk::SurfaceKHR GetSurface() const { return m_Surface; }
+		[[nodiscard]] const vk::PhysicalDeviceFeatures& GetEnabledFeatures() const { return m_EnabledFeatures; }
+		[[nodiscard]] const vk::PhysicalDeviceVulkan12Features& GetEnabledFeatures12() const { return m_EnabledFeatures12; }
+		[[nodiscard]] bool IsHeadless() const { return m_Headless; }
 
 		// Finds queue families for VulkanDevice's physical device.
 		// !! Make sure to only call this function after the device has been initialized !!
@@ -42,14 +60,26 @@ namespace Pelican
 		void CreateLogicalDevice();
 
 		bool IsDeviceSuitable(vk::PhysicalDevice device) const;
+		// The renderer binds all textures through one bindless descriptor array, see VulkanBindlessTable.
+		static bool SupportsDescriptorIndexing(vk::PhysicalDevice device);
+		uint32_t RateDevice(vk::PhysicalDevice device) const;
 
 	private:
 		vk::Instance m_Instance;
+		bool m_Headless{};
+		// g_DeviceExtensions minus the ones this device doesn't need, plus the debug ones.
+		std::vector<const char*> m_Extensions{};
 
 		vk::SurfaceKHR m_Surface{};
 		vk::UniqueDevice m_Device{};
 		vk::PhysicalDevice m_PhysicalDevice{};
 		vk::Queue m_GraphicsQueue{};
 		vk::Queue m_PresentQueue{};
+		vk::Queue m_TransferQueue{};
+		uint32_t m_GraphicsQueueFamily{};
+		uint32_t m_TransferQueueFamily{};
+		std::vector<uint32_t> m_ResourceQueueFamilies{};
+		vk::PhysicalDeviceFeatures m_EnabledFeatures{};
+		vk::PhysicalDeviceVulkan12Features m_EnabledFeatures12{};
 	};
 }
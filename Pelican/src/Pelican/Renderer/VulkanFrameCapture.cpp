@@ -0,0 +1,253 @@
+﻿#include "PelicanPCH.h"
+#include "VulkanFrameCapture.h"
+
+#include <cstring>
+
+#include <logtools.h>
+#include <stb_image_write.h>
+
+#include "Pelican/Core/Profiler.h"
+
+#include "VulkanDebug.h"
+#include "VulkanDevice.h"
+#include "VulkanHelpers.h"
+#include "VulkanRenderTarget.h"
+
+namespace Pelican
+{
+	VulkanFrameCapture::VulkanFrameCapture(VulkanDevice* pDevice, uint32_t frameCount)
+		: m_pDevice(pDevice)
+	{
+		m_Frames.resize(frameCount);
+		m_WriterThread = std::thread(&VulkanFrameCapture::WriterLoop, this);
+	}
+
+	VulkanFrameCapture::~VulkanFrameCapture()
+	{
+		// The device is idle, so every copy that was recorded has finished.
+		for (Frame& frame : m_Frames)
+		{
+			if (frame.isPending)
+			{
+				QueueWrite(frame);
+			}
+		}
+
+		{
+			std::lock_guard lock(m_WriterMutex);
+			m_StopWriter = true;
+		}
+		m_WriterCondition.notify_all();
+		m_WriterThread.join();
+
+		for (Frame& frame : m_Frames)
+		{
+			if (frame.buffer)
+			{
+				VulkanHelpers::DestroyBuffer(frame.buffer, frame.memory);
+			}
+		}
+
+		if (!m_Requests.empty())
+		{
+			Logger::LogWarning("%u frame captures were requested but never rendered", static_cast<uint32_t>(m_Requests.size()));
+		}
+	}
+
+	void VulkanFrameCapture::RequestCapture(const std::filesystem::path& path, bool includeUi)
+	{
+		m_Requests.push_back(Request{ path, includeUi });
+	}
+
+	void VulkanFrameCapture::BeginFrame(uint32_t frameIndex)
+	{
+		m_FrameIndex = frameIndex;
+
+		Frame& frame = m_Frames[m_FrameIndex];
+		if (frame.isPending)
+		{
+			QueueWrite(frame);
+		}
+	}
+
+	bool VulkanFrameCapture::ShouldDrawUi() const
+	{
+		return m_Requests.empty() || m_Requests.front().includeUi;
+	}
+
+	void VulkanFrameCapture::RecordCopy(vk::CommandBuffer cmd, const VulkanRenderTarget* pTarget, uint32_t imageIndex)
+	{
+		if (m_Requests.empty())
+			return;
+
+		const Request request = std::move(m_Requests.front());
+		m_Requests.pop_front();
+
+		const vk::Format format = pTarget->GetImageFormat();
+		if (!pTarget->SupportsCopy() || !SupportsFormat(format))
+		{
+			Logger::LogWarning("Can't capture \"%s\", the render target can't be copied from", request.path.string().c_str());
+			return;
+		}
+
+		const vk::Extent2D extent = pTarget->GetExtent();
+		const vk::DeviceSize size = static_cast<vk::DeviceSize>(extent.width) * extent.height * 4;
+
+		// The fence of this frame has been waited on, so its old buffer isn't used anymore.
+		Frame& frame = m_Frames[m_FrameIndex];
+		if (frame.size < size)
+		{
+			if (frame.buffer)
+			{
+				VulkanHelpers::DestroyBuffer(frame.buffer, frame.memory);
+			}
+
+			VulkanHelpers::CreateBuffer(size, vk::BufferUsageFlagBits::eTransferDst,
+				vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+				frame.buffer, frame.memory);
+			VkDebugMarker::SetBufferName(m_pDevice->GetDevice(), frame.buffer, "Frame Capture Readback");
+			frame.size = size;
+		}
+
+		const vk::Image image = pTarget->GetImages()[imageIndex];
+		const vk::ImageLayout layout = pTarget->GetFinalLayout();
+		const vk::ImageSubresourceRange range(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+
+		// The render pass only guarantees the image is in its final layout, the copy still has to wait for the writes.
+		const vk::ImageMemoryBarrier toTransfer = vk::ImageMemoryBarrier()
+			.setSrcAccessMask(vk::AccessFlagBits::eColorAttachmentWrite)
+			.setDstAccessMask(vk::AccessFlagBits::eTransferRead)
+			.setOldLayout(layout)
+			.setNewLayout(vk::ImageLayout::eTransferSrcOptimal)
+			.setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+			.setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+			.setImage(image)
+			.setSubresourceRange(range);
+		cmd.pipelineBarrier(vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, toTransfer);
+
+		const vk::BufferImageCopy region = vk::BufferImageCopy()
+			.setImageSubresource(vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1))
+			.setImageExtent(vk::Extent3D(extent.width, extent.height, 1));
+		cmd.copyImageToBuffer(image, vk::ImageLayout::eTransferSrcOptimal, frame.buffer, region);
+
+		const vk::MemoryBarrier hostBarrier = vk::MemoryBarrier()
+			.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+			.setDstAccessMask(vk::AccessFlagBits::eHostRead);
+		std::vector<vk::ImageMemoryBarrier> imageBarriers;
+		if (layout != vk::ImageLayout::eTransferSrcOptimal)
+		{
+			imageBarriers.push_back(vk::ImageMemoryBarrier()
+				.setSrcAccessMask(vk::AccessFlagBits::eTransferRead)
+				.setOldLayout(vk::ImageLayout::eTransferSrcOptimal)
+				.setNewLayout(layout)
+				.setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+				.setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+				.setImage(image)
+				.setSubresourceRange(range));
+		}
+		cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost | vk::PipelineStageFlagBits::eBottomOfPipe,
+			{}, hostBarrier, {}, imageBarriers);
+
+		frame.isPending = true;
+		frame.path = request.path;
+		frame.width = extent.width;
+		frame.height = extent.height;
+		frame.isBgra = format == vk::Format::eB8G8R8A8Unorm || format == vk::Format::eB8G8R8A8Srgb;
+	}
+
+	uint32_t VulkanFrameCapture::GetPendingCount() const
+	{
+		uint32_t count = static_cast<uint32_t>(m_Requests.size()) + m_WriteCount;
+		for (const Frame& frame : m_Frames)
+		{
+			if (frame.isPending)
+			{
+				count++;
+			}
+		}
+
+		return count;
+	}
+
+	bool VulkanFrameCapture::SupportsFormat(vk::Format format)
+	{
+		switch (format)
+		{
+		case vk::Format::eR8G8B8A8Unorm:
+		case vk::Format::eR8G8B8A8Srgb:
+		case vk::Format::eB8G8R8A8Unorm:
+		case vk::Format::eB8G8R8A8Srgb:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	void VulkanFrameCapture::QueueWrite(Frame& frame)
+	{
+		frame.isPending = false;
+
+		WriteJob job{ std::move(frame.path), {}, frame.width, frame.height, frame.isBgra };
+		job.pixels.resize(static_cast<size_t>(frame.width) * frame.height * 4);
+		memcpy(job.pixels.data(), frame.memory.pMapped, job.pixels.size());
+
+		m_WriteCount++;
+		{
+			std::lock_guard lock(m_WriterMutex);
+			m_WriteQueue.push_back(std::move(job));
+		}
+		m_WriterCondition.notify_one();
+	}
+
+	void VulkanFrameCapture::WriterLoop()
+	{
+		Profiler::SetThreadName("Frame Capture");
+
+		while (true)
+		{
+			WriteJob job{};
+			{
+				std::unique_lock lock(m_WriterMutex);
+				m_WriterCondition.wait(lock, [this]() { return m_StopWriter || !m_WriteQueue.empty(); });
+				// Everything that was queued still gets written when stopping.
+				if (m_WriteQueue.empty())
+					return;
+
+				job = std::move(m_WriteQueue.front());
+				m_WriteQueue.pop_front();
+			}
+
+			PELICAN_PROFILE_SCOPE("Write Frame Capture");
+
+			// The alpha of the color target isn't meaningful, PNGs get saved opaque.
+			for (size_t i = 0; i < job.pixels.size(); i += 4)
+			{
+				if (job.isBgra)
+				{
+					std::swap(job.pixels[i], job.pixels[i + 2]);
+				}
+				job.pixels[i + 3] = 255;
+			}
+
+			if (job.path.has_parent_path())
+			{
+				std::error_code error;
+				std::filesystem::create_directories(job.path.parent_path(), error);
+			}
+
+			const int width = static_cast<int>(job.width);
+			const int height = static_cast<int>(job.height);
+			if (stbi_write_png(job.path.string().c_str(), width, height, 4, job.pixels.data(), width * 4))
+			{
+				Logger::LogInfo("Captured frame to \"%s\"", job.path.string().c_str());
+				m_WrittenCount++;
+			}
+			else
+			{
+				Logger::LogError("Failed to write frame capture \"%s\"", job.path.string().c_str());
+			}
+
+			m_WriteCount--;
+		}
+	}
+}
@@ -0,0 +1,100 @@
+﻿#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include <vulkan/vulkan.hpp>
+
+#include "VulkanAllocator.h"
+
+namespace Pelican
+{
+	class VulkanDevice;
+	class VulkanRenderTarget;
+
+	// Copies the final color target of a frame into host visible memory and writes it out as a PNG.
+	// The copy is recorded at the end of the frame that gets captured, and only read once the fence of that frame in
+	// flight has been waited on again, so capturing never waits on the GPU. The PNGs get encoded on a thread of their own.
+	class VulkanFrameCapture final
+	{
+	public:
+		VulkanFrameCapture(VulkanDevice* pDevice, uint32_t frameCount);
+		// Only call this once the device is idle, captures that are still on their way get written first.
+		~VulkanFrameCapture();
+
+		VulkanFrameCapture(const VulkanFrameCapture&) = delete;
+		VulkanFrameCapture& operator=(const VulkanFrameCapture&) = delete;
+
+		// Captures the next frame that gets rendered, one frame per request. The debug UI is left out unless
+		// includeUi is set, so captures of the same view can be compared with each other.
+		void RequestCapture(const std::filesystem::path& path, bool includeUi = false);
+
+		// Only call this once the fence of the given frame has been waited on, hands its capture to the writer thread.
+		void BeginFrame(uint32_t frameIndex);
+
+		// Whether the frame that's being recorded should draw the debug UI.
+		[[nodiscard]] bool ShouldDrawUi() const;
+		// Records the copy out of the target's image when this frame gets captured. Has to be recorded outside of a
+		// render pass, after the image reached the target's final layout. It's left in that layout.
+		void RecordCopy(vk::CommandBuffer cmd, const VulkanRenderTarget* pTarget, uint32_t imageIndex);
+
+		// Captures that were requested but haven't been written to disk yet.
+		[[nodiscard]] uint32_t GetPendingCount() const;
+		[[nodiscard]] uint32_t GetWrittenCount() const { return m_WrittenCount; }
+
+		// Only 8 bit RGBA and BGRA color targets can be captured.
+		[[nodiscard]] static bool SupportsFormat(vk::Format format);
+
+	private:
+		struct Request
+		{
+			std::filesystem::path path;
+			bool includeUi;
+		};
+
+		struct Frame
+		{
+			vk::Buffer buffer{};
+			VulkanAllocation memory{};
+			vk::DeviceSize size{};
+
+			// Set while the frame's copy is in flight.
+			bool isPending{};
+			std::filesystem::path path{};
+			uint32_t width{};
+			uint32_t height{};
+			bool isBgra{};
+		};
+
+		struct WriteJob
+		{
+			std::filesystem::path path;
+			std::vector<uint8_t> pixels;
+			uint32_t width;
+			uint32_t height;
+			bool isBgra;
+		};
+
+		void QueueWrite(Frame& frame);
+		void WriterLoop();
+
+	private:
+		VulkanDevice* m_pDevice{};
+
+		std::deque<Request> m_Requests{};
+		std::vector<Frame> m_Frames{};
+		uint32_t m_FrameIndex{};
+
+		std::thread m_WriterThread{};
+		std::mutex m_WriterMutex{};
+		std::condition_variable m_WriterCondition{};
+		std::deque<WriteJob> m_WriteQueue{};
+		// Queued jobs plus the one being written.
+		std::atomic<uint32_t> m_WriteCount{};
+		std::atomic<uint32_t> m_WrittenCount{};
+		bool m_StopWriter{};
+	};
+}
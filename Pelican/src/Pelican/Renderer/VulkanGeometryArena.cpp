@@ -0,0 +1,150 @@
+﻿#include "PelicanPCH.h"
+#include "VulkanGeometryArena.h"
+
+#include "VulkanDebug.h"
+#include "VulkanDevice.h"
+#include "VulkanHelpers.h"
+#include "VulkanRenderer.h"
+
+namespace Pelican
+{
+	VulkanGeometryArena::VulkanGeometryArena(VulkanDevice* pDevice, uint32_t frameCount, uint32_t maxVertices, uint32_t maxIndices)
+		: m_pDevice(pDevice)
+		, m_VertexAllocator(maxVertices)
+		, m_IndexAllocator(maxIndices)
+	{
+		VulkanHelpers::CreateBuffer(static_cast<vk::DeviceSize>(maxVertices) * sizeof(Vertex),
+			vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer,
+			vk::MemoryPropertyFlagBits::eDeviceLocal,
+			m_VertexBuffer, m_VertexMemory);
+
+		VulkanHelpers::CreateBuffer(static_cast<vk::DeviceSize>(maxVertices) * sizeof(glm::vec3),
+			vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer,
+			vk::MemoryPropertyFlagBits::eDeviceLocal,
+			m_PositionBuffer, m_PositionMemory);
+
+		VulkanHelpers::CreateBuffer(static_cast<vk::DeviceSize>(maxIndices) * sizeof(uint32_t),
+			vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer,
+			vk::MemoryPropertyFlagBits::eDeviceLocal,
+			m_IndexBuffer, m_IndexMemory);
+
+		VkDebugMarker::SetBufferName(m_pDevice->GetDevice(), m_VertexBuffer, "Geometry Arena Vertices");
+		VkDebugMarker::SetBufferName(m_pDevice->GetDevice(), m_PositionBuffer, "Geometry Arena Positions");
+		VkDebugMarker::SetBufferName(m_pDevice->GetDevice(), m_IndexBuffer, "Geometry Arena Indices");
+
+		m_PendingFrees.resize(frameCount);
+
+		m_MultiDrawIndirect = m_pDevice->GetEnabledFeatures().multiDrawIndirect;
+		m_MaxDrawIndirectCount = m_MultiDrawIndirect ? m_pDevice->GetPhysicalDevice().getProperties().limits.maxDrawIndirectCount : 1;
+	}
+
+	VulkanGeometryArena::~VulkanGeometryArena()
+	{
+		VulkanHelpers::DestroyBuffer(m_IndexBuffer, m_IndexMemory);
+		VulkanHelpers::DestroyBuffer(m_PositionBuffer, m_PositionMemory);
+		VulkanHelpers::DestroyBuffer(m_VertexBuffer, m_VertexMemory);
+	}
+
+	void VulkanGeometryArena::BeginFrame(uint32_t frameIndex)
+	{
+		std::lock_guard lock(m_Mutex);
+
+		m_FrameIndex = frameIndex;
+
+		for (const GeometryAllocation& allocation : m_PendingFrees[m_FrameIndex])
+		{
+			m_VertexAllocator.Free(allocation.vertices);
+			m_IndexAllocator.Free(allocation.indices);
+		}
+		m_PendingFrees[m_FrameIndex].clear();
+	}
+
+	GeometryAllocation VulkanGeometryArena::Allocate(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+	{
+		// Nothing to draw, the allocator can't hand out empty ranges. Free ignores the invalid allocation and
+		// its draw command has no indices.
+		if (vertices.empty() || indices.empty())
+			return {};
+
+		GeometryAllocation allocation;
+		{
+			std::lock_guard lock(m_Mutex);
+
+			allocation.vertices = m_VertexAllocator.Allocate(vertices.size());
+			allocation.indices = m_IndexAllocator.Allocate(indices.size());
+
+			if (!allocation.IsValid())
+			{
+				if (allocation.vertices.IsValid())
+					m_VertexAllocator.Free(allocation.vertices);
+				if (allocation.indices.IsValid())
+					m_IndexAllocator.Free(allocation.indices);
+
+				throw std::runtime_error("Geometry arena is out of space, increase its size!");
+			}
+		}
+
+		std::vector<glm::vec3> positions(vertices.size());
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			positions[i] = vertices[i].pos;
+		}
+
+		VulkanUploader* pUploader = VulkanRenderer::GetUploader();
+		pUploader->UploadBuffer(m_VertexBuffer, vertices.data(), vertices.size() * sizeof(Vertex),
+			allocation.vertices.offset * sizeof(Vertex));
+		pUploader->UploadBuffer(m_PositionBuffer, positions.data(), positions.size() * sizeof(glm::vec3),
+			allocation.vertices.offset * sizeof(glm::vec3));
+		pUploader->UploadBuffer(m_IndexBuffer, indices.data(), indices.size() * sizeof(uint32_t),
+			allocation.indices.offset * sizeof(uint32_t));
+
+		return allocation;
+	}
+
+	void VulkanGeometryArena::Free(const GeometryAllocation& allocation)
+	{
+		if (!allocation.IsValid())
+			return;
+
+		std::lock_guard lock(m_Mutex);
+		m_PendingFrees[m_FrameIndex].push_back(allocation);
+	}
+
+	void VulkanGeometryArena::Bind(vk::CommandBuffer cmd) const
+	{
+		const vk::DeviceSize offset = 0;
+		cmd.bindVertexBuffers(0, m_VertexBuffer, offset);
+		cmd.bindIndexBuffer(m_IndexBuffer, 0, vk::IndexType::eUint32);
+	}
+
+	void VulkanGeometryArena::BindPositions(vk::CommandBuffer cmd) const
+	{
+		const vk::DeviceSize offset = 0;
+		cmd.bindVertexBuffers(0, m_PositionBuffer, offset);
+		cmd.bindIndexBuffer(m_IndexBuffer, 0, vk::IndexType::eUint32);
+	}
+
+	uint32_t VulkanGeometryArena::DrawIndirect(vk::CommandBuffer cmd, vk::Buffer buffer, vk::DeviceSize offset, uint32_t drawCount) const
+	{
+		constexpr uint32_t stride = sizeof(vk::DrawIndexedIndirectCommand);
+
+		uint32_t callCount = 0;
+		for (uint32_t first = 0; first < drawCount; first += m_MaxDrawIndirectCount)
+		{
+			const uint32_t count = std::min(drawCount - first, m_MaxDrawIndirectCount);
+			cmd.drawIndexedIndirect(buffer, offset + static_cast<vk::DeviceSize>(first) * stride, count, stride);
+			callCount++;
+		}
+
+		return callCount;
+	}
+
+	uint32_t VulkanGeometryArena::DrawIndirectCount(vk::CommandBuffer cmd, vk::Buffer buffer, vk::DeviceSize offset,
+		vk::Buffer countBuffer, vk::DeviceSize countOffset, uint32_t maxDrawCount) const
+	{
+		ASSERT_MSG(maxDrawCount <= m_MaxDrawIndirectCount, "Indirect count draws can't be split up, too many draws!");
+
+		cmd.drawIndexedIndirectCount(buffer, offset, countBuffer, countOffset, maxDrawCount, sizeof(vk::DrawIndexedIndirectCommand));
+		return 1;
+	}
+}
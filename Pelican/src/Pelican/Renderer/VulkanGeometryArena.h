@@ -0,0 +1,93 @@
+﻿#pragma once
+
+#include <mutex>
+
+#include <vulkan/vulkan.hpp>
+
+#include "OffsetAllocator.h"
+#include "Vertex.h"
+#include "VulkanAllocator.h"
+
+namespace Pelican
+{
+	class VulkanDevice;
+
+	// Where a mesh lives inside the geometry arena, both ranges are counted in elements (vertices and indices).
+	struct GeometryAllocation
+	{
+		OffsetAllocation vertices{};
+		OffsetAllocation indices{};
+
+		[[nodiscard]] bool IsValid() const { return vertices.IsValid() && indices.IsValid(); }
+
+		// Draws the whole allocation, the instance index is used to look up the per-instance data.
+		[[nodiscard]] vk::DrawIndexedIndirectCommand GetDrawCommand(uint32_t firstInstance, uint32_t instanceCount = 1) const
+		{
+			return vk::DrawIndexedIndirectCommand(static_cast<uint32_t>(indices.size), instanceCount,
+				static_cast<uint32_t>(indices.offset), static_cast<int32_t>(vertices.offset), firstInstance);
+		}
+	};
+
+	// One big vertex buffer and one big index buffer that all meshes sub-allocate from.
+	// Since every mesh shares the same buffers, they only have to be bound once, and any number of meshes
+	// can be drawn with a single drawIndexedIndirect call.
+	// The positions are stored a second time in a buffer of their own, at the same offsets, so passes that only need
+	// positions (like the depth prepass) don't have to fetch whole vertices.
+	class VulkanGeometryArena final
+	{
+	public:
+		VulkanGeometryArena(VulkanDevice* pDevice, uint32_t frameCount,
+			uint32_t maxVertices = 2 * 1024 * 1024, uint32_t maxIndices = 8 * 1024 * 1024);
+		~VulkanGeometryArena();
+
+		VulkanGeometryArena(const VulkanGeometryArena&) = delete;
+		VulkanGeometryArena& operator=(const VulkanGeometryArena&) = delete;
+
+		// Only call this once the fence of the given frame has been waited on,
+		// ranges that were freed during that frame can be handed out again after this.
+		void BeginFrame(uint32_t frameIndex);
+
+		// Copies the geometry into the arena through the uploader. Geometry without vertices or indices gets an invalid
+		// allocation, which draws nothing.
+		[[nodiscard]] GeometryAllocation Allocate(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+		void Free(const GeometryAllocation& allocation);
+
+		void Bind(vk::CommandBuffer cmd) const;
+		// Binds the position only stream instead of the vertices, the draw commands stay the same.
+		void BindPositions(vk::CommandBuffer cmd) const;
+
+		// Draws drawCount commands from the buffer, as a single call when the device supports multi draw indirect.
+		// Returns the number of draw calls that were recorded.
+		uint32_t DrawIndirect(vk::CommandBuffer cmd, vk::Buffer buffer, vk::DeviceSize offset, uint32_t drawCount) const;
+		// Same as DrawIndirect, but the GPU reads the draw count from countBuffer, up to maxDrawCount.
+		// Needs the drawIndirectCount feature, maxDrawCount can't go over maxDrawIndirectCount.
+		uint32_t DrawIndirectCount(vk::CommandBuffer cmd, vk::Buffer buffer, vk::DeviceSize offset,
+			vk::Buffer countBuffer, vk::DeviceSize countOffset, uint32_t maxDrawCount) const;
+
+		[[nodiscard]] OffsetAllocatorStats GetVertexStats() const { return m_VertexAllocator.GetStats(); }
+		[[nodiscard]] OffsetAllocatorStats GetIndexStats() const { return m_IndexAllocator.GetStats(); }
+
+	private:
+		VulkanDevice* m_pDevice{};
+
+		vk::Buffer m_VertexBuffer{};
+		VulkanAllocation m_VertexMemory{};
+		vk::Buffer m_PositionBuffer{};
+		VulkanAllocation m_PositionMemory{};
+		vk::Buffer m_IndexBuffer{};
+		VulkanAllocation m_IndexMemory{};
+
+		TlsfAllocator m_VertexAllocator;
+		TlsfAllocator m_IndexAllocator;
+
+		// Freed ranges can still be read by frames in flight, they only get reused once that frame has finished.
+		std::vector<std::vector<GeometryAllocation>> m_PendingFrees{};
+		uint32_t m_FrameIndex{};
+
+		bool m_MultiDrawIndirect{};
+		uint32_t m_MaxDrawIndirectCount{};
+
+		// Meshes can get loaded from any thread.
+		std::mutex m_Mutex{};
+	};
+}
@@ -52,10 +52,17 @@ namespace Pelican
 	}
 
 	void VulkanHelpers::CreateBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties,
-	                                 vk::Buffer& buffer, vk::DeviceMemory& bufferMemory)
+	                                 vk::Buffer& buffer, VulkanAllocation& allocation, MemoryStrategy strategy)
 	{
 		vk::BufferCreateInfo bufferInfo({}, size, usage, vk::SharingMode::eExclusive);
 
+		// Buffers that get filled on the transfer queue are used on the graphics queue as well.
+		const std::vector<uint32_t>& queueFamilies = VulkanRenderer::GetVulkanDevice()->GetResourceQueueFamilies();
+		if ((usage & vk::BufferUsageFlagBits::eTransferDst) && queueFamilies.size() > 1)
+		{
+			bufferInfo.setSharingMode(vk::SharingMode::eConcurrent).setQueueFamilyIndices(queueFamilies);
+		}
+
 		try
 		{
 			buffer = VulkanRenderer::GetDevice().createBuffer(bufferInfo);
@@ -65,30 +72,15 @@ namespace Pelican
 			throw std::runtime_error("Failed to create buffer: "s + e.what());
 		}
 
-		vk::MemoryRequirements memRequirements = VulkanRenderer::GetDevice().getBufferMemoryRequirements(buffer);
-
-		vk::MemoryAllocateInfo allocInfo(
-			memRequirements.size,
-			FindMemoryType(memRequirements.memoryTypeBits, properties)
-		);
+		allocation = VulkanRenderer::GetAllocator()->AllocateForBuffer(buffer, properties, strategy);
+	}
 
-		try
-		{
-			bufferMemory = VulkanRenderer::GetDevice().allocateMemory(allocInfo);
-		}
-		catch (vk::SystemError& e)
-		{
-			throw std::runtime_error("Failed to allocate buffer memory: "s + e.what());
-		}
+	void VulkanHelpers::DestroyBuffer(vk::Buffer& buffer, VulkanAllocation& allocation)
+	{
+		VulkanRenderer::GetDevice().destroyBuffer(buffer);
+		buffer = nullptr;
 
-		try
-		{
-			VulkanRenderer::GetDevice().bindBufferMemory(buffer, bufferMemory, 0);
-		}
-		catch (vk::SystemError& e)
-		{
-			throw std::runtime_error("Failed to bind buffer memory: "s + e.what());
-		}
+		VulkanRenderer::GetAllocator()->Free(allocation);
 	}
 
 	void VulkanHelpers::CopyBuffer(vk::Buffer srcBuffer, vk::Buffer dstBuffer, vk::DeviceSize size)
@@ -101,12 +93,12 @@ namespace Pelican
 		EndSingleTimeCommands(commandBuffer);
 	}
 
-	bool VulkanHelpers::CheckDeviceExtensionSupport(vk::PhysicalDevice physicalDevice)
+	bool VulkanHelpers::CheckDeviceExtensionSupport(vk::PhysicalDevice physicalDevice, const std::vector<const char*>& extensions)
 	{
 		using namespace std::string_literals;
 
 		std::vector<vk::ExtensionProperties> availableExtensions = physicalDevice.enumerateDeviceExtensionProperties(""s);
-		std::set<std::string> requiredExtensions(g_DeviceExtensions.begin(), g_DeviceExtensions.end());
+		std::set<std::string> requiredExtensions(extensions.begin(), extensions.end());
 
 		for (const auto& extension : availableExtensions)
 		{
@@ -2,6 +2,8 @@
 
 #include <vulkan/vulkan.hpp>
 
+#include "VulkanAllocator.h"
+
 namespace Pelican
 {
 	class VulkanDevice;
@@ -52,10 +54,11 @@ namespace Pelican
 
 		static uint32_t FindMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties);
 		static void CreateBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties,
-			vk::Buffer& buffer, vk::DeviceMemory& bufferMemory);
+			vk::Buffer& buffer, VulkanAllocation& allocation, MemoryStrategy strategy = MemoryStrategy::General);
+		static void DestroyBuffer(vk::Buffer& buffer, VulkanAllocation& allocation);
 		static void CopyBuffer(vk::Buffer srcBuffer, vk::Buffer dstBuffer, vk::DeviceSize size);
 
-		static bool CheckDeviceExtensionSupport(vk::PhysicalDevice physicalDevice);
+		static bool CheckDeviceExtensionSupport(vk::PhysicalDevice physicalDevice, const std::vector<const char*>& extensions);
 		static SwapChainSupportDetails QuerySwapChainSupport(vk::PhysicalDevice physicalDevice, vk::SurfaceKHR surface);
 	};
 }
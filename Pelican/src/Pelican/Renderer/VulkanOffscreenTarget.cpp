@@ -0,0 +1,148 @@
+﻿#include "PelicanPCH.h"
+#include "VulkanOffscreenTarget.h"
+
+#include "VulkanDebug.h"
+#include "VulkanDevice.h"
+#include "VulkanRenderer.h"
+
+namespace Pelican
+{
+	VulkanOffscreenTarget::VulkanOffscreenTarget(VulkanDevice* pDevice, vk::Extent2D extent, uint32_t imageCount)
+		: m_pDevice(pDevice), m_Extent(extent), m_ImageCount(imageCount)
+	{
+		Initialize();
+	}
+
+	VulkanOffscreenTarget::~VulkanOffscreenTarget()
+	{
+		Cleanup();
+	}
+
+	void VulkanOffscreenTarget::Initialize()
+	{
+		CreateImages();
+		CreateImageViews();
+	}
+
+	void VulkanOffscreenTarget::CreateFramebuffers(vk::ImageView depthImageView, vk::RenderPass renderPass)
+	{
+		m_Framebuffers.resize(m_ImageViews.size());
+
+		for (size_t i = 0; i < m_ImageViews.size(); i++)
+		{
+			std::array<vk::ImageView, 2> attachments = {
+				m_ImageViews[i],
+				depthImageView
+			};
+
+			const vk::FramebufferCreateInfo framebufferInfo(
+				{},
+				renderPass,
+				static_cast<uint32_t>(attachments.size()),
+				attachments.data(),
+				m_Extent.width,
+				m_Extent.height,
+				1
+			);
+
+			try
+			{
+				m_Framebuffers[i] = m_pDevice->GetDevice().createFramebuffer(framebufferInfo);
+			}
+			catch (vk::SystemError& e)
+			{
+				throw std::runtime_error("Failed to create offscreen framebuffer: "s + e.what());
+			}
+
+			VkDebugMarker::SetFramebufferName(m_pDevice->GetDevice(), m_Framebuffers[i], ("Offscreen Framebuffer " + std::to_string(i)).c_str());
+		}
+	}
+
+	void VulkanOffscreenTarget::Cleanup()
+	{
+		// Same as the swap chain, this can get called twice when closing the application.
+		if (m_Images.empty())
+			return;
+
+		const vk::Device device = m_pDevice->GetDevice();
+
+		for (vk::Framebuffer framebuffer : m_Framebuffers)
+		{
+			device.destroyFramebuffer(framebuffer);
+		}
+		m_Framebuffers.clear();
+
+		for (size_t i = 0; i < m_Images.size(); i++)
+		{
+			device.destroyImageView(m_ImageViews[i]);
+			device.destroyImage(m_Images[i]);
+			VulkanRenderer::GetAllocator()->Free(m_ImageMemories[i]);
+		}
+
+		m_ImageViews.clear();
+		m_Images.clear();
+		m_ImageMemories.clear();
+	}
+
+	void VulkanOffscreenTarget::CreateImages()
+	{
+		const vk::Device device = m_pDevice->GetDevice();
+
+		m_Images.resize(m_ImageCount);
+		m_ImageMemories.resize(m_ImageCount);
+
+		for (uint32_t i = 0; i < m_ImageCount; i++)
+		{
+			const vk::ImageCreateInfo imageInfo = vk::ImageCreateInfo()
+				.setImageType(vk::ImageType::e2D)
+				.setExtent(vk::Extent3D(m_Extent.width, m_Extent.height, 1))
+				.setFormat(m_ImageFormat)
+				.setTiling(vk::ImageTiling::eOptimal)
+				.setUsage(vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc)
+				.setMipLevels(1)
+				.setArrayLayers(1)
+				.setInitialLayout(vk::ImageLayout::eUndefined)
+				.setSharingMode(vk::SharingMode::eExclusive)
+				.setSamples(vk::SampleCountFlagBits::e1);
+
+			try
+			{
+				m_Images[i] = device.createImage(imageInfo);
+			}
+			catch (vk::SystemError& e)
+			{
+				throw std::runtime_error("Failed to create offscreen image: "s + e.what());
+			}
+
+			m_ImageMemories[i] = VulkanRenderer::GetAllocator()->AllocateForImage(m_Images[i], vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+			VkDebugMarker::SetImageName(device, m_Images[i], ("Offscreen Color " + std::to_string(i)).c_str());
+		}
+	}
+
+	void VulkanOffscreenTarget::CreateImageViews()
+	{
+		m_ImageViews.resize(m_Images.size());
+
+		for (size_t i = 0; i < m_Images.size(); i++)
+		{
+			const vk::ImageViewCreateInfo viewInfo(
+				{},
+				m_Images[i],
+				vk::ImageViewType::e2D,
+				m_ImageFormat,
+				{},
+				vk::ImageSubresourceRange{ vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 }
+			);
+
+			try
+			{
+				m_ImageViews[i] = m_pDevice->GetDevice().createImageView(viewInfo);
+			}
+			catch (vk::SystemError& e)
+			{
+				throw std::runtime_error("Failed to create offscreen image view: "s + e.what());
+			}
+		}
+	}
+}
@@ -0,0 +1,49 @@
+﻿#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include "VulkanAllocator.h"
+#include "VulkanRenderTarget.h"
+
+namespace Pelican
+{
+	class VulkanDevice;
+
+	// Render target used in headless mode: a set of color images that live entirely in device memory.
+	// Nothing gets presented, the images stay in eTransferSrcOptimal so they can be copied out if needed.
+	class VulkanOffscreenTarget final : public VulkanRenderTarget
+	{
+	public:
+		VulkanOffscreenTarget(VulkanDevice* pDevice, vk::Extent2D extent, uint32_t imageCount);
+		~VulkanOffscreenTarget() override;
+
+		void Initialize() override;
+		void CreateFramebuffers(vk::ImageView depthImageView, vk::RenderPass renderPass) override;
+		void Cleanup() override;
+
+		vk::ImageLayout GetFinalLayout() const override { return vk::ImageLayout::eTransferSrcOptimal; }
+		bool SupportsCopy() const override { return true; }
+
+		vk::Format GetImageFormat() const override { return m_ImageFormat; }
+		vk::Extent2D GetExtent() const override { return m_Extent; }
+		std::vector<vk::ImageView> GetImageViews() const override { return m_ImageViews; }
+		std::vector<vk::Image> GetImages() const override { return m_Images; }
+		std::vector<vk::Framebuffer> GetFramebuffers() const override { return m_Framebuffers; }
+
+	private:
+		void CreateImages();
+		void CreateImageViews();
+
+	private:
+		VulkanDevice* m_pDevice{};
+
+		vk::Extent2D m_Extent{};
+		uint32_t m_ImageCount{};
+		vk::Format m_ImageFormat{ vk::Format::eR8G8B8A8Unorm };
+
+		std::vector<vk::Image> m_Images{};
+		std::vector<VulkanAllocation> m_ImageMemories{};
+		std::vector<vk::ImageView> m_ImageViews{};
+		std::vector<vk::Framebuffer> m_Framebuffers{};
+	};
+}
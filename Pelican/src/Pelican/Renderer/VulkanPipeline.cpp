@@ -1,31 +1,101 @@
 ﻿#include "PelicanPCH.h"
 #include "VulkanPipeline.h"
 
+#include <chrono>
+#include <logtools.h>
+
+#include "Pelican/Core/Hash.h"
 
 #include "Vertex.h"
 #include "VkInit.h"
+#include "VulkanPipelineCache.h"
 #include "VulkanShader.h"
 
 namespace Pelican
 {
-	void VulkanPipeline::Init(const vk::Pipeline& pipeline, const vk::PipelineCache& cache,
-		const vk::PipelineLayout& layout)
+	size_t PipelineKeyHash::operator()(const PipelineKey& key) const
+	{
+		size_t hash = key.shaderHash;
+		HashCombine(hash, key.isCompute);
+		HashCombine(hash, key.setLayouts.size());
+
+		for (const vk::PushConstantRange& range : key.pushConstants)
+		{
+			HashCombine(hash, static_cast<VkShaderStageFlags>(range.stageFlags));
+			HashCombine(hash, range.offset);
+			HashCombine(hash, range.size);
+		}
+
+		if (key.isCompute)
+			return hash;
+
+		HashCombine(hash, key.vertexBinding.stride);
+		for (const vk::VertexInputAttributeDescription& attribute : key.vertexAttributes)
+		{
+			HashCombine(hash, attribute.location);
+			HashCombine(hash, attribute.format);
+			HashCombine(hash, attribute.offset);
+		}
+
+		HashCombine(hash, key.inputAssembly.topology);
+		HashCombine(hash, key.inputAssembly.primitiveRestartEnable);
+
+		HashCombine(hash, key.rasterizer.depthClampEnable);
+		HashCombine(hash, key.rasterizer.rasterizerDiscardEnable);
+		HashCombine(hash, key.rasterizer.polygonMode);
+		HashCombine(hash, static_cast<VkCullModeFlags>(key.rasterizer.cullMode));
+		HashCombine(hash, key.rasterizer.frontFace);
+		HashCombine(hash, key.rasterizer.depthBiasEnable);
+		HashCombine(hash, key.rasterizer.depthBiasConstantFactor);
+		HashCombine(hash, key.rasterizer.depthBiasClamp);
+		HashCombine(hash, key.rasterizer.depthBiasSlopeFactor);
+		HashCombine(hash, key.rasterizer.lineWidth);
+
+		HashCombine(hash, key.multisampling.rasterizationSamples);
+		HashCombine(hash, key.multisampling.sampleShadingEnable);
+		HashCombine(hash, key.multisampling.minSampleShading);
+		HashCombine(hash, key.multisampling.alphaToCoverageEnable);
+		HashCombine(hash, key.multisampling.alphaToOneEnable);
+
+		HashCombine(hash, key.depthStencil.depthTestEnable);
+		HashCombine(hash, key.depthStencil.depthWriteEnable);
+		HashCombine(hash, key.depthStencil.depthCompareOp);
+		HashCombine(hash, key.depthStencil.depthBoundsTestEnable);
+		HashCombine(hash, key.depthStencil.stencilTestEnable);
+
+		HashCombine(hash, key.colorBlendAttachment.blendEnable);
+		HashCombine(hash, key.colorBlendAttachment.srcColorBlendFactor);
+		HashCombine(hash, key.colorBlendAttachment.dstColorBlendFactor);
+		HashCombine(hash, key.colorBlendAttachment.colorBlendOp);
+		HashCombine(hash, key.colorBlendAttachment.srcAlphaBlendFactor);
+		HashCombine(hash, key.colorBlendAttachment.dstAlphaBlendFactor);
+		HashCombine(hash, key.colorBlendAttachment.alphaBlendOp);
+		HashCombine(hash, static_cast<VkColorComponentFlags>(key.colorBlendAttachment.colorWriteMask));
+		HashCombine(hash, key.logicOpEnable);
+		HashCombine(hash, key.logicOp);
+
+		return hash;
+	}
+
+	void VulkanPipeline::Init(const vk::Pipeline& pipeline, const vk::PipelineLayout& layout)
 	{
 		m_Pipeline = pipeline;
-		m_Cache = cache;
 		m_Layout = layout;
 	}
 
 	void VulkanPipeline::Cleanup(vk::Device device) const
 	{
 		device.destroyPipeline(m_Pipeline);
-		device.destroyPipelineCache(m_Cache);
 		device.destroyPipelineLayout(m_Layout);
 	}
 
-	PipelineBuilder::PipelineBuilder(vk::Device device)
-		: m_Device(device)
+	PipelineBuilder::PipelineBuilder(vk::Device device, VulkanPipelineCache* pCache)
+		: m_Device(device), m_pCache(pCache)
 	{
+		ASSERT_MSG(m_pCache, "PipelineBuilder needs a pipeline cache!");
+
+		const auto attributes = Vertex::GetAttributeDescriptions();
+		SetVertexInput(Vertex::GetBindingDescription(), { attributes.begin(), attributes.end() });
 	}
 
 	void PipelineBuilder::SetShader(VulkanShader* pShader)
@@ -33,6 +103,12 @@ namespace Pelican
 		m_pShader = pShader;
 	}
 
+	void PipelineBuilder::SetVertexInput(const vk::VertexInputBindingDescription& binding, const std::vector<vk::VertexInputAttributeDescription>& attributes)
+	{
+		m_VertexBinding = binding;
+		m_VertexAttributes = attributes;
+	}
+
 	void PipelineBuilder::SetInputAssembly(vk::PrimitiveTopology topology, bool primitiveRestartEnable)
 	{
 		m_InputAssembly = vk::PipelineInputAssemblyStateCreateInfo()
@@ -40,21 +116,6 @@ namespace Pelican
 			.setPrimitiveRestartEnable(primitiveRestartEnable);
 	}
 
-	void PipelineBuilder::SetViewport(float x, float y, float width, float height, float minDepth, float maxDepth)
-	{
-		m_Viewport = vk::Viewport()
-			.setX(x).setY(y)
-			.setWidth(width).setHeight(height)
-			.setMinDepth(minDepth).setMaxDepth(maxDepth);
-	}
-
-	void PipelineBuilder::SetScissor(const vk::Offset2D& offset, const vk::Extent2D& extent)
-	{
-		m_Scissor = vk::Rect2D()
-			.setOffset(offset)
-			.setExtent(extent);
-	}
-
 	void PipelineBuilder::SetRasterizer(vk::PolygonMode polygonMode, vk::CullModeFlagBits cullMode)
 	{
 		m_Rasterizer = VkInit::RasterizationStateCreateInfo(polygonMode, cullMode);
@@ -90,6 +151,11 @@ namespace Pelican
 			.setBlendConstants({ 0.0f, 0.0f, 0.0f, 0.0f });
 	}
 
+	void PipelineBuilder::SetColorWriteMask(vk::ColorComponentFlags writeMask)
+	{
+		m_ColorBlendAttachment.setColorWriteMask(writeMask);
+	}
+
 	void PipelineBuilder::SetDescriptorSetLayout(uint32_t layoutsCount, const vk::DescriptorSetLayout* pLayouts,
 		uint32_t pushConstCount, const vk::PushConstantRange* pPushConstants)
 	{
@@ -103,16 +169,24 @@ namespace Pelican
 
 	VulkanPipeline PipelineBuilder::BuildGraphics(const vk::RenderPass& renderPass)
 	{
-		auto bindingDescription = Vertex::GetBindingDescription();
-		auto attributeDescriptions = Vertex::GetAttributeDescriptions();
+		PipelineKey key = GetGraphicsKey(renderPass);
+		if (const VulkanPipeline* pCached = m_pCache->FindPipeline(key))
+		{
+			return *pCached;
+		}
 
 		const vk::PipelineVertexInputStateCreateInfo vertexInputInfo = vk::PipelineVertexInputStateCreateInfo()
-			.setVertexBindingDescriptions(bindingDescription)
-			.setVertexAttributeDescriptions(attributeDescriptions);
+			.setVertexBindingDescriptions(m_VertexBinding)
+			.setVertexAttributeDescriptions(m_VertexAttributes);
 
+		// Viewport and scissor are dynamic, so resizing the render target doesn't need new pipelines.
 		const vk::PipelineViewportStateCreateInfo viewportState = vk::PipelineViewportStateCreateInfo()
-			.setViewports(m_Viewport)
-			.setScissors(m_Scissor);
+			.setViewportCount(1)
+			.setScissorCount(1);
+
+		const std::array<vk::DynamicState, 2> dynamicStates = { vk::DynamicState::eViewport, vk::DynamicState::eScissor };
+		const vk::PipelineDynamicStateCreateInfo dynamicState = vk::PipelineDynamicStateCreateInfo()
+			.setDynamicStates(dynamicStates);
 
 		// First we need to create the pipeline layout.
 		vk::PipelineLayout pipelineLayout;
@@ -137,7 +211,7 @@ namespace Pelican
 			.setPMultisampleState(&m_Multisampling)
 			.setPDepthStencilState(&m_DepthStencil)
 			.setPColorBlendState(&m_ColorBlending)
-			.setPDynamicState(nullptr)
+			.setPDynamicState(&dynamicState)
 
 			.setLayout(pipelineLayout)
 			.setRenderPass(renderPass)
@@ -146,22 +220,33 @@ namespace Pelican
 			.setBasePipelineHandle(nullptr)
 			.setBasePipelineIndex(-1);
 
-		const vk::PipelineCache pipelineCache = m_Device.createPipelineCache(vk::PipelineCacheCreateInfo());
+		const auto startTime = std::chrono::high_resolution_clock::now();
 
-		const vk::ResultValue<vk::Pipeline> pipelineResult = m_Device.createGraphicsPipeline(pipelineCache, pipelineInfo);
+		const vk::ResultValue<vk::Pipeline> pipelineResult = m_Device.createGraphicsPipeline(m_pCache->GetCache(), pipelineInfo);
 
 		if (pipelineResult.result != vk::Result::eSuccess)
 		{
 			throw std::runtime_error("Failed to create graphics pipeline");
 		}
 
+		const float ms = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+		Logger::LogTrace("Created graphics pipeline in %.2fms", ms);
+		m_pCache->AddCreationTime(ms);
+
 		VulkanPipeline pipeline;
-		pipeline.Init(pipelineResult.value, pipelineCache, pipelineLayout);
+		pipeline.Init(pipelineResult.value, pipelineLayout);
+		m_pCache->AddPipeline(std::move(key), pipeline);
 		return pipeline;
 	}
 
 	VulkanPipeline PipelineBuilder::BuildCompute()
 	{
+		PipelineKey key = GetComputeKey();
+		if (const VulkanPipeline* pCached = m_pCache->FindPipeline(key))
+		{
+			return *pCached;
+		}
+
 		vk::PipelineLayout pipelineLayout;
 
 		try
@@ -179,16 +264,55 @@ namespace Pelican
 			.setBasePipelineHandle(nullptr)
 			.setBasePipelineIndex(-1);
 
-		const vk::PipelineCache pipelineCache = m_Device.createPipelineCache(vk::PipelineCacheCreateInfo());
+		const auto startTime = std::chrono::high_resolution_clock::now();
 
-		const vk::ResultValue<vk::Pipeline> pipelineResult = m_Device.createComputePipeline(pipelineCache, pipelineInfo);
+		const vk::ResultValue<vk::Pipeline> pipelineResult = m_Device.createComputePipeline(m_pCache->GetCache(), pipelineInfo);
 		if (pipelineResult.result != vk::Result::eSuccess)
 		{
 			throw std::runtime_error("Failed to create compute pipeline");
 		}
 
+		const float ms = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+		Logger::LogTrace("Created compute pipeline in %.2fms", ms);
+		m_pCache->AddCreationTime(ms);
+
 		VulkanPipeline pipeline;
-		pipeline.Init(pipelineResult.value, pipelineCache, pipelineLayout);
+		pipeline.Init(pipelineResult.value, pipelineLayout);
+		m_pCache->AddPipeline(std::move(key), pipeline);
 		return pipeline;
 	}
+
+	PipelineKey PipelineBuilder::GetGraphicsKey(const vk::RenderPass& renderPass) const
+	{
+		PipelineKey key = GetLayoutKey();
+		key.renderPass = renderPass;
+		key.vertexBinding = m_VertexBinding;
+		key.vertexAttributes = m_VertexAttributes;
+		key.inputAssembly = m_InputAssembly;
+		key.rasterizer = m_Rasterizer;
+		key.multisampling = m_Multisampling;
+		key.depthStencil = m_DepthStencil;
+		key.colorBlendAttachment = m_ColorBlendAttachment;
+		key.logicOpEnable = m_ColorBlending.logicOpEnable;
+		key.logicOp = m_ColorBlending.logicOp;
+		return key;
+	}
+
+	PipelineKey PipelineBuilder::GetComputeKey() const
+	{
+		PipelineKey key = GetLayoutKey();
+		key.isCompute = true;
+		return key;
+	}
+
+	PipelineKey PipelineBuilder::GetLayoutKey() const
+	{
+		PipelineKey key{};
+		key.shaderHash = m_pShader->GetHash();
+		key.shaderModules = m_pShader->GetAllShaderModules();
+		key.setLayouts.assign(m_PipelineLayoutInfo.pSetLayouts, m_PipelineLayoutInfo.pSetLayouts + m_PipelineLayoutInfo.setLayoutCount);
+		key.pushConstants.assign(m_PipelineLayoutInfo.pPushConstantRanges,
+			m_PipelineLayoutInfo.pPushConstantRanges + m_PipelineLayoutInfo.pushConstantRangeCount);
+		return key;
+	}
 }
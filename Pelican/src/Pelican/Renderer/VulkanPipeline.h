@@ -4,51 +4,94 @@
 
 namespace Pelican
 {
+	class VulkanPipelineCache;
 	class VulkanShader;
 
+	// Everything a pipeline gets built from, the pipeline cache looks pipelines up by this.
+	// The Vulkan handles are only compared, the hash leaves them out so it stays the same when they get recreated.
+	struct PipelineKey
+	{
+		bool isCompute{};
+		// Combined stages and code hashes of the shader, along with the modules themselves.
+		size_t shaderHash{};
+		std::vector<vk::ShaderModule> shaderModules{};
+		std::vector<vk::DescriptorSetLayout> setLayouts{};
+		std::vector<vk::PushConstantRange> pushConstants{};
+
+		// Only used by graphics pipelines.
+		vk::RenderPass renderPass{};
+		vk::VertexInputBindingDescription vertexBinding{};
+		std::vector<vk::VertexInputAttributeDescription> vertexAttributes{};
+		vk::PipelineInputAssemblyStateCreateInfo inputAssembly{};
+		vk::PipelineRasterizationStateCreateInfo rasterizer{};
+		vk::PipelineMultisampleStateCreateInfo multisampling{};
+		vk::PipelineDepthStencilStateCreateInfo depthStencil{};
+		vk::PipelineColorBlendAttachmentState colorBlendAttachment{};
+		bool logicOpEnable{};
+		vk::LogicOp logicOp{};
+
+		bool operator==(const PipelineKey& other) const = default;
+	};
+
+	struct PipelineKeyHash
+	{
+		size_t operator()(const PipelineKey& key) const;
+	};
+
 	class VulkanPipeline
 	{
 	public:
 		VulkanPipeline() = default;
 
-		void Init(const vk::Pipeline& pipeline, const vk::PipelineCache& cache, const vk::PipelineLayout& layout);
+		void Init(const vk::Pipeline& pipeline, const vk::PipelineLayout& layout);
 		void Cleanup(vk::Device device) const;
 
 		[[nodiscard]] const vk::Pipeline& GetPipeline() const { return m_Pipeline; }
-		[[nodiscard]] const vk::PipelineCache& GetCache() const { return m_Cache; }
 		[[nodiscard]] const vk::PipelineLayout& GetLayout() const { return m_Layout; }
 
 	private:
 		vk::Pipeline m_Pipeline;
-		vk::PipelineCache m_Cache;
 		vk::PipelineLayout m_Layout;
 	};
 
 	class PipelineBuilder
 	{
 	public:
-		PipelineBuilder(vk::Device device);
+		PipelineBuilder(vk::Device device, VulkanPipelineCache* pCache);
 
 		void SetShader(VulkanShader* pShader);
+		// Reads whole Vertex structs by default.
+		void SetVertexInput(const vk::VertexInputBindingDescription& binding, const std::vector<vk::VertexInputAttributeDescription>& attributes);
 		void SetInputAssembly(vk::PrimitiveTopology topology, bool primitiveRestartEnable);
-		void SetViewport(float x, float y, float width, float height, float minDepth, float maxDepth);
-		void SetScissor(const vk::Offset2D& offset, const vk::Extent2D& extent);
 		void SetRasterizer(vk::PolygonMode polygonMode, vk::CullModeFlagBits cullMode);
 		void SetMultisampling();
 		void SetDepthStencil(bool depthTest, bool depthWrite, vk::CompareOp compareOp);
 		void SetColorBlend(bool blendEnable, vk::BlendOp colorBlendOp, vk::BlendOp alphaBlendOp, bool logicOpEnable, vk::LogicOp logicOp);
+		// SetColorBlend writes every component, this has to be called after it. Pass no components for depth only pipelines.
+		void SetColorWriteMask(vk::ColorComponentFlags writeMask);
 		void SetDescriptorSetLayout(uint32_t layoutsCount, const vk::DescriptorSetLayout* pLayouts, uint32_t pushConstCount, const vk::PushConstantRange* pPushConstants);
 
+		// Both return the pipeline from the pipeline cache when one with the same state was built before,
+		// the returned pipeline is owned by the cache.
+		// Viewport and scissor are dynamic state, they have to be set on the command buffer.
 		VulkanPipeline BuildGraphics(const vk::RenderPass& renderPass);
 		VulkanPipeline BuildCompute();
 
+		// All the state set on this builder, this is what pipelines are looked up by.
+		[[nodiscard]] PipelineKey GetGraphicsKey(const vk::RenderPass& renderPass) const;
+		[[nodiscard]] PipelineKey GetComputeKey() const;
+
+	private:
+		[[nodiscard]] PipelineKey GetLayoutKey() const;
+
 	private:
 		vk::Device m_Device;
+		VulkanPipelineCache* m_pCache{};
 
 		VulkanShader* m_pShader{};
+		vk::VertexInputBindingDescription m_VertexBinding{};
+		std::vector<vk::VertexInputAttributeDescription> m_VertexAttributes{};
 		vk::PipelineInputAssemblyStateCreateInfo m_InputAssembly{};
-		vk::Viewport m_Viewport{};
-		vk::Rect2D m_Scissor{};
 		vk::PipelineRasterizationStateCreateInfo m_Rasterizer{};
 		vk::PipelineMultisampleStateCreateInfo m_Multisampling{};
 		vk::PipelineDepthStencilStateCreateInfo m_DepthStencil{};
@@ -0,0 +1,197 @@
+﻿#include "PelicanPCH.h"
+#include "VulkanPipelineCache.h"
+
+#include <fstream>
+#include <logtools.h>
+
+#include "VulkanDevice.h"
+
+namespace Pelican
+{
+	VulkanPipelineCache::VulkanPipelineCache(VulkanDevice* pDevice, std::filesystem::path path)
+		: m_pDevice(pDevice), m_Path(std::move(path))
+	{
+		const std::vector<char> initialData = LoadFromDisk();
+		m_LoadedFromDisk = !initialData.empty();
+
+		const vk::PipelineCacheCreateInfo createInfo = vk::PipelineCacheCreateInfo()
+			.setInitialDataSize(initialData.size())
+			.setPInitialData(initialData.data());
+
+		try
+		{
+			m_Cache = m_pDevice->GetDevice().createPipelineCache(createInfo);
+		}
+		catch (vk::SystemError& e)
+		{
+			throw std::runtime_error("Failed to create pipeline cache: "s + e.what());
+		}
+
+		if (m_LoadedFromDisk)
+			Logger::LogInfo("Loaded pipeline cache \"%s\" (%llu bytes)", m_Path.string().c_str(), static_cast<unsigned long long>(initialData.size()));
+		else
+			Logger::LogInfo("Starting with an empty pipeline cache, pipelines will be compiled from scratch.");
+	}
+
+	VulkanPipelineCache::~VulkanPipelineCache()
+	{
+		DestroyPipelines();
+		m_pDevice->GetDevice().destroyPipelineCache(m_Cache);
+	}
+
+	void VulkanPipelineCache::Save() const
+	{
+		std::vector<uint8_t> data;
+
+		try
+		{
+			data = m_pDevice->GetDevice().getPipelineCacheData(m_Cache);
+		}
+		catch (vk::SystemError& e)
+		{
+			Logger::LogWarning("Failed to get the pipeline cache data: %s", e.what());
+			return;
+		}
+
+		FileHeader header = CreateHeader();
+		header.dataSize = data.size();
+		header.dataHash = HashData(reinterpret_cast<const char*>(data.data()), data.size());
+
+		std::error_code error;
+		if (m_Path.has_parent_path())
+			std::filesystem::create_directories(m_Path.parent_path(), error);
+
+		// Write to a temporary file first, so a crash halfway through can't leave a broken cache behind.
+		std::filesystem::path tempPath = m_Path;
+		tempPath += ".tmp";
+
+		{
+			std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+			if (!file.is_open())
+			{
+				Logger::LogWarning("Failed to open \"%s\" for writing the pipeline cache", tempPath.string().c_str());
+				return;
+			}
+
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+			if (!file.good())
+			{
+				Logger::LogWarning("Failed to write the pipeline cache to \"%s\"", tempPath.string().c_str());
+				return;
+			}
+		}
+
+		std::filesystem::rename(tempPath, m_Path, error);
+		if (error)
+		{
+			Logger::LogWarning("Failed to move the pipeline cache to \"%s\": %s", m_Path.string().c_str(), error.message().c_str());
+			return;
+		}
+
+		Logger::LogInfo("Saved pipeline cache \"%s\" (%llu bytes)", m_Path.string().c_str(), static_cast<unsigned long long>(data.size()));
+	}
+
+	const VulkanPipeline* VulkanPipelineCache::FindPipeline(const PipelineKey& key)
+	{
+		const auto it = m_Pipelines.find(key);
+		if (it == m_Pipelines.end())
+			return nullptr;
+
+		m_LookupHits++;
+		return &it->second;
+	}
+
+	void VulkanPipelineCache::AddPipeline(PipelineKey key, const VulkanPipeline& pipeline)
+	{
+		ASSERT_MSG(m_Pipelines.find(key) == m_Pipelines.end(), "A pipeline with this state already exists!");
+		m_Pipelines.emplace(std::move(key), pipeline);
+	}
+
+	void VulkanPipelineCache::DestroyPipelines()
+	{
+		for (const auto& [key, pipeline] : m_Pipelines)
+		{
+			pipeline.Cleanup(m_pDevice->GetDevice());
+		}
+		m_Pipelines.clear();
+	}
+
+	void VulkanPipelineCache::AddCreationTime(float ms)
+	{
+		m_PipelineCount++;
+		m_TotalCreationTime += ms;
+	}
+
+	std::vector<char> VulkanPipelineCache::LoadFromDisk() const
+	{
+		std::ifstream file(m_Path, std::ios::binary | std::ios::ate);
+		if (!file.is_open())
+			return {};
+
+		const std::streamoff fileSize = file.tellg();
+		file.seekg(0);
+
+		FileHeader header{};
+		file.read(reinterpret_cast<char*>(&header), sizeof(header));
+		if (!file.good() || header.magic != FILE_MAGIC || header.version != FILE_VERSION)
+		{
+			Logger::LogWarning("Ignoring pipeline cache \"%s\", it isn't a valid pipeline cache file.", m_Path.string().c_str());
+			return {};
+		}
+
+		// Pipeline cache data is only valid on the exact device and driver that created it.
+		const FileHeader expected = CreateHeader();
+		if (header.vendorID != expected.vendorID || header.deviceID != expected.deviceID ||
+			header.driverVersion != expected.driverVersion ||
+			memcmp(header.pipelineCacheUUID, expected.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+		{
+			Logger::LogInfo("Ignoring pipeline cache \"%s\", it was created by a different device or driver.", m_Path.string().c_str());
+			return {};
+		}
+
+		// The size comes from the file, so check it against what's actually there before allocating anything.
+		if (fileSize < static_cast<std::streamoff>(sizeof(header)) ||
+			header.dataSize > static_cast<uint64_t>(fileSize) - sizeof(header))
+		{
+			Logger::LogWarning("Ignoring pipeline cache \"%s\", the file is truncated or corrupt.", m_Path.string().c_str());
+			return {};
+		}
+
+		std::vector<char> data(static_cast<size_t>(header.dataSize));
+		file.read(data.data(), static_cast<std::streamsize>(data.size()));
+		if (!file.good() || HashData(data.data(), data.size()) != header.dataHash)
+		{
+			Logger::LogWarning("Ignoring pipeline cache \"%s\", the file is truncated or corrupt.", m_Path.string().c_str());
+			return {};
+		}
+
+		return data;
+	}
+
+	VulkanPipelineCache::FileHeader VulkanPipelineCache::CreateHeader() const
+	{
+		const vk::PhysicalDeviceProperties properties = m_pDevice->GetPhysicalDevice().getProperties();
+
+		FileHeader header{};
+		header.magic = FILE_MAGIC;
+		header.version = FILE_VERSION;
+		header.vendorID = properties.vendorID;
+		header.deviceID = properties.deviceID;
+		header.driverVersion = properties.driverVersion;
+		memcpy(header.pipelineCacheUUID, &properties.pipelineCacheUUID[0], VK_UUID_SIZE);
+		return header;
+	}
+
+	uint64_t VulkanPipelineCache::HashData(const char* pData, size_t size)
+	{
+		// FNV-1a, only used to catch truncated or corrupted files.
+		uint64_t hash = 14695981039346656037ull;
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= static_cast<uint8_t>(pData[i]);
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+}
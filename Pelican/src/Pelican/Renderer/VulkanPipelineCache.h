@@ -0,0 +1,76 @@
+﻿#pragma once
+
+#include <unordered_map>
+
+#include <vulkan/vulkan.hpp>
+
+#include "VulkanPipeline.h"
+
+namespace Pelican
+{
+	class VulkanDevice;
+
+	// One vk::PipelineCache shared by every pipeline the engine builds.
+	// It gets loaded from disk on startup and written back on shutdown, the file is only used when it was written by
+	// the same device and driver, otherwise we start from an empty cache.
+	// On top of that it owns every pipeline built through a PipelineBuilder, keyed by the builder state.
+	class VulkanPipelineCache final
+	{
+	public:
+		VulkanPipelineCache(VulkanDevice* pDevice, std::filesystem::path path);
+		~VulkanPipelineCache();
+
+		VulkanPipelineCache(const VulkanPipelineCache&) = delete;
+		VulkanPipelineCache& operator=(const VulkanPipelineCache&) = delete;
+
+		void Save() const;
+
+		// Returns nullptr when no pipeline with this state has been built yet.
+		[[nodiscard]] const VulkanPipeline* FindPipeline(const PipelineKey& key);
+		void AddPipeline(PipelineKey key, const VulkanPipeline& pipeline);
+		// Destroys every pipeline, the device must be idle. Used when the shaders or the render pass get recreated,
+		// the keys of the old pipelines point at the destroyed handles.
+		void DestroyPipelines();
+
+		// Gets called by the PipelineBuilder for every pipeline it creates, only used for reporting.
+		void AddCreationTime(float ms);
+
+		[[nodiscard]] vk::PipelineCache GetCache() const { return m_Cache; }
+		// True when the cache was loaded from disk, or when it already holds pipelines from earlier in this run.
+		[[nodiscard]] bool IsWarm() const { return m_LoadedFromDisk || m_PipelineCount > 0; }
+		[[nodiscard]] uint32_t GetPipelineCount() const { return m_PipelineCount; }
+		[[nodiscard]] float GetTotalCreationTime() const { return m_TotalCreationTime; }
+		[[nodiscard]] uint32_t GetLookupHits() const { return m_LookupHits; }
+
+	private:
+		struct FileHeader
+		{
+			uint32_t magic;
+			uint32_t version;
+			uint32_t vendorID;
+			uint32_t deviceID;
+			uint32_t driverVersion;
+			uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+			uint64_t dataSize;
+			uint64_t dataHash;
+		};
+
+		static constexpr uint32_t FILE_MAGIC = 0x43504C50; // "PLPC"
+		static constexpr uint32_t FILE_VERSION = 1;
+
+		[[nodiscard]] std::vector<char> LoadFromDisk() const;
+		[[nodiscard]] FileHeader CreateHeader() const;
+		[[nodiscard]] static uint64_t HashData(const char* pData, size_t size);
+
+	private:
+		VulkanDevice* m_pDevice{};
+		std::filesystem::path m_Path{};
+		vk::PipelineCache m_Cache{};
+		std::unordered_map<PipelineKey, VulkanPipeline, PipelineKeyHash> m_Pipelines{};
+
+		bool m_LoadedFromDisk{};
+		uint32_t m_PipelineCount{};
+		float m_TotalCreationTime{};
+		uint32_t m_LookupHits{};
+	};
+}
@@ -0,0 +1,29 @@
+﻿#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+namespace Pelican
+{
+	// Common interface for everything the renderer can render its main pass into.
+	// This is either the swap chain of a window, or a set of offscreen images when running headless.
+	class VulkanRenderTarget
+	{
+	public:
+		virtual ~VulkanRenderTarget() = default;
+
+		virtual void Initialize() = 0;
+		virtual void CreateFramebuffers(vk::ImageView depthImageView, vk::RenderPass renderPass) = 0;
+		virtual void Cleanup() = 0;
+
+		// The layout the color attachment should be in at the end of the render pass.
+		[[nodiscard]] virtual vk::ImageLayout GetFinalLayout() const = 0;
+		// Whether the images can be the source of a transfer, which frame captures need.
+		[[nodiscard]] virtual bool SupportsCopy() const = 0;
+
+		[[nodiscard]] virtual vk::Format GetImageFormat() const = 0;
+		[[nodiscard]] virtual vk::Extent2D GetExtent() const = 0;
+		[[nodiscard]] virtual std::vector<vk::ImageView> GetImageViews() const = 0;
+		[[nodiscard]] virtual std::vector<vk::Image> GetImages() const = 0;
+		[[nodiscard]] virtual std::vector<vk::Framebuffer> GetFramebuffers() const = 0;
+	};
+}
@@ -5,6 +5,7 @@
 #include <logtools.h>
 
 #include <fstream>
+#include <chrono>
 #include <cstdint>
 #include <array>
 
@@ -18,13 +19,16 @@
 #include <stb_image.h>
 
 #include "Pelican/Core/Application.h"
+#include "Pelican/Core/Profiler.h"
 
 #include "VkInit.h"
 #include "VulkanDebug.h"
+#include "VulkanOffscreenTarget.h"
 #include "UniformData.h"
 #include "Camera.h"
 
 #include "VulkanShader.h"
+#include "Vertex.h"
 #include "VulkanPipeline.h"
 #include "ImGui/ImGuiWrapper.h"
 #include "Pelican/Assets/AssetManager.h"
@@ -43,8 +47,10 @@ namespace Pelican
 		m_pInstance = this;
 	}
 
-	void VulkanRenderer::Initialize()
+	void VulkanRenderer::Initialize(bool headless)
 	{
+		m_Headless = headless;
+
 		CreateInstance();
 
 		if (m_EnableValidationLayers)
@@ -52,23 +58,61 @@ namespace Pelican
 			VkDebug::Setup(m_Instance.get());
 		}
 
-		m_pDevice = new VulkanDevice(m_Instance.get());
+		m_pDevice = new VulkanDevice(m_Instance.get(), m_Headless);
+		m_pAllocator = new VulkanAllocator(m_pDevice);
+		m_pUploader = new VulkanUploader(m_pDevice);
 
 		if (m_EnableValidationLayers)
 		{
 			VkDebugMarker::Setup(m_pDevice->GetDevice());
 		}
 
-		m_pSwapChain = new VulkanSwapChain(m_pDevice);
+		m_pUniformRing = new VulkanUniformRing(m_pDevice, static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT));
+		m_pBindlessTable = new VulkanBindlessTable(m_pDevice, static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT));
+		m_pTextureStreamer = new TextureStreamer(static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT));
+		m_pGpuProfiler = new GpuProfiler(m_pDevice, static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT));
+		m_pFrameCapture = new VulkanFrameCapture(m_pDevice, static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT));
+		m_pGeometryArena = new VulkanGeometryArena(m_pDevice, static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT));
+
+		// Roughly what an average set of ours holds, the pools grow when this turns out to be wrong.
+		const std::vector<VulkanDescriptorAllocator::PoolSizeRatio> poolRatios = {
+			{ vk::DescriptorType::eUniformBuffer, 1.0f },
+			{ vk::DescriptorType::eUniformBufferDynamic, 1.0f },
+			{ vk::DescriptorType::eStorageBuffer, 2.0f },
+			{ vk::DescriptorType::eStorageBufferDynamic, 1.0f },
+			{ vk::DescriptorType::eCombinedImageSampler, 4.0f },
+			{ vk::DescriptorType::eStorageImage, 1.0f },
+		};
+		m_pDescriptorAllocator = new VulkanDescriptorAllocator(m_pDevice->GetDevice(), poolRatios, 16);
+		for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+		{
+			m_FrameDescriptorAllocators.push_back(new VulkanDescriptorAllocator(m_pDevice->GetDevice(), poolRatios));
+		}
+		m_pPipelineCache = new VulkanPipelineCache(m_pDevice, "cache/pipelines.bin");
+		m_pCullingPass = new VulkanCullingPass(m_pDevice, m_pUniformRing, static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT));
+		m_pCullingPass->CreatePipeline(m_pPipelineCache);
+
+		if (m_Headless)
+		{
+			const Window::Params& params = Application::Get().GetWindow()->GetParams();
+			m_pRenderTarget = new VulkanOffscreenTarget(m_pDevice,
+				vk::Extent2D(static_cast<uint32_t>(params.width), static_cast<uint32_t>(params.height)),
+				static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT));
+		}
+		else
+		{
+			m_pSwapChain = new VulkanSwapChain(m_pDevice);
+			m_pRenderTarget = m_pSwapChain;
+		}
 
 		CreateRenderPass();
-		CreateDescriptorSetLayout();
+		CreateFrameSetLayout();
 		CreateGraphicsPipeline();
 		CreateCommandPool();
+		CreateSecondaryCommandPools();
 		CreateDepthResources();
-		m_pSwapChain->CreateFramebuffers(m_DepthImageView, m_RenderPass);
-		CreateUniformBuffers();
-		CreateDescriptorPool();
+		m_pRenderTarget->CreateFramebuffers(m_DepthImageView, m_RenderPass);
+		CreateFrameDescriptorSet();
 		CreateCommandBuffers();
 		CreateSyncObjects();
 
@@ -96,7 +140,18 @@ namespace Pelican
 		delete m_pImGui;
 		m_pImGui = nullptr;
 
-		m_pDevice->GetDevice().destroyDescriptorSetLayout(m_DescriptorSetLayout);
+		// Destroying the pools frees the frame set as well.
+		delete m_pDescriptorAllocator;
+		m_pDescriptorAllocator = nullptr;
+
+		for (VulkanDescriptorAllocator* pAllocator : m_FrameDescriptorAllocators)
+		{
+			delete pAllocator;
+		}
+		m_FrameDescriptorAllocators.clear();
+
+		m_pDevice->GetDevice().destroyDescriptorSetLayout(m_FrameSetLayout);
+		m_pDevice->GetDevice().destroyRenderPass(m_RenderPass);
 
 		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
 		{
@@ -107,9 +162,55 @@ namespace Pelican
 
 		m_pDevice->GetDevice().destroyCommandPool(m_CommandPool);
 
-		delete m_pSwapChain;
+		// Destroying the pools frees their command buffers as well.
+		for (const std::vector<SecondaryCommandPool>& framePools : m_SecondaryPools)
+		{
+			for (const SecondaryCommandPool& pool : framePools)
+			{
+				m_pDevice->GetDevice().destroyCommandPool(pool.pool);
+			}
+		}
+		m_SecondaryPools.clear();
+
+		delete m_pUploader;
+		m_pUploader = nullptr;
+
+		delete m_pUniformRing;
+		m_pUniformRing = nullptr;
+
+		// The scene is gone, so every texture, material and mesh has been released by now.
+		delete m_pBindlessTable;
+		m_pBindlessTable = nullptr;
+
+		// Destroys the images textures retired during the last frames.
+		delete m_pTextureStreamer;
+		m_pTextureStreamer = nullptr;
+
+		delete m_pGeometryArena;
+		m_pGeometryArena = nullptr;
+
+		delete m_pCullingPass;
+		m_pCullingPass = nullptr;
+
+		delete m_pGpuProfiler;
+		m_pGpuProfiler = nullptr;
+
+		// Writes the captures that were still in flight.
+		delete m_pFrameCapture;
+		m_pFrameCapture = nullptr;
+
+		// All pipelines have been created by now, so this is the most complete the cache will get.
+		m_pPipelineCache->Save();
+		delete m_pPipelineCache;
+		m_pPipelineCache = nullptr;
+
+		delete m_pRenderTarget;
+		m_pRenderTarget = nullptr;
 		m_pSwapChain = nullptr;
 
+		delete m_pAllocator;
+		m_pAllocator = nullptr;
+
 		delete m_pDevice;
 		m_pDevice = nullptr;
 
@@ -121,28 +222,46 @@ namespace Pelican
 
 	bool VulkanRenderer::BeginScene()
 	{
-		vk::Result result = m_pDevice->GetDevice().waitForFences(m_InFlightFences[m_CurrentFrame], true, UINT64_MAX);
+		PELICAN_PROFILE_FUNCTION();
+
+		vk::Result result{};
+		{
+			// Time spent here is the CPU waiting for the GPU.
+			PELICAN_PROFILE_SCOPE("Wait for Frame Fence");
+			result = m_pDevice->GetDevice().waitForFences(m_InFlightFences[m_CurrentFrame], true, UINT64_MAX);
+		}
 		if (result != vk::Result::eSuccess)
 		{
 			throw std::runtime_error("Failed to wait for fence");
 		}
 
-		result = m_pDevice->GetDevice().acquireNextImageKHR(
-			m_pSwapChain->GetSwapChain(),
-			// UINT64_MAX,
-			1'000'000'000,
-			m_ImageAvailableSemaphores[m_CurrentFrame],
-			nullptr,
-			&m_CurrentBuffer);
+		// Runs the completion callbacks of finished uploads.
+		m_pUploader->Update();
 
-		if (result == vk::Result::eErrorOutOfDateKHR)
+		if (m_Headless)
 		{
-			RecreateSwapChain();
-			return false;
+			// Offscreen images map 1:1 on the frames in flight, so the fence we just waited on guards this image.
+			m_CurrentBuffer = static_cast<uint32_t>(m_CurrentFrame);
 		}
-		else if (result != vk::Result::eSuccess && result != vk::Result::eSuboptimalKHR)
+		else
 		{
-			throw std::runtime_error("Failed to acquire swap chain image!");
+			result = m_pDevice->GetDevice().acquireNextImageKHR(
+				m_pSwapChain->GetSwapChain(),
+				// UINT64_MAX,
+				1'000'000'000,
+				m_ImageAvailableSemaphores[m_CurrentFrame],
+				nullptr,
+				&m_CurrentBuffer);
+
+			if (result == vk::Result::eErrorOutOfDateKHR)
+			{
+				RecreateSwapChain();
+				return false;
+			}
+			else if (result != vk::Result::eSuccess && result != vk::Result::eSuboptimalKHR)
+			{
+				throw std::runtime_error("Failed to acquire swap chain image!");
+			}
 		}
 
 		if (m_ImagesInFlight[m_CurrentBuffer])
@@ -153,8 +272,26 @@ namespace Pelican
 		}
 		m_ImagesInFlight[m_CurrentBuffer] = m_InFlightFences[m_CurrentFrame];
 
-		UpdateUniformBuffer(m_CurrentBuffer);
-
+		// The fence of this frame has been waited on, so its part of the uniform ring, the bindless indices and texture images
+		// it released, its descriptor sets and its secondary command buffers are free again, and its culling results, timings and capture can be read back.
+		m_pUniformRing->BeginFrame(static_cast<uint32_t>(m_CurrentFrame));
+		m_pBindlessTable->BeginFrame(static_cast<uint32_t>(m_CurrentFrame));
+		m_pTextureStreamer->BeginFrame(static_cast<uint32_t>(m_CurrentFrame));
+		m_pGeometryArena->BeginFrame(static_cast<uint32_t>(m_CurrentFrame));
+		m_pCullingPass->BeginFrame(static_cast<uint32_t>(m_CurrentFrame));
+		m_pGpuProfiler->BeginFrame(static_cast<uint32_t>(m_CurrentFrame));
+		m_pFrameCapture->BeginFrame(static_cast<uint32_t>(m_CurrentFrame));
+		m_FrameDescriptorAllocators[m_CurrentFrame]->Reset();
+
+		m_DescriptorStats.writes = 0;
+		m_DescriptorStats.binds = 0;
+		m_DescriptorStats.skippedBinds = 0;
+
+		for (SecondaryCommandPool& pool : m_SecondaryPools[m_CurrentFrame])
+		{
+			m_pDevice->GetDevice().resetCommandPool(pool.pool);
+			pool.usedCount = 0;
+		}
 
 		BeginCommandBuffers();
 
@@ -166,18 +303,59 @@ namespace Pelican
 
 	void VulkanRenderer::EndScene()
 	{
-		m_pImGui->Render(m_CommandBuffers[m_CurrentBuffer]);
+		PELICAN_PROFILE_FUNCTION();
+
+		const vk::CommandBuffer imGuiCmd = BeginSecondaryCommandBuffer(0);
+		// Captures leave the debug UI out unless they asked for it.
+		m_pImGui->Render(imGuiCmd, m_pFrameCapture->ShouldDrawUi());
+		EndSecondaryCommandBuffer(imGuiCmd);
+		ExecuteSecondaryCommandBuffers({ imGuiCmd });
 
 		// Submit our main scene rendering commands.
 		EndCommandBuffers();
 
-		vk::PipelineStageFlags waitStages[] = { vk::PipelineStageFlagBits::eColorAttachmentOutput };
+		// Kick off everything that was uploaded this frame, this frame's rendering has to wait for it.
+		m_pUploader->Flush();
 
-		const vk::SubmitInfo submitInfo = vk::SubmitInfo()
-			.setWaitSemaphores(m_ImageAvailableSemaphores[m_CurrentFrame])
-			.setPWaitDstStageMask(waitStages)
+		std::vector<vk::Semaphore> waitSemaphores;
+		std::vector<vk::PipelineStageFlags> waitStages;
+		// Only used by the timeline semaphore, binary semaphores ignore their value.
+		std::vector<uint64_t> waitValues;
+		std::vector<vk::Semaphore> signalSemaphores;
+		std::vector<uint64_t> signalValues;
+
+		// There is no image to acquire or present when headless, so no need to synchronize with the presentation engine.
+		if (!m_Headless)
+		{
+			waitSemaphores.push_back(m_ImageAvailableSemaphores[m_CurrentFrame]);
+			waitStages.push_back(vk::PipelineStageFlagBits::eColorAttachmentOutput);
+			waitValues.push_back(0);
+
+			signalSemaphores.push_back(m_RenderFinishedSemaphores[m_CurrentFrame]);
+			signalValues.push_back(0);
+		}
+
+		if (m_pUploader->GetTimelineSemaphore() && m_pUploader->GetLastSubmittedValue() > 0)
+		{
+			waitSemaphores.push_back(m_pUploader->GetTimelineSemaphore());
+			waitStages.push_back(vk::PipelineStageFlagBits::eVertexInput | vk::PipelineStageFlagBits::eVertexShader | vk::PipelineStageFlagBits::eFragmentShader);
+			waitValues.push_back(m_pUploader->GetLastSubmittedValue());
+		}
+
+		const vk::TimelineSemaphoreSubmitInfo timelineInfo = vk::TimelineSemaphoreSubmitInfo()
+			.setWaitSemaphoreValues(waitValues)
+			.setSignalSemaphoreValues(signalValues);
+
+		vk::SubmitInfo submitInfo = vk::SubmitInfo()
 			.setCommandBuffers(m_CommandBuffers[m_CurrentBuffer])
-			.setSignalSemaphores(m_RenderFinishedSemaphores[m_CurrentFrame]);
+			.setWaitSemaphores(waitSemaphores)
+			.setWaitDstStageMask(waitStages)
+			.setSignalSemaphores(signalSemaphores);
+
+		if (m_pUploader->GetTimelineSemaphore())
+		{
+			submitInfo.setPNext(&timelineInfo);
+		}
 
 		m_pDevice->GetDevice().resetFences(m_InFlightFences[m_CurrentFrame]);
 
@@ -190,6 +368,12 @@ namespace Pelican
 			throw std::runtime_error("Failed to submit to the graphics queue: "s + e.what());
 		}
 
+		if (m_Headless)
+		{
+			FinishFrame();
+			return;
+		}
+
 		// Present the image to the window
 		std::vector<vk::SwapchainKHR> swapChains = { m_pSwapChain->GetSwapChain() };
 		const vk::PresentInfoKHR presentInfo = vk::PresentInfoKHR()
@@ -224,6 +408,11 @@ namespace Pelican
 			throw std::runtime_error("Failed to present swap chain image!");
 		}
 
+		FinishFrame();
+	}
+
+	void VulkanRenderer::FinishFrame()
+	{
 		m_CurrentFrame = (m_CurrentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
 
 		if (m_ReloadShadersFlag)
@@ -253,6 +442,11 @@ namespace Pelican
 		return m_pInstance->m_Pipelines[static_cast<int>(Application::Get().m_RenderMode)].GetPipeline();
 	}
 
+	bool VulkanRenderer::IsDepthPrepassActive()
+	{
+		return m_pInstance->m_DepthPrepassEnabled && Application::Get().m_RenderMode == RenderMode::Filled;
+	}
+
 	void VulkanRenderer::CreateInstance()
 	{
 		if (m_EnableValidationLayers && !CheckValidationLayerSupport())
@@ -320,10 +514,15 @@ namespace Pelican
 
 	std::vector<const char*> VulkanRenderer::GetRequiredExtensions() const
 	{
-		uint32_t glfwExtensionCount = 0;
-		const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+		std::vector<const char*> extensions;
 
-		std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+		// GLFW isn't initialized when headless, and we don't need any surface extensions either.
+		if (!m_Headless)
+		{
+			uint32_t glfwExtensionCount = 0;
+			const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+			extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+		}
 
 		if (m_EnableValidationLayers)
 		{
@@ -348,14 +547,14 @@ namespace Pelican
 	void VulkanRenderer::CreateRenderPass()
 	{
 		const vk::AttachmentDescription colorAttachment = vk::AttachmentDescription()
-			.setFormat(m_pSwapChain->GetImageFormat())
+			.setFormat(m_pRenderTarget->GetImageFormat())
 			.setSamples(vk::SampleCountFlagBits::e1)
 			.setLoadOp(vk::AttachmentLoadOp::eClear)
 			.setStoreOp(vk::AttachmentStoreOp::eStore)
 			.setStencilLoadOp(vk::AttachmentLoadOp::eDontCare)
 			.setStencilStoreOp(vk::AttachmentStoreOp::eDontCare)
 			.setInitialLayout(vk::ImageLayout::eUndefined)
-			.setFinalLayout(vk::ImageLayout::ePresentSrcKHR);
+			.setFinalLayout(m_pRenderTarget->GetFinalLayout());
 
 		const vk::AttachmentDescription depthAttachment = vk::AttachmentDescription()
 			.setFormat(FindDepthFormat())
@@ -407,81 +606,35 @@ namespace Pelican
 		VkDebugMarker::SetRenderPassName(m_pDevice->GetDevice(), m_RenderPass, "Main Render Pass");
 	}
 
-	void VulkanRenderer::CreateDescriptorSetLayout()
+	void VulkanRenderer::CreateFrameSetLayout()
 	{
-		const auto mvpUboLayoutBinding = vk::DescriptorSetLayoutBinding()
+		// Camera, lights and the environment map indices are in the frame data, which gets written once per frame.
+		// Materials and textures live in the bindless set, per-object and per-draw data in arrays in the uniform ring.
+		const auto objectsBinding = vk::DescriptorSetLayoutBinding()
 			.setBinding(0)
-			.setDescriptorType(vk::DescriptorType::eUniformBuffer)
+			.setDescriptorType(vk::DescriptorType::eStorageBuffer)
 			.setDescriptorCount(1)
 			.setStageFlags(vk::ShaderStageFlagBits::eVertex)
 			.setPImmutableSamplers(nullptr);
 
-		const auto lightUboBinding = vk::DescriptorSetLayoutBinding()
-			.setBinding(1)
-			.setDescriptorType(vk::DescriptorType::eUniformBuffer)
-			.setDescriptorCount(1)
-			.setStageFlags(vk::ShaderStageFlagBits::eFragment)
-			.setPImmutableSamplers(nullptr);
-
-		const auto albedoSamplerBinding = vk::DescriptorSetLayoutBinding()
+		const auto drawsBinding = vk::DescriptorSetLayoutBinding()
 			.setBinding(2)
+			.setDescriptorType(vk::DescriptorType::eStorageBuffer)
 			.setDescriptorCount(1)
-			.setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
-			.setPImmutableSamplers(nullptr)
-			.setStageFlags(vk::ShaderStageFlagBits::eFragment);
-
-		const auto normalSamplerBinding = vk::DescriptorSetLayoutBinding()
-			.setBinding(3)
-			.setDescriptorCount(1)
-			.setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
-			.setPImmutableSamplers(nullptr)
-			.setStageFlags(vk::ShaderStageFlagBits::eFragment);
-
-		const auto metallicRoughnessSamplerBinding = vk::DescriptorSetLayoutBinding()
-			.setBinding(4)
-			.setDescriptorCount(1)
-			.setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
-			.setPImmutableSamplers(nullptr)
-			.setStageFlags(vk::ShaderStageFlagBits::eFragment);
-
-		const auto ambientOcclusionSamplerBinding = vk::DescriptorSetLayoutBinding()
-			.setBinding(5)
-			.setDescriptorCount(1)
-			.setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
-			.setPImmutableSamplers(nullptr)
-			.setStageFlags(vk::ShaderStageFlagBits::eFragment);
-
-		const auto cubemapSamplerBinding = vk::DescriptorSetLayoutBinding()
-			.setBinding(6)
-			.setDescriptorCount(1)
-			.setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
-			.setPImmutableSamplers(nullptr)
-			.setStageFlags(vk::ShaderStageFlagBits::eFragment);
+			.setStageFlags(vk::ShaderStageFlagBits::eVertex)
+			.setPImmutableSamplers(nullptr);
 
-		const auto radianceMapSamplerBinding = vk::DescriptorSetLayoutBinding()
-			.setBinding(7)
+		const auto frameDataBinding = vk::DescriptorSetLayoutBinding()
+			.setBinding(1)
+			.setDescriptorType(vk::DescriptorType::eUniformBufferDynamic)
 			.setDescriptorCount(1)
-			.setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
-			.setPImmutableSamplers(nullptr)
-			.setStageFlags(vk::ShaderStageFlagBits::eFragment);
+			.setStageFlags(vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment)
+			.setPImmutableSamplers(nullptr);
 
-		const auto irradianceMapSamplerBinding = vk::DescriptorSetLayoutBinding()
-			.setBinding(8)
-			.setDescriptorCount(1)
-			.setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
-			.setPImmutableSamplers(nullptr)
-			.setStageFlags(vk::ShaderStageFlagBits::eFragment);
-
-		const std::array<vk::DescriptorSetLayoutBinding, 9> bindings = {
-			mvpUboLayoutBinding,
-			lightUboBinding,
-			albedoSamplerBinding,
-			normalSamplerBinding,
-			metallicRoughnessSamplerBinding,
-			ambientOcclusionSamplerBinding,
-			cubemapSamplerBinding,
-			radianceMapSamplerBinding,
-			irradianceMapSamplerBinding
+		const std::array<vk::DescriptorSetLayoutBinding, 3> bindings = {
+			objectsBinding,
+			frameDataBinding,
+			drawsBinding
 		};
 
 		const auto layoutInfo = vk::DescriptorSetLayoutCreateInfo()
@@ -489,7 +642,7 @@ namespace Pelican
 
 		try
 		{
-			m_DescriptorSetLayout = m_pDevice->GetDevice().createDescriptorSetLayout(layoutInfo);
+			m_FrameSetLayout = m_pDevice->GetDevice().createDescriptorSetLayout(layoutInfo);
 		}
 		catch (vk::SystemError& e)
 		{
@@ -503,35 +656,65 @@ namespace Pelican
 		pLitShader->AddShader(ShaderType::Vertex, "res/shaders/vert.spv");
 		pLitShader->AddShader(ShaderType::Fragment, "res/shaders/frag.spv");
 
-		vk::PushConstantRange pushConstant = vk::PushConstantRange()
-			.setOffset(0)
-			.setSize(sizeof(CameraPushConst))
-			.setStageFlags(vk::ShaderStageFlagBits::eFragment);
+		// Ordered by how often they change, see DescriptorSetIndex.
+		std::array<vk::DescriptorSetLayout, 2> descLayouts{};
+		descLayouts[FRAME_SET] = m_FrameSetLayout;
+		descLayouts[MATERIAL_SET] = m_pBindlessTable->GetLayout();
 
-		const std::array<vk::DescriptorSetLayout, 1> descLayouts = { m_DescriptorSetLayout };
-		const std::array<vk::PushConstantRange, 1> pushConsts = { pushConstant };
+		const bool warmCache = m_pPipelineCache->IsWarm();
+		const uint32_t lookupHits = m_pPipelineCache->GetLookupHits();
+		const auto startTime = std::chrono::high_resolution_clock::now();
 
-		PipelineBuilder builder{ m_pDevice->GetDevice() };
+		PipelineBuilder builder{ m_pDevice->GetDevice(), m_pPipelineCache };
 		builder.SetShader(pLitShader);
 		builder.SetInputAssembly(vk::PrimitiveTopology::eTriangleList, false);
-		builder.SetViewport(0.0f, 0.0f, static_cast<float>(m_pSwapChain->GetExtent().width), static_cast<float>(m_pSwapChain->GetExtent().height), 0.0f, 1.0f);
-		builder.SetScissor(vk::Offset2D(0, 0), m_pSwapChain->GetExtent());
 		builder.SetRasterizer(vk::PolygonMode::eFill, vk::CullModeFlagBits::eBack);
 		builder.SetMultisampling();
 		builder.SetDepthStencil(true, true, vk::CompareOp::eLess);
 		builder.SetColorBlend(true, vk::BlendOp::eAdd, vk::BlendOp::eAdd, false, vk::LogicOp::eCopy);
-		builder.SetDescriptorSetLayout(static_cast<uint32_t>(descLayouts.size()), descLayouts.data(), static_cast<uint32_t>(pushConsts.size()), pushConsts.data());
+		builder.SetDescriptorSetLayout(static_cast<uint32_t>(descLayouts.size()), descLayouts.data(), 0, nullptr);
 
 		m_Pipelines[static_cast<int>(RenderMode::Filled)] = builder.BuildGraphics(m_RenderPass);
 
-		builder.SetRasterizer(vk::PolygonMode::eLine, vk::CullModeFlagBits::eBack);
+		// The prepass already wrote the closest depth, so only the fragment that ends up visible gets shaded.
+		builder.SetDepthStencil(true, false, vk::CompareOp::eEqual);
+		m_DepthEqualPipeline = builder.BuildGraphics(m_RenderPass);
+
+		// Translucent meshes are drawn back to front after everything else, they can't hide what's behind them.
+		builder.SetDepthStencil(true, false, vk::CompareOp::eLess);
+		m_TranslucentPipeline = builder.BuildGraphics(m_RenderPass);
+		builder.SetDepthStencil(true, true, vk::CompareOp::eLess);
+
+		// Wireframe and point rendering need fillModeNonSolid, which not every device (e.g. software rasterizers) supports.
+		const bool nonSolidFill = m_pDevice->GetEnabledFeatures().fillModeNonSolid;
+
+		builder.SetRasterizer(nonSolidFill ? vk::PolygonMode::eLine : vk::PolygonMode::eFill, vk::CullModeFlagBits::eBack);
 		m_Pipelines[static_cast<int>(RenderMode::Lines)] = builder.BuildGraphics(m_RenderPass);
 
-		builder.SetRasterizer(vk::PolygonMode::ePoint, vk::CullModeFlagBits::eBack);
+		builder.SetRasterizer(nonSolidFill ? vk::PolygonMode::ePoint : vk::PolygonMode::eFill, vk::CullModeFlagBits::eBack);
 		m_Pipelines[static_cast<int>(RenderMode::Points)] = builder.BuildGraphics(m_RenderPass);
 
 		delete pLitShader;
 		pLitShader = nullptr;
+
+		// Vertex shader only, it has to calculate the positions exactly the same way as the lit one for eEqual to pass.
+		VulkanShader* pDepthShader = new VulkanShader();
+		pDepthShader->AddShader(ShaderType::Vertex, "res/shaders/depth_vert.spv");
+
+		const auto positionAttributes = Vertex::GetPositionAttributeDescriptions();
+		builder.SetShader(pDepthShader);
+		builder.SetVertexInput(Vertex::GetPositionBindingDescription(), { positionAttributes.begin(), positionAttributes.end() });
+		builder.SetRasterizer(vk::PolygonMode::eFill, vk::CullModeFlagBits::eBack);
+		builder.SetColorBlend(false, vk::BlendOp::eAdd, vk::BlendOp::eAdd, false, vk::LogicOp::eCopy);
+		builder.SetColorWriteMask({});
+		m_DepthPrepassPipeline = builder.BuildGraphics(m_RenderPass);
+
+		delete pDepthShader;
+		pDepthShader = nullptr;
+
+		const float ms = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+		Logger::LogInfo("Created the lit pipelines in %.2fms (%s pipeline cache, %u reused)",
+			ms, warmCache ? "warm" : "cold", m_pPipelineCache->GetLookupHits() - lookupHits);
 	}
 
 	void VulkanRenderer::CreateCommandPool()
@@ -552,11 +735,40 @@ namespace Pelican
 		}
 	}
 
+	void VulkanRenderer::CreateSecondaryCommandPools()
+	{
+		const uint32_t threadCount = Application::Get().GetThreadPool()->GetThreadCount();
+
+		// Transient, all buffers of a pool get reset at once at the start of the frame.
+		const vk::CommandPoolCreateInfo poolInfo = vk::CommandPoolCreateInfo()
+			.setFlags(vk::CommandPoolCreateFlagBits::eTransient)
+			.setQueueFamilyIndex(m_pDevice->GetGraphicsQueueFamily());
+
+		m_SecondaryPools.resize(MAX_FRAMES_IN_FLIGHT);
+		for (std::vector<SecondaryCommandPool>& framePools : m_SecondaryPools)
+		{
+			framePools.resize(threadCount);
+			for (SecondaryCommandPool& pool : framePools)
+			{
+				try
+				{
+					pool.pool = m_pDevice->GetDevice().createCommandPool(poolInfo);
+				}
+				catch (vk::SystemError& e)
+				{
+					throw std::runtime_error("Failed to create secondary command pool: "s + e.what());
+				}
+			}
+		}
+
+		Logger::LogDebug("Recording secondary command buffers on %u threads", threadCount);
+	}
+
 	void VulkanRenderer::CreateDepthResources()
 	{
 		const vk::Format depthFormat = FindDepthFormat();
 
-		CreateImage(m_pSwapChain->GetExtent().width, m_pSwapChain->GetExtent().height, depthFormat, vk::ImageTiling::eOptimal,
+		CreateImage(m_pRenderTarget->GetExtent().width, m_pRenderTarget->GetExtent().height, depthFormat, vk::ImageTiling::eOptimal,
 			vk::ImageUsageFlagBits::eDepthStencilAttachment, vk::MemoryPropertyFlagBits::eDeviceLocal,
 			m_DepthImage, m_DepthImageMemory);
 		m_DepthImageView = CreateImageView(m_DepthImage, depthFormat, vk::ImageAspectFlagBits::eDepth);
@@ -564,61 +776,42 @@ namespace Pelican
 		TransitionImageLayout(m_DepthImage, depthFormat, vk::ImageLayout::eUndefined, vk::ImageLayout::eDepthStencilAttachmentOptimal);
 	}
 
-	void VulkanRenderer::CreateUniformBuffers()
-	{
-		const vk::DeviceSize uboBufferSize = sizeof(UniformBufferObject);
-		const vk::DeviceSize lightBufferSize = sizeof(DirectionalLight);
-
-		m_MvpUbo.resize(m_pSwapChain->GetImages().size());
-		m_MvpUboMemory.resize(m_pSwapChain->GetImages().size());
-
-		m_LightUbo.resize(m_pSwapChain->GetImages().size());
-		m_LightUboMemory.resize(m_pSwapChain->GetImages().size());
-
-		for (size_t i = 0; i < m_pSwapChain->GetImages().size(); i++)
-		{
-			VulkanHelpers::CreateBuffer(
-				uboBufferSize,
-				vk::BufferUsageFlagBits::eUniformBuffer,
-				vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
-				m_MvpUbo[i], m_MvpUboMemory[i]
-			);
-
-			VulkanHelpers::CreateBuffer(
-				lightBufferSize,
-				vk::BufferUsageFlagBits::eUniformBuffer,
-				vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
-				m_LightUbo[i], m_LightUboMemory[i]);
-		}
-	}
-
-	void VulkanRenderer::CreateDescriptorPool()
+	void VulkanRenderer::CreateFrameDescriptorSet()
 	{
-		std::array<vk::DescriptorPoolSize, 2> poolSizes{};
-
-		poolSizes[0].type = vk::DescriptorType::eUniformBuffer;
-		poolSizes[0].descriptorCount = static_cast<uint32_t>(m_pSwapChain->GetImages().size());
-
-		poolSizes[1].type = vk::DescriptorType::eCombinedImageSampler;
-		poolSizes[1].descriptorCount = static_cast<uint32_t>(m_pSwapChain->GetImages().size());
+		m_FrameDescriptorSet = m_pDescriptorAllocator->Allocate(m_FrameSetLayout);
+
+		// All point at the uniform ring, which never moves. The objects and draws are indexed from the start of the ring,
+		// the frame data gets picked with a dynamic offset.
+		const vk::DescriptorBufferInfo ringInfo(m_pUniformRing->GetBuffer(), 0, VK_WHOLE_SIZE);
+		const vk::DescriptorBufferInfo frameDataInfo(m_pUniformRing->GetBuffer(), 0, sizeof(FrameData));
+
+		const std::array<vk::WriteDescriptorSet, 3> writes = {
+			vk::WriteDescriptorSet()
+				.setDstSet(m_FrameDescriptorSet)
+				.setDstBinding(0)
+				.setDescriptorType(vk::DescriptorType::eStorageBuffer)
+				.setBufferInfo(ringInfo),
+			vk::WriteDescriptorSet()
+				.setDstSet(m_FrameDescriptorSet)
+				.setDstBinding(1)
+				.setDescriptorType(vk::DescriptorType::eUniformBufferDynamic)
+				.setBufferInfo(frameDataInfo),
+			vk::WriteDescriptorSet()
+				.setDstSet(m_FrameDescriptorSet)
+				.setDstBinding(2)
+				.setDescriptorType(vk::DescriptorType::eStorageBuffer)
+				.setBufferInfo(ringInfo),
+		};
 
-		const vk::DescriptorPoolCreateInfo poolInfo = vk::DescriptorPoolCreateInfo()
-			.setMaxSets(static_cast<uint32_t>(m_pSwapChain->GetImages().size()))
-			.setPoolSizes(poolSizes);
+		m_pDevice->GetDevice().updateDescriptorSets(writes, {});
+		m_DescriptorStats.writes += static_cast<uint32_t>(writes.size());
 
-		try
-		{
-			m_DescriptorPool = m_pDevice->GetDevice().createDescriptorPool(poolInfo);
-		}
-		catch (vk::SystemError& e)
-		{
-			throw std::runtime_error("Failed to create descriptor pool: "s + e.what());
-		}
+		VkDebugMarker::SetDescriptorSetName(m_pDevice->GetDevice(), m_FrameDescriptorSet, "Frame Set");
 	}
 
 	void VulkanRenderer::CreateCommandBuffers()
 	{
-		m_CommandBuffers.resize(m_pSwapChain->GetFramebuffers().size());
+		m_CommandBuffers.resize(m_pRenderTarget->GetFramebuffers().size());
 
 		const vk::CommandBufferAllocateInfo allocInfo = vk::CommandBufferAllocateInfo()
 			.setCommandPool(m_CommandPool)
@@ -640,7 +833,7 @@ namespace Pelican
 		m_ImageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
 		m_RenderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
 		m_InFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-		m_ImagesInFlight.resize(m_pSwapChain->GetImages().size(), nullptr);
+		m_ImagesInFlight.resize(m_pRenderTarget->GetImages().size(), nullptr);
 
 		const vk::SemaphoreCreateInfo semaphoreInfo = vk::SemaphoreCreateInfo();
 		const vk::FenceCreateInfo fenceInfo = vk::FenceCreateInfo(vk::FenceCreateFlagBits::eSignaled);
@@ -664,33 +857,19 @@ namespace Pelican
 	{
 		m_pDevice->GetDevice().destroyImageView(m_DepthImageView);
 		m_pDevice->GetDevice().destroyImage(m_DepthImage);
-		m_pDevice->GetDevice().freeMemory(m_DepthImageMemory);
+		m_pAllocator->Free(m_DepthImageMemory);
 
 		m_pDevice->GetDevice().freeCommandBuffers(m_CommandPool, m_CommandBuffers);
 
-		for (int i = 0; i < static_cast<int>(RenderMode::RENDERING_MODE_MAX); i++)
-		{
-			m_Pipelines[i].Cleanup(m_pDevice->GetDevice());
-		}
-		m_UnlitPipeline.Cleanup(m_pDevice->GetDevice());
-		m_pDevice->GetDevice().destroyRenderPass(m_RenderPass);
-
-		m_pSwapChain->Cleanup();
-
-		for (size_t i = 0; i < m_pSwapChain->GetImages().size(); i++)
-		{
-			m_pDevice->GetDevice().destroyBuffer(m_MvpUbo[i]);
-			m_pDevice->GetDevice().freeMemory(m_MvpUboMemory[i]);
-
-			m_pDevice->GetDevice().destroyBuffer(m_LightUbo[i]);
-			m_pDevice->GetDevice().freeMemory(m_LightUboMemory[i]);
-		}
-
-		m_pDevice->GetDevice().destroyDescriptorPool(m_DescriptorPool);
+		m_pRenderTarget->Cleanup();
 	}
 
 	void VulkanRenderer::RecreateSwapChain()
 	{
+		// The offscreen target has a fixed size, there is nothing to recreate.
+		if (m_Headless)
+			return;
+
 		Window::Params params = Application::Get().GetWindow()->GetParams();
 		while (params.width == 0 || params.height == 0)
 		{
@@ -704,14 +883,22 @@ namespace Pelican
 
 		CleanupSwapChain();
 
+		const vk::Format oldFormat = m_pRenderTarget->GetImageFormat();
 		m_pSwapChain->Initialize();
 
-		CreateRenderPass();
-		CreateGraphicsPipeline();
+		// Pipelines are built for the render pass, so only recreate it (and with that, the pipelines)
+		// when the surface format actually changed. The cached pipelines all refer to the old render pass.
+		if (m_pRenderTarget->GetImageFormat() != oldFormat)
+		{
+			m_pPipelineCache->DestroyPipelines();
+			m_pDevice->GetDevice().destroyRenderPass(m_RenderPass);
+			CreateRenderPass();
+			CreateGraphicsPipeline();
+			m_pCullingPass->CreatePipeline(m_pPipelineCache);
+		}
+
 		CreateDepthResources();
-		m_pSwapChain->CreateFramebuffers(m_DepthImageView, m_RenderPass);
-		CreateUniformBuffers();
-		CreateDescriptorPool();
+		m_pRenderTarget->CreateFramebuffers(m_DepthImageView, m_RenderPass);
 		CreateCommandBuffers();
 	}
 
@@ -719,44 +906,15 @@ namespace Pelican
 	{
 		m_pDevice->WaitIdle();
 
-		// Cleanup pipeline
-		// TODO: we should not have to destroy the pipeline cache and pipeline layout, for faster pipeline rebuilding.
-		for (int i = 0; i < static_cast<int>(RenderMode::RENDERING_MODE_MAX); i++)
-		{
-			m_Pipelines[i].Cleanup(m_pDevice->GetDevice());
-		}
-		m_UnlitPipeline.Cleanup(m_pDevice->GetDevice());
-		m_pDevice->GetDevice().destroyRenderPass(m_RenderPass);
+		// The old pipelines won't be looked up anymore, the shader modules are part of the key.
+		m_pPipelineCache->DestroyPipelines();
 
-		CreateRenderPass();
 		CreateGraphicsPipeline();
-	}
-
-	void VulkanRenderer::UpdateUniformBuffer(uint32_t currentImage)
-	{
-		ASSERT_MSG(m_pCamera, "Current camera is nullptr!");
-
-		UniformBufferObject ubo{};
-		ubo.model = glm::mat4(1.0f); // just stay still for now
-		ubo.model = glm::rotate(glm::mat4(1.0f), glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f)) *
-			glm::scale(glm::mat4(1.0f), glm::vec3(0.1f, 0.1f, 0.1f));
-		ubo.view = m_pCamera->GetView();
-		ubo.proj = m_pCamera->GetProjection();
-		ubo.proj[1][1] *= -1;
-
-		void* data = m_pDevice->GetDevice().mapMemory(m_MvpUboMemory[currentImage], 0, sizeof(ubo));
-			memcpy(data, &ubo, sizeof(ubo));
-		m_pDevice->GetDevice().unmapMemory(m_MvpUboMemory[currentImage]);
-
-		const DirectionalLight& light = Application::Get().GetScene()->GetDirectionalLight();
-
-		data = m_pDevice->GetDevice().mapMemory(m_LightUboMemory[currentImage], 0, sizeof(light));
-			memcpy(data, &light, sizeof(light));
-		m_pDevice->GetDevice().unmapMemory(m_LightUboMemory[currentImage]);
+		m_pCullingPass->CreatePipeline(m_pPipelineCache);
 	}
 
 	void VulkanRenderer::CreateImage(uint32_t width, uint32_t height, vk::Format format, vk::ImageTiling tiling,
-		vk::ImageUsageFlags usage, vk::MemoryPropertyFlags properties, vk::Image& image, vk::DeviceMemory& imageMemory) const
+		vk::ImageUsageFlags usage, vk::MemoryPropertyFlags properties, vk::Image& image, VulkanAllocation& imageMemory) const
 	{
 		const vk::ImageCreateInfo imageInfo = vk::ImageCreateInfo()
 			.setImageType(vk::ImageType::e2D)
@@ -779,15 +937,7 @@ namespace Pelican
 			throw std::runtime_error("Failed to create image: "s + e.what());
 		}
 
-		const vk::MemoryRequirements memRequirements = m_pDevice->GetDevice().getImageMemoryRequirements(image);
-
-		const vk::MemoryAllocateInfo allocInfo = vk::MemoryAllocateInfo()
-			.setAllocationSize(memRequirements.size)
-			.setMemoryTypeIndex(VulkanHelpers::FindMemoryType(memRequirements.memoryTypeBits, properties));
-
-		imageMemory = m_pDevice->GetDevice().allocateMemory(allocInfo);
-
-		m_pDevice->GetDevice().bindImageMemory(image, imageMemory, 0);
+		imageMemory = m_pAllocator->AllocateForImage(image, properties);
 	}
 
 	void VulkanRenderer::TransitionImageLayout(vk::Image image, vk::Format format, vk::ImageLayout oldLayout,
@@ -923,6 +1073,79 @@ namespace Pelican
 		return format == vk::Format::eD32SfloatS8Uint || format == vk::Format::eD24UnormS8Uint;
 	}
 
+	vk::CommandBuffer VulkanRenderer::BeginSecondaryCommandBuffer(uint32_t threadIndex)
+	{
+		VulkanRenderer* pRenderer = m_pInstance;
+		SecondaryCommandPool& pool = pRenderer->m_SecondaryPools[pRenderer->m_CurrentFrame][threadIndex];
+
+		if (pool.usedCount == pool.buffers.size())
+		{
+			const vk::CommandBufferAllocateInfo allocInfo = vk::CommandBufferAllocateInfo()
+				.setCommandPool(pool.pool)
+				.setLevel(vk::CommandBufferLevel::eSecondary)
+				.setCommandBufferCount(1);
+
+			try
+			{
+				pool.buffers.push_back(pRenderer->m_pDevice->GetDevice().allocateCommandBuffers(allocInfo)[0]);
+			}
+			catch (vk::SystemError& e)
+			{
+				throw std::runtime_error("Failed to allocate secondary command buffer: "s + e.what());
+			}
+		}
+
+		const vk::CommandBuffer cmd = pool.buffers[pool.usedCount++];
+
+		const vk::CommandBufferInheritanceInfo inheritanceInfo = vk::CommandBufferInheritanceInfo()
+			.setRenderPass(pRenderer->m_RenderPass)
+			.setSubpass(0)
+			.setFramebuffer(GetCurrentFramebuffer());
+
+		const vk::CommandBufferBeginInfo beginInfo = vk::CommandBufferBeginInfo()
+			.setFlags(vk::CommandBufferUsageFlagBits::eRenderPassContinue | vk::CommandBufferUsageFlagBits::eOneTimeSubmit)
+			.setPInheritanceInfo(&inheritanceInfo);
+
+		try
+		{
+			cmd.begin(beginInfo);
+		}
+		catch (vk::SystemError& e)
+		{
+			throw std::runtime_error("Failed to begin secondary command buffer: "s + e.what());
+		}
+
+		// Dynamic state isn't inherited from the primary command buffer.
+		const vk::Extent2D extent = pRenderer->m_pRenderTarget->GetExtent();
+		cmd.setViewport(0, vk::Viewport(0.0f, 0.0f, static_cast<float>(extent.width), static_cast<float>(extent.height), 0.0f, 1.0f));
+		cmd.setScissor(0, vk::Rect2D(vk::Offset2D(0, 0), extent));
+
+		return cmd;
+	}
+
+	void VulkanRenderer::EndSecondaryCommandBuffer(vk::CommandBuffer cmd)
+	{
+		try
+		{
+			cmd.end();
+		}
+		catch (vk::SystemError& e)
+		{
+			throw std::runtime_error("Failed to end secondary command buffer: "s + e.what());
+		}
+	}
+
+	void VulkanRenderer::ExecuteSecondaryCommandBuffers(const std::vector<vk::CommandBuffer>& buffers)
+	{
+		if (buffers.empty())
+			return;
+
+		if (!m_pInstance->m_InRenderPass)
+			m_pInstance->BeginRenderPass();
+
+		GetCurrentBuffer().executeCommands(buffers);
+	}
+
 	void VulkanRenderer::BeginCommandBuffers()
 	{
 		const vk::CommandBufferBeginInfo beginInfo = vk::CommandBufferBeginInfo();
@@ -938,26 +1161,43 @@ namespace Pelican
 			throw std::runtime_error("Failed to begin command buffer: "s + e.what());
 		}
 
+		// Everything the frame records ends up inside this region.
+		m_pGpuProfiler->ResetQueries(cmd);
+		m_pGpuProfiler->BeginRegion(cmd, "Frame", glm::vec4(1.0f));
+	}
+
+	void VulkanRenderer::BeginRenderPass()
+	{
+		const vk::CommandBuffer& cmd = m_CommandBuffers[m_CurrentBuffer];
+
 		std::array<vk::ClearValue, 2> clearValues{};
 		clearValues[0].setColor(vk::ClearColorValue(std::array<float, 4>{0.1f, 0.1f, 0.1f, 1.0f}));
 		clearValues[1].setDepthStencil(vk::ClearDepthStencilValue(1.0f, 0));
 
 		const vk::RenderPassBeginInfo renderPassInfo = vk::RenderPassBeginInfo()
 			.setRenderPass(m_RenderPass)
-			.setFramebuffer(m_pSwapChain->GetFramebuffers()[m_CurrentBuffer])
+			.setFramebuffer(m_pRenderTarget->GetFramebuffers()[m_CurrentBuffer])
 			.setRenderArea(vk::Rect2D()
 				.setOffset(vk::Offset2D(0, 0))
-				.setExtent(m_pSwapChain->GetExtent()))
+				.setExtent(m_pRenderTarget->GetExtent()))
 			.setClearValues(clearValues);
 
-		cmd.beginRenderPass(renderPassInfo, vk::SubpassContents::eInline);
+		// Everything inside the render pass is recorded into secondary command buffers, possibly on other threads.
+		cmd.beginRenderPass(renderPassInfo, vk::SubpassContents::eSecondaryCommandBuffers);
+		m_InRenderPass = true;
 	}
 
 	void VulkanRenderer::EndCommandBuffers()
 	{
 		vk::CommandBuffer& cmd = m_CommandBuffers[m_CurrentBuffer];
 
+		// ImGui always executes a secondary buffer, so the render pass has been begun by now.
 		cmd.endRenderPass();
+		m_InRenderPass = false;
+
+		m_pFrameCapture->RecordCopy(cmd, m_pRenderTarget, m_CurrentBuffer);
+
+		m_pGpuProfiler->EndRegion(cmd);
 
 		try
 		{
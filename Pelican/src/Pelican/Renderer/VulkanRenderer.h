@@ -2,9 +2,22 @@
 
 #include <vulkan/vulkan.hpp>
 
+#include "GpuProfiler.h"
+#include "TextureStreamer.h"
+#include "VulkanAllocator.h"
+#include "VulkanBindlessTable.h"
+#include "VulkanBindTracker.h"
+#include "VulkanCullingPass.h"
+#include "VulkanDescriptorAllocator.h"
 #include "VulkanDevice.h"
+#include "VulkanFrameCapture.h"
+#include "VulkanGeometryArena.h"
 #include "VulkanPipeline.h"
+#include "VulkanPipelineCache.h"
+#include "VulkanRenderTarget.h"
 #include "VulkanSwapChain.h"
+#include "VulkanUniformRing.h"
+#include "VulkanUploader.h"
 
 namespace Pelican
 {
@@ -29,7 +42,8 @@ namespace Pelican
 	public:
 		VulkanRenderer();
 
-		void Initialize();
+		// When headless, we render into offscreen images instead of a swap chain, nothing gets presented.
+		void Initialize(bool headless = false);
 		void BeforeSceneCleanup();
 		void AfterSceneCleanup();
 
@@ -48,19 +62,61 @@ namespace Pelican
 		static int GetMaxImages() { return m_pInstance->MAX_FRAMES_IN_FLIGHT; }
 		static vk::Instance GetInstance() { return m_pInstance->m_Instance.get(); }
 		static VulkanDevice* GetVulkanDevice() { return m_pInstance->m_pDevice; }
+		static VulkanAllocator* GetAllocator() { return m_pInstance->m_pAllocator; }
+		static VulkanUploader* GetUploader() { return m_pInstance->m_pUploader; }
+		static VulkanUniformRing* GetUniformRing() { return m_pInstance->m_pUniformRing; }
+		static VulkanBindlessTable* GetBindlessTable() { return m_pInstance->m_pBindlessTable; }
+		static TextureStreamer* GetTextureStreamer() { return m_pInstance->m_pTextureStreamer; }
+		static VulkanGeometryArena* GetGeometryArena() { return m_pInstance->m_pGeometryArena; }
+		static VulkanCullingPass* GetCullingPass() { return m_pInstance->m_pCullingPass; }
+		static GpuProfiler* GetGpuProfiler() { return m_pInstance->m_pGpuProfiler; }
+		static VulkanFrameCapture* GetFrameCapture() { return m_pInstance->m_pFrameCapture; }
+		static VulkanPipelineCache* GetPipelineCache() { return m_pInstance->m_pPipelineCache; }
 		static VulkanSwapChain* GetSwapChain() { return m_pInstance->m_pSwapChain; }
+		static VulkanRenderTarget* GetRenderTarget() { return m_pInstance->m_pRenderTarget; }
+		static bool IsHeadless() { return m_pInstance->m_Headless; }
 		static vk::Device GetDevice() { return m_pInstance->m_pDevice->GetDevice(); }
 		static vk::RenderPass GetRenderPass() { return m_pInstance->m_RenderPass; }
 		static vk::PhysicalDevice GetPhysicalDevice() { return m_pInstance->m_pDevice->GetPhysicalDevice(); }
 		static vk::Queue GetGraphicsQueue() { return m_pInstance->m_pDevice->GetGraphicsQueue(); }
-		static vk::DescriptorPool GetDescriptorPool() { return m_pInstance->m_DescriptorPool; }
-		static vk::DescriptorSetLayout& GetDescriptorSetLayout() { return m_pInstance->m_DescriptorSetLayout; }
+		// FRAME_SET of the lit pipelines: the object and draw arrays in the uniform ring and the frame data, which is bound with a dynamic offset.
+		// MATERIAL_SET is the bindless set, see GetBindlessTable().
+		static vk::DescriptorSet GetFrameDescriptorSet() { return m_pInstance->m_FrameDescriptorSet; }
+		// Counts of the current frame, reset in BeginScene.
+		static DescriptorStats& GetDescriptorStats() { return m_pInstance->m_DescriptorStats; }
+		// For sets that live until they're explicitly not needed anymore.
+		static VulkanDescriptorAllocator* GetDescriptorAllocator() { return m_pInstance->m_pDescriptorAllocator; }
+		// For sets that are only used in the current frame, they all get freed once the frame has finished on the GPU.
+		static VulkanDescriptorAllocator* GetFrameDescriptorAllocator() { return m_pInstance->m_FrameDescriptorAllocators[m_pInstance->m_CurrentFrame]; }
 		static vk::CommandPool GetCommandPool() { return m_pInstance->m_CommandPool; }
+		// The primary command buffer of this frame. The main render pass only accepts secondary command buffers,
+		// draws have to be recorded through BeginSecondaryCommandBuffer.
+		// The render pass only begins with the first ExecuteSecondaryCommandBuffers of the frame, until then compute
+		// and transfer work can be recorded in here directly.
 		static vk::CommandBuffer GetCurrentBuffer() { return m_pInstance->m_CommandBuffers[m_pInstance->m_CurrentBuffer]; }
-		static vk::Framebuffer GetCurrentFramebuffer() { return m_pInstance->m_pSwapChain->GetFramebuffers()[m_pInstance->m_CurrentBuffer]; }
+		static bool IsInRenderPass() { return m_pInstance->m_InRenderPass; }
+		static vk::Framebuffer GetCurrentFramebuffer() { return m_pInstance->m_pRenderTarget->GetFramebuffers()[m_pInstance->m_CurrentBuffer]; }
 		static vk::PipelineLayout GetPipelineLayout();
 		static vk::Pipeline GetCurrentPipeline();
 		static vk::PipelineLayout GetUnlitPipelineLayout() { return m_pInstance->m_UnlitPipeline.GetLayout(); }
+		// Only writes the depth of the opaque draws, reading nothing but their positions. Has the same layout as the lit pipelines.
+		static const VulkanPipeline& GetDepthPrepassPipeline() { return m_pInstance->m_DepthPrepassPipeline; }
+		// The lit pipeline for draws that are in the depth prepass, it only keeps fragments at the depth that pass wrote.
+		static const VulkanPipeline& GetDepthEqualPipeline() { return m_pInstance->m_DepthEqualPipeline; }
+		// The lit pipeline for translucent draws, they're tested against the depth but don't write it.
+		static const VulkanPipeline& GetTranslucentPipeline() { return m_pInstance->m_TranslucentPipeline; }
+		static bool IsDepthPrepassEnabled() { return m_pInstance->m_DepthPrepassEnabled; }
+		static void SetDepthPrepassEnabled(bool enabled) { m_pInstance->m_DepthPrepassEnabled = enabled; }
+		// Lines and points don't rasterize the same depths as the prepass, so it's only used when filling polygons.
+		static bool IsDepthPrepassActive();
+
+		// Returns a secondary command buffer that continues the main render pass, with the viewport and scissor already set.
+		// Every thread has its own command pool per frame in flight, so this can be called from any thread of the
+		// application's thread pool, as long as it passes its own thread index.
+		static vk::CommandBuffer BeginSecondaryCommandBuffer(uint32_t threadIndex);
+		static void EndSecondaryCommandBuffer(vk::CommandBuffer cmd);
+		// Main thread only, executes the given buffers in order in the main render pass, which gets begun if it wasn't yet.
+		static void ExecuteSecondaryCommandBuffers(const std::vector<vk::CommandBuffer>& buffers);
 
 #if TEST_ENABLE_SKYBOX
 		static VulkanTexture* GetSkybox() { return m_pInstance->m_pSkyboxCubemap; }
@@ -74,13 +130,13 @@ namespace Pelican
 
 		void CreateRenderPass();
 
-		void CreateDescriptorSetLayout();
+		void CreateFrameSetLayout();
 		void CreateGraphicsPipeline();
 
 		void CreateCommandPool();
+		void CreateSecondaryCommandPools();
 		void CreateDepthResources();
-		void CreateUniformBuffers();
-		void CreateDescriptorPool();
+		void CreateFrameDescriptorSet();
 		void CreateCommandBuffers();
 
 		void CreateSyncObjects();
@@ -89,11 +145,11 @@ namespace Pelican
 		void RecreateSwapChain();
 
 		void ReloadShaders_Internal();
-
-		void UpdateUniformBuffer(uint32_t currentImage);
+		// Advances to the next frame in flight, shared by the windowed and headless paths.
+		void FinishFrame();
 
 		void CreateImage(uint32_t width, uint32_t height, vk::Format format, vk::ImageTiling tiling,
-			vk::ImageUsageFlags usage, vk::MemoryPropertyFlags properties, vk::Image& image, vk::DeviceMemory& imageMemory) const;
+			vk::ImageUsageFlags usage, vk::MemoryPropertyFlags properties, vk::Image& image, VulkanAllocation& imageMemory) const;
 		void TransitionImageLayout(vk::Image image, vk::Format format, vk::ImageLayout oldLayout, vk::ImageLayout newLayout) const;
 		void CopyBufferToImage(vk::Buffer buffer, vk::Image image, uint32_t width, uint32_t height) const;
 		vk::ImageView CreateImageView(vk::Image image, vk::Format format, vk::ImageAspectFlags aspectFlags) const;
@@ -103,6 +159,7 @@ namespace Pelican
 		bool HasStencilComponent(vk::Format format) const;
 
 		void BeginCommandBuffers();
+		void BeginRenderPass();
 		void EndCommandBuffers();
 
 	private:
@@ -120,19 +177,49 @@ namespace Pelican
 		};
 
 		VulkanDevice* m_pDevice{};
+		VulkanAllocator* m_pAllocator{};
+		VulkanUploader* m_pUploader{};
+		VulkanUniformRing* m_pUniformRing{};
+		VulkanBindlessTable* m_pBindlessTable{};
+		TextureStreamer* m_pTextureStreamer{};
+		VulkanGeometryArena* m_pGeometryArena{};
+		VulkanCullingPass* m_pCullingPass{};
+		GpuProfiler* m_pGpuProfiler{};
+		VulkanFrameCapture* m_pFrameCapture{};
+		VulkanPipelineCache* m_pPipelineCache{};
+		// Either the swap chain or the offscreen target, everything that doesn't need to present goes through this.
+		VulkanRenderTarget* m_pRenderTarget{};
+		// nullptr when running headless.
 		VulkanSwapChain* m_pSwapChain{};
+		bool m_Headless{};
 
 		vk::RenderPass m_RenderPass;
-		vk::DescriptorSetLayout m_DescriptorSetLayout;
+		vk::DescriptorSetLayout m_FrameSetLayout;
 
+		// Owned by the pipeline cache.
 		VulkanPipeline m_Pipelines[static_cast<int>(RenderMode::RENDERING_MODE_MAX)];
 		VulkanPipeline m_UnlitPipeline;
+		VulkanPipeline m_DepthPrepassPipeline;
+		VulkanPipeline m_DepthEqualPipeline;
+		VulkanPipeline m_TranslucentPipeline;
+		bool m_DepthPrepassEnabled{};
 
 		vk::CommandPool m_CommandPool;
 		std::vector<vk::CommandBuffer> m_CommandBuffers;
+
+		struct SecondaryCommandPool
+		{
+			vk::CommandPool pool{};
+			std::vector<vk::CommandBuffer> buffers{};
+			// Buffers handed out since the pool was last reset.
+			uint32_t usedCount{};
+		};
+		// Indexed by [frame in flight][thread index].
+		std::vector<std::vector<SecondaryCommandPool>> m_SecondaryPools;
 		const int MAX_FRAMES_IN_FLIGHT = 2;
 		size_t m_CurrentFrame = 0;
-		uint32_t m_CurrentBuffer;
+		uint32_t m_CurrentBuffer{};
+		bool m_InRenderPass{};
 		std::vector<vk::Semaphore> m_ImageAvailableSemaphores;
 		std::vector<vk::Semaphore> m_RenderFinishedSemaphores;
 		std::vector<vk::Fence> m_InFlightFences;
@@ -142,14 +229,13 @@ namespace Pelican
 
 		bool m_ReloadShadersFlag = false;
 
-		std::vector<vk::Buffer> m_MvpUbo;
-		std::vector<vk::DeviceMemory> m_MvpUboMemory;
-		std::vector<vk::Buffer> m_LightUbo;
-		std::vector<vk::DeviceMemory> m_LightUboMemory;
-		vk::DescriptorPool m_DescriptorPool;
+		VulkanDescriptorAllocator* m_pDescriptorAllocator{};
+		std::vector<VulkanDescriptorAllocator*> m_FrameDescriptorAllocators;
+		vk::DescriptorSet m_FrameDescriptorSet;
+		DescriptorStats m_DescriptorStats{};
 
 		vk::Image m_DepthImage;
-		vk::DeviceMemory m_DepthImageMemory;
+		VulkanAllocation m_DepthImageMemory;
 		vk::ImageView m_DepthImageView;
 
 
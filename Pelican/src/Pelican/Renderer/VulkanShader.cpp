@@ -1,6 +1,7 @@
 ﻿#include "PelicanPCH.h"
 #include "VulkanShader.h"
 
+#include "Pelican/Core/Hash.h"
 #include "Pelican/Core/System/FileUtils.h"
 
 #include "VulkanHelpers.h"
@@ -21,6 +22,7 @@ namespace Pelican
 		m_Type = other.m_Type;
 		m_ShaderModule = other.m_ShaderModule;
 		m_ShaderInfo = other.m_ShaderInfo;
+		m_CodeHash = other.m_CodeHash;
 
 		other.m_ShaderModule = nullptr;
 	}
@@ -31,6 +33,7 @@ namespace Pelican
 		m_Type = other.m_Type;
 		m_ShaderModule = other.m_ShaderModule;
 		m_ShaderInfo = other.m_ShaderInfo;
+		m_CodeHash = other.m_CodeHash;
 
 		other.m_ShaderModule = nullptr;
 
@@ -57,6 +60,7 @@ namespace Pelican
 		}
 
 		std::vector<char> contents(buf.begin(), buf.end());
+		m_CodeHash = std::hash<std::string>()(buf);
 
 		const vk::ShaderModuleCreateInfo createInfo = vk::ShaderModuleCreateInfo()
 			.setCodeSize(contents.size())
@@ -159,4 +163,15 @@ namespace Pelican
 
 		return infos;
 	}
+
+	size_t VulkanShader::GetHash() const
+	{
+		size_t hash = 0;
+		for (const auto& [type, module] : m_ShaderModules)
+		{
+			HashCombine(hash, static_cast<VkShaderStageFlags>(type));
+			HashCombine(hash, module.GetCodeHash());
+		}
+		return hash;
+	}
 }
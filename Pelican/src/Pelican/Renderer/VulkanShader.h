@@ -30,6 +30,10 @@ namespace Pelican
 		vk::PipelineShaderStageCreateInfo GetShaderInfo() const
 		{ return m_ShaderInfo; }
 
+		// Hash of the SPIR-V code, used to identify pipelines using this shader.
+		size_t GetCodeHash() const
+		{ return m_CodeHash; }
+
 	private:
 		void Initialize();
 		void Cleanup() const;
@@ -40,6 +44,7 @@ namespace Pelican
 
 		vk::ShaderModule m_ShaderModule{ nullptr };
 		vk::PipelineShaderStageCreateInfo m_ShaderInfo;
+		size_t m_CodeHash{};
 	};
 
 	class VulkanShader final
@@ -53,6 +58,8 @@ namespace Pelican
 		[[nodiscard]] vk::PipelineShaderStageCreateInfo GetShaderStage(ShaderType type) const;
 		[[nodiscard]] std::vector<vk::ShaderModule> GetAllShaderModules() const;
 		[[nodiscard]] std::vector<vk::PipelineShaderStageCreateInfo> GetAllShaderStages() const;
+		// Combines the stages and code hashes of all shader modules.
+		[[nodiscard]] size_t GetHash() const;
 
 	private:
 		std::map<ShaderType, ShaderModule> m_ShaderModules;
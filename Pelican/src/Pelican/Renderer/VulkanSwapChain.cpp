@@ -152,6 +152,13 @@ namespace Pelican
 		createInfo.imageArrayLayers = 1;
 		createInfo.imageUsage = vk::ImageUsageFlagBits::eColorAttachment;
 
+		// Frame captures copy out of the swap chain images, most surfaces allow that.
+		m_SupportsCopy = static_cast<bool>(swapChainSupport.capabilities.supportedUsageFlags & vk::ImageUsageFlagBits::eTransferSrc);
+		if (m_SupportsCopy)
+		{
+			createInfo.imageUsage |= vk::ImageUsageFlagBits::eTransferSrc;
+		}
+
 		QueueFamilyIndices indices = m_pDevice->FindQueueFamilies();
 		uint32_t queueFamilyIndices[] = { indices.graphicsFamily.value(), indices.presentFamily.value() };
 
@@ -2,26 +2,31 @@
 
 #include <vulkan/vulkan.hpp>
 
+#include "VulkanRenderTarget.h"
+
 namespace Pelican
 {
 	class VulkanDevice;
 
-	class VulkanSwapChain final
+	class VulkanSwapChain final : public VulkanRenderTarget
 	{
 	public:
 		VulkanSwapChain(VulkanDevice* pDevice);
-		~VulkanSwapChain();
+		~VulkanSwapChain() override;
+
+		void Initialize() override;
+		void CreateFramebuffers(vk::ImageView depthImageView, vk::RenderPass renderPass) override;
+		void Cleanup() override;
 
-		void Initialize();
-		void CreateFramebuffers(vk::ImageView depthImageView, vk::RenderPass renderPass);
-		void Cleanup();
+		vk::ImageLayout GetFinalLayout() const override { return vk::ImageLayout::ePresentSrcKHR; }
+		bool SupportsCopy() const override { return m_SupportsCopy; }
 
 		vk::SwapchainKHR GetSwapChain() const { return m_SwapChain; }
-		vk::Format GetImageFormat() const { return m_SwapChainImageFormat; }
-		vk::Extent2D GetExtent() const { return m_SwapChainExtent; }
-		std::vector<vk::ImageView> GetImageViews() const { return m_SwapChainImageViews; }
-		std::vector<vk::Image> GetImages() const { return m_SwapChainImages; }
-		std::vector<vk::Framebuffer> GetFramebuffers() const { return m_Framebuffers; }
+		vk::Format GetImageFormat() const override { return m_SwapChainImageFormat; }
+		vk::Extent2D GetExtent() const override { return m_SwapChainExtent; }
+		std::vector<vk::ImageView> GetImageViews() const override { return m_SwapChainImageViews; }
+		std::vector<vk::Image> GetImages() const override { return m_SwapChainImages; }
+		std::vector<vk::Framebuffer> GetFramebuffers() const override { return m_Framebuffers; }
 
 	private:
 		vk::SurfaceFormatKHR ChooseSwapSurfaceFormat(const std::vector<vk::SurfaceFormatKHR>& availableFormats) const;
@@ -43,5 +48,6 @@ namespace Pelican
 		vk::Extent2D m_SwapChainExtent{};
 		std::vector<vk::ImageView> m_SwapChainImageViews{};
 		std::vector<vk::Framebuffer> m_Framebuffers{};
+		bool m_SupportsCopy{};
 	};
 }
@@ -5,6 +5,13 @@
 #include <stb_image.h>
 #include <glm/vec4.hpp>
 
+#include "Pelican/Core/Profiler.h"
+
+#include "BcDecoder.h"
+#include "Ktx2File.h"
+#include "MipGenerator.h"
+#include "TextureFormat.h"
+#include "TextureStreamer.h"
 #include "VulkanDebug.h"
 #include "VulkanHelpers.h"
 #include "VulkanRenderer.h"
@@ -24,19 +31,42 @@ namespace Pelican
 
 	VulkanTexture::~VulkanTexture()
 	{
+		// The upload callbacks point at this texture, so they must not run anymore. The uploads themselves still have to
+		// finish before the image can go away.
+		VulkanRenderer::GetUploader()->CancelCallbacks(this);
+		if (!m_IsReady || m_IsStreaming)
+		{
+			VulkanRenderer::GetUploader()->WaitIdle();
+		}
+
+		// The new mips never got registered, so the bindless index still belongs to the previous image.
+		if (m_IsStreaming)
+		{
+			VulkanRenderer::GetTextureStreamer()->RetireImage(m_PreviousImage);
+		}
+
+		if (m_IsStreamed)
+		{
+			VulkanRenderer::GetTextureStreamer()->Unregister(this);
+		}
+
+		VulkanRenderer::GetBindlessTable()->UnregisterTexture(*this, m_BindlessIndex);
+
 		VulkanRenderer::GetDevice().destroySampler(m_ImageSampler);
 		VulkanRenderer::GetDevice().destroyImageView(m_ImageView);
 		VulkanRenderer::GetDevice().destroyImage(m_Image);
-		VulkanRenderer::GetDevice().freeMemory(m_ImageMemory);
+		VulkanRenderer::GetAllocator()->Free(m_ImageMemory);
 	}
 
 	void VulkanTexture::InitFromFile(const std::filesystem::path& path)
 	{
+		PELICAN_PROFILE_FUNCTION();
+
 		m_AssetPath = path;
 
 		void* pixels;
 
-		const std::array<const char*, 8> supportedFormats = {
+		const std::array<const char*, 9> supportedFormats = {
 			".jpg",
 			".png",
 			".tga",
@@ -44,7 +74,8 @@ namespace Pelican
 			".psd",
 			".gif",
 			".hdr",
-			".pic"
+			".pic",
+			".ktx2"
 		};
 
 		bool supported = false;
@@ -66,6 +97,39 @@ namespace Pelican
 
 		Logger::LogDebug("Loading \"%s\" - is hdr: %s", path.string().c_str(), m_IsHDR ? "yes" : "no");
 
+		if (path.extension() == ".ktx2")
+		{
+			// 2D textures start out with their small mips, the texture streamer loads the larger ones once something needs them.
+			Ktx2File file;
+			const bool canStream = m_TextureMode == TextureMode::Texture2d;
+			if (!file.Load(path, canStream ? TextureStreamer::INITIAL_SIZE : UINT32_MAX))
+			{
+				ASSERT_MSG(false, "failed to load texture image!");
+				return;
+			}
+
+			if ((m_TextureMode == TextureMode::Cubemap) != (file.GetFaceCount() == 6) || file.GetLayerCount() != 1)
+			{
+				Logger::LogError("\"%s\" has %u layers and %u faces, which doesn't match its texture mode", path.string().c_str(),
+					file.GetLayerCount(), file.GetFaceCount());
+				ASSERT_MSG(false, "failed to load texture image!");
+				return;
+			}
+
+			m_FirstMip = file.GetFirstLevel();
+			CreateTextureImage(file);
+			CreateTextureImageView();
+			CreateTextureSampler();
+			m_BindlessIndex = VulkanRenderer::GetBindlessTable()->RegisterTexture(*this);
+
+			if (m_FirstMip > 0)
+			{
+				m_IsStreamed = true;
+				VulkanRenderer::GetTextureStreamer()->Register(this);
+			}
+			return;
+		}
+
 		int width, height, nrChannels;
 		if (m_IsHDR)
 			pixels = stbi_loadf(path.string().c_str(), &width, &height, &nrChannels, 0);
@@ -82,6 +146,7 @@ namespace Pelican
 		CreateTextureImage(pixels, width, height, STBI_rgb_alpha);
 		CreateTextureImageView();
 		CreateTextureSampler();
+		m_BindlessIndex = VulkanRenderer::GetBindlessTable()->RegisterTexture(*this);
 
 		stbi_image_free(pixels);
 	}
@@ -93,6 +158,7 @@ namespace Pelican
 		CreateTextureImage(pixels.data(), width, height, 4);
 		CreateTextureImageView();
 		CreateTextureSampler();
+		m_BindlessIndex = VulkanRenderer::GetBindlessTable()->RegisterTexture(*this);
 	}
 
 	void VulkanTexture::InitFromData(void* data, int width, int height, int channels)
@@ -100,6 +166,7 @@ namespace Pelican
 		CreateTextureImage(data, width, height, channels);
 		CreateTextureImageView();
 		CreateTextureSampler();
+		m_BindlessIndex = VulkanRenderer::GetBindlessTable()->RegisterTexture(*this);
 	}
 
 	void VulkanTexture::TransitionLayout(vk::ImageLayout newLayout)
@@ -114,7 +181,7 @@ namespace Pelican
 		barrier.image = m_Image;
 		barrier.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
 		barrier.subresourceRange.baseMipLevel = 0;
-		barrier.subresourceRange.levelCount = 1;
+		barrier.subresourceRange.levelCount = m_MipLevels;
 		barrier.subresourceRange.baseArrayLayer = 0;
 		barrier.subresourceRange.layerCount = m_LayerCount;
 
@@ -172,6 +239,40 @@ namespace Pelican
 		m_ImageLayout = newLayout;
 	}
 
+	vk::DeviceSize VulkanTexture::GetMemorySize(uint32_t firstMip) const
+	{
+		vk::DeviceSize size = 0;
+		for (uint32_t level = firstMip; level < m_FullMipCount; level++)
+		{
+			size += TextureFormat::GetImageSize(m_Format, MipGenerator::GetMipSize(m_FullWidth, level), MipGenerator::GetMipSize(m_FullHeight, level));
+		}
+		return size * m_LayerCount;
+	}
+
+	void VulkanTexture::StreamMips(const Ktx2File& file)
+	{
+		// The current image keeps getting sampled until the new one is uploaded.
+		m_PreviousImage = RetiredImage{ m_Image, m_ImageMemory, m_ImageView, m_ImageSampler };
+		m_PreviousIndex = m_BindlessIndex;
+		const uint32_t firstMip = file.GetFirstLevel();
+		m_IsStreaming = true;
+
+		CreateTextureImage(file);
+		CreateTextureImageView();
+		CreateTextureSampler();
+		VulkanRenderer::GetUploader()->OnComplete([this, firstMip]()
+		{
+			// Descriptors can't be rewritten while frames in flight use them, so the new mips get a new index.
+			m_BindlessIndex = VulkanRenderer::GetBindlessTable()->RegisterTexture(*this);
+			VulkanRenderer::GetBindlessTable()->UnregisterTexture(*this, m_PreviousIndex);
+			VulkanRenderer::GetTextureStreamer()->RetireImage(m_PreviousImage);
+			m_PreviousImage = RetiredImage{};
+			m_PreviousIndex = ~0u;
+			m_FirstMip = firstMip;
+			m_IsStreaming = false;
+		}, this);
+	}
+
 	vk::DescriptorImageInfo VulkanTexture::GetDescriptorImageInfo() const
 	{
 		vk::DescriptorImageInfo info(
@@ -182,42 +283,153 @@ namespace Pelican
 		return info;
 	}
 
-	void VulkanTexture::CreateTextureImage(void* pixelData, int width, int height, int channels)
+	void VulkanTexture::CreateTextureImage(void* pixelData, int width, int height, int /*channels*/)
 	{
-		const vk::DeviceSize size = width * height * channels;
+		m_Format = m_IsHDR ? vk::Format::eR16G16B16A16Sfloat : vk::Format::eR8G8B8A8Srgb;
+		m_SourceFormat = m_Format;
+		// Same as the copy regions, the pixel data has to be in the image's format.
+		const vk::DeviceSize size = TextureFormat::GetImageSize(m_Format, static_cast<uint32_t>(width), static_cast<uint32_t>(height));
+
+		// Cubemaps are stored as a strip of square faces.
+		const uint32_t faceHeight = m_TextureMode == TextureMode::Cubemap ? static_cast<uint32_t>(width) : static_cast<uint32_t>(height);
+		m_MipLevels = MipGenerator::GetMipCount(static_cast<uint32_t>(width), faceHeight);
+
+		// Mips get blitted on the GPU when the format allows it, 8 bit formats can be downsampled on the CPU otherwise.
+		const bool blitMips = m_MipLevels > 1 && SupportsLinearBlit(m_Format);
+		const bool cpuMips = m_MipLevels > 1 && !blitMips && !m_IsHDR;
+		if (m_MipLevels > 1 && !blitMips && !cpuMips)
+		{
+			Logger::LogWarning("Can't generate mips for \"%s\", it will only have one.", m_AssetPath.string().c_str());
+			m_MipLevels = 1;
+		}
 
-		vk::Buffer stagingBuffer;
-		vk::DeviceMemory stagingBufferMemory;
+		vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled;
+		if (blitMips)
+		{
+			usage |= vk::ImageUsageFlagBits::eTransferSrc;
+		}
+		CreateImage(width, height, m_Format, vk::ImageTiling::eOptimal, usage, vk::MemoryPropertyFlagBits::eDeviceLocal);
+		m_FullWidth = m_Width;
+		m_FullHeight = m_Height;
+		m_FullMipCount = m_MipLevels;
+
+		// The uploader takes care of the layout transitions and the blits, the image is ready to be sampled once the upload is done.
+		const vk::ImageSubresourceRange range(vk::ImageAspectFlagBits::eColor, 0, m_MipLevels, 0, m_LayerCount);
+		if (cpuMips)
+		{
+			const std::vector<uint8_t> chain = MipGenerator::BuildChainRgba8(static_cast<const uint8_t*>(pixelData),
+				m_Width, m_Height, m_LayerCount, m_MipLevels, TextureFormat::IsSrgb(m_Format));
+			VulkanRenderer::GetUploader()->UploadImage(m_Image, chain.data(), chain.size(), GetCopyRegions(m_MipLevels), range);
+		}
+		else
+		{
+			VulkanRenderer::GetUploader()->UploadImage(m_Image, pixelData, size, GetCopyRegions(1), range, blitMips);
+		}
+		VulkanRenderer::GetUploader()->OnComplete([this]()
+		{
+			m_IsReady = true;
+		}, this);
+		m_ImageLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+
+		VkDebugMarker::SetImageName(VulkanRenderer::GetDevice(), m_Image, m_AssetPath.string().c_str());
+	}
 
-		VulkanHelpers::CreateBuffer(
-			size,
-			vk::BufferUsageFlagBits::eTransferSrc,
-			vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
-			stagingBuffer, stagingBufferMemory);
+	void VulkanTexture::CreateTextureImage(const Ktx2File& file)
+	{
+		m_SourceFormat = file.GetFormat();
+		m_Format = m_SourceFormat;
+		// Files loaded for streaming start at a smaller level, which becomes mip 0 of the image.
+		const uint32_t firstLevel = file.GetFirstLevel();
+		m_MipLevels = file.GetLevelCount() - firstLevel;
+
+		// Devices without BC support get the blocks decoded here, which costs the memory the compression would have saved.
+		const bool isCompressed = TextureFormat::IsBlockCompressed(m_SourceFormat);
+		const bool decode = isCompressed && !VulkanRenderer::GetVulkanDevice()->GetEnabledFeatures().textureCompressionBC;
+		if (decode)
+		{
+			m_Format = BcDecoder::GetDecodedFormat(m_SourceFormat);
+			Logger::LogDebug("Decoding \"%s\" on the CPU, the device doesn't support BC textures", m_AssetPath.string().c_str());
+		}
 
-		void* data = VulkanRenderer::GetDevice().mapMemory(stagingBufferMemory, 0, size);
-			memcpy(data, pixelData, static_cast<size_t>(size));
-		VulkanRenderer::GetDevice().unmapMemory(stagingBufferMemory);
+		// Uncompressed files without mips get them blitted, like the ones loaded through stb.
+		const uint32_t fullMipCount = MipGenerator::GetMipCount(file.GetWidth(), file.GetHeight());
+		const bool blitMips = file.GetLevelCount() == 1 && fullMipCount > 1 && !isCompressed && SupportsLinearBlit(m_Format);
+		if (blitMips)
+		{
+			m_MipLevels = fullMipCount;
+		}
+		m_FullWidth = file.GetWidth();
+		m_FullHeight = file.GetHeight();
+		m_FullMipCount = firstLevel + m_MipLevels;
 
-		m_Format = m_IsHDR ? vk::Format::eR16G16B16A16Sfloat : vk::Format::eR8G8B8A8Srgb;
-		CreateImage(width, height, m_Format, vk::ImageTiling::eOptimal,
-			vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled, vk::MemoryPropertyFlagBits::eDeviceLocal);
+		vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled;
+		if (blitMips)
+		{
+			usage |= vk::ImageUsageFlagBits::eTransferSrc;
+		}
+		CreateImage(file.GetLevelWidth(firstLevel), file.GetLevelHeight(firstLevel), m_Format, vk::ImageTiling::eOptimal, usage, vk::MemoryPropertyFlagBits::eDeviceLocal);
 
-		TransitionLayout(vk::ImageLayout::eTransferDstOptimal);
+		const auto getRegion = [](vk::DeviceSize offset, uint32_t level, uint32_t layer, uint32_t width, uint32_t height)
+		{
+			vk::BufferImageCopy region{};
+			region.bufferOffset = offset;
+			region.imageSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
+			region.imageSubresource.mipLevel = level;
+			region.imageSubresource.baseArrayLayer = layer;
+			region.imageSubresource.layerCount = 1;
+			region.imageExtent = vk::Extent3D(width, height, 1);
+			return region;
+		};
 
-		if (m_TextureMode == TextureMode::Cubemap)
+		std::vector<vk::BufferImageCopy> regions;
+		const vk::ImageSubresourceRange range(vk::ImageAspectFlagBits::eColor, 0, m_MipLevels, 0, m_LayerCount);
+		if (decode)
 		{
-			CopyBufferToImageCubemap(stagingBuffer);
+			// Every image starts 16 byte aligned, enough for any texel size.
+			std::vector<uint8_t> texels;
+			for (uint32_t level = firstLevel; level < file.GetLevelCount(); level++)
+			{
+				const uint32_t width = file.GetLevelWidth(level);
+				const uint32_t height = file.GetLevelHeight(level);
+				for (uint32_t face = 0; face < m_LayerCount; face++)
+				{
+					const size_t offset = (texels.size() + 15) & ~static_cast<size_t>(15);
+					texels.resize(offset + static_cast<size_t>(TextureFormat::GetImageSize(m_Format, width, height)));
+					BcDecoder::DecodeImage(m_SourceFormat, file.GetImageData(level, 0, face), width, height, texels.data() + offset);
+					regions.push_back(getRegion(offset, level - firstLevel, face, width, height));
+				}
+			}
+
+			VulkanRenderer::GetUploader()->UploadImage(m_Image, texels.data(), texels.size(), regions, range);
 		}
 		else
 		{
-			CopyBufferToImage(stagingBuffer);
-		}
+			// The levels are uploaded straight out of the file, KTX2 already aligns them to the block size.
+			// Small levels are stored first, so find the range that covers all of them.
+			const uint8_t* pBegin = file.GetImageData(firstLevel, 0, 0);
+			const uint8_t* pEnd = pBegin;
+			for (uint32_t level = firstLevel; level < file.GetLevelCount(); level++)
+			{
+				pBegin = std::min(pBegin, file.GetImageData(level, 0, 0));
+				pEnd = std::max(pEnd, file.GetImageData(level, 0, m_LayerCount - 1) + file.GetImageSize(level));
+			}
 
-		TransitionLayout(vk::ImageLayout::eShaderReadOnlyOptimal);
+			for (uint32_t level = firstLevel; level < file.GetLevelCount(); level++)
+			{
+				for (uint32_t face = 0; face < m_LayerCount; face++)
+				{
+					const vk::DeviceSize offset = static_cast<vk::DeviceSize>(file.GetImageData(level, 0, face) - pBegin);
+					regions.push_back(getRegion(offset, level - firstLevel, face, file.GetLevelWidth(level), file.GetLevelHeight(level)));
+				}
+			}
 
-		VulkanRenderer::GetDevice().destroyBuffer(stagingBuffer);
-		VulkanRenderer::GetDevice().freeMemory(stagingBufferMemory);
+			VulkanRenderer::GetUploader()->UploadImage(m_Image, pBegin, static_cast<vk::DeviceSize>(pEnd - pBegin), regions, range, blitMips);
+		}
+		VulkanRenderer::GetUploader()->OnComplete([this]()
+		{
+			m_IsReady = true;
+		}, this);
+		m_ImageLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
 
 		VkDebugMarker::SetImageName(VulkanRenderer::GetDevice(), m_Image, m_AssetPath.string().c_str());
 	}
@@ -235,8 +447,10 @@ namespace Pelican
 		samplerInfo.addressModeU = vk::SamplerAddressMode::eRepeat;
 		samplerInfo.addressModeV = vk::SamplerAddressMode::eRepeat;
 		samplerInfo.addressModeW = vk::SamplerAddressMode::eRepeat;
-		samplerInfo.anisotropyEnable = VK_TRUE;
-		samplerInfo.maxAnisotropy = 16.0f;
+		// Software rasterizers (used when running headless on CI) don't always support anisotropic filtering.
+		const bool anisotropy = VulkanRenderer::GetVulkanDevice()->GetEnabledFeatures().samplerAnisotropy;
+		samplerInfo.anisotropyEnable = anisotropy;
+		samplerInfo.maxAnisotropy = anisotropy ? 16.0f : 1.0f;
 		samplerInfo.borderColor = vk::BorderColor::eIntOpaqueBlack;
 		samplerInfo.unnormalizedCoordinates = false;
 		samplerInfo.compareEnable = false;
@@ -244,7 +458,7 @@ namespace Pelican
 		samplerInfo.mipmapMode = vk::SamplerMipmapMode::eLinear;
 		samplerInfo.mipLodBias = 0.0f;
 		samplerInfo.minLod = 0.0f;
-		samplerInfo.maxLod = 0.0f;
+		samplerInfo.maxLod = static_cast<float>(m_MipLevels);
 
 		try
 		{
@@ -273,13 +487,20 @@ namespace Pelican
 		imageInfo.extent.width = m_Width;
 		imageInfo.extent.height = m_Height;
 		imageInfo.extent.depth = 1;
-		imageInfo.mipLevels = 1;
+		imageInfo.mipLevels = m_MipLevels;
 		imageInfo.arrayLayers = m_LayerCount;
 		imageInfo.format = m_Format;
 		imageInfo.tiling = tiling;
 		imageInfo.initialLayout = vk::ImageLayout::eUndefined;
 		imageInfo.usage = usage;
 		imageInfo.sharingMode = vk::SharingMode::eExclusive;
+
+		// Filled on the transfer queue, sampled on the graphics queue.
+		const std::vector<uint32_t>& queueFamilies = VulkanRenderer::GetVulkanDevice()->GetResourceQueueFamilies();
+		if ((usage & vk::ImageUsageFlagBits::eTransferDst) && queueFamilies.size() > 1)
+		{
+			imageInfo.setSharingMode(vk::SharingMode::eConcurrent).setQueueFamilyIndices(queueFamilies);
+		}
 		imageInfo.samples = vk::SampleCountFlagBits::e1;
 		imageInfo.flags = flags;
 
@@ -292,21 +513,7 @@ namespace Pelican
 			throw std::runtime_error("Failed to create image: "s + e.what());
 		}
 
-		vk::MemoryRequirements memRequirements = VulkanRenderer::GetDevice().getImageMemoryRequirements(m_Image);
-		vk::MemoryAllocateInfo allocInfo(
-			memRequirements.size,
-			VulkanHelpers::FindMemoryType(memRequirements.memoryTypeBits, properties));
-
-		try
-		{
-			m_ImageMemory = VulkanRenderer::GetDevice().allocateMemory(allocInfo);
-		}
-		catch (vk::SystemError& e)
-		{
-			throw std::runtime_error("Failed to allocate image memory: "s + e.what());
-		}
-
-		VulkanRenderer::GetDevice().bindImageMemory(m_Image, m_ImageMemory, 0);
+		m_ImageMemory = VulkanRenderer::GetAllocator()->AllocateForImage(m_Image, properties);
 	}
 
 	vk::ImageView VulkanTexture::CreateImageView(vk::ImageAspectFlags aspectFlags)
@@ -321,7 +528,7 @@ namespace Pelican
 		viewInfo.format = m_Format;
 		viewInfo.subresourceRange.aspectMask = aspectFlags;
 		viewInfo.subresourceRange.baseMipLevel = 0;
-		viewInfo.subresourceRange.levelCount = 1;
+		viewInfo.subresourceRange.levelCount = m_MipLevels;
 		viewInfo.subresourceRange.baseArrayLayer = 0;
 		viewInfo.subresourceRange.layerCount = m_LayerCount;
 
@@ -338,53 +545,43 @@ namespace Pelican
 		return imageView;
 	}
 
-	void VulkanTexture::CopyBufferToImage(vk::Buffer buffer)
-	{
-		vk::CommandBuffer commandBuffer = VulkanHelpers::BeginSingleTimeCommands();
-
-		vk::BufferImageCopy region{};
-		region.bufferOffset = 0;
-		region.bufferRowLength = 0;
-		region.bufferImageHeight = 0;
-		region.imageSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
-		region.imageSubresource.mipLevel = 0;
-		region.imageSubresource.baseArrayLayer = 0;
-		region.imageSubresource.layerCount = 1;
-		region.imageOffset = vk::Offset3D(0, 0, 0);
-		region.imageExtent = vk::Extent3D(m_Width, m_Height, 1);
-
-		commandBuffer.copyBufferToImage(buffer, m_Image, vk::ImageLayout::eTransferDstOptimal, region);
-
-		VulkanHelpers::EndSingleTimeCommands(commandBuffer);
-	}
-
-	void VulkanTexture::CopyBufferToImageCubemap(vk::Buffer buffer)
+	std::vector<vk::BufferImageCopy> VulkanTexture::GetCopyRegions(uint32_t levelCount) const
 	{
-		vk::CommandBuffer cmd = VulkanHelpers::BeginSingleTimeCommands();
-
 		std::vector<vk::BufferImageCopy> regions;
 
-		for (uint32_t face = 0; face < 6; face++)
+		vk::DeviceSize offset = 0;
+		for (uint32_t layer = 0; layer < m_LayerCount; layer++)
 		{
-			// TODO: add support for mip levels.
+			for (uint32_t level = 0; level < levelCount; level++)
+			{
+				const uint32_t width = MipGenerator::GetMipSize(m_Width, level);
+				const uint32_t height = MipGenerator::GetMipSize(m_Height, level);
+
+				vk::BufferImageCopy region{};
+				region.bufferOffset = offset;
+				region.bufferRowLength = 0;
+				region.bufferImageHeight = 0;
+				region.imageSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
+				region.imageSubresource.mipLevel = level;
+				region.imageSubresource.baseArrayLayer = layer;
+				region.imageSubresource.layerCount = 1;
+				region.imageOffset = vk::Offset3D(0, 0, 0);
+				region.imageExtent = vk::Extent3D(width, height, 1);
+				regions.push_back(region);
+
+				offset += TextureFormat::GetImageSize(m_Format, width, height);
+			}
+		}
 
-			const uint32_t imageSize = m_Width * m_Height * 4 * 6;
-			const uint32_t layerSize = imageSize / 6;
-			const uint32_t offset = layerSize * face;
+		return regions;
+	}
 
-			vk::BufferImageCopy region{};
-			region.bufferOffset = offset;
-			region.imageSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
-			region.imageSubresource.mipLevel = 0;
-			region.imageSubresource.baseArrayLayer = face;
-			region.imageSubresource.layerCount = 1;
-			region.imageExtent.width = m_Width;
-			region.imageExtent.height = m_Height;
-			region.imageExtent.depth = 1;
-			regions.push_back(region);
-		}
+	bool VulkanTexture::SupportsLinearBlit(vk::Format format)
+	{
+		const vk::FormatFeatureFlags required = vk::FormatFeatureFlagBits::eBlitSrc | vk::FormatFeatureFlagBits::eBlitDst
+			| vk::FormatFeatureFlagBits::eSampledImageFilterLinear;
+		const vk::FormatProperties properties = VulkanRenderer::GetVulkanDevice()->GetPhysicalDevice().getFormatProperties(format);
 
-		cmd.copyBufferToImage(buffer, m_Image, vk::ImageLayout::eTransferDstOptimal, regions);
-		VulkanHelpers::EndSingleTimeCommands(cmd);
+		return (properties.optimalTilingFeatures & required) == required;
 	}
 }
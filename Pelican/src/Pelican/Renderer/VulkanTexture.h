@@ -4,9 +4,13 @@
 #include <glm/vec4.hpp>
 
 #include "Pelican/Assets/BaseAsset.h"
+#include "Pelican/Renderer/TextureStreamer.h"
+#include "Pelican/Renderer/VulkanAllocator.h"
 
 namespace Pelican
 {
+	class Ktx2File;
+
 	class VulkanTexture : public BaseAsset
 	{
 	public:
@@ -35,8 +39,38 @@ namespace Pelican
 
 		[[nodiscard]] vk::DescriptorImageInfo GetDescriptorImageInfo() const;
 
+		[[nodiscard]] vk::Format GetFormat() const { return m_Format; }
+		// The format the file stored the texture in, differs from GetFormat() when it had to be decoded on the CPU.
+		[[nodiscard]] vk::Format GetSourceFormat() const { return m_SourceFormat; }
+
+		// False while the pixel data is still being uploaded.
+		[[nodiscard]] bool IsReady() const { return m_IsReady; }
+
+		[[nodiscard]] TextureMode GetTextureMode() const { return m_TextureMode; }
+		// Index into the bindless texture or cubemap array, depending on the texture mode.
+		[[nodiscard]] uint32_t GetBindlessIndex() const { return m_BindlessIndex; }
+
+		// Streamed textures only have the mips from GetResidentMip() on in memory, the TextureStreamer loads the others.
+		[[nodiscard]] bool IsStreamed() const { return m_IsStreamed; }
+		// True while other mips are being uploaded, the texture keeps sampling its current ones until they're done.
+		[[nodiscard]] bool IsStreaming() const { return m_IsStreaming; }
+		[[nodiscard]] uint32_t GetResidentMip() const { return m_FirstMip; }
+		// Counts the mips that aren't resident as well, the same goes for the full size.
+		[[nodiscard]] uint32_t GetMipCount() const { return m_FullMipCount; }
+		[[nodiscard]] uint32_t GetFullWidth() const { return m_FullWidth; }
+		[[nodiscard]] uint32_t GetFullHeight() const { return m_FullHeight; }
+		// Memory the mips from firstMip on take, the resident ones by default.
+		[[nodiscard]] vk::DeviceSize GetMemorySize() const { return GetMemorySize(m_FirstMip); }
+		[[nodiscard]] vk::DeviceSize GetMemorySize(uint32_t firstMip) const;
+
+		// Replaces the resident mips with the ones the file has loaded. The texture gets a new bindless index once the upload
+		// is done, materials using it have to be registered again after that.
+		void StreamMips(const Ktx2File& file);
+
 	private:
 		void CreateTextureImage(void* pixelData, int width, int height, int channels);
+		// Uploads the mips stored in the file, block compressed ones get decoded first when the device can't sample them.
+		void CreateTextureImage(const Ktx2File& file);
 		void CreateTextureImageView();
 		void CreateTextureSampler();
 
@@ -44,12 +78,14 @@ namespace Pelican
 		void CreateImage(uint32_t width, uint32_t height, vk::Format format, vk::ImageTiling tiling,
 			vk::ImageUsageFlags usage, vk::MemoryPropertyFlags properties);
 		vk::ImageView CreateImageView(vk::ImageAspectFlags aspectFlags);
-		void CopyBufferToImage(vk::Buffer buffer);
-		void CopyBufferToImageCubemap(vk::Buffer buffer);
+		// Regions for the first levelCount mips of every layer, the buffer has each layer's mips after each other.
+		[[nodiscard]] std::vector<vk::BufferImageCopy> GetCopyRegions(uint32_t levelCount) const;
+		// Whether the GPU can generate the mips of the format with linear blits.
+		[[nodiscard]] static bool SupportsLinearBlit(vk::Format format);
 
 	private:
 		vk::Image m_Image{};
-		vk::DeviceMemory m_ImageMemory{};
+		VulkanAllocation m_ImageMemory{};
 		vk::ImageView m_ImageView{};
 		vk::Sampler m_ImageSampler{};
 
@@ -57,9 +93,22 @@ namespace Pelican
 		uint32_t m_Width{};
 		uint32_t m_Height{};
 		uint32_t m_LayerCount{};
+		uint32_t m_MipLevels{ 1 };
+		uint32_t m_FirstMip{};
+		uint32_t m_FullMipCount{ 1 };
+		uint32_t m_FullWidth{};
+		uint32_t m_FullHeight{};
 		vk::Format m_Format{};
+		vk::Format m_SourceFormat{};
 		vk::ImageLayout m_ImageLayout{};
 
 		bool m_IsHDR;
+		bool m_IsReady{};
+		bool m_IsStreamed{};
+		bool m_IsStreaming{};
+		uint32_t m_BindlessIndex{ ~0u };
+		// The image that keeps getting sampled while other mips are streamed in, along with its bindless index.
+		RetiredImage m_PreviousImage{};
+		uint32_t m_PreviousIndex{ ~0u };
 	};
 }
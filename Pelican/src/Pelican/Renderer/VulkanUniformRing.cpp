@@ -0,0 +1,61 @@
+﻿#include "PelicanPCH.h"
+#include "VulkanUniformRing.h"
+
+#include "VulkanDebug.h"
+#include "VulkanDevice.h"
+#include "VulkanHelpers.h"
+
+namespace Pelican
+{
+	VulkanUniformRing::VulkanUniformRing(VulkanDevice* pDevice, uint32_t frameCount, vk::DeviceSize frameSize)
+	{
+		const vk::PhysicalDeviceLimits& limits = pDevice->GetPhysicalDevice().getProperties().limits;
+		m_Alignment = std::max<vk::DeviceSize>({ limits.minUniformBufferOffsetAlignment, limits.minStorageBufferOffsetAlignment, 16 });
+		m_FrameSize = (frameSize + m_Alignment - 1) / m_Alignment * m_Alignment;
+
+		// Dynamic offsets are 32 bit.
+		ASSERT_MSG(m_FrameSize * frameCount <= UINT32_MAX, "Uniform ring is too big to be addressed with dynamic offsets!");
+
+		VulkanHelpers::CreateBuffer(m_FrameSize * frameCount, vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer,
+			vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+			m_Buffer, m_Memory);
+
+		VkDebugMarker::SetBufferName(pDevice->GetDevice(), m_Buffer, "Uniform Ring");
+	}
+
+	VulkanUniformRing::~VulkanUniformRing()
+	{
+		VulkanHelpers::DestroyBuffer(m_Buffer, m_Memory);
+	}
+
+	void VulkanUniformRing::BeginFrame(uint32_t frameIndex)
+	{
+		m_PeakUsed = GetPeakUsedBytes();
+		m_FrameBase = m_FrameSize * frameIndex;
+		m_Head = m_FrameBase;
+	}
+
+	uint32_t VulkanUniformRing::Allocate(vk::DeviceSize size, void*& pMapped)
+	{
+		const vk::DeviceSize alignedSize = (size + m_Alignment - 1) / m_Alignment * m_Alignment;
+
+		const vk::DeviceSize offset = m_Head.fetch_add(alignedSize);
+		if (offset + alignedSize > m_FrameBase + m_FrameSize)
+		{
+			throw std::runtime_error("Uniform ring is out of space, increase its frame size!");
+		}
+
+		pMapped = static_cast<uint8_t*>(m_Memory.pMapped) + offset;
+		return static_cast<uint32_t>(offset);
+	}
+
+	uint32_t VulkanUniformRing::AllocateArray(vk::DeviceSize elementSize, uint32_t count, void*& pMapped)
+	{
+		// One extra element, so the start can be moved up to a multiple of the element size.
+		const uint32_t offset = Allocate(elementSize * (count + 1), pMapped);
+		const vk::DeviceSize firstElement = (offset + elementSize - 1) / elementSize;
+
+		pMapped = static_cast<uint8_t*>(pMapped) + (firstElement * elementSize - offset);
+		return static_cast<uint32_t>(firstElement);
+	}
+}
@@ -0,0 +1,61 @@
+﻿#pragma once
+
+#include <atomic>
+
+#include <vulkan/vulkan.hpp>
+
+#include "VulkanAllocator.h"
+
+namespace Pelican
+{
+	class VulkanDevice;
+
+	// One persistently mapped uniform buffer, split into a region per frame in flight.
+	// Every allocation is a pointer bump inside the current frame's region, the returned offset is meant to be
+	// passed as a dynamic offset when binding a descriptor set that points at GetBuffer().
+	// The buffer can be bound as a storage or indirect buffer as well, arrays in there get addressed by element index instead.
+	class VulkanUniformRing final
+	{
+	public:
+		VulkanUniformRing(VulkanDevice* pDevice, uint32_t frameCount, vk::DeviceSize frameSize = 4ull * 1024 * 1024);
+		~VulkanUniformRing();
+
+		VulkanUniformRing(const VulkanUniformRing&) = delete;
+		VulkanUniformRing& operator=(const VulkanUniformRing&) = delete;
+
+		// Only call this once the fence of the given frame has been waited on, the GPU might still be reading its region otherwise.
+		void BeginFrame(uint32_t frameIndex);
+
+		// Returns the dynamic offset of the slice, the slice itself can be written through pMapped.
+		// Safe to call from multiple threads at once.
+		[[nodiscard]] uint32_t Allocate(vk::DeviceSize size, void*& pMapped);
+
+		template<typename T>
+		[[nodiscard]] uint32_t Push(const T& data)
+		{
+			void* pMapped;
+			const uint32_t offset = Allocate(sizeof(T), pMapped);
+			memcpy(pMapped, &data, sizeof(T));
+			return offset;
+		}
+
+		// Returns the index of the first element, counted from the start of the buffer, so a storage buffer descriptor
+		// covering the whole ring can address it without dynamic offsets.
+		[[nodiscard]] uint32_t AllocateArray(vk::DeviceSize elementSize, uint32_t count, void*& pMapped);
+
+		[[nodiscard]] vk::Buffer GetBuffer() const { return m_Buffer; }
+		[[nodiscard]] vk::DeviceSize GetFrameSize() const { return m_FrameSize; }
+		[[nodiscard]] vk::DeviceSize GetUsedBytes() const { return std::min(m_Head.load(), m_FrameBase + m_FrameSize) - m_FrameBase; }
+		[[nodiscard]] vk::DeviceSize GetPeakUsedBytes() const { return std::max(m_PeakUsed, GetUsedBytes()); }
+
+	private:
+		vk::Buffer m_Buffer{};
+		VulkanAllocation m_Memory{};
+
+		vk::DeviceSize m_Alignment{};
+		vk::DeviceSize m_FrameSize{};
+		vk::DeviceSize m_FrameBase{};
+		std::atomic<vk::DeviceSize> m_Head{};
+		vk::DeviceSize m_PeakUsed{};
+	};
+}
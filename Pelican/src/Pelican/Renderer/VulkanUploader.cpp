@@ -0,0 +1,631 @@
+﻿#include "PelicanPCH.h"
+#include "VulkanUploader.h"
+
+#include <logtools.h>
+
+#include "VulkanDebug.h"
+#include "VulkanDevice.h"
+#include "VulkanHelpers.h"
+#include "VulkanRenderer.h"
+
+namespace Pelican
+{
+	VulkanUploader::VulkanUploader(VulkanDevice* pDevice, vk::DeviceSize stagingSize)
+		: m_pDevice(pDevice)
+	{
+		const vk::Device device = m_pDevice->GetDevice();
+
+		const vk::CommandPoolCreateInfo poolInfo = vk::CommandPoolCreateInfo()
+			.setFlags(vk::CommandPoolCreateFlagBits::eResetCommandBuffer)
+			.setQueueFamilyIndex(m_pDevice->GetTransferQueueFamily());
+
+		try
+		{
+			m_CommandPool = device.createCommandPool(poolInfo);
+
+			if (m_pDevice->HasDedicatedTransferQueue())
+			{
+				m_MipCommandPool = device.createCommandPool(vk::CommandPoolCreateInfo(poolInfo).setQueueFamilyIndex(m_pDevice->GetGraphicsQueueFamily()));
+			}
+		}
+		catch (vk::SystemError& e)
+		{
+			throw std::runtime_error("Failed to create upload command pool: "s + e.what());
+		}
+
+		if (m_pDevice->GetEnabledFeatures12().timelineSemaphore)
+		{
+			vk::SemaphoreTypeCreateInfo typeInfo(vk::SemaphoreType::eTimeline, 0);
+			const vk::SemaphoreCreateInfo semaphoreInfo = vk::SemaphoreCreateInfo().setPNext(&typeInfo);
+
+			try
+			{
+				m_TimelineSemaphore = device.createSemaphore(semaphoreInfo);
+			}
+			catch (vk::SystemError& e)
+			{
+				throw std::runtime_error("Failed to create upload timeline semaphore: "s + e.what());
+			}
+
+			VkDebugMarker::SetSemaphoreName(device, m_TimelineSemaphore, "Upload Timeline");
+		}
+		else
+		{
+			Logger::LogWarning("Timeline semaphores aren't supported, uploads will block until they're finished.");
+		}
+
+		// Copies into images need their buffer offset aligned to the texel size, this covers every format we use.
+		const vk::DeviceSize copyAlignment = m_pDevice->GetPhysicalDevice().getProperties().limits.optimalBufferCopyOffsetAlignment;
+		m_StagingAlignment = std::max<vk::DeviceSize>(copyAlignment, 16);
+		m_StagingSize = (stagingSize + m_StagingAlignment - 1) / m_StagingAlignment * m_StagingAlignment;
+
+		VulkanHelpers::CreateBuffer(m_StagingSize, vk::BufferUsageFlagBits::eTransferSrc,
+			vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+			m_StagingBuffer, m_StagingMemory);
+
+		VkDebugMarker::SetBufferName(device, m_StagingBuffer, "Upload Staging Ring");
+	}
+
+	VulkanUploader::~VulkanUploader()
+	{
+		WaitIdle();
+
+		const vk::Device device = m_pDevice->GetDevice();
+
+		for (const Batch& batch : m_FreeBatches)
+		{
+			device.destroyFence(batch.fence);
+			if (batch.mipSemaphore)
+			{
+				device.destroySemaphore(batch.mipSemaphore);
+			}
+		}
+		m_FreeBatches.clear();
+
+		// Frees all the command buffers as well.
+		device.destroyCommandPool(m_CommandPool);
+		if (m_MipCommandPool)
+		{
+			device.destroyCommandPool(m_MipCommandPool);
+		}
+
+		if (m_TimelineSemaphore)
+		{
+			device.destroySemaphore(m_TimelineSemaphore);
+		}
+
+		VulkanHelpers::DestroyBuffer(m_StagingBuffer, m_StagingMemory);
+	}
+
+	void VulkanUploader::UploadBuffer(vk::Buffer dstBuffer, const void* pData, vk::DeviceSize size, vk::DeviceSize dstOffset)
+	{
+		if (size == 0)
+			return;
+
+		const auto [srcBuffer, srcOffset] = WriteStaging(pData, size);
+
+		m_Recording.bufferCopies.push_back({ srcBuffer, dstBuffer, vk::BufferCopy(srcOffset, dstOffset, size) });
+		m_Recording.bytes += size;
+	}
+
+	void VulkanUploader::UploadImage(vk::Image dstImage, const void* pData, vk::DeviceSize size,
+		const std::vector<vk::BufferImageCopy>& regions, const vk::ImageSubresourceRange& range, bool generateMips)
+	{
+		const auto [srcBuffer, srcOffset] = WriteStaging(pData, size);
+
+		PendingImageCopy copy{ srcBuffer, dstImage, regions, range, generateMips && range.levelCount > 1 };
+		for (vk::BufferImageCopy& region : copy.regions)
+		{
+			region.bufferOffset += srcOffset;
+		}
+
+		m_Recording.imageCopies.push_back(std::move(copy));
+		m_Recording.bytes += size;
+	}
+
+	void VulkanUploader::OnComplete(CompletionCallback callback, const void* pOwner)
+	{
+		m_Recording.callbacks.push_back(PendingCallback{ pOwner, std::move(callback) });
+	}
+
+	void VulkanUploader::CancelCallbacks(const void* pOwner)
+	{
+		const auto cancel = [pOwner](std::vector<PendingCallback>& callbacks)
+		{
+			std::erase_if(callbacks, [pOwner](const PendingCallback& pending) { return pending.pOwner == pOwner; });
+		};
+
+		cancel(m_Recording.callbacks);
+		for (Batch& batch : m_InFlight)
+		{
+			cancel(batch.callbacks);
+		}
+	}
+
+	void VulkanUploader::Flush()
+	{
+		if (!m_Recording.HasWork())
+		{
+			if (m_Recording.callbacks.empty())
+				return;
+
+			// Nothing new to upload, so these only depend on what's already in flight.
+			if (!m_InFlight.empty())
+			{
+				std::vector<PendingCallback>& callbacks = m_InFlight.back().callbacks;
+				callbacks.insert(callbacks.end(), std::make_move_iterator(m_Recording.callbacks.begin()), std::make_move_iterator(m_Recording.callbacks.end()));
+				m_Recording.callbacks.clear();
+			}
+			else
+			{
+				std::vector<PendingCallback> callbacks = std::move(m_Recording.callbacks);
+				m_Recording.callbacks.clear();
+				for (PendingCallback& pending : callbacks)
+				{
+					pending.callback();
+				}
+			}
+			return;
+		}
+
+		Batch batch = std::move(m_Recording);
+		m_Recording = Batch{};
+
+		AcquireBatchObjects(batch);
+		RecordBatch(batch);
+
+		// The fence and the timeline semaphore go on the last submit, the graphics one when there is one.
+		const bool mipSubmit = m_MipCommandPool && batch.HasMipWork();
+		if (mipSubmit)
+		{
+			AcquireMipObjects(batch);
+			RecordMipBatch(batch);
+		}
+
+		batch.ringEnd = m_RingHead;
+		batch.timelineValue = m_LastSubmittedValue + 1;
+
+		vk::TimelineSemaphoreSubmitInfo timelineInfo = vk::TimelineSemaphoreSubmitInfo()
+			.setSignalSemaphoreValues(batch.timelineValue);
+
+		vk::SubmitInfo submitInfo = vk::SubmitInfo()
+			.setCommandBuffers(batch.commandBuffer);
+
+		vk::SubmitInfo mipSubmitInfo = vk::SubmitInfo()
+			.setCommandBuffers(batch.mipCommandBuffer);
+		const vk::PipelineStageFlags mipWaitStage = vk::PipelineStageFlagBits::eTransfer;
+
+		vk::SubmitInfo& lastSubmitInfo = mipSubmit ? mipSubmitInfo : submitInfo;
+		if (m_TimelineSemaphore)
+		{
+			lastSubmitInfo
+				.setSignalSemaphores(m_TimelineSemaphore)
+				.setPNext(&timelineInfo);
+		}
+
+		try
+		{
+			if (mipSubmit)
+			{
+				submitInfo.setSignalSemaphores(batch.mipSemaphore);
+				mipSubmitInfo
+					.setWaitSemaphores(batch.mipSemaphore)
+					.setWaitDstStageMask(mipWaitStage);
+
+				m_pDevice->GetTransferQueue().submit(submitInfo, nullptr);
+				m_pDevice->GetGraphicsQueue().submit(mipSubmitInfo, batch.fence);
+			}
+			else
+			{
+				m_pDevice->GetTransferQueue().submit(submitInfo, batch.fence);
+			}
+		}
+		catch (vk::SystemError& e)
+		{
+			throw std::runtime_error("Failed to submit uploads: "s + e.what());
+		}
+
+		m_LastSubmittedValue = batch.timelineValue;
+		m_TotalUploadedBytes += batch.bytes;
+		m_InFlight.push_back(std::move(batch));
+
+		// Without a timeline semaphore the graphics queue has no way to wait for us, so we'll have to.
+		if (!m_TimelineSemaphore)
+		{
+			WaitIdle();
+		}
+	}
+
+	void VulkanUploader::Update()
+	{
+		while (!m_InFlight.empty() && m_pDevice->GetDevice().getFenceStatus(m_InFlight.front().fence) == vk::Result::eSuccess)
+		{
+			CompleteOldestBatch();
+		}
+	}
+
+	void VulkanUploader::WaitIdle()
+	{
+		Flush();
+
+		while (!m_InFlight.empty())
+		{
+			WaitForOldestBatch();
+		}
+	}
+
+	std::pair<vk::Buffer, vk::DeviceSize> VulkanUploader::WriteStaging(const void* pData, vk::DeviceSize size)
+	{
+		// Doesn't fit in the ring at all, give it its own staging buffer that gets destroyed along with the batch.
+		if (size > m_StagingSize)
+		{
+			TempBuffer temp;
+			VulkanHelpers::CreateBuffer(size, vk::BufferUsageFlagBits::eTransferSrc,
+				vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+				temp.buffer, temp.allocation, MemoryStrategy::Linear);
+
+			memcpy(temp.allocation.pMapped, pData, static_cast<size_t>(size));
+
+			m_Recording.tempBuffers.push_back(temp);
+			return { temp.buffer, 0 };
+		}
+
+		uint64_t ringOffset = 0;
+		while (!TryAllocateRing(size, ringOffset))
+		{
+			// The ring is full: submit what we have and wait until the oldest batch frees up some space.
+			Flush();
+
+			if (!m_InFlight.empty())
+			{
+				WaitForOldestBatch();
+			}
+			else
+			{
+				// Everything has finished, so the whole ring is free again.
+				m_RingHead = m_RingTail = 0;
+			}
+		}
+
+		const vk::DeviceSize physicalOffset = ringOffset % m_StagingSize;
+		memcpy(static_cast<uint8_t*>(m_StagingMemory.pMapped) + physicalOffset, pData, static_cast<size_t>(size));
+
+		return { m_StagingBuffer, physicalOffset };
+	}
+
+	bool VulkanUploader::TryAllocateRing(vk::DeviceSize size, uint64_t& ringOffset)
+	{
+		uint64_t start = (m_RingHead + m_StagingAlignment - 1) / m_StagingAlignment * m_StagingAlignment;
+
+		// Allocations can't wrap around the end of the buffer, skip to the start instead.
+		if (start % m_StagingSize + size > m_StagingSize)
+		{
+			start = (start / m_StagingSize + 1) * m_StagingSize;
+		}
+
+		if (start + size - m_RingTail > m_StagingSize)
+			return false;
+
+		m_RingHead = start + size;
+		ringOffset = start;
+		return true;
+	}
+
+	void VulkanUploader::WaitForOldestBatch()
+	{
+		const vk::Result result = m_pDevice->GetDevice().waitForFences(m_InFlight.front().fence, true, UINT64_MAX);
+		if (result != vk::Result::eSuccess)
+		{
+			throw std::runtime_error("Failed to wait for upload fence");
+		}
+
+		CompleteOldestBatch();
+	}
+
+	void VulkanUploader::CompleteOldestBatch()
+	{
+		Batch batch = std::move(m_InFlight.front());
+		m_InFlight.pop_front();
+
+		m_RingTail = std::max(m_RingTail, batch.ringEnd);
+		// Nothing in flight means the whole ring is free again, start from the beginning to avoid needless wrapping.
+		if (m_InFlight.empty() && !m_Recording.HasWork() && m_RingTail == m_RingHead)
+		{
+			m_RingHead = m_RingTail = 0;
+		}
+
+		for (TempBuffer& temp : batch.tempBuffers)
+		{
+			VulkanHelpers::DestroyBuffer(temp.buffer, temp.allocation);
+		}
+
+		m_pDevice->GetDevice().resetFences(batch.fence);
+
+		Batch recycled{};
+		recycled.commandBuffer = batch.commandBuffer;
+		recycled.fence = batch.fence;
+		recycled.mipCommandBuffer = batch.mipCommandBuffer;
+		recycled.mipSemaphore = batch.mipSemaphore;
+		m_FreeBatches.push_back(std::move(recycled));
+
+		// Callbacks might upload new data, so only run them once we're done touching our own state.
+		for (PendingCallback& pending : batch.callbacks)
+		{
+			pending.callback();
+		}
+	}
+
+	void VulkanUploader::RecordBatch(Batch& batch) const
+	{
+		const vk::CommandBuffer cmd = batch.commandBuffer;
+		const bool dedicatedQueue = m_pDevice->HasDedicatedTransferQueue();
+
+		try
+		{
+			cmd.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+		}
+		catch (vk::SystemError& e)
+		{
+			throw std::runtime_error("Failed to begin upload command buffer: "s + e.what());
+		}
+
+		VkDebugMarker::BeginRegion(cmd, "Uploads", glm::vec4(0.8f, 0.6f, 0.2f, 1.0f));
+
+		// All image layout transitions go in one barrier before and one barrier after the copies.
+		std::vector<vk::ImageMemoryBarrier> preBarriers;
+		std::vector<vk::ImageMemoryBarrier> postBarriers;
+		preBarriers.reserve(batch.imageCopies.size());
+		postBarriers.reserve(batch.imageCopies.size());
+
+		for (const PendingImageCopy& copy : batch.imageCopies)
+		{
+			// Covers the whole range, so the mips are ready to be blitted into as well.
+			preBarriers.push_back(vk::ImageMemoryBarrier()
+				.setSrcAccessMask({})
+				.setDstAccessMask(vk::AccessFlagBits::eTransferWrite)
+				.setOldLayout(vk::ImageLayout::eUndefined)
+				.setNewLayout(vk::ImageLayout::eTransferDstOptimal)
+				.setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+				.setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+				.setImage(copy.dstImage)
+				.setSubresourceRange(copy.range));
+
+			// The mip chain leaves these in eShaderReadOnlyOptimal itself.
+			if (copy.generateMips)
+				continue;
+
+			// A transfer queue can't name the fragment shader stage, the semaphore wait on the graphics queue covers that instead.
+			postBarriers.push_back(vk::ImageMemoryBarrier()
+				.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+				.setDstAccessMask(dedicatedQueue ? vk::AccessFlags{} : vk::AccessFlagBits::eShaderRead)
+				.setOldLayout(vk::ImageLayout::eTransferDstOptimal)
+				.setNewLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
+				.setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+				.setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+				.setImage(copy.dstImage)
+				.setSubresourceRange(copy.range));
+		}
+
+		if (!preBarriers.empty())
+		{
+			cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, preBarriers);
+		}
+
+		// Merge the buffer copies that share a source and destination into a single command.
+		std::vector<PendingBufferCopy> bufferCopies = batch.bufferCopies;
+		std::stable_sort(bufferCopies.begin(), bufferCopies.end(), [](const PendingBufferCopy& a, const PendingBufferCopy& b)
+		{
+			const VkBuffer aSrc = a.srcBuffer, bSrc = b.srcBuffer, aDst = a.dstBuffer, bDst = b.dstBuffer;
+			return std::less<VkBuffer>()(aSrc, bSrc) || (aSrc == bSrc && std::less<VkBuffer>()(aDst, bDst));
+		});
+
+		std::vector<vk::BufferCopy> regions;
+		for (size_t i = 0; i < bufferCopies.size(); i++)
+		{
+			regions.push_back(bufferCopies[i].region);
+
+			const bool last = i + 1 == bufferCopies.size() ||
+				bufferCopies[i + 1].srcBuffer != bufferCopies[i].srcBuffer ||
+				bufferCopies[i + 1].dstBuffer != bufferCopies[i].dstBuffer;
+
+			if (last)
+			{
+				cmd.copyBuffer(bufferCopies[i].srcBuffer, bufferCopies[i].dstBuffer, regions);
+				regions.clear();
+			}
+		}
+
+		for (const PendingImageCopy& copy : batch.imageCopies)
+		{
+			cmd.copyBufferToImage(copy.srcBuffer, copy.dstImage, vk::ImageLayout::eTransferDstOptimal, copy.regions);
+		}
+
+		if (!dedicatedQueue)
+		{
+			RecordMipChains(cmd, batch.imageCopies);
+		}
+
+		if (dedicatedQueue)
+		{
+			if (!postBarriers.empty())
+			{
+				cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe, {}, {}, {}, postBarriers);
+			}
+		}
+		else
+		{
+			const vk::PipelineStageFlags dstStages = vk::PipelineStageFlagBits::eVertexInput | vk::PipelineStageFlagBits::eVertexShader | vk::PipelineStageFlagBits::eFragmentShader;
+
+			std::vector<vk::MemoryBarrier> memoryBarriers;
+			if (!bufferCopies.empty())
+			{
+				memoryBarriers.push_back(vk::MemoryBarrier(vk::AccessFlagBits::eTransferWrite,
+					vk::AccessFlagBits::eVertexAttributeRead | vk::AccessFlagBits::eIndexRead | vk::AccessFlagBits::eUniformRead | vk::AccessFlagBits::eShaderRead));
+			}
+
+			cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, dstStages, {}, memoryBarriers, {}, postBarriers);
+		}
+
+		VkDebugMarker::EndRegion(cmd);
+
+		try
+		{
+			cmd.end();
+		}
+		catch (vk::SystemError& e)
+		{
+			throw std::runtime_error("Failed to end upload command buffer: "s + e.what());
+		}
+	}
+
+	void VulkanUploader::RecordMipBatch(Batch& batch) const
+	{
+		const vk::CommandBuffer cmd = batch.mipCommandBuffer;
+
+		try
+		{
+			cmd.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+		}
+		catch (vk::SystemError& e)
+		{
+			throw std::runtime_error("Failed to begin mip command buffer: "s + e.what());
+		}
+
+		VkDebugMarker::BeginRegion(cmd, "Mip Generation", glm::vec4(0.8f, 0.6f, 0.2f, 1.0f));
+		RecordMipChains(cmd, batch.imageCopies);
+		VkDebugMarker::EndRegion(cmd);
+
+		try
+		{
+			cmd.end();
+		}
+		catch (vk::SystemError& e)
+		{
+			throw std::runtime_error("Failed to end mip command buffer: "s + e.what());
+		}
+	}
+
+	void VulkanUploader::RecordMipChains(vk::CommandBuffer cmd, const std::vector<PendingImageCopy>& imageCopies)
+	{
+		for (const PendingImageCopy& copy : imageCopies)
+		{
+			if (!copy.generateMips)
+				continue;
+
+			// Every copy fills the first mip entirely, so its extent is the largest one in the regions.
+			vk::Extent3D extent{};
+			for (const vk::BufferImageCopy& region : copy.regions)
+			{
+				extent.width = std::max(extent.width, region.imageExtent.width);
+				extent.height = std::max(extent.height, region.imageExtent.height);
+			}
+
+			vk::ImageMemoryBarrier barrier = vk::ImageMemoryBarrier()
+				.setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+				.setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+				.setImage(copy.dstImage)
+				.setSubresourceRange(vk::ImageSubresourceRange(copy.range.aspectMask, 0, 1, copy.range.baseArrayLayer, copy.range.layerCount));
+
+			int32_t width = static_cast<int32_t>(extent.width);
+			int32_t height = static_cast<int32_t>(extent.height);
+			const uint32_t lastLevel = copy.range.baseMipLevel + copy.range.levelCount - 1;
+			for (uint32_t level = copy.range.baseMipLevel; level < lastLevel; level++)
+			{
+				// This level has been written, read from it for the next one.
+				barrier.subresourceRange.baseMipLevel = level;
+				barrier
+					.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+					.setDstAccessMask(vk::AccessFlagBits::eTransferRead)
+					.setOldLayout(vk::ImageLayout::eTransferDstOptimal)
+					.setNewLayout(vk::ImageLayout::eTransferSrcOptimal);
+				cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, barrier);
+
+				const int32_t nextWidth = std::max(width / 2, 1);
+				const int32_t nextHeight = std::max(height / 2, 1);
+
+				const vk::ImageBlit blit(
+					vk::ImageSubresourceLayers(copy.range.aspectMask, level, copy.range.baseArrayLayer, copy.range.layerCount),
+					{ vk::Offset3D(0, 0, 0), vk::Offset3D(width, height, 1) },
+					vk::ImageSubresourceLayers(copy.range.aspectMask, level + 1, copy.range.baseArrayLayer, copy.range.layerCount),
+					{ vk::Offset3D(0, 0, 0), vk::Offset3D(nextWidth, nextHeight, 1) });
+				cmd.blitImage(copy.dstImage, vk::ImageLayout::eTransferSrcOptimal, copy.dstImage, vk::ImageLayout::eTransferDstOptimal, blit, vk::Filter::eLinear);
+
+				barrier
+					.setSrcAccessMask(vk::AccessFlagBits::eTransferRead)
+					.setDstAccessMask(vk::AccessFlagBits::eShaderRead)
+					.setOldLayout(vk::ImageLayout::eTransferSrcOptimal)
+					.setNewLayout(vk::ImageLayout::eShaderReadOnlyOptimal);
+				cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader, {}, {}, {}, barrier);
+
+				width = nextWidth;
+				height = nextHeight;
+			}
+
+			// The last level is only ever written to.
+			barrier.subresourceRange.baseMipLevel = lastLevel;
+			barrier
+				.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+				.setDstAccessMask(vk::AccessFlagBits::eShaderRead)
+				.setOldLayout(vk::ImageLayout::eTransferDstOptimal)
+				.setNewLayout(vk::ImageLayout::eShaderReadOnlyOptimal);
+			cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader, {}, {}, {}, barrier);
+		}
+	}
+
+	void VulkanUploader::AcquireBatchObjects(Batch& batch)
+	{
+		if (!m_FreeBatches.empty())
+		{
+			// The batch already holds its copies and callbacks, so only the recycled objects get taken over.
+			// The mip ones have to come along, they'd leak otherwise.
+			const Batch& recycled = m_FreeBatches.back();
+			batch.commandBuffer = recycled.commandBuffer;
+			batch.fence = recycled.fence;
+			batch.mipCommandBuffer = recycled.mipCommandBuffer;
+			batch.mipSemaphore = recycled.mipSemaphore;
+			m_FreeBatches.pop_back();
+			return;
+		}
+
+		const vk::CommandBufferAllocateInfo allocInfo = vk::CommandBufferAllocateInfo()
+			.setCommandPool(m_CommandPool)
+			.setCommandBufferCount(1)
+			.setLevel(vk::CommandBufferLevel::ePrimary);
+
+		try
+		{
+			batch.commandBuffer = m_pDevice->GetDevice().allocateCommandBuffers(allocInfo)[0];
+			batch.fence = m_pDevice->GetDevice().createFence(vk::FenceCreateInfo());
+		}
+		catch (vk::SystemError& e)
+		{
+			throw std::runtime_error("Failed to create upload batch: "s + e.what());
+		}
+	}
+
+	void VulkanUploader::AcquireMipObjects(Batch& batch)
+	{
+		if (batch.mipCommandBuffer)
+			return;
+
+		const vk::CommandBufferAllocateInfo allocInfo = vk::CommandBufferAllocateInfo()
+			.setCommandPool(m_MipCommandPool)
+			.setCommandBufferCount(1)
+			.setLevel(vk::CommandBufferLevel::ePrimary);
+
+		try
+		{
+			batch.mipCommandBuffer = m_pDevice->GetDevice().allocateCommandBuffers(allocInfo)[0];
+			batch.mipSemaphore = m_pDevice->GetDevice().createSemaphore(vk::SemaphoreCreateInfo());
+		}
+		catch (vk::SystemError& e)
+		{
+			throw std::runtime_error("Failed to create mip generation objects: "s + e.what());
+		}
+	}
+
+	bool VulkanUploader::Batch::HasMipWork() const
+	{
+		return std::any_of(imageCopies.begin(), imageCopies.end(), [](const PendingImageCopy& copy) { return copy.generateMips; });
+	}
+}
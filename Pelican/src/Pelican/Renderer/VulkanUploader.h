@@ -0,0 +1,142 @@
+﻿#pragma once
+
+#include <deque>
+#include <functional>
+
+#include <vulkan/vulkan.hpp>
+
+#include "VulkanAllocator.h"
+
+namespace Pelican
+{
+	class VulkanDevice;
+
+	// Records all buffer and texture uploads into batches that get submitted once per frame (or when the staging ring is full),
+	// on the dedicated transfer queue if the device has one. Nothing in here waits on the device unless the staging ring
+	// runs out of space, completion is reported through callbacks instead.
+	class VulkanUploader final
+	{
+	public:
+		using CompletionCallback = std::function<void()>;
+
+		explicit VulkanUploader(VulkanDevice* pDevice, vk::DeviceSize stagingSize = 64ull * 1024 * 1024);
+		~VulkanUploader();
+
+		VulkanUploader(const VulkanUploader&) = delete;
+		VulkanUploader& operator=(const VulkanUploader&) = delete;
+
+		// The data gets copied into the staging ring right away, so it can be freed after this returns.
+		void UploadBuffer(vk::Buffer dstBuffer, const void* pData, vk::DeviceSize size, vk::DeviceSize dstOffset = 0);
+		// Copies the data into the given regions and leaves the image in eShaderReadOnlyOptimal.
+		// With generateMips the regions only have to fill the first mip of the range, the others get blitted down from it.
+		// The image needs eTransferSrc usage and a format that supports linear blits for that.
+		void UploadImage(vk::Image dstImage, const void* pData, vk::DeviceSize size,
+			const std::vector<vk::BufferImageCopy>& regions, const vk::ImageSubresourceRange& range, bool generateMips = false);
+
+		// Gets called on the main thread once every upload recorded before this call has finished on the GPU.
+		// Objects that pass themselves as the owner have to cancel their callbacks with CancelCallbacks before they go away.
+		void OnComplete(CompletionCallback callback, const void* pOwner = nullptr);
+		// Drops the callbacks of the owner that haven't run yet, the uploads themselves still happen.
+		void CancelCallbacks(const void* pOwner);
+
+		// Submits everything that has been recorded so far.
+		void Flush();
+		// Checks which batches have finished, runs their callbacks and releases their staging memory.
+		void Update();
+		// Blocks until every upload has finished, only meant for shutdown and resource destruction.
+		void WaitIdle();
+
+		// The graphics queue has to wait on this semaphore reaching GetLastSubmittedValue() before using uploaded resources.
+		// nullptr when timeline semaphores aren't supported, Flush() waits on the CPU in that case.
+		[[nodiscard]] vk::Semaphore GetTimelineSemaphore() const { return m_TimelineSemaphore; }
+		[[nodiscard]] uint64_t GetLastSubmittedValue() const { return m_LastSubmittedValue; }
+
+		[[nodiscard]] uint32_t GetBatchesInFlight() const { return static_cast<uint32_t>(m_InFlight.size()); }
+		[[nodiscard]] uint64_t GetTotalUploadedBytes() const { return m_TotalUploadedBytes; }
+
+	private:
+		struct PendingBufferCopy
+		{
+			vk::Buffer srcBuffer;
+			vk::Buffer dstBuffer;
+			vk::BufferCopy region;
+		};
+
+		struct PendingImageCopy
+		{
+			vk::Buffer srcBuffer;
+			vk::Image dstImage;
+			std::vector<vk::BufferImageCopy> regions;
+			vk::ImageSubresourceRange range;
+			bool generateMips;
+		};
+
+		struct PendingCallback
+		{
+			const void* pOwner;
+			CompletionCallback callback;
+		};
+
+		struct TempBuffer
+		{
+			vk::Buffer buffer;
+			VulkanAllocation allocation;
+		};
+
+		struct Batch
+		{
+			vk::CommandBuffer commandBuffer{};
+			vk::Fence fence{};
+			// Blits aren't allowed on a transfer queue, with a dedicated one the mips get generated by a second
+			// submit on the graphics queue that waits on the copies through the semaphore.
+			vk::CommandBuffer mipCommandBuffer{};
+			vk::Semaphore mipSemaphore{};
+			uint64_t timelineValue{};
+			// Staging ring position after this batch, everything before it can be reused once the batch is done.
+			uint64_t ringEnd{};
+
+			std::vector<PendingBufferCopy> bufferCopies{};
+			std::vector<PendingImageCopy> imageCopies{};
+			std::vector<PendingCallback> callbacks{};
+			std::vector<TempBuffer> tempBuffers{};
+			vk::DeviceSize bytes{};
+
+			[[nodiscard]] bool HasWork() const { return !bufferCopies.empty() || !imageCopies.empty(); }
+			[[nodiscard]] bool HasMipWork() const;
+		};
+
+		// Returns the staging buffer and offset the data was written to.
+		std::pair<vk::Buffer, vk::DeviceSize> WriteStaging(const void* pData, vk::DeviceSize size);
+		bool TryAllocateRing(vk::DeviceSize size, uint64_t& ringOffset);
+		void WaitForOldestBatch();
+		void CompleteOldestBatch();
+		void RecordBatch(Batch& batch) const;
+		void RecordMipBatch(Batch& batch) const;
+		// Blits the mips of every copy that asked for them, starting and ending in the layouts RecordBatch leaves them in.
+		static void RecordMipChains(vk::CommandBuffer cmd, const std::vector<PendingImageCopy>& imageCopies);
+		void AcquireBatchObjects(Batch& batch);
+		void AcquireMipObjects(Batch& batch);
+
+	private:
+		VulkanDevice* m_pDevice{};
+		vk::CommandPool m_CommandPool{};
+		// Only created when the transfer queue is dedicated, on the graphics queue family.
+		vk::CommandPool m_MipCommandPool{};
+		vk::Semaphore m_TimelineSemaphore{};
+		uint64_t m_LastSubmittedValue{};
+
+		vk::Buffer m_StagingBuffer{};
+		VulkanAllocation m_StagingMemory{};
+		vk::DeviceSize m_StagingSize{};
+		vk::DeviceSize m_StagingAlignment{};
+		// Monotonic positions in the ring, the physical offset is position % m_StagingSize.
+		uint64_t m_RingHead{};
+		uint64_t m_RingTail{};
+
+		Batch m_Recording{};
+		std::deque<Batch> m_InFlight{};
+		std::vector<Batch> m_FreeBatches{};
+
+		uint64_t m_TotalUploadedBytes{};
+	};
+}
@@ -1,6 +1,8 @@
-#include "PelicanPCH.h"
+﻿#include "PelicanPCH.h"
 #include "Scene.h"
 
+#include <algorithm>
+#include <chrono>
 #include <logtools.h>
 #include <imgui.h>
 #include <misc/cpp/imgui_stdlib.h>
@@ -12,13 +14,13 @@
 #include "Pelican/Assets/AssetManager.h"
 
 #include "Pelican/Core/Application.h"
+#include "Pelican/Core/Profiler.h"
 #include "Pelican/Core/Time.h"
 #include "Pelican/Core/System/FileUtils.h"
 #include "Pelican/Core/System/FileDialog.h"
 
 #include "Pelican/Renderer/Camera.h"
 #include "Pelican/Renderer/UniformData.h"
-#include "Pelican/Renderer/VulkanDebug.h"
 
 
 namespace Pelican
@@ -80,48 +82,313 @@ namespace Pelican
 	{
 	}
 
-	void Scene::Update(Camera* pCamera)
+	void Scene::Update(Camera* /*pCamera*/)
 	{
+		PELICAN_PROFILE_FUNCTION();
+
 		if (m_AnimateLight)
 			m_PointLight.position = glm::vec3(cos(Time::GetTotalTime()) * 10.0f, 30.0f, sin(Time::GetTotalTime()) * 10.0f);
+	}
+
+	void Scene::Draw(Camera* pCamera)
+	{
+		PELICAN_PROFILE_FUNCTION();
+
+		const auto startTime = std::chrono::high_resolution_clock::now();
 
+		const Frustum frustum = pCamera->GetFrustum();
+
+		// Cull whole models on the CPU first, against their world space bounds. Models that are off screen
+		// don't get any object or draw data written at all.
+		m_Candidates.clear();
 		for (auto [entity, transform, model] : m_Registry.view<TransformComponent, ModelComponent>().each())
 		{
-			glm::mat4 m = transform.GetTransform();
-			glm::mat4 v = pCamera->GetView();
-			glm::mat4 p = pCamera->GetProjection();
-			p[1][1] *= -1;
+			m_Candidates.push_back(DrawItem{ transform.GetTransform(), model.pModel });
+		}
+
+		const uint32_t candidateCount = static_cast<uint32_t>(m_Candidates.size());
+		m_VisibleObjects.resize(candidateCount);
+		uint32_t visibleCount = candidateCount;
 
-			model.pModel->UpdateDrawData(m, v, p);
+		const auto cullStartTime = std::chrono::high_resolution_clock::now();
+		if (m_CpuCulling)
+		{
+			PELICAN_PROFILE_SCOPE("CPU Culling");
+			m_WorldBounds.Resize(candidateCount);
+			for (uint32_t i = 0; i < candidateCount; i++)
+			{
+				m_WorldBounds.Set(i, m_Candidates[i].pModel->GetBounds(), m_Candidates[i].transform);
+			}
+
+			visibleCount = m_Culler.Cull(frustum, m_WorldBounds, m_VisibleObjects.data());
 		}
-	}
+		else
+		{
+			for (uint32_t i = 0; i < candidateCount; i++)
+			{
+				m_VisibleObjects[i] = i;
+			}
+		}
+		m_RecordStats.cullTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - cullStartTime).count();
+		m_RecordStats.culledCount = candidateCount - visibleCount;
 
-	void Scene::Draw(Camera* pCamera)
-	{
-		auto view = m_Registry.view<TransformComponent, ModelComponent>();
+		// Entities sharing a model are drawn as instances of the same commands, so sort the visible ones by model
+		// and turn every run of the same model into an instance group.
+		std::sort(m_VisibleObjects.begin(), m_VisibleObjects.begin() + visibleCount, [this](uint32_t a, uint32_t b)
+		{
+			const Model* pModelA = m_Candidates[a].pModel;
+			const Model* pModelB = m_Candidates[b].pModel;
+			return pModelA != pModelB ? std::less<const Model*>{}(pModelA, pModelB) : a < b;
+		});
+
+		const glm::mat4 view = pCamera->GetView();
+		// Turns a radius over view depth into pixels.
+		const float pixelScale = pCamera->GetProjection()[1][1] * pCamera->GetHeight();
+
+		m_InstanceGroups.clear();
+		m_ObjectGroups.resize(visibleCount);
+		uint32_t commandCount = 0;
+		for (uint32_t i = 0; i < visibleCount; i++)
+		{
+			const DrawItem& item = m_Candidates[m_VisibleObjects[i]];
+			if (m_InstanceGroups.empty() || m_InstanceGroups.back().pModel != item.pModel)
+			{
+				m_InstanceGroups.push_back(InstanceGroup{ item.pModel, i, 0, commandCount, 0, FLT_MAX, -FLT_MAX, 0.0f });
+				commandCount += item.pModel->GetMeshCount();
+			}
+
+			// The view looks down -z.
+			const glm::vec4 center = view * item.transform * glm::vec4(item.pModel->GetBounds().GetCenter(), 1.0f);
+			InstanceGroup& group = m_InstanceGroups.back();
+			group.nearDepth = std::min(group.nearDepth, -center.z);
+			group.farDepth = std::max(group.farDepth, -center.z);
+
+			// Bounding sphere of the instance, the camera being inside it counts as the model filling the screen.
+			const float scale = std::max({ glm::length(glm::vec3(item.transform[0])), glm::length(glm::vec3(item.transform[1])),
+				glm::length(glm::vec3(item.transform[2])) });
+			const float radius = glm::length(item.pModel->GetBounds().GetExtents()) * scale;
+			group.screenSize = std::max(group.screenSize, radius * pixelScale / std::max(-center.z, radius));
+			group.instanceCount++;
+			m_ObjectGroups[i] = static_cast<uint32_t>(m_InstanceGroups.size() - 1);
+		}
+
+		// Textures that got other mips streamed in have new bindless indices, so the materials have to be up to date
+		// before their indices go into the keys. The requests decide what gets streamed in next.
+		for (const InstanceGroup& group : m_InstanceGroups)
+		{
+			group.pModel->UpdateMaterials();
+			group.pModel->RequestTextureMips(group.screenSize);
+		}
+
+		// Sort the commands, opaque ones front to back by their closest instance and translucent ones
+		// back to front by their furthest instance.
+		// Instances of the same mesh are a single command, so their order among each other doesn't change.
+		m_RenderQueue.Clear();
+		m_CommandRefs.resize(commandCount);
+		for (uint32_t groupIndex = 0; groupIndex < static_cast<uint32_t>(m_InstanceGroups.size()); groupIndex++)
+		{
+			const InstanceGroup& group = m_InstanceGroups[groupIndex];
+			for (uint32_t mesh = 0; mesh < group.pModel->GetMeshCount(); mesh++)
+			{
+				const uint32_t material = group.pModel->GetMaterialIndex(mesh);
+				uint64_t key{};
+				if (group.pModel->IsTranslucent(mesh))
+					key = RenderKey::MakeTranslucent(TRANSLUCENT_PIPELINE, material, RenderKey::GetDepthBucket(group.farDepth));
+				else if (group.pModel->IsAlphaTested(mesh))
+					key = RenderKey::MakeAlphaTested(LIT_PIPELINE, material, RenderKey::GetDepthBucket(group.nearDepth));
+				else
+					key = RenderKey::MakeOpaque(LIT_PIPELINE, material, RenderKey::GetDepthBucket(group.nearDepth));
+
+				m_CommandRefs[group.firstCommand + mesh] = CommandRef{ groupIndex, mesh };
+				m_RenderQueue.Submit(key, group.firstCommand + mesh);
+			}
+		}
+		{
+			PELICAN_PROFILE_SCOPE("Render Queue Sort");
+			m_RenderQueue.Sort();
+		}
 
-		vk::CommandBuffer cmd = VulkanRenderer::GetCurrentBuffer();
+		// Every instance of every mesh gets its own DrawData, the instances of a mesh are next to each other.
+		uint32_t drawCount = 0;
+		for (InstanceGroup& group : m_InstanceGroups)
+		{
+			group.firstDraw = drawCount;
+			drawCount += group.pModel->GetMeshCount() * group.instanceCount;
+		}
+
+		// Per-frame, per-object and per-draw data go through the uniform ring, this has to happen after BeginScene
+		// so the frame's part of the ring is no longer in use by the GPU.
+		VulkanUniformRing* pUniformRing = VulkanRenderer::GetUniformRing();
+
+		FrameData frameData{};
+		frameData.view = view;
+		frameData.proj = pCamera->GetProjection();
+		frameData.proj[1][1] *= -1;
+		frameData.lights.directionalLight = m_DirectionalLight;
+		frameData.lights.pointLight = m_PointLight;
+		frameData.eyePos = pCamera->GetPosition();
+		frameData.skyboxIndex = m_Skybox->GetBindlessIndex();
+		frameData.radianceIndex = m_Radiance->GetBindlessIndex();
+		frameData.irradianceIndex = m_Irradiance->GetBindlessIndex();
+		const uint32_t frameDataOffset = pUniformRing->Push(frameData);
+
+		const uint32_t modelCount = visibleCount;
+
+		// One object per visible model, one indirect command per mesh of every group and one DrawData per instance of those.
+		// The jobs fill in their own range of objects, the commands are written in the order of the render queue.
+		ObjectData* pObjects = nullptr;
+		DrawData* pDraws = nullptr;
+		vk::DrawIndexedIndirectCommand* pCommands = nullptr;
+		uint32_t firstObject = 0;
+		uint32_t firstDraw = 0;
+		uint32_t firstCommand = 0;
+		if (commandCount > 0)
+		{
+			void* pMapped = nullptr;
+			firstObject = pUniformRing->AllocateArray(sizeof(ObjectData), modelCount, pMapped);
+			pObjects = static_cast<ObjectData*>(pMapped);
+			firstDraw = pUniformRing->AllocateArray(sizeof(DrawData), drawCount, pMapped);
+			pDraws = static_cast<DrawData*>(pMapped);
+			firstCommand = pUniformRing->AllocateArray(sizeof(vk::DrawIndexedIndirectCommand), commandCount, pMapped);
+			pCommands = static_cast<vk::DrawIndexedIndirectCommand*>(pMapped);
+		}
+
+		const std::vector<RenderQueue::Item>& queueItems = m_RenderQueue.GetItems();
+		for (uint32_t i = 0; i < commandCount; i++)
+		{
+			const CommandRef& ref = m_CommandRefs[queueItems[i].payload];
+			const InstanceGroup& group = m_InstanceGroups[ref.group];
+			pCommands[i] = group.pModel->GetDrawCommand(ref.mesh, firstDraw + group.firstDraw, group.instanceCount);
+		}
+
+		// The commands are split into three parts, each drawn with its own pipeline.
+		// The opaque commands that don't discard come first, with the depth prepass they're drawn apart from the others:
+		// once in the prepass and once with the depth equal pipeline. Without it, they're part of the second part.
+		// The translucent commands come last, they're drawn without writing depth.
+		const bool depthPrepass = VulkanRenderer::IsDepthPrepassActive();
+		uint32_t prepassCount = 0;
+		while (prepassCount < commandCount && RenderKey::GetPass(queueItems[prepassCount].key) == RenderKey::OPAQUE_PASS)
+		{
+			prepassCount++;
+		}
+		uint32_t translucentStart = prepassCount;
+		while (translucentStart < commandCount && RenderKey::GetPass(queueItems[translucentStart].key) != RenderKey::TRANSLUCENT_PASS)
+		{
+			translucentStart++;
+		}
+		const VulkanCullingPass::PartSplits splits{ depthPrepass ? prepassCount : 0, translucentStart };
+
+		ThreadPool* pThreadPool = Application::Get().GetThreadPool();
+		const uint32_t jobCount = std::min(pThreadPool->GetThreadCount(), (modelCount + MIN_DRAWS_PER_JOB - 1) / MIN_DRAWS_PER_JOB);
+
+		pThreadPool->ParallelFor(jobCount, [&](uint32_t jobIndex, uint32_t /*threadIndex*/)
+		{
+			PELICAN_PROFILE_SCOPE("Write Draws");
+			const uint32_t begin = static_cast<uint32_t>(static_cast<uint64_t>(modelCount) * jobIndex / jobCount);
+			const uint32_t end = static_cast<uint32_t>(static_cast<uint64_t>(modelCount) * (jobIndex + 1) / jobCount);
+
+			for (uint32_t i = begin; i < end; i++)
+			{
+				const InstanceGroup& group = m_InstanceGroups[m_ObjectGroups[i]];
+				const uint32_t instance = i - group.firstObject;
+
+				pObjects[i].model = m_Candidates[m_VisibleObjects[i]].transform;
+				group.pModel->WriteInstance(pDraws + group.firstDraw, group.instanceCount, instance, firstObject + i);
+			}
+		});
+
+		//
+		// GPU Culling
+		//
+		// Has to be recorded into the primary buffer before the render pass begins. The pass writes its own list of
+		// draws, which is what gets drawn instead of the commands in the ring.
+		// Both when it compacts and when it keeps the draws in place, the sorted order is kept.
+		VulkanCullingPass* pCullingPass = VulkanRenderer::GetCullingPass();
+		const bool gpuCulling = commandCount > 0 && pCullingPass->IsEnabled() && commandCount <= pCullingPass->GetMaxDraws();
+		if (gpuCulling)
+		{
+			pCullingPass->Record(VulkanRenderer::GetCurrentBuffer(), frustum, firstCommand, commandCount, splits);
+		}
 
 		//
 		// Scene Render
 		//
-		VkDebugMarker::BeginRegion(cmd, "Scene Render", glm::vec4(1.0f, 0.5f, 0.0f, 1.0f));
+		// All meshes live in the geometry arena and find their data through the instance index,
+		// so the whole scene is a single indirect draw (or one per maxDrawIndirectCount commands).
+		// One more for the translucent meshes, and with the depth prepass two more: the prepass and its commands again
+		// with the depth equal pipeline.
+		uint32_t drawCallCount = 0;
+		if (commandCount > 0)
+		{
+			const vk::CommandBuffer cmd = VulkanRenderer::BeginSecondaryCommandBuffer(0);
+			VulkanBindTracker tracker{ cmd, VulkanRenderer::GetDescriptorStats() };
+			VulkanGeometryArena* pGeometryArena = VulkanRenderer::GetGeometryArena();
 
-		cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, VulkanRenderer::GetCurrentPipeline());
+			// Draws the commands of one part, whatever the culling pass kept of them when it ran.
+			const std::array<uint32_t, VulkanCullingPass::MAX_PARTS + 1> partStarts{ 0, splits[0], splits[1], commandCount };
+			const auto drawPart = [&](uint32_t part)
+			{
+				if (gpuCulling)
+					return pCullingPass->Draw(cmd, pGeometryArena, part);
 
-		// Bind push constants
-		CameraPushConst pushConst;
-		pushConst.eyePos = pCamera->GetPosition();
+				return pGeometryArena->DrawIndirect(cmd, pUniformRing->GetBuffer(),
+					static_cast<vk::DeviceSize>(firstCommand + partStarts[part]) * sizeof(vk::DrawIndexedIndirectCommand),
+					partStarts[part + 1] - partStarts[part]);
+			};
 
-		cmd.pushConstants(VulkanRenderer::GetPipelineLayout(), vk::ShaderStageFlagBits::eFragment, 0, sizeof(CameraPushConst), &pushConst);
+			if (depthPrepass && prepassCount > 0)
+			{
+				VulkanRenderer::GetGpuProfiler()->BeginRegion(cmd, "Depth Prepass", glm::vec4(0.5f, 0.5f, 0.5f, 1.0f));
 
-		// Draw meshes
-		for (auto [entity, transform, model] : view.each())
-		{
-			model.pModel->Draw();
+				const VulkanPipeline& prepassPipeline = VulkanRenderer::GetDepthPrepassPipeline();
+				tracker.BindPipeline(prepassPipeline.GetPipeline(), prepassPipeline.GetLayout());
+				tracker.BindDescriptorSet(FRAME_SET, VulkanRenderer::GetFrameDescriptorSet(), frameDataOffset);
+				pGeometryArena->BindPositions(cmd);
+				drawCallCount += drawPart(0);
+
+				VulkanRenderer::GetGpuProfiler()->EndRegion(cmd);
+			}
+
+			VulkanRenderer::GetGpuProfiler()->BeginRegion(cmd, "Scene Render", glm::vec4(1.0f, 0.5f, 0.0f, 1.0f));
+			pGeometryArena->Bind(cmd);
+
+			const auto bindLitPipeline = [&](vk::Pipeline pipeline, vk::PipelineLayout layout)
+			{
+				tracker.BindPipeline(pipeline, layout);
+				tracker.BindDescriptorSet(FRAME_SET, VulkanRenderer::GetFrameDescriptorSet(), frameDataOffset);
+				tracker.BindDescriptorSet(MATERIAL_SET, VulkanRenderer::GetBindlessTable()->GetDescriptorSet());
+			};
+
+			if (depthPrepass)
+			{
+				const VulkanPipeline& depthEqualPipeline = VulkanRenderer::GetDepthEqualPipeline();
+				bindLitPipeline(depthEqualPipeline.GetPipeline(), depthEqualPipeline.GetLayout());
+				drawCallCount += drawPart(0);
+			}
+
+			bindLitPipeline(VulkanRenderer::GetCurrentPipeline(), VulkanRenderer::GetPipelineLayout());
+			drawCallCount += drawPart(1);
+
+			// Lines and points draw the translucent meshes like everything else.
+			if (Application::Get().m_RenderMode == RenderMode::Filled)
+			{
+				const VulkanPipeline& translucentPipeline = VulkanRenderer::GetTranslucentPipeline();
+				bindLitPipeline(translucentPipeline.GetPipeline(), translucentPipeline.GetLayout());
+			}
+			drawCallCount += drawPart(2);
+
+			VulkanRenderer::GetGpuProfiler()->EndRegion(cmd);
+			VulkanRenderer::EndSecondaryCommandBuffer(cmd);
+
+			VulkanRenderer::ExecuteSecondaryCommandBuffers({ cmd });
 		}
 
-		VkDebugMarker::EndRegion(cmd);
+		m_RecordStats.modelCount = modelCount;
+		m_RecordStats.groupCount = static_cast<uint32_t>(m_InstanceGroups.size());
+		m_RecordStats.commandCount = commandCount;
+		m_RecordStats.drawCallCount = drawCallCount;
+		m_RecordStats.jobCount = jobCount;
+		m_RecordStats.recordTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
 
 
 		// TODO: move this out to an editor or so...
@@ -158,6 +425,18 @@ namespace Pelican
 
 			const auto entities = m_Registry.view<TagComponent>();
 
+			ImGui::Text("Prepared %u models in %u jobs on %u threads: %.3fms", m_RecordStats.modelCount, m_RecordStats.jobCount,
+				Application::Get().GetThreadPool()->GetThreadCount(), m_RecordStats.recordTime);
+			ImGui::Text("Instance groups: %u, indirect commands: %u, draw calls issued: %u", m_RecordStats.groupCount,
+				m_RecordStats.commandCount, m_RecordStats.drawCallCount);
+			const RenderQueueStats& queueStats = m_RenderQueue.GetStats();
+			ImGui::Text("Sorted %u commands in %.3fms", queueStats.itemCount, queueStats.sortTime);
+			ImGui::Text("Pipeline changes: %u unsorted, %u sorted", queueStats.pipelineChangesUnsorted, queueStats.pipelineChangesSorted);
+			ImGui::Text("Material changes: %u unsorted, %u sorted", queueStats.materialChangesUnsorted, queueStats.materialChangesSorted);
+			ImGui::Checkbox("CPU frustum culling", &m_CpuCulling);
+			ImGui::Text("Culled %u models in %.3fms (%s)", m_RecordStats.culledCount, m_RecordStats.cullTime, FrustumCuller::GetPathName(m_Culler.GetPath()));
+			ImGui::Spacing();
+
 			ImGui::Text("%i entities in scene:", static_cast<int>(entities.size()));
 			ImGui::Spacing();
 
@@ -210,7 +489,7 @@ namespace Pelican
 		// Will have to test when VLD works again.
 		for (auto [entity, model] : m_Registry.view<ModelComponent>().each())
 		{
-			delete model.pModel;
+			AssetManager::GetInstance().UnloadModel(model.pModel);
 		}
 
 		AssetManager::GetInstance().UnloadTexture(m_Skybox);
@@ -1,7 +1,9 @@
-#pragma once
+﻿#pragma once
 
 #include <entt.hpp>
 
+#include "Pelican/Renderer/FrustumCuller.h"
+#include "Pelican/Renderer/RenderQueue.h"
 #include "Pelican/Renderer/UniformData.h"
 
 namespace Pelican
@@ -51,6 +53,68 @@ namespace Pelican
 		PointLight m_PointLight;
 		bool m_AnimateLight{ false };
 
+		// Jobs don't get fewer models than this, so small scenes don't pay for waking up threads.
+		static constexpr uint32_t MIN_DRAWS_PER_JOB = 64;
+
+		struct DrawItem
+		{
+			glm::mat4 transform;
+			Model* pModel;
+		};
+		// Every model in the scene, their world space bounds are at the same index in m_WorldBounds.
+		std::vector<DrawItem> m_Candidates;
+		BoundsSoA m_WorldBounds;
+		// Indices into m_Candidates, the models that survived frustum culling, sorted by model.
+		std::vector<uint32_t> m_VisibleObjects;
+		FrustumCuller m_Culler;
+		bool m_CpuCulling{ true };
+
+		// Visible entities sharing a model, drawn with one instanced indirect command per mesh.
+		struct InstanceGroup
+		{
+			Model* pModel;
+			// The group's range in m_VisibleObjects, which is also its range in this frame's object array.
+			uint32_t firstObject;
+			uint32_t instanceCount;
+			// Index of the group's first command before sorting, and where its DrawData starts in this frame's array.
+			uint32_t firstCommand;
+			uint32_t firstDraw;
+			// View depth of the closest and furthest instance.
+			float nearDepth;
+			float farDepth;
+			// Projected diameter of the largest instance in pixels, decides which texture mips the model needs.
+			float screenSize;
+		};
+		std::vector<InstanceGroup> m_InstanceGroups;
+		// Index into m_InstanceGroups for every entry of m_VisibleObjects.
+		std::vector<uint32_t> m_ObjectGroups;
+
+		// Every mesh of every group is one command, the render queue decides the order they're drawn in.
+		// The payload of a queue item is the command's index in m_CommandRefs.
+		struct CommandRef
+		{
+			uint32_t group;
+			uint32_t mesh;
+		};
+		std::vector<CommandRef> m_CommandRefs;
+		RenderQueue m_RenderQueue;
+		// Pipelines in the sort keys, translucent meshes are lit as well but don't write depth.
+		static constexpr uint32_t LIT_PIPELINE = 0;
+		static constexpr uint32_t TRANSLUCENT_PIPELINE = 1;
+
+		struct RecordStats
+		{
+			uint32_t modelCount{};
+			uint32_t culledCount{};
+			float cullTime{};
+			uint32_t groupCount{};
+			uint32_t commandCount{};
+			uint32_t drawCallCount{};
+			uint32_t jobCount{};
+			float recordTime{};
+		};
+		RecordStats m_RecordStats{};
+
 		VulkanTexture* m_Skybox;
 		VulkanTexture* m_Radiance;
 		VulkanTexture* m_Irradiance;
@@ -10,6 +10,7 @@
 
 #include "ald_serializer.h"
 #include "Pelican/Assets/AssetManager.h"
+#include "Pelican/Core/Profiler.h"
 
 namespace Pelican
 {
@@ -72,6 +73,8 @@ namespace Pelican
 
 	void SceneSerializer::Deserialize(const std::string& serialized, Scene* pScene)
 	{
+		PELICAN_PROFILE_FUNCTION();
+
 		using namespace nlohmann;
 
 		json jsonScene = json::parse(serialized);
@@ -152,7 +155,7 @@ namespace Pelican
 
 					std::string assetPath;
 					jComponent["assetPath"].get_to(assetPath);
-					e.AddComponent<ModelComponent>(new Model(assetPath));
+					e.AddComponent<ModelComponent>(AssetManager::GetInstance().LoadModel(assetPath));
 				}
 			}
 		}
@@ -0,0 +1,58 @@
+﻿#include <Pelican.h>
+#include <Pelican/Core/Entrypoint.h>
+
+#include "BenchmarkLayer.h"
+
+// Headless frame benchmark, renders a scene along a camera path and writes the frame timings as JSON:
+// PelicanBench [--scene file] [--path camera.json|camera.campath] [--frames N] [--warmup N] [--timestep seconds]
+//              [--out results.json] [--baseline results.json] [--tolerance fraction] [--width N] [--height N] [--window]
+//              [--capture directory] [--capture-interval N] [--depth-prepass]
+// --capture writes every N-th measured frame to a PNG, captured frames also copy the image back so they take a bit longer.
+// Exits with 1 when something got slower than in the baseline, and with 2 when the benchmark failed to run
+// or the command line is invalid.
+// Run it from a directory with the res folder in it, like the Sandbox one.
+class Bench final : public Pelican::Application
+{
+public:
+	Bench(const Params& params, const BenchmarkLayer::Params& benchmarkParams)
+		: Application(params)
+		, m_ScenePath(benchmarkParams.scenePath)
+	{
+		PushLayer(new BenchmarkLayer(benchmarkParams));
+	}
+
+	void LoadScene(Pelican::Scene* pScene) override
+	{
+		pScene->LoadFromFile(m_ScenePath.string());
+	}
+
+private:
+	std::filesystem::path m_ScenePath;
+};
+
+Pelican::Application* Pelican::CreateApplication(ApplicationCommandLineArgs args)
+{
+	BenchmarkLayer::Params benchmarkParams{};
+	benchmarkParams.scenePath = args.GetOption("--scene", "res/scenes/demoScene.json");
+	benchmarkParams.cameraPath = args.GetOption("--path");
+	benchmarkParams.outputPath = args.GetOption("--out", "benchmark.json");
+	benchmarkParams.baselinePath = args.GetOption("--baseline");
+	benchmarkParams.captureDirectory = args.GetOption("--capture");
+	benchmarkParams.depthPrepass = args.HasFlag("--depth-prepass");
+
+	Application::Params params{};
+	params.name = "PelicanBench";
+	// --window renders to a window instead, to check what the benchmark looks at.
+	params.headless = !args.HasFlag("--window");
+
+	if (!args.ParseOption("--warmup", benchmarkParams.warmupFrames)
+		|| !args.ParseOption("--frames", benchmarkParams.frameCount)
+		|| !args.ParseOption("--timestep", benchmarkParams.timestep)
+		|| !args.ParseOption("--tolerance", benchmarkParams.tolerance)
+		|| !args.ParseOption("--capture-interval", benchmarkParams.captureInterval)
+		|| !args.ParseOption("--width", params.width)
+		|| !args.ParseOption("--height", params.height))
+		return nullptr;
+
+	return new Bench(params, benchmarkParams);
+}
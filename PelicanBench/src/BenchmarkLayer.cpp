@@ -0,0 +1,390 @@
+﻿#include "BenchmarkLayer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include <logtools.h>
+
+#include <Pelican/Core/Profiler.h>
+#include <Pelican/Core/System/FileUtils.h>
+#include <Pelican/Renderer/Camera.h>
+#include <Pelican/Renderer/GpuProfiler.h>
+#include <Pelican/Renderer/VulkanAllocator.h>
+#include <Pelican/Renderer/VulkanFrameCapture.h>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace
+{
+	using nlohmann::json;
+
+	// Differences smaller than this are noise, however big they are relative to the baseline.
+	constexpr float MIN_REGRESSION_MS = 0.05f;
+
+	constexpr int EXIT_REGRESSION = 1;
+	constexpr int EXIT_ERROR = 2;
+
+	json ToJson(const BenchmarkLayer::Stats& stats)
+	{
+		return json{
+			{ "mean", stats.mean },
+			{ "min", stats.min },
+			{ "max", stats.max },
+			{ "p50", stats.p50 },
+			{ "p95", stats.p95 },
+			{ "p99", stats.p99 },
+		};
+	}
+
+	json ToJson(const std::map<std::string, std::vector<float>>& times)
+	{
+		json passes = json::object();
+		for (const auto& [name, samples] : times)
+		{
+			json pass = ToJson(BenchmarkLayer::ComputeStats(samples));
+			pass["frames"] = samples.size();
+			passes[name] = pass;
+		}
+
+		return passes;
+	}
+
+	// Null when the member doesn't exist, so missing parts of an older baseline get skipped.
+	const json& GetMember(const json& object, const std::string& key)
+	{
+		static const json null{};
+		if (!object.is_object())
+			return null;
+
+		const auto it = object.find(key);
+		return it != object.end() ? *it : null;
+	}
+
+	void Fail(const std::string& message)
+	{
+		Logger::LogError("%s", message.c_str());
+		Pelican::Application::Get().SetExitCode(EXIT_ERROR);
+		Pelican::Application::Get().Close();
+	}
+}
+
+BenchmarkLayer::BenchmarkLayer(const Params& params)
+	: Layer("Benchmark")
+	, m_Params(params)
+{
+}
+
+void BenchmarkLayer::OnUpdate()
+{
+	using namespace Pelican;
+
+	if (m_IsDone)
+		return;
+
+	if (m_Frame == 0)
+	{
+		Start();
+		if (m_IsDone)
+			return;
+	}
+
+	// The timings only come in after the frame, so this records the previous one.
+	if (m_Frame > m_Params.warmupFrames)
+	{
+		RecordFrame();
+	}
+
+	if (m_FrameTimes.size() >= m_Params.frameCount)
+	{
+		Finish();
+		return;
+	}
+
+	// Warmup frames stay at the start of the path, the measured ones loop over it.
+	if (m_Frame == m_Params.warmupFrames)
+	{
+		Application::Get().GetCameraRecorder().StartPlayback(m_CameraPath, m_Params.timestep, true);
+	}
+
+	// The camera moves a fixed timestep every frame, so the same frames get captured every run.
+	if (!m_Params.captureDirectory.empty() && m_Params.captureInterval > 0 && m_Frame >= m_Params.warmupFrames)
+	{
+		const uint32_t measuredFrame = m_Frame - m_Params.warmupFrames;
+		if (measuredFrame % m_Params.captureInterval == 0)
+		{
+			char fileName[32];
+			snprintf(fileName, sizeof(fileName), "frame_%05u.png", measuredFrame);
+			VulkanRenderer::GetFrameCapture()->RequestCapture(m_Params.captureDirectory / fileName);
+		}
+	}
+
+	m_Frame++;
+}
+
+BenchmarkLayer::Stats BenchmarkLayer::ComputeStats(std::vector<float> samples)
+{
+	if (samples.empty())
+		return Stats{};
+
+	std::sort(samples.begin(), samples.end());
+
+	double sum = 0.0;
+	for (const float sample : samples)
+	{
+		sum += sample;
+	}
+
+	// Nearest rank, so every percentile is a frame that actually happened.
+	const auto percentile = [&samples](float fraction)
+	{
+		const size_t rank = static_cast<size_t>(std::ceil(fraction * static_cast<float>(samples.size())));
+		return samples[std::clamp<size_t>(rank, 1, samples.size()) - 1];
+	};
+
+	Stats stats{};
+	stats.mean = static_cast<float>(sum / static_cast<double>(samples.size()));
+	stats.min = samples.front();
+	stats.max = samples.back();
+	stats.p50 = percentile(0.5f);
+	stats.p95 = percentile(0.95f);
+	stats.p99 = percentile(0.99f);
+	return stats;
+}
+
+void BenchmarkLayer::Start()
+{
+	using namespace Pelican;
+
+	if (m_Params.cameraPath.empty())
+	{
+		m_CameraPath = CameraPath::CreateOrbit(glm::vec3(0.0f), 40.0f, 20.0f, 20.0f);
+	}
+	else
+	{
+		try
+		{
+			m_CameraPath.LoadFromFile(m_Params.cameraPath);
+		}
+		catch (const std::exception& e)
+		{
+			m_IsDone = true;
+			Fail(e.what());
+			return;
+		}
+	}
+
+	if (m_CameraPath.IsEmpty())
+	{
+		m_IsDone = true;
+		Fail("The camera path has no keyframes");
+		return;
+	}
+
+	Camera* pCamera = Application::Get().GetCamera();
+	pCamera->SetInputEnabled(false);
+	m_CameraPath.Apply(pCamera, m_CameraPath.GetKeyframes().front().time);
+
+	VulkanRenderer::SetDepthPrepassEnabled(m_Params.depthPrepass);
+
+	Logger::LogInfo("Benchmarking %s: %u warmup frames, %u measured frames", m_Params.scenePath.string().c_str(),
+		m_Params.warmupFrames, m_Params.frameCount);
+}
+
+void BenchmarkLayer::RecordFrame()
+{
+	using namespace Pelican;
+
+	m_FrameTimes.push_back(Time::GetDeltaTime() * 1000.0f);
+
+	// Zones with the same name add up, a pass split over the worker threads counts all of their time.
+	std::map<std::string, float> cpuTimes;
+	for (const Profiler::Zone& zone : Profiler::GetFrameZones())
+	{
+		cpuTimes[zone.name] += static_cast<float>(zone.end - zone.start) / 1'000'000.0f;
+	}
+	for (const auto& [name, time] : cpuTimes)
+	{
+		m_CpuTimes[name].push_back(time);
+	}
+
+	const GpuProfiler* pGpuProfiler = VulkanRenderer::GetGpuProfiler();
+	if (pGpuProfiler->IsSupported())
+	{
+		std::map<std::string, float> gpuTimes;
+		for (const GpuProfiler::Region& region : pGpuProfiler->GetRegions())
+		{
+			gpuTimes[region.name] += region.time;
+		}
+		for (const auto& [name, time] : gpuTimes)
+		{
+			m_GpuTimes[name].push_back(time);
+		}
+	}
+
+	uint64_t deviceUsed = 0;
+	uint64_t deviceAllocated = 0;
+	for (const VulkanAllocator::PoolStats& pool : VulkanRenderer::GetAllocator()->GetPoolStats())
+	{
+		deviceUsed += pool.stats.usedSize;
+		deviceAllocated += pool.stats.totalSize;
+	}
+	m_PeakDeviceUsed = std::max(m_PeakDeviceUsed, deviceUsed);
+	m_PeakDeviceAllocated = std::max(m_PeakDeviceAllocated, deviceAllocated);
+}
+
+void BenchmarkLayer::Finish()
+{
+	using namespace Pelican;
+
+	m_IsDone = true;
+	Application::Get().GetCameraRecorder().Stop();
+
+	json results = GetResults();
+	const Stats frameTime = ComputeStats(m_FrameTimes);
+	Logger::LogInfo("Frame time: mean %.3fms, p50 %.3fms, p95 %.3fms, p99 %.3fms",
+		frameTime.mean, frameTime.p50, frameTime.p95, frameTime.p99);
+
+	if (!m_Params.baselinePath.empty())
+	{
+		std::string contents;
+		if (!FileUtils::ReadFileSync(m_Params.baselinePath.string(), contents))
+		{
+			Fail("Failed to read the baseline " + m_Params.baselinePath.string());
+			return;
+		}
+
+		try
+		{
+			const json regressions = CompareToBaseline(results, json::parse(contents));
+			results["baseline"] = json{
+				{ "path", m_Params.baselinePath.generic_string() },
+				{ "tolerance", m_Params.tolerance },
+				{ "regressions", regressions },
+			};
+
+			for (const json& regression : regressions)
+			{
+				Logger::LogWarning("Regression in %s: %.3fms, the baseline was %.3fms",
+					regression["metric"].get<std::string>().c_str(), regression["current"].get<float>(), regression["baseline"].get<float>());
+			}
+
+			if (!regressions.empty())
+			{
+				Application::Get().SetExitCode(EXIT_REGRESSION);
+			}
+		}
+		catch (const std::exception& e)
+		{
+			Fail("Failed to compare against the baseline: "s + e.what());
+			return;
+		}
+	}
+
+	if (!FileUtils::WriteFileSync(m_Params.outputPath.string(), results.dump(2)))
+	{
+		Fail("Failed to write the results to " + m_Params.outputPath.string());
+		return;
+	}
+
+	Logger::LogInfo("Wrote the results to %s", m_Params.outputPath.string().c_str());
+	Application::Get().Close();
+}
+
+json BenchmarkLayer::GetResults() const
+{
+	using namespace Pelican;
+
+	const Window::Params window = Application::Get().GetWindow()->GetParams();
+	const vk::PhysicalDeviceProperties properties = VulkanRenderer::GetPhysicalDevice().getProperties();
+
+	json results = json::object();
+	results["scene"] = m_Params.scenePath.generic_string();
+	results["cameraPath"] = m_Params.cameraPath.empty() ? "orbit" : m_Params.cameraPath.generic_string();
+	results["device"] = std::string(properties.deviceName.data());
+	results["width"] = window.width;
+	results["height"] = window.height;
+	results["headless"] = window.headless;
+	results["warmupFrames"] = m_Params.warmupFrames;
+	results["frames"] = m_FrameTimes.size();
+	results["timestep"] = m_Params.timestep;
+	results["depthPrepass"] = m_Params.depthPrepass;
+
+	// All times are in milliseconds, memory is in bytes.
+	results["frameTime"] = ToJson(ComputeStats(m_FrameTimes));
+	results["cpu"] = ToJson(m_CpuTimes);
+	results["gpu"] = ToJson(m_GpuTimes);
+	results["memory"] = json{
+		{ "peakProcess", GetPeakProcessMemory() },
+		{ "peakDeviceUsed", m_PeakDeviceUsed },
+		{ "peakDeviceAllocated", m_PeakDeviceAllocated },
+	};
+
+	return results;
+}
+
+json BenchmarkLayer::CompareToBaseline(const json& results, const json& baseline) const
+{
+	json regressions = json::array();
+
+	const auto compare = [&](const std::string& metric, const json& current, const json& previous)
+	{
+		if (!current.is_number() || !previous.is_number())
+			return;
+
+		const float currentTime = current.get<float>();
+		const float previousTime = previous.get<float>();
+		if (currentTime > previousTime * (1.0f + m_Params.tolerance) && currentTime - previousTime > MIN_REGRESSION_MS)
+		{
+			regressions.push_back(json{ { "metric", metric }, { "baseline", previousTime }, { "current", currentTime } });
+		}
+	};
+
+	const json& frameTime = GetMember(results, "frameTime");
+	const json& baselineFrameTime = GetMember(baseline, "frameTime");
+	for (const char* stat : { "mean", "p95", "p99" })
+	{
+		compare("frameTime."s + stat, GetMember(frameTime, stat), GetMember(baselineFrameTime, stat));
+	}
+
+	// Passes only compare their mean, the tail of short passes is too noisy. Passes that were renamed or removed are skipped.
+	for (const char* category : { "cpu", "gpu" })
+	{
+		const json& passes = GetMember(results, category);
+		const json& baselinePasses = GetMember(baseline, category);
+		if (!baselinePasses.is_object())
+			continue;
+
+		for (const auto& [name, baselinePass] : baselinePasses.items())
+		{
+			compare(category + "."s + name + ".mean", GetMember(GetMember(passes, name), "mean"), GetMember(baselinePass, "mean"));
+		}
+	}
+
+	return regressions;
+}
+
+uint64_t BenchmarkLayer::GetPeakProcessMemory()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters{};
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0;
+
+	return counters.PeakWorkingSetSize;
+#else
+	rusage usage{};
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+
+	// Kilobytes on Linux.
+	return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+}
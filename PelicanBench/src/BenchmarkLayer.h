@@ -0,0 +1,81 @@
+﻿#pragma once
+#include <Pelican.h>
+
+#include <Pelican/Renderer/CameraPath.h>
+
+#include <json.hpp>
+
+// Plays a camera path back at a fixed timestep and records how long every frame took, on the CPU and on the GPU.
+// Once enough frames are measured the results are written as JSON, compared against a baseline when there is one,
+// and the application closes.
+class BenchmarkLayer final : public Pelican::Layer
+{
+public:
+	struct Params
+	{
+		std::filesystem::path scenePath{};
+		// A camera path or a recording, the camera orbits the origin without one.
+		std::filesystem::path cameraPath{};
+		std::filesystem::path outputPath{ "benchmark.json" };
+		std::filesystem::path baselinePath{};
+
+		// Frames rendered before measuring, so loading and texture streaming don't end up in the results.
+		uint32_t warmupFrames{ 100 };
+		uint32_t frameCount{ 1000 };
+		// Seconds the camera moves along the path every frame, regardless of how long the frame took.
+		float timestep{ 1.0f / 60.0f };
+		// How much slower than the baseline a metric may get before it counts as a regression, 0.1 is 10%.
+		float tolerance{ 0.1f };
+
+		// Writes every captureInterval-th measured frame to this directory, as golden images for PelicanImageDiff.
+		std::filesystem::path captureDirectory{};
+		uint32_t captureInterval{ 100 };
+
+		// Renders the scene with the depth prepass, to compare its cost against what it saves.
+		bool depthPrepass{};
+	};
+
+	struct Stats
+	{
+		float mean{};
+		float min{};
+		float max{};
+		float p50{};
+		float p95{};
+		float p99{};
+	};
+
+	explicit BenchmarkLayer(const Params& params);
+	virtual ~BenchmarkLayer() = default;
+
+	void OnUpdate() override;
+
+	[[nodiscard]] static Stats ComputeStats(std::vector<float> samples);
+
+private:
+	void Start();
+	void RecordFrame();
+	void Finish();
+
+	[[nodiscard]] nlohmann::json GetResults() const;
+	// Returns the metrics that got slower than the baseline by more than the tolerance.
+	[[nodiscard]] nlohmann::json CompareToBaseline(const nlohmann::json& results, const nlohmann::json& baseline) const;
+
+	[[nodiscard]] static uint64_t GetPeakProcessMemory();
+
+private:
+	Params m_Params;
+	Pelican::CameraPath m_CameraPath{};
+
+	uint32_t m_Frame{};
+	bool m_IsDone{};
+
+	// Milliseconds per measured frame.
+	std::vector<float> m_FrameTimes{};
+	// Per zone or region name, the time it took in every frame it showed up in.
+	std::map<std::string, std::vector<float>> m_CpuTimes{};
+	std::map<std::string, std::vector<float>> m_GpuTimes{};
+
+	uint64_t m_PeakDeviceUsed{};
+	uint64_t m_PeakDeviceAllocated{};
+};
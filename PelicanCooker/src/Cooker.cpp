@@ -0,0 +1,199 @@
+﻿#include <PelicanPCH.h>
+
+#include <charconv>
+#include <logtools.h>
+
+#include <Pelican/Assets/TextureCooker.h>
+#include <Pelican/Core/ThreadPool.h>
+#include <Pelican/Renderer/Mesh.h>
+#include <Pelican/Renderer/TextureFormat.h>
+
+// Offline texture cooker, compresses source images into KTX2 files next to them:
+// PelicanCooker [--format bc1|bc1-srgb|bc3|bc3-srgb|bc4|bc5|bc6h|bc7|bc7-srgb] [--slot albedo|normal|metallic-roughness|ao|emissive]
+//               [--quality fast|normal|high] [--no-mips] [--out directory] [--threads N] files...
+namespace
+{
+	void PrintUsage()
+	{
+		std::cout << "Usage: PelicanCooker [options] files...\n"
+			<< "  --format bc1|bc1-srgb|bc3|bc3-srgb|bc4|bc5|bc6h|bc7|bc7-srgb  Block format, picked from the source by default\n"
+			<< "  --slot albedo|normal|metallic-roughness|ao|emissive  Use the format the material slot expects\n"
+			<< "  --quality fast|normal|high  Encoding effort, normal by default\n"
+			<< "  --no-mips  Only cook the first level\n"
+			<< "  --out directory  Write the KTX2 files there instead of next to the sources\n"
+			<< "  --threads N  Worker threads besides the main one\n";
+	}
+
+	bool ParseFormat(const std::string& name, vk::Format& format)
+	{
+		// Plain names are linear, colors need the -srgb ones.
+		static const std::map<std::string, vk::Format> formats{
+			{ "bc1", vk::Format::eBc1RgbaUnormBlock },
+			{ "bc1-srgb", vk::Format::eBc1RgbaSrgbBlock },
+			{ "bc3", vk::Format::eBc3UnormBlock },
+			{ "bc3-srgb", vk::Format::eBc3SrgbBlock },
+			{ "bc4", vk::Format::eBc4UnormBlock },
+			{ "bc5", vk::Format::eBc5UnormBlock },
+			{ "bc6h", vk::Format::eBc6HUfloatBlock },
+			{ "bc7", vk::Format::eBc7UnormBlock },
+			{ "bc7-srgb", vk::Format::eBc7SrgbBlock },
+		};
+
+		const auto it = formats.find(name);
+		if (it == formats.end())
+			return false;
+
+		format = it->second;
+		return true;
+	}
+
+	bool ParseSlot(const std::string& name, vk::Format& format)
+	{
+		using Pelican::TextureSlot;
+		static const std::map<std::string, TextureSlot> slots{
+			{ "albedo", TextureSlot::ALBEDO },
+			{ "normal", TextureSlot::NORMAL },
+			{ "metallic-roughness", TextureSlot::METALLIC_ROUGHNESS },
+			{ "ao", TextureSlot::AMBIENT_OCCLUSION },
+			{ "emissive", TextureSlot::EMISSIVE },
+		};
+
+		const auto it = slots.find(name);
+		if (it == slots.end())
+			return false;
+
+		format = Pelican::TextureFormat::GetSlotFormat(it->second);
+		return true;
+	}
+
+	bool ParseThreadCount(const std::string& value, uint32_t& threadCount)
+	{
+		// Unlike stoul, this doesn't throw and doesn't wrap negative numbers around.
+		const auto [pEnd, error] = std::from_chars(value.data(), value.data() + value.size(), threadCount);
+		return error == std::errc{} && pEnd == value.data() + value.size();
+	}
+
+	bool ParseQuality(const std::string& name, Pelican::BcEncoder::Quality& quality)
+	{
+		using Pelican::BcEncoder::Quality;
+		static const std::map<std::string, Quality> qualities{
+			{ "fast", Quality::Fast },
+			{ "normal", Quality::Normal },
+			{ "high", Quality::High },
+		};
+
+		const auto it = qualities.find(name);
+		if (it == qualities.end())
+			return false;
+
+		quality = it->second;
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	using namespace Pelican;
+
+	Logger::Init();
+	Logger::Configure({ true, true });
+
+	TextureCooker::Params params{};
+	std::filesystem::path outputDirectory{};
+	uint32_t workerCount = ThreadPool::GetDefaultWorkerCount();
+	std::vector<std::filesystem::path> sources{};
+
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+
+		if (arg == "--no-mips")
+		{
+			params.generateMips = false;
+		}
+		else if (arg == "--format" && hasValue)
+		{
+			if (!ParseFormat(argv[++i], params.format))
+			{
+				Logger::LogError("Unknown format \"%s\"", argv[i]);
+				return 1;
+			}
+		}
+		else if (arg == "--slot" && hasValue)
+		{
+			if (!ParseSlot(argv[++i], params.format))
+			{
+				Logger::LogError("Unknown slot \"%s\"", argv[i]);
+				return 1;
+			}
+		}
+		else if (arg == "--quality" && hasValue)
+		{
+			if (!ParseQuality(argv[++i], params.quality))
+			{
+				Logger::LogError("Unknown quality \"%s\"", argv[i]);
+				return 1;
+			}
+		}
+		else if (arg == "--out" && hasValue)
+		{
+			outputDirectory = argv[++i];
+		}
+		else if (arg == "--threads" && hasValue)
+		{
+			if (!ParseThreadCount(argv[++i], workerCount))
+			{
+				Logger::LogError("Invalid thread count \"%s\"", argv[i]);
+				PrintUsage();
+				return 1;
+			}
+		}
+		else if (arg.starts_with("--"))
+		{
+			PrintUsage();
+			return 1;
+		}
+		else
+		{
+			sources.emplace_back(arg);
+		}
+	}
+
+	if (sources.empty())
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	if (!outputDirectory.empty())
+	{
+		std::filesystem::create_directories(outputDirectory);
+	}
+
+	ThreadPool threadPool(workerCount);
+	const TextureCooker cooker(&threadPool);
+
+	uint32_t failedCount = 0;
+	for (const std::filesystem::path& source : sources)
+	{
+		std::filesystem::path destination = TextureCooker::GetCookedPath(source);
+		if (!outputDirectory.empty())
+		{
+			destination = outputDirectory / destination.filename();
+		}
+
+		if (!cooker.Cook(source, destination, params))
+		{
+			failedCount++;
+		}
+	}
+
+	if (failedCount > 0)
+	{
+		Logger::LogError("Failed to cook %u of %u textures", failedCount, static_cast<uint32_t>(sources.size()));
+		return 1;
+	}
+
+	return 0;
+}
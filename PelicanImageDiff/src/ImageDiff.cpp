@@ -0,0 +1,218 @@
+﻿#include <PelicanPCH.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+
+#include <logtools.h>
+#include <stb_image.h>
+#include <stb_image_write.h>
+
+#include <Pelican/Renderer/ImageDiff.h>
+
+// Compares frame captures against golden images, for catching rendering regressions:
+// PelicanImageDiff [--threshold 0.1] [--tolerance 0.0] [--diff path] golden image
+// Both can be PNG files or directories, directories compare every PNG of the golden one with the one of the same name.
+// Exits with 1 when an image differs from its golden one, and with 2 when the images couldn't be compared.
+namespace
+{
+	constexpr int EXIT_DIFFERENT = 1;
+	constexpr int EXIT_ERROR = 2;
+
+	// Unlike stof, this doesn't throw and the whole argument has to be the number.
+	bool ParseFloat(const std::string& text, float& value)
+	{
+		const auto [pEnd, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+		return error == std::errc{} && pEnd == text.data() + text.size() && std::isfinite(value);
+	}
+
+	void PrintUsage()
+	{
+		std::cout << "Usage: PelicanImageDiff [options] golden image\n"
+			<< "  --threshold value  How different (0 to 1) a pixel may get before it counts as different, 0.1 by default\n"
+			<< "  --tolerance fraction  Fraction of the pixels that may differ, 0 by default\n"
+			<< "  --diff path  Write an image with the different pixels in red, a directory when comparing directories\n"
+			<< "Both the golden image and the image can be directories of PNGs.\n";
+	}
+
+	struct Image
+	{
+		std::vector<uint8_t> pixels{};
+		uint32_t width{};
+		uint32_t height{};
+	};
+
+	bool LoadPng(const std::filesystem::path& path, Image& image)
+	{
+		int width{}, height{}, channels{};
+		stbi_uc* pPixels = stbi_load(path.string().c_str(), &width, &height, &channels, STBI_rgb_alpha);
+		if (!pPixels)
+		{
+			Logger::LogError("Failed to load \"%s\": %s", path.string().c_str(), stbi_failure_reason());
+			return false;
+		}
+
+		image.width = static_cast<uint32_t>(width);
+		image.height = static_cast<uint32_t>(height);
+		image.pixels.assign(pPixels, pPixels + static_cast<size_t>(width) * height * 4);
+		stbi_image_free(pPixels);
+		return true;
+	}
+
+	// Returns 0 when the images match, or the exit code to fail with.
+	int CompareFiles(const std::filesystem::path& goldenPath, const std::filesystem::path& imagePath,
+		const std::filesystem::path& diffPath, float threshold, float tolerance)
+	{
+		using namespace Pelican;
+
+		Image golden{};
+		Image image{};
+		if (!LoadPng(goldenPath, golden) || !LoadPng(imagePath, image))
+			return EXIT_ERROR;
+
+		if (golden.width != image.width || golden.height != image.height)
+		{
+			Logger::LogError("\"%s\" is %ux%u, but its golden image is %ux%u", imagePath.string().c_str(),
+				image.width, image.height, golden.width, golden.height);
+			return EXIT_DIFFERENT;
+		}
+
+		std::vector<uint8_t> diff(diffPath.empty() ? 0 : golden.pixels.size());
+		const ImageDiff::Result result = ImageDiff::Compare(golden.pixels.data(), image.pixels.data(), golden.width, golden.height,
+			threshold, diff.empty() ? nullptr : diff.data());
+
+		const bool isDifferent = result.GetDifferentFraction() > tolerance;
+		const std::string message = "\""s + imagePath.string() + "\": " + std::to_string(result.differentPixels) + " of "
+			+ std::to_string(result.pixelCount) + " pixels differ (" + std::to_string(result.GetDifferentFraction() * 100.0f)
+			+ "%), max difference " + std::to_string(result.maxDifference) + ", mean " + std::to_string(result.meanDifference);
+		if (isDifferent)
+		{
+			Logger::LogError("%s", message.c_str());
+		}
+		else
+		{
+			Logger::LogInfo("%s", message.c_str());
+		}
+
+		// Only the images that failed get a diff, so the directory ends up holding just what needs looking at.
+		if (isDifferent && !diffPath.empty())
+		{
+			if (diffPath.has_parent_path())
+			{
+				std::filesystem::create_directories(diffPath.parent_path());
+			}
+
+			const int width = static_cast<int>(golden.width);
+			if (!stbi_write_png(diffPath.string().c_str(), width, static_cast<int>(golden.height), 4, diff.data(), width * 4))
+			{
+				Logger::LogError("Failed to write \"%s\"", diffPath.string().c_str());
+			}
+		}
+
+		return isDifferent ? EXIT_DIFFERENT : 0;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Logger::Init();
+	Logger::Configure({ true, true });
+
+	float threshold = 0.1f;
+	float tolerance = 0.0f;
+	std::filesystem::path diffPath{};
+	std::vector<std::filesystem::path> paths{};
+
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+
+		if (arg == "--threshold" && hasValue)
+		{
+			if (!ParseFloat(argv[++i], threshold))
+			{
+				Logger::LogError("Invalid threshold \"%s\"", argv[i]);
+				return EXIT_ERROR;
+			}
+		}
+		else if (arg == "--tolerance" && hasValue)
+		{
+			if (!ParseFloat(argv[++i], tolerance))
+			{
+				Logger::LogError("Invalid tolerance \"%s\"", argv[i]);
+				return EXIT_ERROR;
+			}
+		}
+		else if (arg == "--diff" && hasValue)
+		{
+			diffPath = argv[++i];
+		}
+		else if (arg.starts_with("--"))
+		{
+			PrintUsage();
+			return EXIT_ERROR;
+		}
+		else
+		{
+			paths.emplace_back(arg);
+		}
+	}
+
+	if (paths.size() != 2)
+	{
+		PrintUsage();
+		return EXIT_ERROR;
+	}
+
+	const std::filesystem::path& golden = paths[0];
+	const std::filesystem::path& image = paths[1];
+	if (!std::filesystem::is_directory(golden))
+		return CompareFiles(golden, image, diffPath, threshold, tolerance);
+
+	if (!std::filesystem::is_directory(image))
+	{
+		Logger::LogError("\"%s\" is a directory, so \"%s\" has to be one as well", golden.string().c_str(), image.string().c_str());
+		return EXIT_ERROR;
+	}
+
+	std::vector<std::filesystem::path> goldenFiles{};
+	for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(golden))
+	{
+		if (entry.is_regular_file() && entry.path().extension() == ".png")
+		{
+			goldenFiles.push_back(entry.path());
+		}
+	}
+	std::sort(goldenFiles.begin(), goldenFiles.end());
+
+	if (goldenFiles.empty())
+	{
+		Logger::LogError("\"%s\" has no golden images", golden.string().c_str());
+		return EXIT_ERROR;
+	}
+
+	int exitCode = 0;
+	uint32_t differentCount = 0;
+	for (const std::filesystem::path& goldenFile : goldenFiles)
+	{
+		const std::filesystem::path imageFile = image / goldenFile.filename();
+		if (!std::filesystem::exists(imageFile))
+		{
+			Logger::LogError("\"%s\" is missing", imageFile.string().c_str());
+			exitCode = EXIT_ERROR;
+			continue;
+		}
+
+		const int result = CompareFiles(goldenFile, imageFile, diffPath.empty() ? diffPath : diffPath / goldenFile.filename(),
+			threshold, tolerance);
+		if (result == EXIT_DIFFERENT)
+		{
+			differentCount++;
+		}
+		exitCode = std::max(exitCode, result);
+	}
+
+	Logger::LogInfo("%u of %u images differ from their golden ones", differentCount, static_cast<uint32_t>(goldenFiles.size()));
+	return exitCode;
+}
@@ -0,0 +1,44 @@
+#version 450
+
+// Depth prepass, only reads the position stream and has no fragment shader.
+// gl_Position has to be calculated exactly like in shader.vert, otherwise the eEqual depth test of the lit pass fails.
+
+struct ObjectData
+{
+    mat4 model;
+};
+
+struct DrawData
+{
+    uint objectIndex;
+    uint materialIndex;
+    vec4 boundingSphere;
+};
+
+layout(std430, set = 0, binding = 0) readonly buffer ObjectBuffer
+{
+    ObjectData objects[];
+};
+
+layout(std430, set = 0, binding = 2) readonly buffer DrawBuffer
+{
+    DrawData draws[];
+};
+
+layout(set = 0, binding = 1) uniform FrameData
+{
+    mat4 view;
+    mat4 proj;
+} frame;
+
+layout(location = 0) in vec3 inPosition;
+
+invariant gl_Position;
+
+void main()
+{
+    DrawData draw = draws[gl_InstanceIndex];
+    mat4 model = objects[draw.objectIndex].model;
+
+    gl_Position = frame.proj * frame.view * model * vec4(inPosition, 1.0);
+}
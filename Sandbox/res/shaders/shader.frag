@@ -1,4 +1,5 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
 struct DirectionalLight
 {
@@ -17,28 +18,44 @@ layout(location = 0) in vec3 vPosition;
 layout(location = 1) in vec3 vNormal;
 layout(location = 2) in vec2 vTexCoord;
 layout(location = 3) in vec3 vTangent;
+layout(location = 4) flat in uint vMaterialIndex;
 
 layout(location = 0) out vec4 fragColor;
 
-layout(set = 0, binding = 1) uniform LightInformation
+struct MaterialData
 {
-    DirectionalLight directionalLight;
-    PointLight pointLight;
-} lights;
+    vec4 albedoColor;
+    vec4 emissiveFactor;
+    float metallicFactor;
+    float roughnessFactor;
+    uint albedoTexture;
+    uint normalTexture;
+    uint metallicRoughnessTexture;
+    uint aoTexture;
+    uint emissiveTexture;
+    // 0 for materials in the depth prepass, those can't discard.
+    uint alphaTest;
+};
 
-layout(push_constant) uniform PushConstants
+// Material set, this is the bindless set from VulkanBindlessTable.
+layout(set = 1, binding = 0) uniform sampler2D textures[];
+layout(set = 1, binding = 1) uniform samplerCube cubemaps[];
+layout(std430, set = 1, binding = 2) readonly buffer MaterialBuffer
 {
-    vec3 eyePos;
-} pushConstants;
-
-layout(binding = 2) uniform sampler2D texAlbedo;
-layout(binding = 3) uniform sampler2D texNormal;
-layout(binding = 4) uniform sampler2D texMetallicRoughness;
-layout(binding = 5) uniform sampler2D texAmbientOcclusion;
+    MaterialData materials[];
+};
 
-layout(binding = 6) uniform samplerCube cubemap;
-layout(binding = 7) uniform samplerCube radianceMap;
-layout(binding = 8) uniform samplerCube irradianceMap;
+layout(set = 0, binding = 1) uniform FrameData
+{
+    mat4 view;
+    mat4 proj;
+    DirectionalLight directionalLight;
+    PointLight pointLight;
+    vec3 eyePos;
+    uint skyboxIndex;
+    uint radianceIndex;
+    uint irradianceIndex;
+} frame;
 
 const float PI = 3.14159265359;
 
@@ -110,31 +127,35 @@ vec3 Reinhard(vec3 v)
 
 void main()
 {
-    vec3 baseColor = texture(texAlbedo, vTexCoord).rgb;
-    vec3 sampledNormal = texture(texNormal, vTexCoord).rgb;
-    vec3 metallicRoughness = texture(texMetallicRoughness, vTexCoord).rgb;
-    float ao = texture(texAmbientOcclusion, vTexCoord).r;
+    // Draws of a multi draw indirect call can share a subgroup, so the material indices aren't dynamically uniform.
+    MaterialData material = materials[vMaterialIndex];
+    vec4 albedoSample = texture(textures[nonuniformEXT(material.albedoTexture)], vTexCoord);
+    vec4 normalSample = texture(textures[nonuniformEXT(material.normalTexture)], vTexCoord);
+
+    vec3 baseColor = albedoSample.rgb;
+    // BC5 normal maps only store x and y, z is rebuilt for every normal map so all of them are treated the same.
+    vec2 normalXY = normalSample.rg * 2.0f - 1.0f;
+    vec3 sampledNormal = vec3(normalSample.rg, sqrt(max(0.0f, 1.0f - dot(normalXY, normalXY))) * 0.5f + 0.5f);
+    vec3 metallicRoughness = texture(textures[nonuniformEXT(material.metallicRoughnessTexture)], vTexCoord).rgb;
+    float ao = texture(textures[nonuniformEXT(material.aoTexture)], vTexCoord).r;
 
     float metallicness = metallicRoughness.b;
     float roughness = metallicRoughness.g;
 
     // Alpha discard.
-    float alpha = texture(texAlbedo, vTexCoord).a;
-    if (alpha <= 0.1f)
-        discard;
-    
-    if (texture(texNormal, vTexCoord).a <= 0.1f)
+    float alpha = albedoSample.a;
+    if (material.alphaTest != 0 && (alpha <= 0.1f || normalSample.a <= 0.1f))
         discard;
 
     vec3 N = CalculateNormal(sampledNormal);
-    vec3 V = normalize(pushConstants.eyePos - vPosition); // View direction
+    vec3 V = normalize(frame.eyePos - vPosition); // View direction
 
-    vec3 L = normalize(lights.pointLight.position - vPosition);
+    vec3 L = normalize(frame.pointLight.position - vPosition);
     vec3 H = normalize(V + L);
 
-    float distance = length(lights.pointLight.position - vPosition);
+    float distance = length(frame.pointLight.position - vPosition);
     float attenuation = 1.0 / (distance * distance);
-    vec3 radiance = lights.pointLight.diffuse * attenuation;
+    vec3 radiance = frame.pointLight.diffuse * attenuation;
 
     vec3 F0 = vec3(0.04);
     F0 = mix(F0, baseColor, metallicness);
@@ -157,7 +178,7 @@ void main()
 
     kS = FresnelSchlick(max(dot(N, V), 0.0), F0);
     kD = 1.0 - kS;
-    vec3 irradiance = texture(irradianceMap, N).rgb;
+    vec3 irradiance = texture(cubemaps[frame.irradianceIndex], N).rgb;
     vec3 diffuse = irradiance * baseColor;
     vec3 ambient = (kD * diffuse) * ao;
 
@@ -1,11 +1,34 @@
 #version 450
 
-layout(set = 0, binding = 0) uniform UniformBufferObject
+struct ObjectData
 {
     mat4 model;
+};
+
+struct DrawData
+{
+    uint objectIndex;
+    uint materialIndex;
+    vec4 boundingSphere;
+};
+
+// Every object drawn this frame, indexed with DrawData.objectIndex.
+layout(std430, set = 0, binding = 0) readonly buffer ObjectBuffer
+{
+    ObjectData objects[];
+};
+
+// One per indirect draw, the draw's firstInstance is its index in here.
+layout(std430, set = 0, binding = 2) readonly buffer DrawBuffer
+{
+    DrawData draws[];
+};
+
+layout(set = 0, binding = 1) uniform FrameData
+{
     mat4 view;
     mat4 proj;
-} ubo;
+} frame;
 
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inNormal;
@@ -16,13 +39,21 @@ layout(location = 0) out vec3 vPosition;
 layout(location = 1) out vec3 vNormal;
 layout(location = 2) out vec2 vTexCoord;
 layout(location = 3) out vec3 vTangent;
+layout(location = 4) flat out uint vMaterialIndex;
+
+// The depth prepass has to end up with the exact same depths, see depth.vert.
+invariant gl_Position;
 
 void main()
 {
-    vPosition = (ubo.model * vec4(inPosition, 1.0)).xyz;
-    vNormal = normalize(mat3(ubo.model) * inNormal);
+    DrawData draw = draws[gl_InstanceIndex];
+    mat4 model = objects[draw.objectIndex].model;
+
+    vPosition = (model * vec4(inPosition, 1.0)).xyz;
+    vNormal = normalize(mat3(model) * inNormal);
     vTexCoord = inTexCoord;
-    vTangent = normalize(mat3(ubo.model) * inTangent);
+    vTangent = normalize(mat3(model) * inTangent);
+    vMaterialIndex = draw.materialIndex;
 
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
+    gl_Position = frame.proj * frame.view * model * vec4(inPosition, 1.0);
 }
@@ -11,7 +11,8 @@
 class Sandbox final : public Pelican::Application
 {
 public:
-	Sandbox()
+	explicit Sandbox(const Pelican::Application::Params& params)
+		: Application(params)
 	{
 		PushLayer(new SandboxLayer());
 	}
@@ -28,7 +29,25 @@ public:
 	}
 };
 
-Pelican::Application* Pelican::CreateApplication()
+Pelican::Application* Pelican::CreateApplication(ApplicationCommandLineArgs args)
 {
-	return new Sandbox();
+	Application::Params params{};
+	// --headless renders offscreen without a window, --frames N closes the application after N frames.
+	// --bench-culling only runs the frustum culling benchmark.
+	// --record-camera file records the camera until the application closes, --play-camera file replays a recording
+	// at --camera-timestep seconds per frame, --loop-camera keeps repeating it.
+	// --capture file writes frame --capture-frame (0 by default) to a PNG.
+	params.headless = args.HasFlag("--headless");
+	params.benchmarkCulling = args.HasFlag("--bench-culling");
+	params.recordCameraPath = args.GetOption("--record-camera");
+	params.playCameraPath = args.GetOption("--play-camera");
+	params.loopCameraPlayback = args.HasFlag("--loop-camera");
+	params.capturePath = args.GetOption("--capture");
+
+	if (!args.ParseOption("--frames", params.maxFrames)
+		|| !args.ParseOption("--camera-timestep", params.cameraTimestep)
+		|| !args.ParseOption("--capture-frame", params.captureFrame))
+		return nullptr;
+
+	return new Sandbox(params);
 }
@@ -69,4 +69,10 @@ group "Engine"
     include "PelicanEd"
 group ""
 
+group "Tools"
+    include "PelicanCooker"
+    include "PelicanBench"
+    include "PelicanImageDiff"
+group ""
+
 include "Sandbox"